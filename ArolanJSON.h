@@ -31,12 +31,36 @@ Structure of Standard JSON:
 */
 
 /*ArolanJSON.h: JSON Parser. Easily search through all elements.
-Creates all the JSON member structs with malloc.
+Creates all the JSON member structs with the AJContext allocator (malloc unless you set your own, see AJAllocator).
 Delete the root AJObject with DeleteAJObject().
 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h> //offsetof, for struct bindings
+#include <errno.h> //ERANGE from strtoll, for struct bindings
+#if defined(__unix__) || defined(__APPLE__) //AJ Images are mmap'd where mmap exists
+#define AJ_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(AJ_NO_PTHREADS) //the background reclaimer needs threads. define AJ_NO_PTHREADS to leave them out
+#define AJ_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(AJ_NO_REGEX) //schema "pattern"s use POSIX regex. define AJ_NO_REGEX to leave them out
+#define AJ_HAVE_REGEX
+#include <regex.h>
+#endif
+#if defined(__AVX2__) && !defined(AJ_NO_SIMD) //string escaping checks 32 chars at a time. define AJ_NO_SIMD to use plain loops
+#define AJ_HAVE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) && !defined(AJ_NO_SIMD) //or 16 at a time
+#define AJ_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 //forward declarations
 struct ArolanJSON;
@@ -47,6 +71,9 @@ struct AJArray;
 struct AJArrayElement;
 struct AJBoolean;
 struct AJKeyValuePair;
+struct AJImage;
+struct AJDocument;
+struct AJParser;
 
 #define TYPE_OBJECT 0
 #define TYPE_STRING 1
@@ -55,12 +82,68 @@ struct AJKeyValuePair;
 #define TYPE_BOOLEAN 4
 #define TYPE_NULL 5
 
+//when Lexeme isnt NULL the number was parsed with AJContext->KeepNumberLexemes on: Lexeme holds the exact source text
+//(null terminated). Keeping lexemes doesnt make conversion lazy: number is always converted at parse time (like without
+//lexemes), so code reading number directly keeps working and reading it never writes to the node. the lexeme is only used
+//for writing, and only while number still holds the value it was parsed as: storing a new value (AJNumberSetDouble, or
+//assigning number yourself) makes writers print the new value instead.
+//LAYOUT: Lexeme makes the struct 16 bytes instead of 8. An AJNumber you fill in yourself (instead of CreateAJNumber) needs
+//Lexeme = NULL, e.g. struct AJNumber n = {1.5, NULL} or {0} and then set number; a garbage Lexeme gets read as source text.
+struct AJNumber{
+  double number;
+  char * Lexeme;
+};
+//a lexeme number is one allocation: the AJNumber, the double it was parsed as (to notice stores to number), then the text
+#define AJ_LEXEME_OFFSET (sizeof(struct AJNumber) + sizeof(double))
+
+struct AJBoolean{
+  char TruthValue; // 0 abi 1
+};
+
+struct AJNull{
+  char dummy; //in practice, just check for AJNull presence
+  //NOTE: I wanted to make this an empty struct but empty struct behavior is inconsistent across compilers.
+};
+
+//room for a number, boolean or null inside the KVP / array element that holds it, so parsed scalars dont each need their own
+//heap node. Only used when AJContext->InlineScalars is on (it is off by default): then value / ArrayElement simply point at it,
+//so code that casts them to AJNumber* etc keeps working.
+//OWNERSHIP: with InlineScalars on, such a pointer is part of its KVP / element, not a node of its own. Dont pass it to AddToAJArray,
+//CreateAJKeyValuePair, AJDelete or anything else that takes ownership: take it out with DetachAJKVPValue / DetachAJArrayElementValue
+//(or copy it with AJClone) first. With it off every scalar is a node of its own and kvp->value can be moved around as before.
+union AJInlineScalar{
+  struct AJNumber Number;
+  struct AJBoolean Boolean;
+  struct AJNull Null;
+};
+
 //Reference to a collection of key value pairs
 struct AJObject{
   struct AJKeyValuePair * FirstAJKVP; //if null but an AJObject instance exists, then its an empty object
+  struct AJKeyValuePair * LastAJKVP; //so appending doesnt have to walk the whole list
   int AJKVPCount;
+  int RefCount; //0: owned by its one parent. more: shared through an AJInternTable, see Interning below
+  struct AJShape * Shape; //non-NULL: keys are shared with other objects and the KVPs are KVPBlock[0..AJKVPCount-1], in order. see Shapes below
+
+  //KVPs that were allocated together (by a builder or shaping) instead of one by one. They are freed with the block, not on their own.
+  //The list can still be edited as normal: KVPs added later are separate allocations, removed block KVPs just sit unused until the object goes.
+  struct AJKeyValuePair * KVPBlock;
+  int KVPBlockCount;
 };
 
+//key list shared by every object with the same keys in the same order (a 'hidden class'). Lives in an AJShapeTable.
+struct AJShape{
+  int KeyCount;
+  struct AJString * Keys; //the shared key strings, in order
+  int * HashIndex; //open addressing over Keys: each slot holds a key index + 1, 0 means empty
+  int HashIndexSize; //power of 2
+  unsigned int SequenceHash;
+  int * CanonicalOrder; //key indexes sorted the RFC 8785 way, filled in by the first canonical write (see Canonical JSON)
+  int HasCanonicalOrder;
+  struct AJShape * NextInBucket;
+};
+
+
 //basic building block of JSON
 struct AJKeyValuePair{
   void * key;
@@ -74,24 +157,41 @@ struct AJKeyValuePair{
   struct AJKeyValuePair * PrevAJKVP;
   struct AJKeyValuePair * NextAJKVP;
 
+  union AJInlineScalar InlineValue; //value points here when the value is a scalar that was stored inline
+
 };
 
+#define AJ_STRING_INLINE_CAPACITY 23 //strings shorter than this (not counting the null terminator) are kept inside the AJString itself (23 + Raw keeps it at 40 bytes)
+
 //simple JSON string. Didnt want to just want to use "string" bc that might cause naming conflicts with existing code
+//string always points at the (null terminated) chars: either InlineChars for short strings, or a heap buffer for long ones.
+//since string can point into the struct itself, never copy an AJString by value - make a new one from its chars instead.
 struct AJString{
   char * string;
-  int length;
-};
-
-struct AJNumber{
-  double number;
+  int length; //number of chars, not counting the null terminator
+  char Raw; //1: the chars still hold the escapes they had in the source (parsed with AJContext->EscapeStrings off) and are written as they are. 0: real chars, escaped when written
+  char InlineChars[AJ_STRING_INLINE_CAPACITY];
+  int RefCount; //0: owned by its one parent. more: shared through an AJInternTable, see Interning below
 };
 
 //JSON Array. Arrays can have multiple types within them so we have to handle that.
 struct AJArray{
   struct AJArrayElement * FirstElement;
   struct AJArrayElement * MiddleElement; //used to find indexes faster - unimplemented
-  struct AJArrayElement * LastElement; //used to find indexes faster - unimplemented
+  struct AJArrayElement * LastElement; //kept up to date, so appending is O(1)
   int length;
+
+  //packed arrays: when every element is a number they can be kept as one contiguous double array instead of an element list.
+  //if PackedNumbers isnt NULL the array is packed: FirstElement is NULL and the length numbers are in PackedNumbers.
+  //see AJContext->PackNumericArrays, GetAJArrayPackedNumbers() and UnpackAJArray().
+  double * PackedNumbers;
+  int PackedCapacity;
+
+  int RefCount; //0: owned by its one parent. more: shared through an AJInternTable, see Interning below
+
+  //elements allocated together (by a builder or unpacking) instead of one by one; works like AJObject->KVPBlock
+  struct AJArrayElement * ElementBlock;
+  int ElementBlockCount;
 };
 
   struct AJArrayElement{
@@ -101,24 +201,18 @@ struct AJArray{
     struct AJArrayElement * PrevAJElement;
     struct AJArrayElement * NextAJElement;
 
-  };
-
-struct AJBoolean{
-  char TruthValue; // 0 abi 1
-};
+    union AJInlineScalar InlineElement; //ArrayElement points here when the element is a scalar that was stored inline
 
-struct AJNull{
-  char dummy; //in practice, just check for AJNull presence
-  //NOTE: I wanted to make this an empty struct but empty struct behavior is inconsistent across compilers.
-};
+  };
 
 //internal functions and global variables
 int __internal__DefaultStringLen = 10; //when increasing the size of a string
 char __internal__DefaultDoublePrintDigitCount[] = "3"; //since ArolanJSON uses doubles internally for representing ALL numbers, we use this to format the printing
-char finalNumberFormatString[5];//<-- increase size of this array when __internal__DefaultDoublePrintDigitCount goes beyond 2 digits
 int __internal__DefaultReallocIncreaseSize = 200; //for writing AJ Types to buffer, how much do we realloc when buffer is full
 #define CASE_INSENSITIVE 0
 #define CASE_SENSITIVE 1
+#define AJ_MAX_PRINT_DIGITS 17 //most digits past the decimal point a number is printed with. a double has no more than that to give
+#define AJ_NUMBER_TEXT_SIZE (1 + 309 + 1 + AJ_MAX_PRINT_DIGITS + 1) //sign, the 309 digits of DBL_MAX, '.', the decimals and the null terminator
 //creates the double printing format with a user - specified number of digits, and writes it to a buffer.
 //params: finalFormatString (char array with length 4 minimum that the format string will be placed into)
 //numberOfDigitsPastDecPoint (null terminated string of how many digits past decimal point preferred)
@@ -148,6 +242,152 @@ void __internal__CreateNumberDigitFormat(char * finalFormatString, char * number
 
 }
 
+#if defined(_MSC_VER)
+#define AJ_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define AJ_THREAD_LOCAL __thread
+#else
+#define AJ_THREAD_LOCAL _Thread_local
+#endif
+
+/*AJAllocator: where every byte ArolanJSON allocates comes from (nodes, strings, parser scratch, and the growth of
+buffers passed to the Write functions). Defaults to malloc/realloc/free. Set one on an AJContext to route a thread's JSON
+memory to a pool, a NUMA local heap, a tracking allocator, etc.
+
+Trees dont remember which allocator made them. Delete*, RemoveFrom*, the Add* functions that grow a container and the
+Write functions that grow a buffer all use the allocator of the context that is current when they are called, so:
+  -delete, edit or grow something only with a context active whose allocator made it (the same context, or one with an
+   equal AJAllocator). Switching allocators in between hands memory to the wrong Free, which is undefined behaviour.
+  -a tree can mix allocators only if you never free it in one go: dont build a tree under one allocator and
+   add nodes to it under another.
+The things that must outlive any one context keep their own copy of the allocator instead and are safe to free anywhere:
+AJShapeTable, AJInternTable, AJTextCache, AJReclaimer queue entries (AJDeleteLater), and an AJDocument's arena.*/
+struct AJAllocator{
+  void * (*Alloc)(size_t size, void * UserPointer);
+  void * (*Realloc)(void * ptr, size_t newSize, void * UserPointer);
+  void (*Free)(void * ptr, void * UserPointer);
+  void * UserPointer; //passed back to the three functions above, e.g your pool
+};
+
+void * __internal__StdAlloc(size_t size, void * UserPointer){(void)UserPointer; return malloc(size);}
+void * __internal__StdRealloc(void * ptr, size_t newSize, void * UserPointer){(void)UserPointer; return realloc(ptr, newSize);}
+void __internal__StdFree(void * ptr, void * UserPointer){(void)UserPointer; free(ptr);}
+
+#define AJ_SHAPE_PREDICTIONS 64 //power of 2
+//every AJShape made for objects parsed while this table is AJContext->Shapes. see Shapes further down
+struct AJShapeTable{
+  struct AJShape ** Buckets;
+  int BucketCount;
+  int ShapeCount;
+  struct AJShape * Predictions[AJ_SHAPE_PREDICTIONS]; //last shape seen for each (hashed) first key, tried by the text parser before it parses the keys
+  struct AJAllocator Allocator; //shapes have to outlive whatever allocator their objects came from (an AJDocument arena for example)
+};
+
+/*AJContext: the settings that parsing and writing use. Nothing in here is shared between threads:
+every thread gets its own default context the first time it asks for one, and can switch to its own context with AJSetContext().
+The __internal__Default* globals above are only read when a context is initialized, so set them once at startup (before
+spawning threads) if you want different defaults everywhere.
+There are no scratch buffers in here on purpose: the writers format numbers into a small buffer on their own stack, which is
+already reentrant, while a buffer in the context would turn sharing one explicit context between threads into a race.*/
+struct AJContext{
+  int DefaultStringLen; //when increasing the size of a string
+  int DefaultReallocIncreaseSize; //for writing AJ Types to buffer, how much do we realloc when buffer is full
+  char DefaultDoublePrintDigitCount[4]; //digits printed past the decimal point, as a string. change with AJSetContextNumberPrintDigitCount()
+  char NumberFormatString[8]; //printf format built from DefaultDoublePrintDigitCount. built once, not on every number.
+  struct AJAllocator Allocator;
+  char PackNumericArrays; //1: parse arrays made only of numbers into AJArray->PackedNumbers. off by default since packed arrays have no element list
+  char KeepNumberLexemes; //1: keep each number's source text next to its value (still converted at parse time); writers copy the text back out as is (until the value is changed). each number is then a node of its own, never inline or packed
+  struct AJShapeTable * Shapes; //non-NULL: objects parsed under this context share key lists (AJShape) from this table. see CreateAJShapeTable()
+  struct AJInternTable * Intern; //non-NULL: parsers point repeated strings and small subtrees at one shared node. see CreateAJInternTable()
+  char EscapeStrings; //1: the text parser turns \n, \", \uXXXX etc into the real chars and the text writers escape them again. 0: strings are kept and written exactly as in the source (see AJString->Raw); strings made in code are still escaped
+  char EscapeNonAscii; //1: when escaping, also write non ASCII (UTF-8) chars as \uXXXX so the output is plain ASCII
+  struct AJTextCache * TextCache; //non-NULL: text writers copy the last text of containers that havent changed since instead of rewriting them. see CreateAJTextCache()
+  struct AJSourceMap * SourceMap; //non-NULL: the text parser records where each container is in the text, so ReparseAJObject() can redo only the edited part
+  char InlineScalars; //1: the parsers and builders store numbers, booleans and nulls inside their KVP / element (see AJInlineScalar). off by default
+};
+
+//puts the defaults into ctx
+void AJInitContext(struct AJContext * ctx){
+  ctx->DefaultStringLen = __internal__DefaultStringLen;
+  ctx->DefaultReallocIncreaseSize = __internal__DefaultReallocIncreaseSize;
+  int digits = atoi(__internal__DefaultDoublePrintDigitCount);
+  snprintf(ctx->DefaultDoublePrintDigitCount, sizeof(ctx->DefaultDoublePrintDigitCount), "%d", digits < 0 ? 0 : digits > AJ_MAX_PRINT_DIGITS ? AJ_MAX_PRINT_DIGITS : digits);
+  __internal__CreateNumberDigitFormat(ctx->NumberFormatString, ctx->DefaultDoublePrintDigitCount);
+  ctx->Allocator.Alloc = __internal__StdAlloc;
+  ctx->Allocator.Realloc = __internal__StdRealloc;
+  ctx->Allocator.Free = __internal__StdFree;
+  ctx->Allocator.UserPointer = NULL;
+  ctx->PackNumericArrays = 0;
+  ctx->KeepNumberLexemes = 0;
+  ctx->Shapes = NULL;
+  ctx->Intern = NULL;
+  ctx->EscapeStrings = 0;
+  ctx->EscapeNonAscii = 0;
+  ctx->TextCache = NULL;
+  ctx->SourceMap = NULL;
+  ctx->InlineScalars = 0;
+}
+
+//numberOfDigitsPastDecPoint: 0 - 17 (AJ_MAX_PRINT_DIGITS). anything else is ignored
+void AJSetContextNumberPrintDigitCount(struct AJContext * ctx, int numberOfDigitsPastDecPoint){
+  if(numberOfDigitsPastDecPoint < 0 || numberOfDigitsPastDecPoint > AJ_MAX_PRINT_DIGITS){return;}
+  snprintf(ctx->DefaultDoublePrintDigitCount, sizeof(ctx->DefaultDoublePrintDigitCount), "%d", numberOfDigitsPastDecPoint);
+  __internal__CreateNumberDigitFormat(ctx->NumberFormatString, ctx->DefaultDoublePrintDigitCount);
+}
+
+AJ_THREAD_LOCAL struct AJContext __internal__ThreadDefaultContext;
+AJ_THREAD_LOCAL char __internal__ThreadDefaultContextReady = 0;
+AJ_THREAD_LOCAL struct AJContext * __internal__ThreadContext = NULL;
+
+//the context the calling thread is using right now
+static inline struct AJContext * AJGetContext(){
+  if(__internal__ThreadContext != NULL){return __internal__ThreadContext;}
+  if(!__internal__ThreadDefaultContextReady){
+    AJInitContext(&__internal__ThreadDefaultContext);
+    __internal__ThreadDefaultContextReady = 1;
+  }
+  return &__internal__ThreadDefaultContext;
+}
+
+//makes ctx the calling thread's context (NULL goes back to the thread's default one). returns the context it replaced,
+//so a library can swap its own context in and put the caller's back afterwards.
+struct AJContext * AJSetContext(struct AJContext * ctx){
+  struct AJContext * previous = __internal__ThreadContext;
+  __internal__ThreadContext = ctx;
+  return previous;
+}
+
+//deprecated: the printf format numbers are written with used to live in this global. it is per context now,
+//so this just names the calling thread's current one. use AJSetContextNumberPrintDigitCount() to change it
+#define finalNumberFormatString (AJGetContext()->NumberFormatString)
+
+//all allocations inside ArolanJSON go through these three
+static inline void * __internal__Malloc(size_t size){
+  struct AJAllocator * a = &AJGetContext()->Allocator;
+  return a->Alloc(size, a->UserPointer);
+}
+
+static inline void * __internal__Realloc(void * ptr, size_t newSize){
+  struct AJAllocator * a = &AJGetContext()->Allocator;
+  return a->Realloc(ptr, newSize, a->UserPointer);
+}
+
+static inline void __internal__Free(void * ptr){
+  if(ptr == NULL){return;}
+  struct AJAllocator * a = &AJGetContext()->Allocator;
+  a->Free(ptr, a->UserPointer);
+}
+
+//allocate/free with the calling thread's allocator. Use these for buffers you hand to the Write functions (they may be grown
+//with AJGetContext()->Allocator), and to free buffers ArolanJSON gives back (e.g LoadJSONFromFile), when you set a custom allocator.
+void * AJAlloc(size_t size){
+  return __internal__Malloc(size);
+}
+
+void AJFree(void * ptr){
+  __internal__Free(ptr);
+}
+
 int __internal__StringCompare(char * str1, char * str2, int caseSensitive){
   // Handle null pointer cases
   if(str1 == str2){ return 1;}  // Both same pointer (including both NULL)
@@ -195,27 +435,28 @@ int __internal__StringCopy(char * src, char * dest){
 }
 
 char * __internal__AddQuotesToString(char * unquotedString, char QuoteType){
-  char * newString = (char*)malloc(sizeof(char) * __internal__DefaultStringLen);
-  int newStringLen = __internal__DefaultStringLen;
+  struct AJContext * ctx = AJGetContext();
+  char * newString = (char*)__internal__Malloc(sizeof(char) * ctx->DefaultStringLen);
+  int newStringLen = ctx->DefaultStringLen;
   newString[0] = QuoteType;
   int idx = 1;
   char currentUnquotedStringChar;
   while(1){
     if(idx >= newStringLen - 1){
-      newString = (char*)realloc(newString, newStringLen + __internal__DefaultStringLen);
-      newStringLen+=__internal__DefaultStringLen;
+      newString = (char*)__internal__Realloc(newString, newStringLen + ctx->DefaultStringLen);
+      newStringLen+=ctx->DefaultStringLen;
     }
     currentUnquotedStringChar = unquotedString[idx-1];
     if(currentUnquotedStringChar == '\0'){
       //add closing quote and null terminator
       if(idx - newStringLen - 1 < 2){
-        newString = (char*)realloc(newString, newStringLen + __internal__DefaultStringLen);
-        newStringLen+=__internal__DefaultStringLen;
+        newString = (char*)__internal__Realloc(newString, newStringLen + ctx->DefaultStringLen);
+        newStringLen+=ctx->DefaultStringLen;
       }
       newString[idx++] = QuoteType;
       newString[idx] = '\0';
       //make as small as possible
-      newString = (char*)realloc(newString, idx+1);
+      newString = (char*)__internal__Realloc(newString, idx+1);
       return newString;
     }
     newString[idx] = currentUnquotedStringChar;
@@ -225,14 +466,39 @@ char * __internal__AddQuotesToString(char * unquotedString, char QuoteType){
 
 //mallocs and copies a string, then returns
 char * __internal__CreateAndCopy(char * src){
-  char * ret = (char *)malloc(strlen(src) + 1);
+  char * ret = (char *)__internal__Malloc(strlen(src) + 1);
   strcpy(ret, src);
   return ret;
 }
 
 //compare string but pointer logic is done for you.
 int compareStringToAJString(char * inputstr, struct AJString * ajstr){
-  return __internal__StringCompare(inputstr, ajstr->string, CASE_SENSITIVE);
+  if(inputstr == NULL || ajstr->string == NULL){return inputstr == ajstr->string;}
+  //ajstr knows its length, so most mismatches end here without touching the chars
+  if(inputstr[0] != ajstr->string[0]){return 0;}
+  if((int)strlen(inputstr) != ajstr->length){return 0;}
+  return memcmp(inputstr, ajstr->string, ajstr->length) == 0 ? 1 : 0;
+}
+
+//points the AJString at 'length' chars copied from bytes (null terminated). Short strings stay inline, only long ones get a heap buffer.
+//bytes doesnt have to be null terminated.
+void __internal__SetAJStringChars(struct AJString * ajstr, const char * bytes, int length){
+  if(length < AJ_STRING_INLINE_CAPACITY){
+    ajstr->string = ajstr->InlineChars;
+  }else{
+    ajstr->string = (char *)__internal__Malloc(length + 1);
+  }
+  memcpy(ajstr->string, bytes, length);
+  ajstr->string[length] = '\0';
+  ajstr->length = length;
+  ajstr->Raw = 0;
+}
+
+//frees the chars of an AJString if they are on the heap (not the AJString itself)
+static inline void __internal__FreeAJStringChars(struct AJString * ajstr){
+  if(ajstr->string != ajstr->InlineChars){
+    __internal__Free(ajstr->string);
+  }
 }
 
 //Primitive types are types that hold 1 value at a time; that is, not an array or object.
@@ -320,6 +586,9 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
 struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString, int * returnIdx);
 struct AJBoolean * ParseNewAJBoolean(int indexOfLetterTOrF, char * JSONString, int * returnIdx);
 struct AJNull * ParseNewAJNull(int indexOfLetterN, char * JSONString, int * returnIdx);
+double __internal__ParseNumberValue(int indexOfFirstDigit, char * JSONString, int * returnIdx);
+double AJNumberGetDouble(struct AJNumber * ayomide);
+char __internal__ParseBooleanValue(int indexOfLetterTOrF, char * JSONString, int * returnIdx);
 void PrettyPrintKVP(struct AJKeyValuePair * kvp, int indentationCount);
 void PrettyPrintAJArray(struct AJArray * aja, int indentationCount);
 void PrettyPrintAJObject(struct AJObject * ajo, int indentationCount);
@@ -328,11 +597,29 @@ void DeleteAJObject(struct AJObject * ajo);
 void * GetElementFromObject(int startIndex, void * startKVP, int destIndex, int iterableType);
 struct AJArrayElement * GetElementFromArrayIndex(struct AJArrayElement * startElement, int startIndex,  int destIndex);
 struct AJKeyValuePair * GetKVPFromObjectIndex(struct AJKeyValuePair * startKVP, int startIndex,  int destIndex);
-void RemoveFromAJArray(struct AJArray * ajarr, int idx);
-void AddToAJArray(struct AJArray * ajarr, void * JSONElement, int elementType, int idx);
+int RemoveFromAJArray(struct AJArray * ajarr, int idx);
+int AddToAJArray(struct AJArray * ajarr, void * JSONElement, int elementType, int idx);
 void AJDelete(void * aj, int elementType);
+void __internal__ShapeAJObject(struct AJShapeTable * table, struct AJObject * ajo);
+void DetachAJObjectShape(struct AJObject * ajo);
+struct AJString * __internal__MatchShapeKey(struct AJShapeTable * table, struct AJShape ** predicted, int keyIndex, char * JSONString, int i, int * closingQuote);
+int GetAJShapeKeyIndex(struct AJShape * shape, char * key);
+struct AJString * __internal__InternAJStringBytes(struct AJInternTable * table, char * bytes, int length);
+void * __internal__InternAJContainer(struct AJInternTable * table, void * node, int type);
+void AJMarkDirty(void * node);
+void __internal__ForgetCachedText(void * node);
+void __internal__UnlinkAJArrayElement(struct AJArray * ajarr, struct AJArrayElement * el);
+void __internal__DeleteUnlinkedAJArrayElement(struct AJArray * ajarr, struct AJArrayElement * el);
+void __internal__ForgetCachedSubtree(void * node, int type);
+int __internal__WriteCachedText(struct AJTextCache * cache, void * node, char ** originalBufferPointer, int * buflength, int positionToStartWriting);
+void __internal__StoreCachedText(struct AJTextCache * cache, void * node, char * text, int length);
+void __internal__NoteCachedChild(struct AJTextCache * cache, void * child, void * parent);
+int __internal__BeginSourceEntry(struct AJSourceMap * map, void * node, int type, int start);
+void __internal__EndSourceEntry(struct AJSourceMap * map, int entry, int end);
+void * __internal__ReuseSourceNode(struct AJSourceMap * map, int start, int type, int * returnIdx);
 
 struct AJObject * CreateAJObject();
+int AddToAJObjectBeforeKVP(struct AJObject * ajo, struct AJKeyValuePair * ajkvp, struct AJKeyValuePair * beforeThis);
 struct AJString * CreateAJString(char * string);
 struct AJNumber * CreateAJNumber(float num);
 struct AJArray * CreateAJArray();
@@ -340,54 +627,212 @@ struct AJBoolean * CreateAJBoolean();
 struct AJNull * CreateAJNull();
 struct AJKeyValuePair * CreateAJKeyValuePair(void * objectKey, int KeyType, void * objectValue, int ValueType);
 
-void AddToAJObject(struct AJObject * ajo, struct AJKeyValuePair * newAJKVP, int position);
-void RemoveFromAJObject(void * key, int KeyType, void * value, int ValueType);
-void RemoveFromAJArray(struct AJArray * ajarr, int idx);
-void AddToAJArray(struct AJArray * ajarr, void * JSONElement, int elementType, int idx);
+int AddToAJObject(struct AJObject * ajo, struct AJKeyValuePair * newAJKVP, int position);
+int RemoveFromAJObject(struct AJObject * ajo, int position);
+int RemoveKVPFromAJObject(struct AJObject * ajo, struct AJKeyValuePair * ajkvp);
+int RemoveFromAJArray(struct AJArray * ajarr, int idx);
+int AddToAJArray(struct AJArray * ajarr, void * JSONElement, int elementType, int idx);
 
 int WriteAJArrayAsStringToBuffer(struct AJArray * aja, char ** originalBufferPointer, int * buflength, int positionToStartWriting);
 int WriteAJObjectAsStringToBuffer(struct AJObject * ajo, char ** originalBufferPointer, int * buflength, int positionToStartWriting);
+int WriteAJArrayAsMsgPackToBuffer(struct AJArray * aja, char ** originalBufferPointer, int * buflength, int positionToStartWriting);
+int WriteAJObjectAsMsgPackToBuffer(struct AJObject * ajo, char ** originalBufferPointer, int * buflength, int positionToStartWriting);
 
 struct AJObject * CreateAJObject(){
-  struct AJObject * adedoyin = (struct AJObject *)malloc(sizeof(struct AJObject));
+  struct AJObject * adedoyin = (struct AJObject *)__internal__Malloc(sizeof(struct AJObject));
   adedoyin->AJKVPCount = 0;
   adedoyin->FirstAJKVP = NULL;
+  adedoyin->LastAJKVP = NULL;
+  adedoyin->Shape = NULL;
+  adedoyin->RefCount = 0;
+  adedoyin->KVPBlock = NULL;
+  adedoyin->KVPBlockCount = 0;
   return adedoyin;
 }
 
 struct AJString * CreateAJString(char * string){
-  struct AJString * pelumi = (struct AJString *)malloc(sizeof(struct AJString));
-  pelumi->string = __internal__CreateAndCopy(string);
-  pelumi->length = __internal__DefaultStringLen;
+  struct AJString * pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+  __internal__SetAJStringChars(pelumi, string, strlen(string));
+  pelumi->RefCount = 0;
   return pelumi;
 }
 
 struct AJNumber * CreateAJNumber(float num){
-  struct AJNumber * ayomide = (struct AJNumber *)malloc(sizeof(struct AJNumber));
+  struct AJNumber * ayomide = (struct AJNumber *)__internal__Malloc(sizeof(struct AJNumber));
   ayomide->number = num;
+  ayomide->Lexeme = NULL;
   return ayomide;
 }
 
+//the source text of a lexeme number, or NULL if it has none or number was changed since it was parsed
+static inline char * __internal__CurrentLexeme(struct AJNumber * ayomide){
+  if(ayomide->Lexeme == NULL){return NULL;}
+  double parsedAs;
+  memcpy(&parsedAs, ayomide->Lexeme - sizeof(double), sizeof(double));
+  return memcmp(&parsedAs, &ayomide->number, sizeof(double)) == 0 ? ayomide->Lexeme : NULL;
+}
+
+//value of an AJNumber as a double. only reads, so any number of threads can call it on the same tree.
+double AJNumberGetDouble(struct AJNumber * ayomide){
+  return ayomide->number;
+}
+
+//value of an AJNumber as a 64 bit integer. integer lexemes are read exactly (ids past 2^53 survive); anything else is the double truncated.
+long long AJNumberGetInt64(struct AJNumber * ayomide){
+  char * lexeme = __internal__CurrentLexeme(ayomide);
+  if(lexeme != NULL && strpbrk(lexeme, ".eE") == NULL){
+    return strtoll(lexeme, NULL, 10);
+  }
+  return (long long)AJNumberGetDouble(ayomide);
+}
+
+//give an AJNumber a new value. drops its lexeme (if it had one), so writers print the new value instead of the old text.
+void AJNumberSetDouble(struct AJNumber * ayomide, double num){
+  ayomide->number = num;
+  ayomide->Lexeme = NULL; //the lexeme chars live in the same allocation as the AJNumber, nothing to free
+  AJMarkDirty(ayomide);
+}
+
 struct AJArray * CreateAJArray(){
-  struct AJArray * opeyemi = (struct AJArray *)malloc(sizeof(struct AJArray));
+  struct AJArray * opeyemi = (struct AJArray *)__internal__Malloc(sizeof(struct AJArray));
   opeyemi->length = 0;
   opeyemi->FirstElement = NULL;
+  opeyemi->MiddleElement = NULL;
+  opeyemi->LastElement = NULL;
+  opeyemi->PackedNumbers = NULL;
+  opeyemi->PackedCapacity = 0;
+  opeyemi->RefCount = 0;
+  opeyemi->ElementBlock = NULL;
+  opeyemi->ElementBlockCount = 0;
   return opeyemi;
 }
 
+//1 if el is part of aja's ElementBlock (so it must not be freed on its own)
+static inline int __internal__IsInElementBlock(struct AJArray * aja, struct AJArrayElement * el){
+  return aja->ElementBlock != NULL && el >= aja->ElementBlock && el < aja->ElementBlock + aja->ElementBlockCount;
+}
+
+//1 if kvp is part of ajo's KVPBlock (so it must not be freed on its own)
+static inline int __internal__IsInKVPBlock(struct AJObject * ajo, struct AJKeyValuePair * kvp){
+  return ajo->KVPBlock != NULL && kvp >= ajo->KVPBlock && kvp < ajo->KVPBlock + ajo->KVPBlockCount;
+}
+
+//adds num at the end of a packed (or still empty) array's PackedNumbers
+void __internal__AppendPackedNumber(struct AJArray * aja, double num){
+  if(aja->length == aja->PackedCapacity){
+    aja->PackedCapacity = aja->PackedCapacity == 0 ? 8 : aja->PackedCapacity * 2;
+    aja->PackedNumbers = (double *)__internal__Realloc(aja->PackedNumbers, sizeof(double) * aja->PackedCapacity);
+  }
+  aja->PackedNumbers[aja->length++] = num;
+}
+
+//where a scalar that was filled in at inlineSlot ends up: the slot itself with AJContext->InlineScalars on, else a node of its own (a copy)
+void * __internal__PlaceScalar(union AJInlineScalar * inlineSlot, int type){
+  if(AJGetContext()->InlineScalars){return (void *)inlineSlot;}
+  if(type == TYPE_NULL){return (void *)CreateAJNull();}
+  size_t size = type == TYPE_NUMBER ? sizeof(struct AJNumber) : sizeof(struct AJBoolean);
+  void * node = __internal__Malloc(size);
+  memcpy(node, inlineSlot, size);
+  return node;
+}
+
+//turns a packed array back into a normal element list (all elements in one block, numbers inline with InlineScalars). returns the last element.
+struct AJArrayElement * __internal__UnpackAJArray(struct AJArray * aja){
+  struct AJArrayElement * previous = NULL;
+  aja->ElementBlock = aja->length == 0 ? NULL : (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement) * aja->length);
+  aja->ElementBlockCount = aja->length;
+  for(int i = 0; i < aja->length; i++){
+    struct AJArrayElement * el = &aja->ElementBlock[i];
+    el->InlineElement.Number.number = aja->PackedNumbers[i];
+    el->InlineElement.Number.Lexeme = NULL;
+    el->ArrayElement = __internal__PlaceScalar(&el->InlineElement, TYPE_NUMBER);
+    el->ArrayElementType = TYPE_NUMBER;
+    el->PrevAJElement = previous;
+    el->NextAJElement = NULL;
+    if(previous != NULL){
+      previous->NextAJElement = el;
+    }else{
+      aja->FirstElement = el;
+    }
+    previous = el;
+  }
+  __internal__Free(aja->PackedNumbers);
+  aja->PackedNumbers = NULL;
+  aja->PackedCapacity = 0;
+  aja->LastElement = previous;
+  return previous;
+}
+
+//converts a packed array to the normal element list form. does nothing to arrays that arent packed.
+//AddToAJArray does this for you; call it yourself before walking FirstElement of an array that might be packed.
+void UnpackAJArray(struct AJArray * aja){
+  if(aja->PackedNumbers != NULL){
+    __internal__UnpackAJArray(aja);
+  }
+}
+
+//PackAJArray. ownsNumbers: a parser just made the number nodes and nobody else can hold them, so they can be packed (and freed) too
+int __internal__PackAJArray(struct AJArray * aja, int ownsNumbers){
+  if(aja->PackedNumbers != NULL){return 1;}
+  if(aja->length == 0 || aja->RefCount > 0){return 0;} //others may be walking a shared array's elements
+  struct AJArrayElement * current = aja->FirstElement;
+  while(current != NULL){
+    if(current->ArrayElementType != TYPE_NUMBER){return 0;}
+    if(current->ArrayElement != (void*)&current->InlineElement && (!ownsNumbers || __internal__CurrentLexeme((struct AJNumber *)current->ArrayElement) != NULL)){return 0;}
+    current = current->NextAJElement;
+  }
+  aja->PackedCapacity = aja->length;
+  aja->PackedNumbers = (double *)__internal__Malloc(sizeof(double) * aja->length);
+  current = aja->FirstElement;
+  for(int i = 0; i < aja->length; i++){
+    aja->PackedNumbers[i] = AJNumberGetDouble((struct AJNumber*)(current->ArrayElement));
+    struct AJArrayElement * next = current->NextAJElement;
+    __internal__ForgetCachedText(current->ArrayElement);
+    if(current->ArrayElement != (void*)&current->InlineElement){
+      __internal__Free(current->ArrayElement);
+    }
+    if(!__internal__IsInElementBlock(aja, current)){
+      __internal__Free(current);
+    }
+    current = next;
+  }
+  __internal__Free(aja->ElementBlock);
+  aja->ElementBlock = NULL;
+  aja->ElementBlockCount = 0;
+  aja->FirstElement = NULL;
+  aja->LastElement = NULL;
+  return 1;
+}
+
+//packs aja if every element is a number stored inline. returns 1 if aja is packed afterwards.
+//packing frees aja's element list, so AJArrayElement pointers you got from it are invalid afterwards. numbers that are
+//nodes of their own (CreateAJNumber, parsed with KeepNumberLexemes or without InlineScalars) may be held elsewhere, so such
+//arrays are left as they are.
+int PackAJArray(struct AJArray * aja){
+  return __internal__PackAJArray(aja, 0);
+}
+
+//direct access to a packed array's numbers (length through 'length'). returns NULL if aja isnt packed.
+//you can read and write the numbers in place; use AddNumberToAJArray / RemoveFromAJArray to change how many there are.
+double * GetAJArrayPackedNumbers(struct AJArray * aja, int * length){
+  if(length != NULL){*length = aja->PackedNumbers != NULL ? aja->length : 0;}
+  return aja->PackedNumbers;
+}
+
 struct AJBoolean * CreateAJBoolean(char * val){
-  struct AJBoolean * femi = (struct AJBoolean *)malloc(sizeof(struct AJBoolean));
+  struct AJBoolean * femi = (struct AJBoolean *)__internal__Malloc(sizeof(struct AJBoolean));
   femi->TruthValue = 0;
   if(val[0] == 't' || val[0] == 'T'){femi->TruthValue = 1;}
   return femi;
 }
 
 struct AJNull * CreateAJNull(){
-  return (struct AJNull *)malloc(sizeof(struct AJNull));
+  return (struct AJNull *)__internal__Malloc(sizeof(struct AJNull));
 }
 
+//the KVP owns objectKey and objectValue afterwards; neither can be an inline scalar of another container (see AJInlineScalar)
 struct AJKeyValuePair * CreateAJKeyValuePair(void * objectKey, int KeyType, void * objectValue, int ValueType){
-  struct AJKeyValuePair * joju = (struct AJKeyValuePair *)malloc(sizeof(struct AJKeyValuePair));
+  struct AJKeyValuePair * joju = (struct AJKeyValuePair *)__internal__Malloc(sizeof(struct AJKeyValuePair));
   joju->PrevAJKVP = NULL;
   joju->NextAJKVP = NULL;
   joju->key = objectKey;
@@ -398,264 +843,539 @@ struct AJKeyValuePair * CreateAJKeyValuePair(void * objectKey, int KeyType, void
   return joju;
 }
 
-void AddToAJObject(struct AJObject * ajo, struct AJKeyValuePair * ajkvp, int position){
-  ajkvp->NextAJKVP = NULL;
-  ajkvp->PrevAJKVP = NULL;
+//puts ajkvp into ajo right before beforeThis (a KVP of ajo), or at the end when beforeThis is NULL. O(1).
+//returns 1, or 0 without doing anything if ajo is shared (RefCount > 0, see Interning); ajkvp is still yours then.
+int AddToAJObjectBeforeKVP(struct AJObject * ajo, struct AJKeyValuePair * ajkvp, struct AJKeyValuePair * beforeThis){
+  if(ajo->RefCount > 0){return 0;}
+  if(ajo->Shape != NULL){ //its keys are about to differ from its shape's
+    DetachAJObjectShape(ajo);
+  }
+  ajkvp->NextAJKVP = beforeThis;
+  if(beforeThis == NULL){//append to end
+    ajkvp->PrevAJKVP = ajo->LastAJKVP;
+    if(ajo->LastAJKVP != NULL){
+      ajo->LastAJKVP->NextAJKVP = ajkvp;
+    }else{
+      ajo->FirstAJKVP = ajkvp;
+    }
+    ajo->LastAJKVP = ajkvp;
+  }else{
+    //'put - behind' approach
+    ajkvp->PrevAJKVP = beforeThis->PrevAJKVP;
+    if(beforeThis->PrevAJKVP != NULL){
+      beforeThis->PrevAJKVP->NextAJKVP = ajkvp;
+    }else{
+      ajo->FirstAJKVP = ajkvp;
+    }
+    beforeThis->PrevAJKVP = ajkvp;
+  }
+  ajo->AJKVPCount++;
+  AJMarkDirty(ajo);
+  return 1;
+}
+
+//makes ajkvp the new positionth KVP of ajo. Appending (position == AJKVPCount) is O(1); anything else walks from whichever end is closer.
+//returns 1, or 0 (and ajkvp is still yours) for a bad position or a shared ajo
+int AddToAJObject(struct AJObject * ajo, struct AJKeyValuePair * ajkvp, int position){
   //check to make sure we arent appending (position == ajo->AJKVPCount)
-  if(position > ajo->AJKVPCount || position < 0){
-    return;
+  if(position > ajo->AJKVPCount || position < 0 || ajo->RefCount > 0){
+    return 0;
   }
 
-  if(ajo->AJKVPCount == 0){
-    ajo->FirstAJKVP = ajkvp;
-    ajo->AJKVPCount++;
-    return;
+  struct AJKeyValuePair * beforeThis = NULL;
+  if(position < ajo->AJKVPCount / 2){
+    beforeThis = GetKVPFromObjectIndex(ajo->FirstAJKVP, 0, position);
+  }else if(position < ajo->AJKVPCount){
+    beforeThis = ajo->LastAJKVP;
+    for(int i = ajo->AJKVPCount - 1; i > position; i--){
+      beforeThis = beforeThis->PrevAJKVP;
+    }
   }
+  return AddToAJObjectBeforeKVP(ajo, ajkvp, beforeThis);
+}
 
-  struct AJKeyValuePair * adjacentKVP;
-  if(position == ajo->AJKVPCount){//append to end
-    adjacentKVP = GetKVPFromObjectIndex(ajo->FirstAJKVP, 0, position-1);
-    adjacentKVP->NextAJKVP = ajkvp;
-    ajkvp->PrevAJKVP = adjacentKVP;
-    ajkvp->NextAJKVP = NULL;
-    ajo->AJKVPCount++;
+//takes ajkvp (a KVP of ajo) out of ajo's list, without deleting anything
+void __internal__UnlinkAJKVP(struct AJObject * ajo, struct AJKeyValuePair * ajkvp){
+  if(ajo->Shape != NULL){ //its keys are about to differ from its shape's
+    DetachAJObjectShape(ajo);
+  }
+  if(ajkvp->PrevAJKVP != NULL){
+    ajkvp->PrevAJKVP->NextAJKVP = ajkvp->NextAJKVP;
   }else{
-    //'put - behind' approach
-    adjacentKVP = GetKVPFromObjectIndex(ajo->FirstAJKVP, 0, position);
-    struct AJKeyValuePair * beforeThis = adjacentKVP->PrevAJKVP;
-    if(beforeThis != NULL){
-      beforeThis->NextAJKVP = ajkvp;
-      ajkvp->PrevAJKVP = beforeThis;
-    }
-    ajkvp->NextAJKVP = adjacentKVP;
-    adjacentKVP->PrevAJKVP = ajkvp;
+    ajo->FirstAJKVP = ajkvp->NextAJKVP;
+  }
+  if(ajkvp->NextAJKVP != NULL){
+    ajkvp->NextAJKVP->PrevAJKVP = ajkvp->PrevAJKVP;
+  }else{
+    ajo->LastAJKVP = ajkvp->PrevAJKVP;
+  }
+  ajo->AJKVPCount--;
+  AJMarkDirty(ajo);
+}
+
+//deletes a KVP that was unlinked from ajo, along with its key and value
+void __internal__DeleteUnlinkedAJKVP(struct AJObject * ajo, struct AJKeyValuePair * ajkvp){
+  AJDelete(ajkvp->key, ajkvp->KeyType);
+  if(ajkvp->value != (void*)&ajkvp->InlineValue){
+    AJDelete(ajkvp->value, ajkvp->ValueType);
+  }else{
+    __internal__ForgetCachedText(ajkvp->value);
+  }
+  if(!__internal__IsInKVPBlock(ajo, ajkvp)){
+    __internal__Free(ajkvp);
+  }
+}
+
+//takes ajkvp (a KVP of ajo) out of ajo and deletes it along with its key and value. O(1). returns 1, or 0 without doing anything if ajo is shared
+int RemoveKVPFromAJObject(struct AJObject * ajo, struct AJKeyValuePair * ajkvp){
+  if(ajo->RefCount > 0){return 0;}
+  __internal__UnlinkAJKVP(ajo, ajkvp);
+  __internal__DeleteUnlinkedAJKVP(ajo, ajkvp);
+  return 1;
+}
+
+//remove the positionth KVP of ajo. returns 1, or 0 for a bad position or a shared ajo
+int RemoveFromAJObject(struct AJObject * ajo, int position){
+  if(position < 0 || position >= ajo->AJKVPCount || ajo->RefCount > 0){return 0;}
+  struct AJKeyValuePair * ajkvp = position == ajo->AJKVPCount - 1 ? ajo->LastAJKVP : GetKVPFromObjectIndex(ajo->FirstAJKVP, 0, position);
+  if(ajkvp == NULL){return 0;}
+  return RemoveKVPFromAJObject(ajo, ajkvp);
+}
+
+//remove ajelement at specified index. returns 1, or 0 without doing anything for a bad index or a shared ajarr (RefCount > 0, see Interning)
+int RemoveFromAJArray(struct AJArray * ajarr, int idx){
+  if(idx < 0 || idx >= ajarr->length || ajarr->RefCount > 0){return 0;}
+  AJMarkDirty(ajarr);
+  if(ajarr->PackedNumbers != NULL){
+    memmove(&ajarr->PackedNumbers[idx], &ajarr->PackedNumbers[idx + 1], sizeof(double) * (ajarr->length - idx - 1));
+    ajarr->length--;
+    return 1;
   }
+  struct AJArrayElement * el = idx == ajarr->length - 1 ? ajarr->LastElement : GetElementFromArrayIndex(ajarr->FirstElement, 0,idx);
+  if(el == NULL){return 0;}
+  __internal__UnlinkAJArrayElement(ajarr, el);
+  __internal__DeleteUnlinkedAJArrayElement(ajarr, el);
+  return 1;
 }
 
-//remove ajelement at specified index
-void RemoveFromAJArray(struct AJArray * ajarr, int idx){
-  struct AJArrayElement * el = GetElementFromArrayIndex(ajarr->FirstElement, 0,idx);
-  if(el == NULL){return;}
+//takes el out of (an unpacked) ajarr's list, without deleting anything
+void __internal__UnlinkAJArrayElement(struct AJArray * ajarr, struct AJArrayElement * el){
   //link prev elem to next as long as both are not null. in the case that either are null, do nothing for the one that is null.
   struct AJArrayElement * prevToEl = el->PrevAJElement;
   struct AJArrayElement * nextToEl = el->NextAJElement;
 
   if(prevToEl != NULL){
     prevToEl->NextAJElement = nextToEl;
+  }else{
+    ajarr->FirstElement = nextToEl;
   }
   if(nextToEl != NULL){
     nextToEl->PrevAJElement = prevToEl;
+  }else{
+    ajarr->LastElement = prevToEl;
   }
-
-  AJDelete(el, el->ArrayElementType);
-
   ajarr->length--;
+  AJMarkDirty(ajarr);
 }
 
-//add an element to the ajarr. idx means 'i want to make this element the new idxth element'.
-void AddToAJArray(struct AJArray * ajarr, void * JSONElement, int elementType, int idx){
-  if(JSONElement == NULL || idx < 0 || idx > ajarr->length){return;}
-  struct AJArrayElement * el = (struct AJArrayElement*)malloc(sizeof(struct AJArrayElement));
-  el->ArrayElement = JSONElement;
-  el->ArrayElementType = elementType;
-  el->PrevAJElement = NULL;
-  el->NextAJElement = NULL;
-
-  if(ajarr->length == 0){
-    //just add as first element
-    ajarr->FirstElement = el;
-    ajarr->length++;
-    return;
+//deletes an element that was unlinked from ajarr, along with its value
+void __internal__DeleteUnlinkedAJArrayElement(struct AJArray * ajarr, struct AJArrayElement * el){
+  if(el->ArrayElement != (void*)&el->InlineElement){
+    AJDelete(el->ArrayElement, el->ArrayElementType);
+  }else{
+    __internal__ForgetCachedText(el->ArrayElement);
+  }
+  if(!__internal__IsInElementBlock(ajarr, el)){
+    __internal__Free(el);
   }
+}
 
-  struct AJArrayElement * currElementAtThisIndex;
+//links el in as the idxth element of (an unpacked) ajarr. Appending is O(1).
+void __internal__LinkAJArrayElement(struct AJArray * ajarr, struct AJArrayElement * el, int idx){
+  struct AJArrayElement * currElementAtThisIndex = NULL;
   if(idx == ajarr->length){//adding to the end
-    //put it after currElementAtThisIndex
-    currElementAtThisIndex = GetElementFromArrayIndex(ajarr->FirstElement, 0, idx-1);
-    el->PrevAJElement = currElementAtThisIndex;
-    currElementAtThisIndex->NextAJElement = el;
+    el->PrevAJElement = ajarr->LastElement;
   }else{
     //otherwise, use a 'put - behind' approach
     currElementAtThisIndex = GetElementFromArrayIndex(ajarr->FirstElement, 0, idx);
-    struct AJArrayElement * pr = currElementAtThisIndex->PrevAJElement;
-    if(pr != NULL){
-      pr->NextAJElement = el;
-      el->PrevAJElement = pr;
-    }
+    el->PrevAJElement = currElementAtThisIndex->PrevAJElement;
     currElementAtThisIndex->PrevAJElement = el;
-    el->NextAJElement = currElementAtThisIndex;
+  }
+  el->NextAJElement = currElementAtThisIndex;
+
+  if(el->PrevAJElement != NULL){
+    el->PrevAJElement->NextAJElement = el;
+  }else{
+    ajarr->FirstElement = el;
+  }
+  if(currElementAtThisIndex == NULL){
+    ajarr->LastElement = el;
   }
   ajarr->length++;
+  AJMarkDirty(ajarr);
+}
+
+//makes a new element and links it in as the idxth element of (an unpacked) ajarr
+struct AJArrayElement * __internal__LinkNewAJArrayElement(struct AJArray * ajarr, int idx){
+  struct AJArrayElement * el = (struct AJArrayElement*)__internal__Malloc(sizeof(struct AJArrayElement));
+  __internal__LinkAJArrayElement(ajarr, el, idx);
+  return el;
+}
+
+//add an element to the ajarr. idx means 'i want to make this element the new idxth element'.
+//ajarr owns JSONElement afterwards, so it must be a node of its own: not an inline scalar of another container (see AJInlineScalar).
+//returns 1, or 0 without doing anything for a NULL JSONElement, a bad idx or a shared ajarr (RefCount > 0, see Interning); JSONElement
+//is still yours then.
+int AddToAJArray(struct AJArray * ajarr, void * JSONElement, int elementType, int idx){
+  if(JSONElement == NULL || idx < 0 || idx > ajarr->length || ajarr->RefCount > 0){return 0;}
+  UnpackAJArray(ajarr); //JSONElement has to keep its address, so it cant go into PackedNumbers
+  struct AJArrayElement * el = __internal__LinkNewAJArrayElement(ajarr, idx);
+  el->ArrayElement = JSONElement;
+  el->ArrayElementType = elementType;
+  return 1;
+}
+
+//add a number as the new idxth element. Packed arrays stay packed without making an AJNumber for it, others store it inline (InlineScalars)
+//or in a new AJNumber. returns 1, or 0 for a bad idx or a shared ajarr.
+int AddNumberToAJArray(struct AJArray * ajarr, double num, int idx){
+  if(idx < 0 || idx > ajarr->length || ajarr->RefCount > 0){return 0;}
+  if(ajarr->PackedNumbers != NULL){
+    __internal__AppendPackedNumber(ajarr, num); //grows the buffer, then shift into place
+    memmove(&ajarr->PackedNumbers[idx + 1], &ajarr->PackedNumbers[idx], sizeof(double) * (ajarr->length - 1 - idx));
+    ajarr->PackedNumbers[idx] = num;
+    AJMarkDirty(ajarr);
+    return 1;
+  }
+  struct AJArrayElement * el = __internal__LinkNewAJArrayElement(ajarr, idx);
+  el->InlineElement.Number.number = num;
+  el->InlineElement.Number.Lexeme = NULL;
+  el->ArrayElement = __internal__PlaceScalar(&el->InlineElement, TYPE_NUMBER);
+  el->ArrayElementType = TYPE_NUMBER;
+  return 1;
+}
+
+/* String escaping
+Used by the text writers (for every string that isnt Raw, see AJString), by AJWriter, and by the text parser for the other direction.
+Most strings have nothing to escape, so __internal__NextCharToEscape skips over clean chars 32 (AVX2) or 16 (SSE2) at a time
+and the clean stretches are memcpy'd. Only the chars that need it go through __internal__EscapeCharAt.*/
+
+static inline int __internal__CharNeedsEscape(unsigned char c, int asciiOnly){
+  return c < 0x20 || c == '"' || c == '\\' || (asciiOnly && c >= 0x80);
+}
+
+//index of the first char at or after 'from' that has to be escaped (length when there is none)
+int __internal__NextCharToEscape(const char * chars, int from, int length, int asciiOnly){
+  int i = from;
+#if defined(AJ_HAVE_AVX2)
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i lastControl = _mm256_set1_epi8(0x1F);
+  for(; i + 32 <= length; i += 32){
+    __m256i v = _mm256_loadu_si256((const __m256i *)&chars[i]);
+    __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(v, lastControl), lastControl); //v <= 0x1F
+    __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), control);
+    int mask = _mm256_movemask_epi8(hit) | (asciiOnly ? _mm256_movemask_epi8(v) : 0); //top bit set = not ASCII
+    if(mask != 0){break;} //the plain loop below finds which one
+  }
+#elif defined(AJ_HAVE_SSE2)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i lastControl = _mm_set1_epi8(0x1F);
+  for(; i + 16 <= length; i += 16){
+    __m128i v = _mm_loadu_si128((const __m128i *)&chars[i]);
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(v, lastControl), lastControl);
+    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), control);
+    int mask = _mm_movemask_epi8(hit) | (asciiOnly ? _mm_movemask_epi8(v) : 0);
+    if(mask != 0){break;}
+  }
+#endif
+  for(; i < length; i++){
+    if(__internal__CharNeedsEscape((unsigned char)chars[i], asciiOnly)){return i;}
+  }
+  return length;
+}
+
+//writes the \u escape for one UTF-16 unit to out (6 chars)
+static inline void __internal__WriteUnicodeEscape(unsigned int unit, char * out){
+  static const char hex[] = "0123456789abcdef";
+  out[0] = '\\';
+  out[1] = 'u';
+  out[2] = hex[(unit >> 12) & 15];
+  out[3] = hex[(unit >> 8) & 15];
+  out[4] = hex[(unit >> 4) & 15];
+  out[5] = hex[unit & 15];
+}
+
+//writes the escape for the char at chars[i] to out (at most 12 chars) and returns how many were written.
+//*used is how many chars of input it covered: 1, or the whole UTF-8 sequence for non ASCII chars.
+//broken UTF-8 becomes \ufffd
+int __internal__EscapeCharAt(const char * chars, int i, int length, char * out, int * used){
+  unsigned char c = (unsigned char)chars[i];
+  *used = 1;
+  out[0] = '\\';
+  switch(c){
+    case '"': out[1] = '"'; return 2;
+    case '\\': out[1] = '\\'; return 2;
+    case '\n': out[1] = 'n'; return 2;
+    case '\r': out[1] = 'r'; return 2;
+    case '\t': out[1] = 't'; return 2;
+    case '\b': out[1] = 'b'; return 2;
+    case '\f': out[1] = 'f'; return 2;
+  }
+  if(c < 0x80){ //other control chars
+    __internal__WriteUnicodeEscape(c, out);
+    return 6;
+  }
+  int extra = c >= 0xC2 && c <= 0xDF ? 1 : c >= 0xE0 && c <= 0xEF ? 2 : c >= 0xF0 && c <= 0xF4 ? 3 : -1;
+  unsigned int codepoint = extra == 1 ? c & 0x1F : extra == 2 ? c & 0x0F : c & 0x07;
+  if(extra < 0 || i + extra >= length){
+    __internal__WriteUnicodeEscape(0xFFFD, out);
+    return 6;
+  }
+  for(int k = 1; k <= extra; k++){
+    unsigned char next = (unsigned char)chars[i + k];
+    if((next & 0xC0) != 0x80){
+      __internal__WriteUnicodeEscape(0xFFFD, out);
+      return 6;
+    }
+    codepoint = (codepoint << 6) | (next & 0x3F);
+  }
+  *used = extra + 1;
+  if(codepoint < 0x10000){
+    __internal__WriteUnicodeEscape(codepoint, out);
+    return 6;
+  }
+  codepoint -= 0x10000; //needs a surrogate pair
+  __internal__WriteUnicodeEscape(0xD800 + (codepoint >> 10), out);
+  __internal__WriteUnicodeEscape(0xDC00 + (codepoint & 0x3FF), &out[6]);
+  return 12;
+}
+
+//how many chars escaping 'length' chars takes (without the quotes)
+int __internal__EscapedLength(const char * chars, int length, int asciiOnly){
+  int total = 0;
+  int i = 0;
+  while(1){
+    int next = __internal__NextCharToEscape(chars, i, length, asciiOnly);
+    total += next - i;
+    if(next == length){return total;}
+    char escaped[12];
+    int used;
+    total += __internal__EscapeCharAt(chars, next, length, escaped, &used);
+    i = next + used;
+  }
+}
+
+//writes 'length' chars escaped to out (which must have __internal__EscapedLength() room). returns chars written, no null terminator
+int __internal__WriteEscapedChars(const char * chars, int length, char * out, int asciiOnly){
+  int written = 0;
+  int i = 0;
+  while(1){
+    int next = __internal__NextCharToEscape(chars, i, length, asciiOnly);
+    memcpy(&out[written], &chars[i], next - i);
+    written += next - i;
+    if(next == length){return written;}
+    int used;
+    written += __internal__EscapeCharAt(chars, next, length, &out[written], &used);
+    i = next + used;
+  }
+}
+
+static inline int __internal__HexValue(char c){
+  if(c >= '0' && c <= '9'){return c - '0';}
+  if(c >= 'a' && c <= 'f'){return c - 'a' + 10;}
+  if(c >= 'A' && c <= 'F'){return c - 'A' + 10;}
+  return -1;
+}
 
+//reads the 4 hex digits after a \u. -1 when they arent hex
+int __internal__ReadUnicodeEscape(const char * chars, int i, int length){
+  if(i + 6 > length || chars[i] != '\\' || chars[i + 1] != 'u'){return -1;}
+  int unit = 0;
+  for(int k = 2; k < 6; k++){
+    int digit = __internal__HexValue(chars[i + k]);
+    if(digit < 0){return -1;}
+    unit = (unit << 4) | digit;
+  }
+  return unit;
+}
+
+//the other direction: turns the escapes in 'length' source chars into the real chars (UTF-8 for \uXXXX) in out.
+//out needs 'length' room (decoding never makes the text longer). returns the new length
+int __internal__UnescapeChars(const char * chars, int length, char * out){
+  int written = 0;
+  for(int i = 0; i < length; i++){
+    if(chars[i] != '\\' || i + 1 == length){
+      out[written++] = chars[i];
+      continue;
+    }
+    i++;
+    switch(chars[i]){
+      case 'n': out[written++] = '\n'; continue;
+      case 'r': out[written++] = '\r'; continue;
+      case 't': out[written++] = '\t'; continue;
+      case 'b': out[written++] = '\b'; continue;
+      case 'f': out[written++] = '\f'; continue;
+      case 'u': break;
+      default: out[written++] = chars[i]; continue; // \" \\ \/ (and anything else) is just the char
+    }
+    int codepoint = __internal__ReadUnicodeEscape(chars, i - 1, length);
+    if(codepoint < 0){ //not really an escape, keep it as it was
+      out[written++] = '\\';
+      out[written++] = 'u';
+      continue;
+    }
+    i += 4;
+    if(codepoint >= 0xD800 && codepoint <= 0xDBFF){ //first half of a surrogate pair
+      int low = __internal__ReadUnicodeEscape(chars, i + 1, length);
+      if(low >= 0xDC00 && low <= 0xDFFF){
+        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+        i += 6;
+      }else{
+        codepoint = 0xFFFD;
+      }
+    }else if(codepoint >= 0xDC00 && codepoint <= 0xDFFF){
+      codepoint = 0xFFFD;
+    }
+    //UTF-8 is never longer than the escape it came from
+    if(codepoint < 0x80){
+      out[written++] = (char)codepoint;
+    }else if(codepoint < 0x800){
+      out[written++] = (char)(0xC0 | (codepoint >> 6));
+      out[written++] = (char)(0x80 | (codepoint & 0x3F));
+    }else if(codepoint < 0x10000){
+      out[written++] = (char)(0xE0 | (codepoint >> 12));
+      out[written++] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+      out[written++] = (char)(0x80 | (codepoint & 0x3F));
+    }else{
+      out[written++] = (char)(0xF0 | (codepoint >> 18));
+      out[written++] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+      out[written++] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+      out[written++] = (char)(0x80 | (codepoint & 0x3F));
+    }
+  }
+  return written;
 }
 
 /*ParseNewAJString takes a char array and an Index to where you encountered the first quoteMark_1 or quoteMark_2.
 It reads forward -saving all the chars into the new AJString struct - until it finds the same quote mark
 again (unescaped). It returns the index where it stopped (i.e where the closing quote mark is).
-All AJStrings are null - terminated. All AJStrings contain the two quote marks that enclose it.*/
+All AJStrings are null - terminated and know their length. The quote marks that enclose it are not stored.*/
 struct AJString * ParseNewAJString(int indexOfOpeningQuoteMark, char * JSONString, int * returnIdx){
-  //create and init new struct
-  struct AJString * pelumi = (struct AJString *)malloc(sizeof(struct AJString));
-  pelumi->string = (char *)malloc(sizeof(char) * __internal__DefaultStringLen); //will resize as more chars are read.
-  pelumi->length = __internal__DefaultStringLen;
-
-
   //read all chars starting with the opening quote.
       //(determine which quote type it is)
       char QuoteType = JSONString[indexOfOpeningQuoteMark];
       if(QuoteType != quoteMark_1 && QuoteType != quoteMark_2){
         //write to the error buffer and return null
-        free(pelumi->string);
-        free(pelumi);
         return NULL;
       }
 
-  //start reading here
-  // pelumi->string[0] = QuoteType;
-  // int charsWritten = 1;
-  int charsWritten = 0;
+  //find the closing quote first, so the chars can be copied in one go into a buffer of exactly the right size
+  //(or straight into the AJString when it is short) instead of growing a buffer char by char.
   int JSONCharIndex = indexOfOpeningQuoteMark + 1; //first char after quote
-  char currentChar;
-  int isEscaped = 0;
-  int atClosingQuoteMark = 0;
-
+  int hasEscapes = 0;
   while(1){
-    currentChar = JSONString[JSONCharIndex];
-    // printf("current char: %d(%c) | position: %d\n", currentChar, currentChar , JSONCharIndex);
-
-    if(currentChar == QuoteType && JSONString[JSONCharIndex-1] != escape){//we may be ending the string. check to see if escaped
-      //write final quote and null ending to pelumi->string
-      atClosingQuoteMark = 1;
-      goto EndStringParse;
-    }
-
-    pelumi->string[charsWritten] = currentChar;
-    charsWritten++;
-
-    if(pelumi->length <= charsWritten){//resize by __internal__DefaultStringLen
-      pelumi->string = (char*)realloc(pelumi->string, sizeof(char) * (pelumi->length + __internal__DefaultStringLen));
-      pelumi->length += __internal__DefaultStringLen;
+    char currentChar = JSONString[JSONCharIndex];
+    if(currentChar == escape){ //whatever comes next is part of the string (so "a\\" ends at the second quote)
+      hasEscapes = 1;
+      JSONCharIndex += 2;
+      continue;
     }
-
-    EndStringParse:
-    if(atClosingQuoteMark == 1){
-      pelumi->string[charsWritten++] = '\0';
+    if(currentChar == QuoteType){
       break;
     }
-
     JSONCharIndex++;
   }
 
-  //realloc again to make sure string is exactly as long as it needs to be
-  if(pelumi->length > charsWritten){
-    pelumi->string = (char*)realloc(pelumi->string, sizeof(char) * charsWritten);
-    pelumi->length = charsWritten;
-  }
   *returnIdx = JSONCharIndex;
+  struct AJContext * ctx = AJGetContext();
+  if(hasEscapes && ctx->EscapeStrings){ //store the real chars, not the escapes
+    int rawLength = JSONCharIndex - indexOfOpeningQuoteMark - 1;
+    char * decoded = (char *)__internal__Malloc(rawLength + 1);
+    int decodedLength = __internal__UnescapeChars(&JSONString[indexOfOpeningQuoteMark + 1], rawLength, decoded);
+    struct AJString * pelumi;
+    if(ctx->Intern != NULL){
+      pelumi = __internal__InternAJStringBytes(ctx->Intern, decoded, decodedLength);
+    }else{
+      pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+      __internal__SetAJStringChars(pelumi, decoded, decodedLength);
+      pelumi->RefCount = 0;
+    }
+    __internal__Free(decoded);
+    return pelumi;
+  }
+  if(hasEscapes){ //kept with its escapes, so it is written back as it is. never shared: decoded strings with the same bytes mean something else
+    struct AJString * pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+    __internal__SetAJStringChars(pelumi, &JSONString[indexOfOpeningQuoteMark + 1], JSONCharIndex - indexOfOpeningQuoteMark - 1);
+    pelumi->Raw = 1;
+    pelumi->RefCount = 0;
+    return pelumi;
+  }
+  if(ctx->Intern != NULL){ //seen these chars before? share that string instead of making another
+    return __internal__InternAJStringBytes(ctx->Intern, &JSONString[indexOfOpeningQuoteMark + 1], JSONCharIndex - indexOfOpeningQuoteMark - 1);
+  }
+
+  //create and init new struct
+  struct AJString * pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+  __internal__SetAJStringChars(pelumi, &JSONString[indexOfOpeningQuoteMark + 1], JSONCharIndex - indexOfOpeningQuoteMark - 1);
+  pelumi->RefCount = 0;
   return pelumi;
 }
 
+//how many chars long the number starting at JSONString[indexOfFirstChar] is: -? digits/. ([eE] [+-]? digits)?
+int __internal__LexNumber(int indexOfFirstChar, char * JSONString){
+  int i = indexOfFirstChar;
+  if(JSONString[i] == '-'){i++;}
+  while((JSONString[i] >= '0' && JSONString[i] <= '9') || JSONString[i] == '.'){i++;}
+  if(JSONString[i] == 'e' || JSONString[i] == 'E'){
+    i++;
+    if(JSONString[i] == '+' || JSONString[i] == '-'){i++;}
+    while(JSONString[i] >= '0' && JSONString[i] <= '9'){i++;}
+  }
+  return i - indexOfFirstChar;
+}
+
+//reads the number whose first digit (or '-') is at indexOfFirstDigit and returns its value. *returnIdx is moved forward to the last char
+//of the number (so pass a pointer to the same index you are reading from, like the array/object parsers do).
+//strtod gives the nearest double to the text, so numbers read back exactly as they were written (canonical output depends on that).
+//it gets a copy of just the number: on the text itself it would also take hex (0x1p3), inf and nan.
+double __internal__ParseNumberValue(int indexOfFirstDigit, char * JSONString, int * returnIdx){
+  int length = __internal__LexNumber(indexOfFirstDigit, JSONString);
+  char shortText[64];
+  char * text = length < (int)sizeof(shortText) ? shortText : (char *)__internal__Malloc(length + 1);
+  memcpy(text, &JSONString[indexOfFirstDigit], length);
+  text[length] = '\0';
+  double number = strtod(text, NULL);
+  if(text != shortText){__internal__Free(text);}
+  *returnIdx += length - 1;
+  return number;
+}
+
 //takes in a pointer to the first digit of a number (we define 'digit' as any char 0-9 that isnt part of a string).
+//with AJContext->KeepNumberLexemes on, the source text is copied too (behind the struct, same allocation, see AJ_LEXEME_OFFSET).
 struct AJNumber * ParseNewAJNumber(int indexOfFirstDigit, char * JSONString, int * returnIdx){
-  struct AJNumber * ayomide = (struct AJNumber *)malloc(sizeof(struct AJNumber));
-
-  struct numHolder{
-    int digit; //0-9
-    struct numHolder * next;
-  };
-  char numParts[11] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.'};
-
-  int digitsRead = 0;
-  char currentChar;
-
-  int positionOfDecPoint = -1;
-  struct numHolder * first = (struct numHolder *)malloc(sizeof(struct numHolder));
-  first->next = NULL;
-  struct numHolder * current = first;
-  int firstDigitHandled = 0;
-  struct numHolder * previous;
-  while(1){ //stop when a char is reached that isnt a digit or decimal point.
-    currentChar = JSONString[digitsRead + indexOfFirstDigit];
-    // printf("%c\n", currentChar );
-    //check if the currentChar is part of a/ther number
-    int isPart = 0;
-    for(int i = 0; i < 11; i++){
-      if(currentChar == numParts[i]){
-        isPart = 1;
-        break;
-      }
-    }
-    if(isPart == 1){
-      //check if . or digit
-      if(currentChar == '.'){
-        positionOfDecPoint = digitsRead;
-      }else{ //must be a digit
-        if(firstDigitHandled == 0){
-          current->digit = currentChar - 48;
-          firstDigitHandled = 1;
-          previous = current;
-        }else{
-          struct numHolder * neue = (struct numHolder *)malloc(sizeof(struct numHolder));
-          neue->digit = currentChar - 48;//digits are asci codes 48-57. Subtract the char value from 48 to get the digit.
-          neue->next = NULL; //An embarrasing amount of time was spent figuring out that i needed to add this.
-          current->next = neue;
-          previous = current;
-          current = neue;
-        }
-
-      }
-      digitsRead++;
-    }else{
-      break;
-    }
-  }
-
-  //read through the numholder linked list. if positionOfDecPoint > -1 then 10^x starts at x = positionOfDecPoint-1.
-  //read from pos 0 till positionOfDecPoint, subtracting 1 for every exponent.
-  current = first;
-  double finalNumber = 0;
-  int exponent = positionOfDecPoint != -1 ? positionOfDecPoint-1 : digitsRead-1;
-  int c = 0;
-  while(1){
-    // printf("second loop");
-    //get 10^x value
-    double TenToTheExponentValue = 1;
-    if(exponent >-1){
-      for(int i = 0; i < exponent; i++){
-        TenToTheExponentValue = TenToTheExponentValue * 10;
-      }
-    }else{//divide
-      for(int i = 0; i > exponent; i--){
-        TenToTheExponentValue = TenToTheExponentValue / 10;
-      }
-    }
-    exponent--;
-    finalNumber+= current->digit * TenToTheExponentValue;
-    // printf("final num: %lf | exponent: %d | TenToTheExponentValue: %lf\n", finalNumber, exponent, TenToTheExponentValue);
-
-    //delete element in linked list. Aint doing a mem leaks ting blud. ya get me fam.
-    if(current->next == NULL){//end of digit seq
-      free(current);
-      break;
-    }
-    struct numHolder * hold = current;
-    current = current->next;
-    free(hold);
-
-
+  if(AJGetContext()->KeepNumberLexemes){
+    int length = __internal__LexNumber(indexOfFirstDigit, JSONString);
+    struct AJNumber * ayomide = (struct AJNumber *)__internal__Malloc(AJ_LEXEME_OFFSET + length + 1);
+    ayomide->Lexeme = (char *)ayomide + AJ_LEXEME_OFFSET;
+    memcpy(ayomide->Lexeme, &JSONString[indexOfFirstDigit], length);
+    ayomide->Lexeme[length] = '\0';
+    ayomide->number = strtod(ayomide->Lexeme, NULL);
+    memcpy(ayomide->Lexeme - sizeof(double), &ayomide->number, sizeof(double));
+    *returnIdx += length - 1; //last char of the number, like __internal__ParseNumberValue
+    return ayomide;
   }
-
-  digitsRead--;//the logic of incrementing digitsRead makes it stop on the char directly AFTER the last char.
-  //to maintain consistency across Parse functions, decrement one to represent the index with the last digit
-  *returnIdx+=digitsRead;
-  ayomide->number = finalNumber;
+  struct AJNumber * ayomide = (struct AJNumber *)__internal__Malloc(sizeof(struct AJNumber));
+  ayomide->number = __internal__ParseNumberValue(indexOfFirstDigit, JSONString, returnIdx);
+  ayomide->Lexeme = NULL;
   return ayomide;
 }
 
 struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONString, int * returnIdx){
+  struct AJContext * ctx = AJGetContext();
   // create and init new struct
-  struct AJArray * opeyemi = (struct AJArray *)malloc(sizeof(struct AJArray));
-  opeyemi->length = 0;
+  struct AJArray * opeyemi = CreateAJArray();
+  int sourceEntry = ctx->SourceMap != NULL ? __internal__BeginSourceEntry(ctx->SourceMap, opeyemi, TYPE_ARRAY, indexOfOpeningArrayBracket) : -1;
   struct AJArrayElement * currentArrayElement;
   struct AJArrayElement * previousArrayElement = NULL;
   int JSONCharIndex = indexOfOpeningArrayBracket+1; //skip over opening array bracket character
@@ -671,49 +1391,55 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
     switch(currentChar){
       case quoteMark_1:{
         struct AJString * element = ParseNewAJString(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
         currentArrayElement->ArrayElement = (void *)element;
         currentArrayElement->ArrayElementType = TYPE_STRING;
         break;
       }
       case quoteMark_2:{
         struct AJString * element = ParseNewAJString(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
         currentArrayElement->ArrayElement = (void *)element;
         currentArrayElement->ArrayElementType = TYPE_STRING;
         break;
       }
       case truthValueLetter_t:{
-        struct AJBoolean * element = ParseNewAJBoolean(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)(malloc(sizeof(struct AJArrayElement)));
-        currentArrayElement->ArrayElement = (void *)element;
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
+        currentArrayElement->InlineElement.Boolean.TruthValue = __internal__ParseBooleanValue(JSONCharIndex, JSONString, &JSONCharIndex);
+        currentArrayElement->ArrayElement = __internal__PlaceScalar(&currentArrayElement->InlineElement, TYPE_BOOLEAN);
         currentArrayElement->ArrayElementType = TYPE_BOOLEAN;
         break;
       }
       case truthValueLetter_f:{
-        struct AJBoolean * element = ParseNewAJBoolean(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
-        currentArrayElement->ArrayElement = (void *)element;
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
+        currentArrayElement->InlineElement.Boolean.TruthValue = __internal__ParseBooleanValue(JSONCharIndex, JSONString, &JSONCharIndex);
+        currentArrayElement->ArrayElement = __internal__PlaceScalar(&currentArrayElement->InlineElement, TYPE_BOOLEAN);
         currentArrayElement->ArrayElementType = TYPE_BOOLEAN;
         break;
       }
       case nullValueLetter_n:{
-        struct AJNull * element = ParseNewAJNull(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
-        currentArrayElement->ArrayElement = (void *)element;
+        JSONCharIndex += 3; //started at n, skip 'ull'
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
+        currentArrayElement->ArrayElement = __internal__PlaceScalar(&currentArrayElement->InlineElement, TYPE_NULL);
         currentArrayElement->ArrayElementType = TYPE_NULL;
         break;
       }
       case openArrayBracket:{
-        struct AJArray * element = ParseNewAJArray(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
+        struct AJArray * element = ctx->SourceMap != NULL ? (struct AJArray *)__internal__ReuseSourceNode(ctx->SourceMap, JSONCharIndex, TYPE_ARRAY, &JSONCharIndex) : NULL;
+        if(element == NULL){
+          element = ParseNewAJArray(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
         currentArrayElement->ArrayElement = (void *)element;
         currentArrayElement->ArrayElementType = TYPE_ARRAY;
         break;
       }
       case openObjectBracket:{
-        struct AJObject * element = ParseNewAJObject(JSONCharIndex, JSONString, &JSONCharIndex);
-        currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
+        struct AJObject * element = ctx->SourceMap != NULL ? (struct AJObject *)__internal__ReuseSourceNode(ctx->SourceMap, JSONCharIndex, TYPE_OBJECT, &JSONCharIndex) : NULL;
+        if(element == NULL){
+          element = ParseNewAJObject(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
+        currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
         currentArrayElement->ArrayElement = (void *)element;
         currentArrayElement->ArrayElementType = TYPE_OBJECT;
         break;
@@ -727,7 +1453,7 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
       default:{
         //check if it is a number
         char numParts[11] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.'};
-        char isNumber = 0;
+        char isNumber = currentChar == '-';
         for(int i = 0; i < 11; i++){
           if(currentChar == numParts[i]){
             isNumber = 1;
@@ -735,9 +1461,22 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
           }
         }
         if(isNumber == 1){
-          struct AJNumber * element = ParseNewAJNumber(JSONCharIndex, JSONString, &JSONCharIndex);
-          currentArrayElement = (struct AJArrayElement *)malloc(sizeof(struct AJArrayElement));
-          currentArrayElement->ArrayElement = (void *)element;
+          if(ctx->KeepNumberLexemes){ //lexemes dont fit in the inline slot or a packed array, they get their own node
+            currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
+            currentArrayElement->ArrayElement = (void *)ParseNewAJNumber(JSONCharIndex, JSONString, &JSONCharIndex);
+            currentArrayElement->ArrayElementType = TYPE_NUMBER;
+            break;
+          }
+          //while everything so far has been a number, keep them packed (only if asked to)
+          if(ctx->PackNumericArrays && (opeyemi->length == 0 || opeyemi->PackedNumbers != NULL)){
+            __internal__AppendPackedNumber(opeyemi, __internal__ParseNumberValue(JSONCharIndex, JSONString, &JSONCharIndex));
+            skipThisChar = 1; //nothing to link
+            break;
+          }
+          currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
+          currentArrayElement->InlineElement.Number.number = __internal__ParseNumberValue(JSONCharIndex, JSONString, &JSONCharIndex);
+          currentArrayElement->InlineElement.Number.Lexeme = NULL;
+          currentArrayElement->ArrayElement = __internal__PlaceScalar(&currentArrayElement->InlineElement, TYPE_NUMBER);
           currentArrayElement->ArrayElementType = TYPE_NUMBER;
           break;
         }else{
@@ -752,6 +1491,9 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
     }
 
     if(skipThisChar == 0){
+      if(opeyemi->PackedNumbers != NULL){//not all numbers after all. turn what we have so far into elements and carry on normally
+        previousArrayElement = __internal__UnpackAJArray(opeyemi);
+      }
       //after creating new element, add to array
       currentArrayElement->PrevAJElement = previousArrayElement; //link current to previous element
       currentArrayElement->NextAJElement = NULL;
@@ -763,6 +1505,7 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
       if(opeyemi->length == 0){//this is the first element
         opeyemi->FirstElement = currentArrayElement;
       }
+      opeyemi->LastElement = currentArrayElement;
       opeyemi->length++;
     }else{
       skipThisChar = 0; //set back to 0
@@ -775,13 +1518,26 @@ struct AJArray * ParseNewAJArray(int indexOfOpeningArrayBracket, char * JSONStri
   if(opeyemi->length == 0){//it was empty; dealloc the OG element we mallocd
     opeyemi->FirstElement = NULL;
   }
+  if(sourceEntry != -1){
+    __internal__EndSourceEntry(ctx->SourceMap, sourceEntry, JSONCharIndex);
+  }
+  if(ctx->Intern != NULL){
+    return (struct AJArray *)__internal__InternAJContainer(ctx->Intern, (void*)opeyemi, TYPE_ARRAY);
+  }
   return opeyemi;
 
 }
 
 struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString, int * returnIdx){
-  struct AJObject * adedoyin = (struct AJObject *)malloc(sizeof(struct AJObject));
+  struct AJObject * adedoyin = (struct AJObject *)__internal__Malloc(sizeof(struct AJObject));
   adedoyin->AJKVPCount = 0;
+  adedoyin->Shape = NULL;
+  adedoyin->RefCount = 0;
+  adedoyin->KVPBlock = NULL;
+  adedoyin->KVPBlockCount = 0;
+  adedoyin->LastAJKVP = NULL;
+  struct AJSourceMap * sourceMap = AJGetContext()->SourceMap;
+  int sourceEntry = sourceMap != NULL ? __internal__BeginSourceEntry(sourceMap, adedoyin, TYPE_OBJECT, indexOfOpeneingBracket) : -1;
 
   struct AJKeyValuePair * currentKVP = NULL; //current KVP having data put into it
   adedoyin->FirstAJKVP = NULL;
@@ -794,6 +1550,11 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
   int IS_VALUE = 1;
   int currentKVPState = IS_KEY;
   int linkKVPsNow = 0;
+  char keepLexemes = AJGetContext()->KeepNumberLexemes;
+  char inlineScalars = AJGetContext()->InlineScalars;
+  struct AJShapeTable * shapes = AJGetContext()->Shapes;
+  struct AJShape * predicted = NULL; //while not NULL the keys so far are this shape's, and their KVPs are in block
+  struct AJKeyValuePair * block = NULL;
 
   void * element;
   int elementType;
@@ -801,6 +1562,29 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
   while(1){
     currentChar = JSONString[JSONCharIndex];
     // printf("current char: %c | position: %d\n", currentChar , JSONCharIndex);
+    if(shapes != NULL && currentKVPState == IS_KEY && currentKVP == NULL && (currentChar == quoteMark_1 || currentChar == quoteMark_2)
+       && (predicted != NULL || adedoyin->AJKVPCount == 0)){ //try the key against the predicted shape before making a string for it
+      int closingQuote;
+      struct AJString * sharedKey = __internal__MatchShapeKey(shapes, &predicted, adedoyin->AJKVPCount, JSONString, JSONCharIndex, &closingQuote);
+      if(sharedKey != NULL){
+        if(block == NULL){
+          block = (struct AJKeyValuePair *)__internal__Malloc(sizeof(struct AJKeyValuePair) * predicted->KeyCount);
+        }
+        currentKVP = &block[adedoyin->AJKVPCount];
+        currentKVP->key = (void*)sharedKey;
+        currentKVP->KeyType = TYPE_STRING;
+        JSONCharIndex = closingQuote + 1;
+        continue;
+      }
+      if(block != NULL){ //other keys after all: the KVPs so far get their own keys and the rest is parsed the usual way
+        adedoyin->KVPBlock = block;
+        adedoyin->KVPBlockCount = predicted->KeyCount;
+        adedoyin->Shape = predicted;
+        DetachAJObjectShape(adedoyin);
+        block = NULL;
+      }
+      predicted = NULL;
+    }
     switch(currentChar){
       case quoteMark_1:{
         element = (void*)ParseNewAJString(JSONCharIndex, JSONString, &JSONCharIndex);
@@ -813,27 +1597,48 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
         break;
       }
       case truthValueLetter_t:{
-        element = (void*)ParseNewAJBoolean(JSONCharIndex, JSONString, &JSONCharIndex);
+        if(currentKVPState == IS_VALUE && currentKVP != NULL && inlineScalars){
+          currentKVP->InlineValue.Boolean.TruthValue = __internal__ParseBooleanValue(JSONCharIndex, JSONString, &JSONCharIndex);
+          element = (void*)&currentKVP->InlineValue;
+        }else{
+          element = (void*)ParseNewAJBoolean(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
         elementType = TYPE_BOOLEAN;
         break;
       }
       case truthValueLetter_f:{
-        element = (void*)ParseNewAJBoolean(JSONCharIndex, JSONString, &JSONCharIndex);
+        if(currentKVPState == IS_VALUE && currentKVP != NULL && inlineScalars){
+          currentKVP->InlineValue.Boolean.TruthValue = __internal__ParseBooleanValue(JSONCharIndex, JSONString, &JSONCharIndex);
+          element = (void*)&currentKVP->InlineValue;
+        }else{
+          element = (void*)ParseNewAJBoolean(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
         elementType = TYPE_BOOLEAN;
         break;
       }
       case nullValueLetter_n:{
-        element = (void*)ParseNewAJNull(JSONCharIndex, JSONString, &JSONCharIndex);
+        if(currentKVPState == IS_VALUE && currentKVP != NULL && inlineScalars){
+          JSONCharIndex += 3; //started at n, skip 'ull'
+          element = (void*)&currentKVP->InlineValue;
+        }else{
+          element = (void*)ParseNewAJNull(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
         elementType = TYPE_NULL;
         break;
       }
       case openObjectBracket:{
-        element = (void*)ParseNewAJObject(JSONCharIndex, JSONString, &JSONCharIndex);
+        element = sourceMap != NULL && currentKVPState == IS_VALUE ? __internal__ReuseSourceNode(sourceMap, JSONCharIndex, TYPE_OBJECT, &JSONCharIndex) : NULL;
+        if(element == NULL){
+          element = (void*)ParseNewAJObject(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
         elementType = TYPE_OBJECT;
         break;
       }
       case openArrayBracket:{
-        element = (void*)ParseNewAJArray(JSONCharIndex, JSONString, &JSONCharIndex);
+        element = sourceMap != NULL && currentKVPState == IS_VALUE ? __internal__ReuseSourceNode(sourceMap, JSONCharIndex, TYPE_ARRAY, &JSONCharIndex) : NULL;
+        if(element == NULL){
+          element = (void*)ParseNewAJArray(JSONCharIndex, JSONString, &JSONCharIndex);
+        }
         elementType = TYPE_ARRAY;
         break;
       }
@@ -856,7 +1661,7 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
       default:{
         //check if number
         char numParts[11] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.'};
-        char isNumber = 0;
+        char isNumber = currentChar == '-';
         for(int i = 0; i < 11; i++){
           if(currentChar == numParts[i]){
             isNumber = 1;
@@ -864,7 +1669,13 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
           }
         }
         if(isNumber == 1){
-          element = (void*)ParseNewAJNumber(JSONCharIndex, JSONString, &JSONCharIndex);
+          if(currentKVPState == IS_VALUE && currentKVP != NULL && inlineScalars && keepLexemes == 0){ //values are stored inline in their KVP (keys are rarely numbers, those still get a node)
+            currentKVP->InlineValue.Number.number = __internal__ParseNumberValue(JSONCharIndex, JSONString, &JSONCharIndex);
+            currentKVP->InlineValue.Number.Lexeme = NULL;
+            element = (void*)&currentKVP->InlineValue;
+          }else{
+            element = (void*)ParseNewAJNumber(JSONCharIndex, JSONString, &JSONCharIndex);
+          }
           elementType = TYPE_NUMBER;
         }else{
           skipCharacter = 1;
@@ -884,6 +1695,7 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
         if(adedoyin->AJKVPCount == 0){
           adedoyin->FirstAJKVP = currentKVP;
         }
+        adedoyin->LastAJKVP = currentKVP;
         previousKVP = currentKVP;
         adedoyin->AJKVPCount++;
         currentKVP = NULL;
@@ -900,7 +1712,7 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
 
     if(skipCharacter == 0){
       if(currentKVPState == IS_KEY){
-        currentKVP = (struct AJKeyValuePair*)malloc(sizeof(struct AJKeyValuePair));
+        currentKVP = (struct AJKeyValuePair*)__internal__Malloc(sizeof(struct AJKeyValuePair));
         currentKVP->key = element;
         currentKVP->KeyType = elementType;
       }else if(currentKVPState == IS_VALUE){
@@ -919,10 +1731,28 @@ struct AJObject * ParseNewAJObject(int indexOfOpeneingBracket, char * JSONString
   }
 
   *returnIdx = JSONCharIndex;
+  if(sourceEntry != -1){
+    __internal__EndSourceEntry(sourceMap, sourceEntry, JSONCharIndex);
+  }
+  if(predicted != NULL){ //parsed straight into the shaped block
+    adedoyin->KVPBlock = block;
+    adedoyin->KVPBlockCount = predicted->KeyCount;
+    adedoyin->Shape = predicted;
+    if(adedoyin->AJKVPCount != predicted->KeyCount){ //ended early, so it has a shape of its own: detach and let ShapeAJObject find it
+      DetachAJObjectShape(adedoyin);
+    }
+  }
+  if(shapes != NULL){
+    __internal__ShapeAJObject(shapes, adedoyin);
+  }
+  if(AJGetContext()->Intern != NULL){
+    return (struct AJObject *)__internal__InternAJContainer(AJGetContext()->Intern, (void*)adedoyin, TYPE_OBJECT);
+  }
   return adedoyin;
 }
 
-struct AJBoolean * ParseNewAJBoolean(int indexOfLetterTOrF, char * JSONString, int * returnIdx){
+//returns 1 for true, 0 for false (and moves *returnIdx to the last letter), or -1 if it isnt a t or f
+char __internal__ParseBooleanValue(int indexOfLetterTOrF, char * JSONString, int * returnIdx){
   // AJBoolean can ony represent true or false, so we only need to check the first letter (t or f)
   char TVal = -1;
   int charsToSkip = 0;
@@ -933,17 +1763,25 @@ struct AJBoolean * ParseNewAJBoolean(int indexOfLetterTOrF, char * JSONString, i
     TVal = (char)0;
     charsToSkip = 4; //4 more chars in word 'false' (after starting letter)
   }else{
+    return -1;
+  }
+  *returnIdx = indexOfLetterTOrF + charsToSkip;
+  return TVal;
+}
+
+struct AJBoolean * ParseNewAJBoolean(int indexOfLetterTOrF, char * JSONString, int * returnIdx){
+  char TVal = __internal__ParseBooleanValue(indexOfLetterTOrF, JSONString, returnIdx);
+  if(TVal == -1){
     return NULL;
   }
-  struct AJBoolean * femi = (struct AJBoolean *)malloc(sizeof(struct AJBoolean));
+  struct AJBoolean * femi = (struct AJBoolean *)__internal__Malloc(sizeof(struct AJBoolean));
   femi->TruthValue = TVal;
-  *returnIdx = indexOfLetterTOrF + charsToSkip;
   return femi;
 }
 
 struct AJNull * ParseNewAJNull(int indexOfLetterN, char * JSONString, int * returnIdx){
   *returnIdx = indexOfLetterN + 3; //started at n, add 'ull'
-  return (struct AJNull *)malloc(sizeof(struct AJNull));
+  return (struct AJNull *)__internal__Malloc(sizeof(struct AJNull));
 }
 
 //returns either AJKVP or AJArrayElement from Object or Array
@@ -963,10 +1801,12 @@ void * GetElementFromObject(int startIndex, void * startKVP, int destIndex, int
   return current;
 }
 
+//walks from startElement (the startIndexth element) to the destIndexth one. NULL if the list ends first. packed arrays have no
+//element list (their FirstElement is NULL), so this returns NULL for them: read those through GetAJArrayPackedNumbers.
 struct AJArrayElement * GetElementFromArrayIndex(struct AJArrayElement * startElement, int startIndex,  int destIndex){
   if(startIndex > destIndex){return NULL;}
   struct AJArrayElement * current = startElement;
-  while(startIndex != destIndex){
+  while(current != NULL && startIndex != destIndex){
     current = current->NextAJElement;
     startIndex++;
   }
@@ -984,6 +1824,7 @@ struct AJKeyValuePair * GetKVPFromObjectIndex(struct AJKeyValuePair * startKVP,
 }
 
 void PrettyPrintKVP(struct AJKeyValuePair * kvp, int indentationCount){
+  struct AJContext * ctx = AJGetContext();
   char whitespace[indentationCount+1];
   for(int i = 0; i < indentationCount; i++){
     whitespace[i] = indentation;
@@ -993,9 +1834,8 @@ void PrettyPrintKVP(struct AJKeyValuePair * kvp, int indentationCount){
   //print key
   switch(kvp->KeyType){
     case TYPE_NUMBER :{
-      double myNum = ((struct AJNumber*)(kvp->key))->number;
-      __internal__CreateNumberDigitFormat(finalNumberFormatString, __internal__DefaultDoublePrintDigitCount);
-      printf(finalNumberFormatString, myNum);
+      double myNum = AJNumberGetDouble(((struct AJNumber*)(kvp->key)));
+      printf(ctx->NumberFormatString, myNum);
       break;
     }
     case TYPE_STRING :{
@@ -1033,9 +1873,8 @@ void PrettyPrintKVP(struct AJKeyValuePair * kvp, int indentationCount){
 
   switch(kvp->ValueType){
     case TYPE_NUMBER :{
-      double myNum = ((struct AJNumber*)(kvp->value))->number;
-      __internal__CreateNumberDigitFormat(finalNumberFormatString, __internal__DefaultDoublePrintDigitCount);
-      printf(finalNumberFormatString, myNum);
+      double myNum = AJNumberGetDouble(((struct AJNumber*)(kvp->value)));
+      printf(ctx->NumberFormatString, myNum);
       break;
     }
     case TYPE_STRING :{
@@ -1071,6 +1910,7 @@ void PrettyPrintKVP(struct AJKeyValuePair * kvp, int indentationCount){
 }
 
 void PrettyPrintAJArray(struct AJArray * aja, int indentationCount){
+  struct AJContext * ctx = AJGetContext();
   char whitespace[indentationCount+1];
   for(int i = 0; i < indentationCount; i++){
     whitespace[i] = indentation;
@@ -1078,6 +1918,16 @@ void PrettyPrintAJArray(struct AJArray * aja, int indentationCount){
   whitespace[indentationCount] = '\0';
   printf("%s[\n", whitespace);
 
+  if(aja->PackedNumbers != NULL){
+    for(int i = 0; i < aja->length; i++){
+      printf("%s%c", whitespace, indentation);
+      printf(ctx->NumberFormatString, aja->PackedNumbers[i]);
+      printf(i != aja->length - 1 ? ",\n" : "\n");
+    }
+    printf("%s]", whitespace);
+    return;
+  }
+
   struct AJArrayElement * current = aja->FirstElement;
   int currentIndex = 0;
   for(int i = 0; i < aja->length; i++){
@@ -1085,9 +1935,8 @@ void PrettyPrintAJArray(struct AJArray * aja, int indentationCount){
     switch (current->ArrayElementType) {
       case TYPE_NUMBER :{
         printf("%s%c", whitespace, indentation); //elements are 1 more indentation away from bracket
-        double myNum = ((struct AJNumber*)(current->ArrayElement))->number;
-        __internal__CreateNumberDigitFormat(finalNumberFormatString, __internal__DefaultDoublePrintDigitCount);
-        printf(finalNumberFormatString, myNum);
+        double myNum = AJNumberGetDouble(((struct AJNumber*)(current->ArrayElement)));
+        printf(ctx->NumberFormatString, myNum);
         break;
       }
       case TYPE_STRING :{
@@ -1155,22 +2004,36 @@ int WritePrimitiveTypeAsStringToBuffer(void* obj, int type, char ** originalBuff
     //writes a number, string, bool, or null to a HEAP CHAR ARRAY. the char array will be resized as necessary to fit everything.
     //it returns actual characters written count + 1 for the null terminator. so if sequentially writing to the same buffer,
     //make sure to DECREMENT the next positionToStartWriting arg to overwrite that null term.
+    struct AJContext * ctx = AJGetContext();
     int digitsWritten = 0;
     (*originalBufferPointer)[positionToStartWriting] = '\0';
 
     switch(type){
         case TYPE_NUMBER :{
             // printf("Writing a number\n");
-            double myNum = ((struct AJNumber*)obj)->number;
-            char numStrBuf[326]; // chars needed to display the longest double string in C
+            struct AJNumber * ayomide = (struct AJNumber*)obj;
+            char * lexeme = __internal__CurrentLexeme(ayomide);
+            if(lexeme != NULL){ //copy the source text back out, no conversions
+                digitsWritten = strlen(lexeme) + 1;
+                if(*buflength - positionToStartWriting < digitsWritten){
+                    *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + digitsWritten + ctx->DefaultReallocIncreaseSize);
+                    *buflength += digitsWritten + ctx->DefaultReallocIncreaseSize;
+                }
+                memcpy(&(*originalBufferPointer)[positionToStartWriting], lexeme, digitsWritten); //includes the null terminator
+                break;
+            }
+            double myNum = ayomide->number;
+            char numStrBuf[AJ_NUMBER_TEXT_SIZE]; // chars needed to display the longest double string in C
             numStrBuf[0] = '\0';
-            __internal__CreateNumberDigitFormat(finalNumberFormatString, __internal__DefaultDoublePrintDigitCount);
-            digitsWritten = sprintf(numStrBuf, finalNumberFormatString, myNum) + 1; // include null ptr
+            digitsWritten = snprintf(numStrBuf, sizeof(numStrBuf), ctx->NumberFormatString, myNum);
+            if(digitsWritten < 0){digitsWritten = 0; numStrBuf[0] = '\0';}
+            if(digitsWritten > (int)sizeof(numStrBuf) - 1){digitsWritten = sizeof(numStrBuf) - 1;}
+            digitsWritten += 1; // include null ptr
 
             // Ensure buffer is large enough
             if(*buflength - positionToStartWriting < digitsWritten){
-                *originalBufferPointer = realloc(*originalBufferPointer, *buflength + digitsWritten + __internal__DefaultReallocIncreaseSize);
-                *buflength += digitsWritten + __internal__DefaultReallocIncreaseSize;
+                *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + digitsWritten + ctx->DefaultReallocIncreaseSize);
+                *buflength += digitsWritten + ctx->DefaultReallocIncreaseSize;
             }
             strcat(&(*originalBufferPointer)[positionToStartWriting], numStrBuf);
             break;
@@ -1178,23 +2041,32 @@ int WritePrimitiveTypeAsStringToBuffer(void* obj, int type, char ** originalBuff
         case TYPE_STRING :{
             // printf("Writing a string\n");
             char * s = ((struct AJString*)obj)->string;
-            int slen = strlen(s);
-            digitsWritten = slen + 3; // +2 for quotes, +1 for null terminator
+            int slen = ((struct AJString*)obj)->length;
+            //the chars up to the first one needing an escape are copied as they are and the rest is escaped (Raw strings already are)
+            int cleanLength = ((struct AJString*)obj)->Raw ? slen : __internal__NextCharToEscape(s, 0, slen, ctx->EscapeNonAscii);
+            int escapedLength = cleanLength;
+            if(cleanLength != slen){
+                escapedLength += __internal__EscapedLength(&s[cleanLength], slen - cleanLength, ctx->EscapeNonAscii);
+            }
+            digitsWritten = escapedLength + 3; // +2 for quotes, +1 for null terminator
 
             // Ensure buffer is large enough
             if(*buflength - positionToStartWriting < digitsWritten){
-                *originalBufferPointer = realloc(*originalBufferPointer, *buflength + digitsWritten + __internal__DefaultReallocIncreaseSize);
-                *buflength +=digitsWritten +  __internal__DefaultReallocIncreaseSize;
+                *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + digitsWritten + ctx->DefaultReallocIncreaseSize);
+                *buflength +=digitsWritten +  ctx->DefaultReallocIncreaseSize;
             }
 
             // Write opening quote
             (*originalBufferPointer)[positionToStartWriting] = '"';
             // Copy the string content
-            strcpy(&(*originalBufferPointer)[positionToStartWriting + 1], s);
+            memcpy(&(*originalBufferPointer)[positionToStartWriting + 1], s, cleanLength);
+            if(cleanLength != slen){
+                __internal__WriteEscapedChars(&s[cleanLength], slen - cleanLength, &(*originalBufferPointer)[positionToStartWriting + 1 + cleanLength], ctx->EscapeNonAscii);
+            }
             // Write closing quote
-            (*originalBufferPointer)[positionToStartWriting + 1 + slen] = '"';
+            (*originalBufferPointer)[positionToStartWriting + 1 + escapedLength] = '"';
             // Write null terminator
-            (*originalBufferPointer)[positionToStartWriting + 1 + slen + 1] = '\0';
+            (*originalBufferPointer)[positionToStartWriting + 1 + escapedLength + 1] = '\0';
             break;
         }
         case TYPE_BOOLEAN:{
@@ -1202,15 +2074,15 @@ int WritePrimitiveTypeAsStringToBuffer(void* obj, int type, char ** originalBuff
             if(((struct AJBoolean*)obj)->TruthValue == 1){
                 digitsWritten = 5;
                 if(*buflength - positionToStartWriting < digitsWritten){
-                    *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-                    *buflength += __internal__DefaultReallocIncreaseSize;
+                    *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+                    *buflength += ctx->DefaultReallocIncreaseSize;
                 }
                 strcat(&(*originalBufferPointer)[positionToStartWriting], "true");
             }else{
                 digitsWritten = 6;
                 if(*buflength - positionToStartWriting < digitsWritten){
-                    *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-                    *buflength += __internal__DefaultReallocIncreaseSize;
+                    *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+                    *buflength += ctx->DefaultReallocIncreaseSize;
                 }
                 strcat(&(*originalBufferPointer)[positionToStartWriting], "false");
             }
@@ -1220,8 +2092,8 @@ int WritePrimitiveTypeAsStringToBuffer(void* obj, int type, char ** originalBuff
             // printf("Writing a null value\n");
             digitsWritten = 5;
             if(*buflength - positionToStartWriting < digitsWritten){
-                *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-                *buflength += __internal__DefaultReallocIncreaseSize;
+                *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+                *buflength += ctx->DefaultReallocIncreaseSize;
             }
             strcat(&(*originalBufferPointer)[positionToStartWriting], "null");
             break;
@@ -1232,13 +2104,20 @@ int WritePrimitiveTypeAsStringToBuffer(void* obj, int type, char ** originalBuff
 }
 
 int WriteAJArrayAsStringToBuffer(struct AJArray * aja, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+    struct AJContext * ctx = AJGetContext();
+    if(ctx->TextCache != NULL){ //unchanged since the last write? copy that text
+        int cachedLength = __internal__WriteCachedText(ctx->TextCache, aja, originalBufferPointer, buflength, positionToStartWriting);
+        if(cachedLength != 0){
+            return cachedLength;
+        }
+    }
     (*originalBufferPointer)[positionToStartWriting] = '\0';
     int bytesWritten = positionToStartWriting;
 
     //write "[ " to the buffer first
     if(*buflength - positionToStartWriting < 3){
-        *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-        *buflength += __internal__DefaultReallocIncreaseSize;
+        *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+        *buflength += ctx->DefaultReallocIncreaseSize;
     }
     strcat(&(*originalBufferPointer)[positionToStartWriting], "[ ");
     positionToStartWriting += 2; // "[ " is 2 chars (not counting null terminator)
@@ -1246,7 +2125,12 @@ int WriteAJArrayAsStringToBuffer(struct AJArray * aja, char ** originalBufferPoi
     //loop over all the array elements
     struct AJArrayElement * current = aja->FirstElement;
     for(int i = 0; i < aja->length; i++){
-        if(isPrimitiveAJType(current->ArrayElementType)){
+        if(aja->PackedNumbers != NULL){
+            struct AJNumber packed;
+            packed.number = aja->PackedNumbers[i];
+            packed.Lexeme = NULL;
+            positionToStartWriting += WritePrimitiveTypeAsStringToBuffer(&packed, TYPE_NUMBER, originalBufferPointer, buflength, positionToStartWriting) - 1;
+        }else if(isPrimitiveAJType(current->ArrayElementType)){
             positionToStartWriting += WritePrimitiveTypeAsStringToBuffer(current->ArrayElement, current->ArrayElementType, originalBufferPointer, buflength, positionToStartWriting) - 1;
         }else{
             switch(current->ArrayElementType){
@@ -1260,35 +2144,50 @@ int WriteAJArrayAsStringToBuffer(struct AJArray * aja, char ** originalBufferPoi
                 }
             }
         }
+        if(ctx->TextCache != NULL && aja->PackedNumbers == NULL){
+            __internal__NoteCachedChild(ctx->TextCache, current->ArrayElement, aja);
+        }
         if(i != aja->length - 1){
             if(*buflength - positionToStartWriting < 3){
-                *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-                *buflength += __internal__DefaultReallocIncreaseSize;
+                *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+                *buflength += ctx->DefaultReallocIncreaseSize;
             }
             strcat(&(*originalBufferPointer)[positionToStartWriting], ", ");
             positionToStartWriting += 2; // ", " is 2 chars
         }
-        current = current->NextAJElement;
+        if(current != NULL){
+            current = current->NextAJElement;
+        }
     }
 
     if(*buflength - positionToStartWriting < 3){
-        *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-        *buflength += __internal__DefaultReallocIncreaseSize;
+        *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+        *buflength += ctx->DefaultReallocIncreaseSize;
     }
 
     strcat(&(*originalBufferPointer)[positionToStartWriting], " ]");
     positionToStartWriting += 2; // " ]" is 2 chars
 
+    if(ctx->TextCache != NULL){
+        __internal__StoreCachedText(ctx->TextCache, aja, &(*originalBufferPointer)[bytesWritten], positionToStartWriting - bytesWritten);
+    }
     return positionToStartWriting - bytesWritten + 1; // +1 for null terminator
 }
 
 int WriteAJObjectAsStringToBuffer(struct AJObject * ajo, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+    struct AJContext * ctx = AJGetContext();
+    if(ctx->TextCache != NULL){ //unchanged since the last write? copy that text
+        int cachedLength = __internal__WriteCachedText(ctx->TextCache, ajo, originalBufferPointer, buflength, positionToStartWriting);
+        if(cachedLength != 0){
+            return cachedLength;
+        }
+    }
     (*originalBufferPointer)[positionToStartWriting] = '\0';
     int bytesWritten = positionToStartWriting;
 
     if(*buflength - positionToStartWriting < 3){
-        *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-        *buflength += __internal__DefaultReallocIncreaseSize;
+        *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+        *buflength += ctx->DefaultReallocIncreaseSize;
     }
     strcat(&(*originalBufferPointer)[positionToStartWriting], "{ ");
     positionToStartWriting += 2; // "{ " is 2 chars
@@ -1314,8 +2213,8 @@ int WriteAJObjectAsStringToBuffer(struct AJObject * ajo, char ** originalBufferP
 
         // Write separator
         if(*buflength - positionToStartWriting < 4){
-            *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-            *buflength += __internal__DefaultReallocIncreaseSize;
+            *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+            *buflength += ctx->DefaultReallocIncreaseSize;
         }
         strcat(&(*originalBufferPointer)[positionToStartWriting], " : ");
         positionToStartWriting += 3; // " : " is 3 chars
@@ -1335,12 +2234,15 @@ int WriteAJObjectAsStringToBuffer(struct AJObject * ajo, char ** originalBufferP
                 }
             }
         }
+        if(ctx->TextCache != NULL){
+            __internal__NoteCachedChild(ctx->TextCache, ajkvp->value, ajo);
+        }
 
         // Add comma if not last element
         if(i != ajo->AJKVPCount - 1){
             if(*buflength - positionToStartWriting < 3){
-                *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-                *buflength += __internal__DefaultReallocIncreaseSize;
+                *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+                *buflength += ctx->DefaultReallocIncreaseSize;
             }
             strcat(&(*originalBufferPointer)[positionToStartWriting], ", ");
             positionToStartWriting += 2; // ", " is 2 chars
@@ -1350,27 +2252,31 @@ int WriteAJObjectAsStringToBuffer(struct AJObject * ajo, char ** originalBufferP
     }
 
     if(*buflength - positionToStartWriting < 3){
-        *originalBufferPointer = realloc(*originalBufferPointer, *buflength + __internal__DefaultReallocIncreaseSize);
-        *buflength += __internal__DefaultReallocIncreaseSize;
+        *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + ctx->DefaultReallocIncreaseSize);
+        *buflength += ctx->DefaultReallocIncreaseSize;
     }
     strcat(&(*originalBufferPointer)[positionToStartWriting], " }");
     positionToStartWriting += 2; // " }" is 2 chars
 
+    if(ctx->TextCache != NULL){
+        __internal__StoreCachedText(ctx->TextCache, ajo, &(*originalBufferPointer)[bytesWritten], positionToStartWriting - bytesWritten);
+    }
     return positionToStartWriting - bytesWritten + 1; // +1 for null terminator
 }
 
 void MinimizeCharArrayByteSize(char ** originalBufferPointer, int * len, int actualByteSize){
-  *originalBufferPointer = realloc(*originalBufferPointer, actualByteSize);
+  *originalBufferPointer = __internal__Realloc(*originalBufferPointer, actualByteSize);
   *len = actualByteSize;
 }
 
 int AppendToBuffer(char * toWrite, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
   //write 'toWrite' to the end of originalBufferPointer (e.g *originalBufferPointer[positionToStartWriting]), and add a null char
   //resize buffer if necessary
+  struct AJContext * ctx = AJGetContext();
   int lenToWrite = strlen(toWrite) + 1;
   if(*buflength < lenToWrite){
-    *originalBufferPointer = realloc(*originalBufferPointer, *buflength + lenToWrite + __internal__DefaultReallocIncreaseSize);
-    *buflength += lenToWrite + __internal__DefaultReallocIncreaseSize;
+    *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + lenToWrite + ctx->DefaultReallocIncreaseSize);
+    *buflength += lenToWrite + ctx->DefaultReallocIncreaseSize;
   }
   (*originalBufferPointer)[positionToStartWriting] = '\0';
   strcat(&(*originalBufferPointer)[positionToStartWriting], toWrite);
@@ -1413,9 +2319,10 @@ void PrintPureByteArray(char * toPrint, int length, char * howToPrint){
 
 int AppendToBuffer_WithKnownLengthOfInput(char * toWrite, int lengthOfToWrite, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
   //uses memcpy for known lengths (e.g if we copy a number, it may have 0x00 bytes and cause strcat to fail.)4
+  struct AJContext * ctx = AJGetContext();
   if(*buflength < lengthOfToWrite + 1){
-    *originalBufferPointer = realloc(*originalBufferPointer, *buflength + lengthOfToWrite + __internal__DefaultReallocIncreaseSize);
-    *buflength += lengthOfToWrite + __internal__DefaultReallocIncreaseSize;
+    *originalBufferPointer = __internal__Realloc(*originalBufferPointer, *buflength + lengthOfToWrite + ctx->DefaultReallocIncreaseSize);
+    *buflength += lengthOfToWrite + ctx->DefaultReallocIncreaseSize;
   }
   (*originalBufferPointer)[positionToStartWriting] = '\0';
   memcpy(&(*originalBufferPointer)[positionToStartWriting], toWrite, lengthOfToWrite);
@@ -1447,7 +2354,7 @@ char * LoadJSONFromFile(char * filename){
   fseek(file, 0, SEEK_SET);
 
   // Allocate memory (+1 for null terminator)
-  content = malloc(file_size + 1);
+  content = __internal__Malloc(file_size + 1);
   if(content == NULL) {
     printf("Memory allocation failed");
     fclose(file);
@@ -1462,15 +2369,26 @@ char * LoadJSONFromFile(char * filename){
   return content;
 }
 
-//linear search for number or string
+//linear search for number or string. *getIndexInArray is the index of the match, or -1 when there is none.
+//packed arrays are searched in place, but they have no elements to hand back: a match there only sets the index and returns NULL.
 struct AJArrayElement * SearchArrayForElement(struct AJArray * arr, void * elem_NumOrString, int type, int* getIndexInArray){
   struct AJArrayElement * current = arr->FirstElement;
   int index = 0;
+  *getIndexInArray = -1;
   if(type == TYPE_NUMBER){
     double searchFor = *((double*)elem_NumOrString);
+    if(arr->PackedNumbers != NULL){
+      for(int i = 0; i < arr->length; i++){
+        if(arr->PackedNumbers[i] == searchFor){
+          *getIndexInArray = i;
+          break;
+        }
+      }
+      return NULL;
+    }
     while(current != NULL){
       if(current->ArrayElementType == TYPE_NUMBER){
-        if(((struct AJNumber*)(current->ArrayElement))->number == searchFor){
+        if(AJNumberGetDouble((struct AJNumber*)(current->ArrayElement)) == searchFor){
           *getIndexInArray = index;
           return current;
         }
@@ -1496,6 +2414,10 @@ struct AJArrayElement * SearchArrayForElement(struct AJArray * arr, void * elem_
 
 struct AJKeyValuePair * SearchObjectForKey(char * key, struct AJObject * obj){
   if(key == NULL){return NULL;}
+  if(obj->Shape != NULL){ //hash lookup, then an indexed load
+    int idx = GetAJShapeKeyIndex(obj->Shape, key);
+    return idx < 0 ? NULL : &obj->KVPBlock[idx];
+  }
 
 
   struct AJKeyValuePair * current = obj->FirstAJKVP;
@@ -1510,100 +2432,56 @@ struct AJKeyValuePair * SearchObjectForKey(char * key, struct AJObject * obj){
   return NULL;
 }
 
-void DeleteAJArray(struct AJArray * aja){//linearly free all heap resources referenced by this AJA.
+void DeleteAJArray(struct AJArray * aja){//linearly free all heap resources referenced by this AJA. uses the current context's allocator (see AJAllocator)
+  if(aja->RefCount > 1){ //shared: just drop this reference
+    aja->RefCount--;
+    return;
+  }
+  __internal__ForgetCachedText(aja);
   struct AJArrayElement * AJae = aja->FirstElement;
   while(AJae != NULL){
-    switch(AJae->ArrayElementType){
-      case TYPE_NUMBER:
-      case TYPE_BOOLEAN:
-      case TYPE_NULL:{
-        free(AJae->ArrayElement); //for these three, all memory is inside the struct
-        break;
-      }
-      case TYPE_STRING:{
-        struct AJString * hold = (struct AJString *)AJae->ArrayElement;
-        free(hold->string);
-        free(hold);
-        break;
-      }
-      case TYPE_ARRAY:{
-        struct AJArray * hold = (struct AJArray *)AJae->ArrayElement;
-        DeleteAJArray(hold);
-        break;
-      }
-      case TYPE_OBJECT:{
-        struct AJObject * hold = (struct AJObject *)AJae->ArrayElement;
-        DeleteAJObject(hold);
-        break;
-      }
+    if(AJae->ArrayElement != (void*)&AJae->InlineElement){ //inline scalars live in the element itself
+      AJDelete(AJae->ArrayElement, AJae->ArrayElementType);
+    }else{
+      __internal__ForgetCachedText(AJae->ArrayElement);
     }
     struct AJArrayElement * prev = AJae;
     AJae = AJae->NextAJElement;
-    free(prev);
+    if(!__internal__IsInElementBlock(aja, prev)){
+      __internal__Free(prev);
+    }
   }
-  free(aja);
+  __internal__Free(aja->ElementBlock);
+  __internal__Free(aja->PackedNumbers);
+  __internal__Free(aja);
 }
 
-void DeleteAJObject(struct AJObject * ajo){//recursively free all heap resources referenced by this AJO. Make sure to change references to this object when deleting.
+void DeleteAJObject(struct AJObject * ajo){//recursively free all heap resources referenced by this AJO. Make sure to change references to this object when deleting. uses the current context's allocator (see AJAllocator)
+  if(ajo->RefCount > 1){ //shared: just drop this reference
+    ajo->RefCount--;
+    return;
+  }
+  __internal__ForgetCachedText(ajo);
   struct AJKeyValuePair * ak = ajo->FirstAJKVP;
   while (ak != NULL) {
-    switch(ak->KeyType){
-      case TYPE_NUMBER:
-      case TYPE_BOOLEAN:
-      case TYPE_NULL:{
-        free(ak->key);
-        break;
-      }
-      case TYPE_STRING:{
-        struct AJString * hold = (struct AJString *)ak->key;
-        free(hold->string);
-        free(hold);
-        break;
-      }
-      case TYPE_ARRAY:{
-        struct AJArray * hold = (struct AJArray *)ak->key;
-        DeleteAJArray(hold);
-        break;
-      }
-      case TYPE_OBJECT:{
-        struct AJObject * hold = (struct AJObject *)ak->key;
-        DeleteAJObject(hold);
-        break;
-      }
-
+    if(ajo->Shape == NULL){ //shaped keys belong to the shape
+      AJDelete(ak->key, ak->KeyType);
     }
-
-    switch(ak->ValueType){
-      case TYPE_NUMBER:
-      case TYPE_BOOLEAN:
-      case TYPE_NULL:{
-        free(ak->value);
-        break;
-      }
-      case TYPE_STRING:{
-        struct AJString * hold = (struct AJString *)ak->value;
-        free(hold->string);
-        free(hold);
-        break;
-      }
-      case TYPE_ARRAY:{
-        struct AJArray * hold = (struct AJArray *)ak->value;
-        DeleteAJArray(hold);
-        break;
-      }
-      case TYPE_OBJECT:{
-        struct AJObject * hold = (struct AJObject *)ak->value;
-        DeleteAJObject(hold);
-        break;
-      }
-
+    if(ak->value != (void*)&ak->InlineValue){ //inline scalars live in the KVP itself
+      AJDelete(ak->value, ak->ValueType);
+    }else{
+      __internal__ForgetCachedText(ak->value);
     }
 
     struct AJKeyValuePair * prev = ak;
     ak = ak->NextAJKVP;
-    free(prev);
+    if(!__internal__IsInKVPBlock(ajo, prev)){
+      __internal__Free(prev);
+    }
 
   }
+  __internal__Free(ajo->KVPBlock);
+  __internal__Free(ajo);
 }
 
 //delete anything
@@ -1612,12 +2490,18 @@ void AJDelete(void * aj, int elementType){
     case TYPE_NUMBER:
     case TYPE_BOOLEAN:
     case TYPE_NULL:{
-      free(aj);
+      __internal__ForgetCachedText(aj);
+      __internal__Free(aj);
       break;
     }
     case TYPE_STRING:{
-      free(((struct AJString *)aj)->string);
-      free(aj);
+      if(((struct AJString *)aj)->RefCount > 1){ //shared: just drop this reference
+        ((struct AJString *)aj)->RefCount--;
+        break;
+      }
+      __internal__ForgetCachedText(aj);
+      __internal__FreeAJStringChars((struct AJString *)aj);
+      __internal__Free(aj);
       break;
     }
 
@@ -1632,51 +2516,7261 @@ void AJDelete(void * aj, int elementType){
   }
 }
 
-typedef struct AJString AJString;
-typedef struct AJNumber AJNumber;
-typedef struct AJArray AJArray;
-typedef struct AJObject AJObject;
-typedef struct AJBoolean AJBoolean;
-typedef struct AJNull AJNull;
-typedef struct AJArrayElement AJArrayElement;
-typedef struct AJKeyValuePair AJKeyValuePair;
+/*MessagePack encoding. Same tree, but binary: containers are length prefixed and numbers are raw
+big endian doubles (or ints when the double is a whole number), so there is no text number conversion on
+either side. Any msgpack reader in another language can decode what we write.*/
+#define MSGPACK_NIL 0xc0
+#define MSGPACK_FALSE 0xc2
+#define MSGPACK_TRUE 0xc3
+#define MSGPACK_FLOAT32 0xca
+#define MSGPACK_FLOAT64 0xcb
+#define MSGPACK_UINT8 0xcc
+#define MSGPACK_UINT16 0xcd
+#define MSGPACK_UINT32 0xce
+#define MSGPACK_UINT64 0xcf
+#define MSGPACK_INT8 0xd0
+#define MSGPACK_INT16 0xd1
+#define MSGPACK_INT32 0xd2
+#define MSGPACK_INT64 0xd3
+#define MSGPACK_BIN8 0xc4
+#define MSGPACK_BIN16 0xc5
+#define MSGPACK_BIN32 0xc6
+#define MSGPACK_STR8 0xd9
+#define MSGPACK_STR16 0xda
+#define MSGPACK_STR32 0xdb
+#define MSGPACK_ARRAY16 0xdc
+#define MSGPACK_ARRAY32 0xdd
+#define MSGPACK_MAP16 0xde
+#define MSGPACK_MAP32 0xdf
+#define MSGPACK_MAX_DEPTH 512 //deeper input is refused instead of running the decoder's recursion out of stack
+
+//grows the buffer so that 'needed' more bytes fit starting at positionToStartWriting
+void __internal__EnsureBufferSpace(char ** originalBufferPointer, int * buflength, int positionToStartWriting, int needed){
+  if(*buflength - positionToStartWriting < needed){
+    struct AJContext * ctx = AJGetContext();
+    *originalBufferPointer = (char*)__internal__Realloc(*originalBufferPointer, positionToStartWriting + needed + ctx->DefaultReallocIncreaseSize);
+    *buflength = positionToStartWriting + needed + ctx->DefaultReallocIncreaseSize;
+  }
+}
 
-// #define TESTING_AROLAN_JSON
-#ifdef TESTING_AROLAN_JSON
-//small test suite
-int main(){
-  char * JSONFile = LoadJSONFromFile("test.json");
-  AJNumber * nu = CreateAJNumber(11.17f);
-  AJString * st = CreateAJString("Eni To Ba Da Omi Siwaju ");
-  AJBoolean * bo = CreateAJBoolean("TRUE");
-  AJNull * nul = CreateAJNull();
+//writes the lowest 'byteCount' bytes of val big endian (network order, like msgpack wants)
+static inline void __internal__WriteBigEndian(unsigned char * dest, unsigned long long val, int byteCount){
+  for(int i = byteCount - 1; i >= 0; i--){
+    dest[i] = (unsigned char)(val & 0xff);
+    val >>= 8;
+  }
+}
 
-  int hold = 0;
-  AJArray * aja = ParseNewAJArray(0, "[{'a':1},{'b':2},{'c':3},{'d':4},{'e':5}]", &hold);
+static inline unsigned long long __internal__ReadBigEndian(unsigned char * src, int byteCount){
+  unsigned long long val = 0;
+  for(int i = 0; i < byteCount; i++){
+    val = (val << 8) | src[i];
+  }
+  return val;
+}
 
-  hold = 0;
-  AJObject * ajo = ParseNewAJObject(0, "{ 'key1' :  1, 'key2' : null, 'arraykey' : [{'false':true}], 'objectkey': {'subkey1' : false, 'subkey2' : 20} }", &hold);
-  // AJObject * ajo = ParseNewAJObject(0, "{'a':'b'}", &hold);
-  // AJObject * ajo = ParseNewAJObject(0, JSONFile, &hold);
+//writes a container/str header: fix form if it fits in fixMax, else the 8/16/32 bit forms.
+//pass 0 for marker8 when the type has no 8 bit form (arrays and maps dont)
+int __internal__WriteMsgPackHeader(unsigned char fixMarker, unsigned int fixMax, unsigned char marker8, unsigned char marker16, unsigned char marker32, unsigned int count, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, 5);
+  unsigned char * dest = (unsigned char *)&(*originalBufferPointer)[positionToStartWriting];
+  if(count <= fixMax){
+    dest[0] = fixMarker | (unsigned char)count;
+    return 1;
+  }
+  if(marker8 != 0 && count <= 0xff){
+    dest[0] = marker8;
+    dest[1] = (unsigned char)count;
+    return 2;
+  }
+  if(count <= 0xffff){
+    dest[0] = marker16;
+    __internal__WriteBigEndian(&dest[1], count, 2);
+    return 3;
+  }
+  dest[0] = marker32;
+  __internal__WriteBigEndian(&dest[1], count, 4);
+  return 5;
+}
 
-  // PrettyPrintAJObject(ajo, 0);
+int __internal__WriteMsgPackNumber(double num, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, 9);
+  unsigned char * dest = (unsigned char *)&(*originalBufferPointer)[positionToStartWriting];
+
+  //whole numbers go out as msgpack ints. they are smaller and other languages read them back as ints.
+  //(9007199254740992 = 2^53, past that doubles cant hold every whole number anyway)
+  //the range check goes first: it also turns away NaN and infinities, and casting those (or anything huge) to long long is undefined
+  if(num >= -9007199254740992.0 && num <= 9007199254740992.0 && num == (double)(long long)num && !(num == 0 && 1/num < 0)){
+    long long whole = (long long)num;
+    if(whole >= 0 && whole <= 0x7f){
+      dest[0] = (unsigned char)whole; //positive fixint
+      return 1;
+    }
+    if(whole < 0 && whole >= -32){
+      dest[0] = (unsigned char)(0xe0 | (whole + 32)); //negative fixint
+      return 1;
+    }
+    if(whole >= -128 && whole <= 127){
+      dest[0] = MSGPACK_INT8;
+      __internal__WriteBigEndian(&dest[1], (unsigned long long)whole, 1);
+      return 2;
+    }
+    if(whole >= -32768 && whole <= 32767){
+      dest[0] = MSGPACK_INT16;
+      __internal__WriteBigEndian(&dest[1], (unsigned long long)whole, 2);
+      return 3;
+    }
+    if(whole >= -2147483647LL - 1 && whole <= 2147483647LL){
+      dest[0] = MSGPACK_INT32;
+      __internal__WriteBigEndian(&dest[1], (unsigned long long)whole, 4);
+      return 5;
+    }
+    dest[0] = MSGPACK_INT64;
+    __internal__WriteBigEndian(&dest[1], (unsigned long long)whole, 8);
+    return 9;
+  }
 
-  int len = 1;
-  char * buf = (char*)malloc(sizeof(char) * len);
-  // memset(buf, '\0', len);
+  unsigned long long bits;
+  memcpy(&bits, &num, 8);
+  dest[0] = MSGPACK_FLOAT64;
+  __internal__WriteBigEndian(&dest[1], bits, 8);
+  return 9;
+}
 
-  int bytes_written = 0;
-  int pos = 0;
-  pos += WriteAJObjectAsStringToBuffer(ajo, &buf, &len, pos) - 1;
-  // pos += WriteAJArrayAsStringToBuffer(aja, buf, &len, pos) - 1;
+int __internal__WriteMsgPackValue(void * obj, int type, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  int start = positionToStartWriting;
+  switch(type){
+    case TYPE_NUMBER :{
+      positionToStartWriting += __internal__WriteMsgPackNumber(AJNumberGetDouble((struct AJNumber*)obj), originalBufferPointer, buflength, positionToStartWriting);
+      break;
+    }
+    case TYPE_STRING :{
+      char * s = ((struct AJString*)obj)->string;
+      int slen = ((struct AJString*)obj)->length;
+      positionToStartWriting += __internal__WriteMsgPackHeader(0xa0, 31, MSGPACK_STR8, MSGPACK_STR16, MSGPACK_STR32, slen, originalBufferPointer, buflength, positionToStartWriting);
+      __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, slen);
+      memcpy(&(*originalBufferPointer)[positionToStartWriting], s, slen);
+      positionToStartWriting += slen;
+      break;
+    }
+    case TYPE_BOOLEAN :{
+      __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, 1);
+      (*originalBufferPointer)[positionToStartWriting++] = (char)(((struct AJBoolean*)obj)->TruthValue == 1 ? MSGPACK_TRUE : MSGPACK_FALSE);
+      break;
+    }
+    case TYPE_NULL :{
+      __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, 1);
+      (*originalBufferPointer)[positionToStartWriting++] = (char)MSGPACK_NIL;
+      break;
+    }
+    case TYPE_ARRAY :{
+      positionToStartWriting += WriteAJArrayAsMsgPackToBuffer((struct AJArray*)obj, originalBufferPointer, buflength, positionToStartWriting);
+      break;
+    }
+    case TYPE_OBJECT :{
+      positionToStartWriting += WriteAJObjectAsMsgPackToBuffer((struct AJObject*)obj, originalBufferPointer, buflength, positionToStartWriting);
+      break;
+    }
+  }
+  return positionToStartWriting - start;
+}
 
-  int len2 = 100;
-  char * buf2 = (char*)malloc(sizeof(char) * len);
-  int f = 16843009;
-  AppendToBuffer_WithKnownLengthOfInput((char*)&f, 4, &buf2, &len2, 0);
+//writes aja as a msgpack array. Unlike the text writers, no null terminator is added (msgpack is binary and may contain 0x00 bytes),
+//so the return value is exactly the number of bytes written.
+int WriteAJArrayAsMsgPackToBuffer(struct AJArray * aja, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  int start = positionToStartWriting;
+  positionToStartWriting += __internal__WriteMsgPackHeader(0x90, 15, 0, MSGPACK_ARRAY16, MSGPACK_ARRAY32, aja->length, originalBufferPointer, buflength, positionToStartWriting);
 
+  if(aja->PackedNumbers != NULL){
+    for(int i = 0; i < aja->length; i++){
+      positionToStartWriting += __internal__WriteMsgPackNumber(aja->PackedNumbers[i], originalBufferPointer, buflength, positionToStartWriting);
+    }
+    return positionToStartWriting - start;
+  }
 
-  printf("%s\n", buf2);
+  struct AJArrayElement * current = aja->FirstElement;
+  for(int i = 0; i < aja->length; i++){
+    positionToStartWriting += __internal__WriteMsgPackValue(current->ArrayElement, current->ArrayElementType, originalBufferPointer, buflength, positionToStartWriting);
+    current = current->NextAJElement;
+  }
+  return positionToStartWriting - start;
+}
+
+//writes ajo as a msgpack map. Keys keep whatever type they have (msgpack maps allow any key type). Returns bytes written, no null terminator.
+int WriteAJObjectAsMsgPackToBuffer(struct AJObject * ajo, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  int start = positionToStartWriting;
+  positionToStartWriting += __internal__WriteMsgPackHeader(0x80, 15, 0, MSGPACK_MAP16, MSGPACK_MAP32, ajo->AJKVPCount, originalBufferPointer, buflength, positionToStartWriting);
+
+  struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP;
+  for(int i = 0; i < ajo->AJKVPCount; i++){
+    positionToStartWriting += __internal__WriteMsgPackValue(ajkvp->key, ajkvp->KeyType, originalBufferPointer, buflength, positionToStartWriting);
+    positionToStartWriting += __internal__WriteMsgPackValue(ajkvp->value, ajkvp->ValueType, originalBufferPointer, buflength, positionToStartWriting);
+    ajkvp = ajkvp->NextAJKVP;
+  }
+  return positionToStartWriting - start;
+}
+
+//makes an AJString out of 'length' raw bytes (msgpack strings are not null terminated)
+struct AJString * __internal__CreateAJStringFromBytes(char * bytes, int length){
+  struct AJString * pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+  __internal__SetAJStringChars(pelumi, bytes, length);
+  pelumi->RefCount = 0;
+  return pelumi;
+}
+
+//puts a decoded scalar in inlineSlot when there is one (array elements and KVP values) and InlineScalars is on, else in its own node
+void * __internal__StoreMsgPackScalar(union AJInlineScalar * inlineSlot, int type, double number, char truthValue){
+  union AJInlineScalar * slot = AJGetContext()->InlineScalars ? inlineSlot : NULL;
+  if(slot == NULL){
+    slot = (union AJInlineScalar *)__internal__Malloc(type == TYPE_NUMBER ? sizeof(struct AJNumber) : type == TYPE_BOOLEAN ? sizeof(struct AJBoolean) : sizeof(struct AJNull));
+  }
+  if(type == TYPE_NUMBER){slot->Number.number = number; slot->Number.Lexeme = NULL;}
+  if(type == TYPE_BOOLEAN){slot->Boolean.TruthValue = truthValue;}
+  return (void*)slot;
+}
+
+//1 if 'needed' more bytes starting at idx are inside the input
+static inline int __internal__MsgPackHas(int idx, int length, unsigned long long needed){
+  return idx >= 0 && idx <= length && needed <= (unsigned long long)(length - idx);
+}
+
+//decodes one msgpack value starting at data[idx]; data is 'length' bytes long and nothing past it is read. On success *nextIdx is the
+//index right after the value. scalars are written into inlineSlot if it isnt NULL. returns NULL (and frees anything it made) on
+//malformed, truncated, too deeply nested or unsupported (ext) input.
+void * __internal__ParseMsgPackValue(int idx, unsigned char * data, int length, int depth, int * nextIdx, int * type, union AJInlineScalar * inlineSlot){
+  if(!__internal__MsgPackHas(idx, length, 1) || depth > MSGPACK_MAX_DEPTH){return NULL;}
+  unsigned char marker = data[idx];
+  long long count = -1; //for str/bin/array/map
+  int payload = idx + 1;
+  int width = 0; //bytes after the marker that hold the number or the count
+  if(marker == MSGPACK_FLOAT32 || marker == MSGPACK_STR32 || marker == MSGPACK_BIN32 || marker == MSGPACK_ARRAY32 || marker == MSGPACK_MAP32){width = 4;}
+  else if(marker == MSGPACK_FLOAT64){width = 8;}
+  else if(marker >= MSGPACK_UINT8 && marker <= MSGPACK_UINT64){width = 1 << (marker - MSGPACK_UINT8);}
+  else if(marker >= MSGPACK_INT8 && marker <= MSGPACK_INT64){width = 1 << (marker - MSGPACK_INT8);}
+  else if(marker == MSGPACK_STR8 || marker == MSGPACK_BIN8){width = 1;}
+  else if(marker == MSGPACK_STR16 || marker == MSGPACK_BIN16 || marker == MSGPACK_ARRAY16 || marker == MSGPACK_MAP16){width = 2;}
+  if(!__internal__MsgPackHas(payload, length, width)){return NULL;}
+
+  if(marker <= 0x7f){
+    *type = TYPE_NUMBER;
+    *nextIdx = idx + 1;
+    return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NUMBER, marker, 0);
+  }
+  if(marker >= 0xe0){
+    *type = TYPE_NUMBER;
+    *nextIdx = idx + 1;
+    return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NUMBER, (signed char)marker, 0);
+  }
+
+  switch(marker){
+    case MSGPACK_NIL:{
+      *type = TYPE_NULL;
+      *nextIdx = idx + 1;
+      return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NULL, 0, 0);
+    }
+    case MSGPACK_FALSE:
+    case MSGPACK_TRUE:{
+      *type = TYPE_BOOLEAN;
+      *nextIdx = idx + 1;
+      return __internal__StoreMsgPackScalar(inlineSlot, TYPE_BOOLEAN, 0, marker == MSGPACK_TRUE ? 1 : 0);
+    }
+    case MSGPACK_FLOAT32:{
+      unsigned int bits = (unsigned int)__internal__ReadBigEndian(&data[payload], 4);
+      float f;
+      memcpy(&f, &bits, 4);
+      *type = TYPE_NUMBER;
+      *nextIdx = payload + 4;
+      return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NUMBER, f, 0);
+    }
+    case MSGPACK_FLOAT64:{
+      unsigned long long bits = __internal__ReadBigEndian(&data[payload], 8);
+      double num;
+      memcpy(&num, &bits, 8);
+      *type = TYPE_NUMBER;
+      *nextIdx = payload + 8;
+      return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NUMBER, num, 0);
+    }
+    case MSGPACK_UINT8:
+    case MSGPACK_UINT16:
+    case MSGPACK_UINT32:
+    case MSGPACK_UINT64:{
+      *type = TYPE_NUMBER;
+      *nextIdx = payload + width;
+      return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NUMBER, (double)__internal__ReadBigEndian(&data[payload], width), 0);
+    }
+    case MSGPACK_INT8:
+    case MSGPACK_INT16:
+    case MSGPACK_INT32:
+    case MSGPACK_INT64:{
+      unsigned long long raw = __internal__ReadBigEndian(&data[payload], width);
+      if(width < 8 && (raw >> (width * 8 - 1)) & 1){
+        raw |= ~0ULL << (width * 8); //sign extend
+      }
+      *type = TYPE_NUMBER;
+      *nextIdx = payload + width;
+      return __internal__StoreMsgPackScalar(inlineSlot, TYPE_NUMBER, (double)(long long)raw, 0);
+    }
+    case MSGPACK_STR8:
+    case MSGPACK_BIN8:{
+      count = data[payload];
+      payload += 1;
+      *type = TYPE_STRING;
+      break;
+    }
+    case MSGPACK_STR16:
+    case MSGPACK_BIN16:{
+      count = (long long)__internal__ReadBigEndian(&data[payload], 2);
+      payload += 2;
+      *type = TYPE_STRING;
+      break;
+    }
+    case MSGPACK_STR32:
+    case MSGPACK_BIN32:{
+      count = (long long)__internal__ReadBigEndian(&data[payload], 4);
+      payload += 4;
+      *type = TYPE_STRING;
+      break;
+    }
+    case MSGPACK_ARRAY16:{
+      count = (long long)__internal__ReadBigEndian(&data[payload], 2);
+      payload += 2;
+      *type = TYPE_ARRAY;
+      break;
+    }
+    case MSGPACK_ARRAY32:{
+      count = (long long)__internal__ReadBigEndian(&data[payload], 4);
+      payload += 4;
+      *type = TYPE_ARRAY;
+      break;
+    }
+    case MSGPACK_MAP16:{
+      count = (long long)__internal__ReadBigEndian(&data[payload], 2);
+      payload += 2;
+      *type = TYPE_OBJECT;
+      break;
+    }
+    case MSGPACK_MAP32:{
+      count = (long long)__internal__ReadBigEndian(&data[payload], 4);
+      payload += 4;
+      *type = TYPE_OBJECT;
+      break;
+    }
+    default:{
+      if((marker & 0xe0) == 0xa0){ //fixstr
+        count = marker & 0x1f;
+        *type = TYPE_STRING;
+      }else if((marker & 0xf0) == 0x90){ //fixarray
+        count = marker & 0x0f;
+        *type = TYPE_ARRAY;
+      }else if((marker & 0xf0) == 0x80){ //fixmap
+        count = marker & 0x0f;
+        *type = TYPE_OBJECT;
+      }else{
+        return NULL; //ext types and the reserved 0xc1 marker have no AJ equivalent
+      }
+      break;
+    }
+  }
+
+  //every element takes at least a byte (a key and a value for maps), so a count bigger than what is left is a lie
+  if(count < 0 || !__internal__MsgPackHas(payload, length, *type == TYPE_OBJECT ? count * 2 : count)){return NULL;}
+
+  if(*type == TYPE_STRING){
+    *nextIdx = payload + (int)count;
+    if(AJGetContext()->Intern != NULL){
+      return (void*)__internal__InternAJStringBytes(AJGetContext()->Intern, (char*)&data[payload], (int)count);
+    }
+    return (void*)__internal__CreateAJStringFromBytes((char*)&data[payload], (int)count);
+  }
+
+  if(*type == TYPE_ARRAY){
+    struct AJArray * opeyemi = CreateAJArray();
+    struct AJArrayElement * previousArrayElement = NULL;
+    for(int i = 0; i < count; i++){
+      int elementType;
+      struct AJArrayElement * currentArrayElement = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement));
+      void * element = __internal__ParseMsgPackValue(payload, data, length, depth + 1, &payload, &elementType, &currentArrayElement->InlineElement);
+      if(element == NULL){
+        __internal__Free(currentArrayElement);
+        DeleteAJArray(opeyemi);
+        return NULL;
+      }
+      currentArrayElement->ArrayElement = element;
+      currentArrayElement->ArrayElementType = elementType;
+      currentArrayElement->PrevAJElement = previousArrayElement;
+      currentArrayElement->NextAJElement = NULL;
+      if(previousArrayElement != NULL){
+        previousArrayElement->NextAJElement = currentArrayElement;
+      }else{
+        opeyemi->FirstElement = currentArrayElement;
+      }
+      opeyemi->LastElement = currentArrayElement;
+      previousArrayElement = currentArrayElement;
+      opeyemi->length++;
+    }
+    if(AJGetContext()->PackNumericArrays){
+      __internal__PackAJArray(opeyemi, 1); //no-op unless it turned out to be all numbers
+    }
+    *nextIdx = payload;
+    if(AJGetContext()->Intern != NULL){
+      return __internal__InternAJContainer(AJGetContext()->Intern, (void*)opeyemi, TYPE_ARRAY);
+    }
+    return (void*)opeyemi;
+  }
+
+  //map
+  struct AJObject * adedoyin = CreateAJObject();
+  struct AJKeyValuePair * previousKVP = NULL;
+  for(int i = 0; i < count; i++){
+    int keyType, valueType;
+    void * key = __internal__ParseMsgPackValue(payload, data, length, depth + 1, &payload, &keyType, NULL);
+    if(key == NULL){
+      DeleteAJObject(adedoyin);
+      return NULL;
+    }
+    struct AJKeyValuePair * currentKVP = CreateAJKeyValuePair(key, keyType, NULL, TYPE_NULL);
+    void * value = __internal__ParseMsgPackValue(payload, data, length, depth + 1, &payload, &valueType, &currentKVP->InlineValue);
+    if(value == NULL){
+      AJDelete(key, keyType);
+      __internal__Free(currentKVP);
+      DeleteAJObject(adedoyin);
+      return NULL;
+    }
+    currentKVP->value = value;
+    currentKVP->ValueType = valueType;
+    currentKVP->PrevAJKVP = previousKVP;
+    if(previousKVP != NULL){
+      previousKVP->NextAJKVP = currentKVP;
+    }else{
+      adedoyin->FirstAJKVP = currentKVP;
+    }
+    adedoyin->LastAJKVP = currentKVP;
+    previousKVP = currentKVP;
+    adedoyin->AJKVPCount++;
+  }
+  if(AJGetContext()->Shapes != NULL){
+    __internal__ShapeAJObject(AJGetContext()->Shapes, adedoyin);
+  }
+  *nextIdx = payload;
+  if(AJGetContext()->Intern != NULL){
+    return __internal__InternAJContainer(AJGetContext()->Intern, (void*)adedoyin, TYPE_OBJECT);
+  }
+  return (void*)adedoyin;
+}
+
+/*ParseNewAJObjectFromMsgPack takes msgpack bytes (length of them) and the index of a map header, and decodes the map into a new AJObject.
+Like the other Parse functions, returnIdx gets the index of the last byte that belonged to the map.
+Every header, length and number is checked against length first, so untrusted input is fine: returns NULL if the bytes at that
+index are not a map, are malformed or cut short, or nest deeper than MSGPACK_MAX_DEPTH.*/
+struct AJObject * ParseNewAJObjectFromMsgPack(int indexOfMapHeader, char * MsgPackData, int length, int * returnIdx){
+  int type, nextIdx;
+  void * result = __internal__ParseMsgPackValue(indexOfMapHeader, (unsigned char *)MsgPackData, length, 0, &nextIdx, &type, NULL);
+  if(result == NULL){return NULL;}
+  if(type != TYPE_OBJECT){
+    AJDelete(result, type);
+    return NULL;
+  }
+  *returnIdx = nextIdx - 1;
+  return (struct AJObject *)result;
+}
+
+//same as ParseNewAJObjectFromMsgPack, but for a msgpack array
+struct AJArray * ParseNewAJArrayFromMsgPack(int indexOfArrayHeader, char * MsgPackData, int length, int * returnIdx){
+  int type, nextIdx;
+  void * result = __internal__ParseMsgPackValue(indexOfArrayHeader, (unsigned char *)MsgPackData, length, 0, &nextIdx, &type, NULL);
+  if(result == NULL){return NULL;}
+  if(type != TYPE_ARRAY){
+    AJDelete(result, type);
+    return NULL;
+  }
+  *returnIdx = nextIdx - 1;
+  return (struct AJArray *)result;
+}
+
+/*AJ Images: a parsed document written out position independent, so it can be mmap'd back and searched without parsing.
+Every node is 8 byte aligned and refers to other nodes by their offset from the start of the image (never by pointer),
+strings are stored inline with their length, and every object carries a key index sorted by key bytes so
+SearchAJImageObjectForKey is a binary search. Offset 0 is the image header, so an offset of 0 means 'not found'.
+Images can come from anywhere, so every offset read from one is checked against the image size before it is followed;
+an offset that points outside the image is treated like 'not found' (0), and a node that doesnt fit reads as empty.
+
+Layout:
+  header : "AJIMAGE" magic, version byte, u32 byte order mark, u32 root offset, u32 root type, u32 image size
+  number : u32 type, u32 pad, double
+  bool   : u32 type, u32 truth value
+  null   : u32 type, u32 pad
+  string : u32 type, u32 length, length bytes + null terminator
+  array  : u32 type, u32 count, u32 element offsets[count]
+  object : u32 type, u32 count, {u32 key offset, u32 value offset}[count], u32 sorted index[count]
+*/
+#define AJ_IMAGE_MAGIC "AJIMAGE"
+#define AJ_IMAGE_VERSION 1
+#define AJ_IMAGE_BYTE_ORDER_MARK 0x01020304u
+#define AJ_IMAGE_HEADER_SIZE 24
+
+struct AJImage{
+  char * base; //start of the image (the mapping, or the caller's buffer)
+  long size;
+  char isMapped; //1 if base came from mmap, 2 if we malloc'd it ourselves, 0 if it belongs to the caller
+};
+
+static inline unsigned int __internal__ImageReadU32(char * base, unsigned int offset){
+  unsigned int val;
+  memcpy(&val, base + offset, 4);
+  return val;
+}
+
+//1 if 'needed' bytes starting at offset are inside the image
+static inline int __internal__ImageHas(struct AJImage * img, unsigned long long offset, unsigned long long needed){
+  return offset <= (unsigned long long)img->size && needed <= (unsigned long long)img->size - offset;
+}
+
+//an offset read out of the image, or 0 if it doesnt point at a whole node header past the image header
+static inline unsigned int __internal__ImageChild(struct AJImage * img, unsigned int offset){
+  return offset >= AJ_IMAGE_HEADER_SIZE && __internal__ImageHas(img, offset, 8) ? offset : 0;
+}
+
+static inline void __internal__ImageWriteU32(char * base, unsigned int offset, unsigned int val){
+  memcpy(base + offset, &val, 4);
+}
+
+//reserves 'size' zeroed bytes at the next 8 byte aligned spot after *end (relative to imageStart) and returns its offset from imageStart
+unsigned int __internal__ImageReserve(char ** originalBufferPointer, int * buflength, int imageStart, int * end, int size){
+  int aligned = imageStart + ((*end - imageStart + 7) & ~7);
+  __internal__EnsureBufferSpace(originalBufferPointer, buflength, aligned, size);
+  memset(&(*originalBufferPointer)[*end], 0, aligned - *end + size);
+  *end = aligned + size;
+  return (unsigned int)(aligned - imageStart);
+}
+
+struct __internal__ImageKeySortEntry{
+  char * key;
+  unsigned int length;
+  unsigned int isString;
+  unsigned int index;
+};
+
+//strings sort by bytes (shorter first on a tie); non string keys go after all string keys and are never matched by a search
+int __internal__CompareImageKeys(const void * a, const void * b){
+  const struct __internal__ImageKeySortEntry * ka = (const struct __internal__ImageKeySortEntry *)a;
+  const struct __internal__ImageKeySortEntry * kb = (const struct __internal__ImageKeySortEntry *)b;
+  if(ka->isString != kb->isString){return ka->isString ? -1 : 1;}
+  if(!ka->isString){return (int)ka->index - (int)kb->index;}
+  unsigned int shorter = ka->length < kb->length ? ka->length : kb->length;
+  int c = memcmp(ka->key, kb->key, shorter);
+  if(c != 0){return c;}
+  if(ka->length != kb->length){return ka->length < kb->length ? -1 : 1;}
+  return 0;
+}
+
+//writes one node (and everything under it) and returns its offset from imageStart
+unsigned int __internal__WriteImageNode(void * obj, int type, char ** originalBufferPointer, int * buflength, int imageStart, int * end){
+  unsigned int nodeOffset = 0;
+  switch(type){
+    case TYPE_NUMBER :{
+      nodeOffset = __internal__ImageReserve(originalBufferPointer, buflength, imageStart, end, 16);
+      double num = AJNumberGetDouble((struct AJNumber*)obj);
+      memcpy(&(*originalBufferPointer)[imageStart + nodeOffset + 8], &num, 8);
+      break;
+    }
+    case TYPE_STRING :{
+      char * s = ((struct AJString*)obj)->string;
+      unsigned int slen = ((struct AJString*)obj)->length;
+      nodeOffset = __internal__ImageReserve(originalBufferPointer, buflength, imageStart, end, 8 + slen + 1);
+      __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 4, slen);
+      memcpy(&(*originalBufferPointer)[imageStart + nodeOffset + 8], s, slen + 1);
+      break;
+    }
+    case TYPE_BOOLEAN :{
+      nodeOffset = __internal__ImageReserve(originalBufferPointer, buflength, imageStart, end, 8);
+      __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 4, ((struct AJBoolean*)obj)->TruthValue == 1 ? 1 : 0);
+      break;
+    }
+    case TYPE_NULL :{
+      nodeOffset = __internal__ImageReserve(originalBufferPointer, buflength, imageStart, end, 8);
+      break;
+    }
+    case TYPE_ARRAY :{
+      struct AJArray * aja = (struct AJArray*)obj;
+      nodeOffset = __internal__ImageReserve(originalBufferPointer, buflength, imageStart, end, 8 + 4 * aja->length);
+      __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 4, aja->length);
+      struct AJArrayElement * current = aja->FirstElement;
+      for(int i = 0; i < aja->length; i++){
+        unsigned int child;
+        if(aja->PackedNumbers != NULL){
+          struct AJNumber packed;
+          packed.number = aja->PackedNumbers[i];
+          packed.Lexeme = NULL;
+          child = __internal__WriteImageNode(&packed, TYPE_NUMBER, originalBufferPointer, buflength, imageStart, end);
+        }else{
+          child = __internal__WriteImageNode(current->ArrayElement, current->ArrayElementType, originalBufferPointer, buflength, imageStart, end);
+          current = current->NextAJElement;
+        }
+        //the buffer may have moved while writing the child, so always go through *originalBufferPointer
+        __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 8 + 4 * i, child);
+      }
+      break;
+    }
+    case TYPE_OBJECT :{
+      struct AJObject * ajo = (struct AJObject*)obj;
+      int count = ajo->AJKVPCount;
+      nodeOffset = __internal__ImageReserve(originalBufferPointer, buflength, imageStart, end, 8 + 12 * count);
+      __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 4, count);
+      struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP;
+      for(int i = 0; i < count; i++){
+        unsigned int keyOffset = __internal__WriteImageNode(ajkvp->key, ajkvp->KeyType, originalBufferPointer, buflength, imageStart, end);
+        unsigned int valueOffset = __internal__WriteImageNode(ajkvp->value, ajkvp->ValueType, originalBufferPointer, buflength, imageStart, end);
+        __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 8 + 8 * i, keyOffset);
+        __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset + 12 + 8 * i, valueOffset);
+        ajkvp = ajkvp->NextAJKVP;
+      }
+
+      //precompute the key index. the buffer doesnt move while sorting so pointing into it is fine here.
+      if(count > 0){
+        char * image = *originalBufferPointer + imageStart;
+        struct __internal__ImageKeySortEntry * sortEntries = (struct __internal__ImageKeySortEntry *)__internal__Malloc(sizeof(struct __internal__ImageKeySortEntry) * count);
+        for(int i = 0; i < count; i++){
+          unsigned int keyOffset = __internal__ImageReadU32(image, nodeOffset + 8 + 8 * i);
+          sortEntries[i].index = i;
+          sortEntries[i].isString = __internal__ImageReadU32(image, keyOffset) == TYPE_STRING;
+          sortEntries[i].length = sortEntries[i].isString ? __internal__ImageReadU32(image, keyOffset + 4) : 0;
+          sortEntries[i].key = image + keyOffset + 8;
+        }
+        qsort(sortEntries, count, sizeof(struct __internal__ImageKeySortEntry), __internal__CompareImageKeys);
+        for(int i = 0; i < count; i++){
+          __internal__ImageWriteU32(image, nodeOffset + 8 + 8 * count + 4 * i, sortEntries[i].index);
+        }
+        __internal__Free(sortEntries);
+      }
+      break;
+    }
+    default:{
+      return 0;
+    }
+  }
+  __internal__ImageWriteU32(*originalBufferPointer + imageStart, nodeOffset, type);
+  return nodeOffset;
+}
+
+/*writes aj (any AJ type, usually the root AJObject) as an AJ Image into the buffer, growing it as needed.
+positionToStartWriting should be 8 byte aligned if you plan to query the image straight out of the buffer.
+Returns the size of the image in bytes (no null terminator is added).*/
+int WriteAJTypeAsImageToBuffer(void * aj, int type, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  int end = positionToStartWriting;
+  __internal__ImageReserve(originalBufferPointer, buflength, positionToStartWriting, &end, AJ_IMAGE_HEADER_SIZE);
+  unsigned int rootOffset = __internal__WriteImageNode(aj, type, originalBufferPointer, buflength, positionToStartWriting, &end);
+
+  char * image = *originalBufferPointer + positionToStartWriting;
+  memcpy(image, AJ_IMAGE_MAGIC, 7);
+  image[7] = AJ_IMAGE_VERSION;
+  __internal__ImageWriteU32(image, 8, AJ_IMAGE_BYTE_ORDER_MARK);
+  __internal__ImageWriteU32(image, 12, rootOffset);
+  __internal__ImageWriteU32(image, 16, type);
+  __internal__ImageWriteU32(image, 20, end - positionToStartWriting);
+  return end - positionToStartWriting;
+}
+
+//writes aj as an AJ Image to filename. returns the image size, or -1 if the file couldnt be written.
+int WriteAJTypeAsImageToFile(void * aj, int type, char * filename){
+  int len = 256;
+  char * buf = (char *)__internal__Malloc(len);
+  int imageSize = WriteAJTypeAsImageToBuffer(aj, type, &buf, &len, 0);
+
+  FILE * file = fopen(filename, "wb");
+  if(file == NULL){
+    printf("Error opening file\" %s \"", filename);
+    __internal__Free(buf);
+    return -1;
+  }
+  size_t written = fwrite(buf, 1, imageSize, file);
+  fclose(file);
+  __internal__Free(buf);
+  return written == (size_t)imageSize ? imageSize : -1;
+}
+
+//checks the header of an image. returns 1 if it looks like an image we can read.
+int __internal__ValidateImage(char * base, long size){
+  if(size < AJ_IMAGE_HEADER_SIZE){return 0;}
+  if(memcmp(base, AJ_IMAGE_MAGIC, 7) != 0 || base[7] != AJ_IMAGE_VERSION){return 0;}
+  if(__internal__ImageReadU32(base, 8) != AJ_IMAGE_BYTE_ORDER_MARK){return 0;} //written on a machine with the other endianness
+  if(__internal__ImageReadU32(base, 20) > (unsigned long)size){return 0;}
+  unsigned int root = __internal__ImageReadU32(base, 12);
+  if(root < AJ_IMAGE_HEADER_SIZE || (unsigned long)root + 8 > (unsigned long)size){return 0;}
+  return 1;
+}
+
+/*wraps an image that is already in memory (e.g written with WriteAJTypeAsImageToBuffer). Nothing is copied,
+so the buffer must stay alive (and 8 byte aligned) for as long as the AJImage is used. Returns NULL if it isnt an image.*/
+struct AJImage * LoadAJImageFromBuffer(char * buffer, long size){
+  if(!__internal__ValidateImage(buffer, size)){return NULL;}
+  struct AJImage * tolu = (struct AJImage *)__internal__Malloc(sizeof(struct AJImage));
+  tolu->base = buffer;
+  tolu->size = size;
+  tolu->isMapped = 0;
+  return tolu;
+}
+
+/*maps an image file read only. On POSIX systems the file is mmap'd (MAP_SHARED), so loading is just page faults
+and every process that maps the same file shares the same physical pages. Elsewhere it is read into memory.
+Returns NULL if the file cant be opened or isnt an image. Close with CloseAJImage().*/
+struct AJImage * LoadAJImageFromFile(char * filename){
+  char * base = NULL;
+  long size = 0;
+  char isMapped = 0;
+#ifdef AJ_HAVE_MMAP
+  int fd = open(filename, O_RDONLY);
+  if(fd < 0){
+    printf("Error opening file\" %s \"", filename);
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0){
+    close(fd);
+    return NULL;
+  }
+  size = (long)st.st_size;
+  void * mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); //the mapping keeps the file alive
+  if(mapping == MAP_FAILED){return NULL;}
+  base = (char *)mapping;
+  isMapped = 1;
+#else
+  FILE * file = fopen(filename, "rb");
+  if(file == NULL){
+    printf("Error opening file\" %s \"", filename);
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  base = (char *)__internal__Malloc(size > 0 ? size : 1); //malloc is aligned enough for the 8 byte nodes
+  if(fread(base, 1, size, file) != (size_t)size){size = 0;}
+  fclose(file);
+  isMapped = 2;
+#endif
+
+  if(!__internal__ValidateImage(base, size)){
+#ifdef AJ_HAVE_MMAP
+    munmap(base, size);
+#else
+    __internal__Free(base);
+#endif
+    return NULL;
+  }
+  struct AJImage * tolu = (struct AJImage *)__internal__Malloc(sizeof(struct AJImage));
+  tolu->base = base;
+  tolu->size = size;
+  tolu->isMapped = isMapped;
+  return tolu;
+}
+
+//unmaps/frees the image. offsets you got from it are meaningless afterwards.
+void CloseAJImage(struct AJImage * img){
+  if(img == NULL){return;}
+#ifdef AJ_HAVE_MMAP
+  if(img->isMapped == 1){munmap(img->base, img->size);}
+#endif
+  if(img->isMapped == 2){__internal__Free(img->base);}
+  __internal__Free(img);
+}
+
+//offset of the root node, and its type through rootType (pass NULL if you dont care)
+unsigned int GetAJImageRoot(struct AJImage * img, int * rootType){
+  if(rootType != NULL){*rootType = __internal__ImageReadU32(img->base, 16);}
+  return __internal__ImageReadU32(img->base, 12);
+}
+
+//TYPE_* of the node at offset
+int GetAJImageNodeType(struct AJImage * img, unsigned int offset){
+  if(!__internal__ImageHas(img, offset, 8)){return -1;}
+  return (int)__internal__ImageReadU32(img->base, offset);
+}
+
+//element count for arrays, key value pair count for objects, byte length for strings. 0 if the node doesnt fit in the image
+int GetAJImageNodeLength(struct AJImage * img, unsigned int offset){
+  if(!__internal__ImageHas(img, offset, 8)){return 0;}
+  unsigned long long length = __internal__ImageReadU32(img->base, offset + 4);
+  unsigned long long needed;
+  switch(__internal__ImageReadU32(img->base, offset)){
+    case TYPE_STRING: needed = length + 1; break;
+    case TYPE_ARRAY: needed = length * 4; break;
+    case TYPE_OBJECT: needed = length * 12; break;
+    default: return 0;
+  }
+  if(length > 0x7fffffff || !__internal__ImageHas(img, offset + 8ULL, needed)){return 0;}
+  return (int)length;
+}
+
+double GetAJImageNumber(struct AJImage * img, unsigned int offset){
+  double num = 0;
+  if(!__internal__ImageHas(img, offset, 16)){return num;}
+  memcpy(&num, img->base + offset + 8, 8);
+  return num;
+}
+
+//points straight into the image (null terminated). Dont write to it: a mapped image is read only.
+//NULL if the string runs off the end of the image or isnt terminated.
+char * GetAJImageString(struct AJImage * img, unsigned int offset){
+  if(!__internal__ImageHas(img, offset, 8)){return NULL;}
+  unsigned int length = __internal__ImageReadU32(img->base, offset + 4);
+  if(!__internal__ImageHas(img, offset + 8ULL, length + 1ULL) || img->base[offset + 8 + length] != '\0'){return NULL;}
+  return img->base + offset + 8;
+}
+
+char GetAJImageBoolean(struct AJImage * img, unsigned int offset){
+  if(!__internal__ImageHas(img, offset, 8)){return 0;}
+  return (char)__internal__ImageReadU32(img->base, offset + 4);
+}
+
+//count of the array or object at offset if it really is one of type and all of its table fits in the image
+//(GetAJImageNodeLength checks the table, this checks that the node is the container the caller is about to read as). -1 if not
+static inline int __internal__ImageContainerLength(struct AJImage * img, unsigned int offset, int type){
+  if(GetAJImageNodeType(img, offset) != type){return -1;}
+  int count = GetAJImageNodeLength(img, offset);
+  unsigned long long needed = 8 + (type == TYPE_OBJECT ? 12ULL : 4ULL) * (unsigned long long)count;
+  return __internal__ImageHas(img, offset, needed) ? count : -1;
+}
+
+//offset of the idx'th element of the array at arrayOffset (O(1)), or 0 if out of range or it isnt an array
+unsigned int GetAJImageElementFromArrayIndex(struct AJImage * img, unsigned int arrayOffset, int idx){
+  if(idx < 0 || idx >= __internal__ImageContainerLength(img, arrayOffset, TYPE_ARRAY)){return 0;}
+  return __internal__ImageChild(img, __internal__ImageReadU32(img->base, arrayOffset + 8 + 4 * idx));
+}
+
+//key and value offsets of the idx'th pair (in document order) of the object at objectOffset. returns 0 if out of range or it isnt an object
+int GetAJImageKVPFromObjectIndex(struct AJImage * img, unsigned int objectOffset, int idx, unsigned int * keyOffset, unsigned int * valueOffset){
+  if(idx < 0 || idx >= __internal__ImageContainerLength(img, objectOffset, TYPE_OBJECT)){return 0;}
+  *keyOffset = __internal__ImageChild(img, __internal__ImageReadU32(img->base, objectOffset + 8 + 8 * idx));
+  *valueOffset = __internal__ImageChild(img, __internal__ImageReadU32(img->base, objectOffset + 12 + 8 * idx));
+  return *keyOffset != 0 && *valueOffset != 0;
+}
+
+//binary search of the object's precomputed key index. returns the offset of the value for key, or 0 if the key isnt there
+//(or objectOffset isnt an object)
+unsigned int SearchAJImageObjectForKey(struct AJImage * img, char * key, unsigned int objectOffset){
+  if(key == NULL){return 0;}
+  char * base = img->base;
+  int count = __internal__ImageContainerLength(img, objectOffset, TYPE_OBJECT);
+  if(count <= 0){return 0;}
+  unsigned int sortedIndexOffset = objectOffset + 8 + 8 * count;
+  struct __internal__ImageKeySortEntry searchFor;
+  searchFor.key = key;
+  searchFor.length = strlen(key);
+  searchFor.isString = 1;
+  searchFor.index = 0;
+
+  int low = 0;
+  int high = count - 1;
+  while(low <= high){
+    int mid = low + (high - low) / 2;
+    unsigned int pairIndex = __internal__ImageReadU32(base, sortedIndexOffset + 4 * mid);
+    if(pairIndex >= (unsigned int)count){return 0;}
+    unsigned int keyOffset = __internal__ImageChild(img, __internal__ImageReadU32(base, objectOffset + 8 + 8 * pairIndex));
+    if(keyOffset == 0){return 0;}
+    struct __internal__ImageKeySortEntry candidate;
+    candidate.isString = __internal__ImageReadU32(base, keyOffset) == TYPE_STRING;
+    candidate.length = candidate.isString ? __internal__ImageReadU32(base, keyOffset + 4) : 0;
+    if(!__internal__ImageHas(img, keyOffset + 8ULL, candidate.length)){return 0;}
+    candidate.key = base + keyOffset + 8;
+    candidate.index = pairIndex;
+    int c = __internal__CompareImageKeys(&searchFor, &candidate);
+    if(c == 0){
+      return __internal__ImageChild(img, __internal__ImageReadU32(base, objectOffset + 12 + 8 * pairIndex));
+    }
+    if(c < 0){
+      high = mid - 1;
+    }else{
+      low = mid + 1;
+    }
+  }
+  return 0;
+}
+
+/*AJDocument / AJParser: for parsing one document after another without going back to the allocator every time.
+An AJDocument owns an arena (a list of big chunks handed out front to back) and its own AJContext whose allocator points at
+that arena, so every node, string and KVP of a parse lands in the document's chunks. Parsing again (or ResetAJDocument)
+just rewinds the chunks; nothing is freed, so once the chunks are big enough for your documents there are no allocator
+calls at all and the memory stays warm in cache.
+An AJParser holds the settings used for parsing (its Context) and is meant to be kept around too.
+
+Dont call DeleteAJObject / DeleteAJArray on a document's root, the document owns it. If you want to change a document's
+tree (AddToAJObject etc) do it with the document's context active (AJSetContext(&doc->Context)) so new nodes land in its arena.*/
+#define AJ_DEFAULT_ARENA_CHUNK_SIZE 65536
+#define AJ_ARENA_ALIGNMENT 16
+
+struct __internal__ArenaChunk{
+  struct __internal__ArenaChunk * NextChunk;
+  size_t Capacity; //usable bytes after the (aligned) chunk header
+  size_t Used;
+};
+
+//every arena allocation starts with one of these, so realloc knows how much to copy
+struct __internal__ArenaBlockHeader{
+  size_t Size;
+  size_t Padding; //keeps the block AJ_ARENA_ALIGNMENT aligned
+};
+
+struct AJDocument{
+  void * Root; //AJObject or AJArray from the last parse, NULL after a reset
+  int RootType;
+
+  struct AJContext Context; //allocator points at the arena below
+  struct __internal__ArenaChunk * FirstChunk;
+  struct __internal__ArenaChunk * CurrentChunk;
+  size_t ChunkSize;
+  struct AJAllocator Backing; //where the chunks themselves come from (the allocator active when the document was created)
+};
+
+struct AJParser{
+  struct AJContext Context; //settings for every document parsed with this parser. Its allocator is ignored; documents use their own.
+};
+
+static inline char * __internal__ArenaChunkData(struct __internal__ArenaChunk * chunk){
+  return (char*)chunk + ((sizeof(struct __internal__ArenaChunk) + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1));
+}
+
+void * __internal__ArenaAlloc(size_t size, void * UserPointer){
+  struct AJDocument * doc = (struct AJDocument *)UserPointer;
+  size_t needed = sizeof(struct __internal__ArenaBlockHeader) + ((size + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1));
+
+  //move forward through chunks kept from earlier parses before making a new one
+  struct __internal__ArenaChunk * chunk = doc->CurrentChunk;
+  while(chunk != NULL && chunk->Capacity - chunk->Used < needed){
+    chunk = chunk->NextChunk;
+    if(chunk != NULL){chunk->Used = 0;}
+  }
+  if(chunk == NULL){
+    size_t capacity = needed > doc->ChunkSize ? needed : doc->ChunkSize;
+    chunk = (struct __internal__ArenaChunk *)doc->Backing.Alloc(AJ_ARENA_ALIGNMENT + sizeof(struct __internal__ArenaChunk) + capacity, doc->Backing.UserPointer);
+    if(chunk == NULL){return NULL;}
+    chunk->Capacity = capacity;
+    chunk->Used = 0;
+    chunk->NextChunk = NULL;
+    if(doc->CurrentChunk == NULL){
+      doc->FirstChunk = chunk;
+    }else{
+      //put it right after the current chunk so the chunks we skipped stay in the list for the next parse
+      chunk->NextChunk = doc->CurrentChunk->NextChunk;
+      doc->CurrentChunk->NextChunk = chunk;
+    }
+  }
+  doc->CurrentChunk = chunk;
+
+  struct __internal__ArenaBlockHeader * header = (struct __internal__ArenaBlockHeader *)(__internal__ArenaChunkData(chunk) + chunk->Used);
+  header->Size = size;
+  chunk->Used += needed;
+  return (void*)(header + 1);
+}
+
+//1 if ptr is the most recent allocation of the current chunk (so it can be grown or given back in place)
+static inline int __internal__ArenaIsLastBlock(struct AJDocument * doc, void * ptr){
+  struct __internal__ArenaChunk * chunk = doc->CurrentChunk;
+  if(chunk == NULL){return 0;}
+  struct __internal__ArenaBlockHeader * header = (struct __internal__ArenaBlockHeader *)ptr - 1;
+  size_t blockSize = sizeof(struct __internal__ArenaBlockHeader) + ((header->Size + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1));
+  return (char*)header + blockSize == __internal__ArenaChunkData(chunk) + chunk->Used;
+}
+
+void * __internal__ArenaRealloc(void * ptr, size_t newSize, void * UserPointer){
+  struct AJDocument * doc = (struct AJDocument *)UserPointer;
+  if(ptr == NULL){return __internal__ArenaAlloc(newSize, UserPointer);}
+  struct __internal__ArenaBlockHeader * header = (struct __internal__ArenaBlockHeader *)ptr - 1;
+  size_t oldRounded = (header->Size + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1);
+  size_t newRounded = (newSize + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1);
+
+  if(newRounded <= oldRounded){ //shrinking (the parsers do this a lot): give the tail back if we can
+    if(__internal__ArenaIsLastBlock(doc, ptr)){
+      doc->CurrentChunk->Used -= oldRounded - newRounded;
+    }
+    header->Size = newSize;
+    return ptr;
+  }
+  if(__internal__ArenaIsLastBlock(doc, ptr) && doc->CurrentChunk->Capacity - doc->CurrentChunk->Used >= newRounded - oldRounded){
+    doc->CurrentChunk->Used += newRounded - oldRounded; //grow in place
+    header->Size = newSize;
+    return ptr;
+  }
+  void * moved = __internal__ArenaAlloc(newSize, UserPointer);
+  if(moved == NULL){return NULL;}
+  memcpy(moved, ptr, header->Size);
+  return moved;
+}
+
+//arena memory comes back all at once on reset. The only thing worth doing here is giving back the last block.
+void __internal__ArenaFree(void * ptr, void * UserPointer){
+  struct AJDocument * doc = (struct AJDocument *)UserPointer;
+  if(__internal__ArenaIsLastBlock(doc, ptr)){
+    struct __internal__ArenaBlockHeader * header = (struct __internal__ArenaBlockHeader *)ptr - 1;
+    doc->CurrentChunk->Used -= sizeof(struct __internal__ArenaBlockHeader) + ((header->Size + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1));
+  }
+}
+
+//chunkSize: bytes per arena chunk, 0 for AJ_DEFAULT_ARENA_CHUNK_SIZE. Bigger chunks than your usual document means one chunk per parse.
+struct AJDocument * CreateAJDocument(size_t chunkSize){
+  struct AJDocument * dami = (struct AJDocument *)__internal__Malloc(sizeof(struct AJDocument));
+  dami->Root = NULL;
+  dami->RootType = TYPE_NULL;
+  dami->FirstChunk = NULL;
+  dami->CurrentChunk = NULL;
+  dami->ChunkSize = chunkSize == 0 ? AJ_DEFAULT_ARENA_CHUNK_SIZE : chunkSize;
+  dami->Backing = AJGetContext()->Allocator;
+  AJInitContext(&dami->Context);
+  dami->Context.Allocator.Alloc = __internal__ArenaAlloc;
+  dami->Context.Allocator.Realloc = __internal__ArenaRealloc;
+  dami->Context.Allocator.Free = __internal__ArenaFree;
+  dami->Context.Allocator.UserPointer = (void*)dami;
+  return dami;
+}
+
+//forgets the tree and rewinds the arena. The chunks are kept for the next parse.
+void ResetAJDocument(struct AJDocument * doc){
+  doc->Root = NULL;
+  doc->RootType = TYPE_NULL;
+  if(doc->FirstChunk != NULL){
+    doc->FirstChunk->Used = 0;
+  }
+  doc->CurrentChunk = doc->FirstChunk;
+}
+
+//frees the document, its tree and all its chunks. Call it with the same allocator active that was active in CreateAJDocument.
+void DeleteAJDocument(struct AJDocument * doc){
+  struct __internal__ArenaChunk * chunk = doc->FirstChunk;
+  while(chunk != NULL){
+    struct __internal__ArenaChunk * next = chunk->NextChunk;
+    doc->Backing.Free(chunk, doc->Backing.UserPointer);
+    chunk = next;
+  }
+  __internal__Free(doc);
+}
+
+struct AJParser * CreateAJParser(){
+  struct AJParser * kunle = (struct AJParser *)__internal__Malloc(sizeof(struct AJParser));
+  AJInitContext(&kunle->Context);
+  return kunle;
+}
+
+void DeleteAJParser(struct AJParser * parser){
+  __internal__Free(parser);
+}
+
+/*resets doc, then parses the JSON object or array at the start of JSONString (leading whitespace is skipped) into it.
+Returns the root (also kept in doc->Root) and its type through rootType, or NULL if the text doesnt start with { or [.*/
+void * ParseAJDocument(struct AJParser * parser, struct AJDocument * doc, char * JSONString, int * rootType){
+  ResetAJDocument(doc);
+
+  //parse with the parser's settings, but the document's arena
+  struct AJAllocator arena = doc->Context.Allocator;
+  doc->Context = parser->Context;
+  doc->Context.Allocator = arena;
+  doc->Context.Intern = NULL; //shared nodes would have to outlive the arena; a reset would pull them out from under the table
+
+  int idx = 0;
+  while(JSONString[idx] == ' ' || JSONString[idx] == '\t' || JSONString[idx] == '\n' || JSONString[idx] == '\r'){
+    idx++;
+  }
+
+  struct AJContext * previous = AJSetContext(&doc->Context);
+  if(JSONString[idx] == openObjectBracket){
+    doc->Root = (void*)ParseNewAJObject(idx, JSONString, &idx);
+    doc->RootType = TYPE_OBJECT;
+  }else if(JSONString[idx] == openArrayBracket){
+    doc->Root = (void*)ParseNewAJArray(idx, JSONString, &idx);
+    doc->RootType = TYPE_ARRAY;
+  }
+  AJSetContext(previous);
+
+  if(rootType != NULL){*rootType = doc->RootType;}
+  return doc->Root;
+}
+
+/* Shapes (hidden classes)
+Big arrays of records usually repeat the same keys in the same order, and normally every record gets its own copy of each key.
+Put an AJShapeTable in AJContext->Shapes and the parsers (text and msgpack) look each finished object's key sequence up in it:
+objects with the same keys share one AJShape (one copy of the keys plus a hash index over them). A shaped object keeps its KVPs in a
+single block, KVPBlock[0..AJKVPCount-1], whose keys point at the shape's strings. They are still linked through NextAJKVP,
+so everything that walks an object works on shaped ones too.
+The text parser guesses the shape from the first key (the last shape seen starting with it) and checks every later key against it
+before parsing it, so a record that matches is parsed straight into its block: no KVP or key is allocated on its own. On a wrong
+guess it carries on the usual way from that key and shapes the object once it is finished.
+  -SearchObjectForKey on a shaped object is a hash lookup instead of a walk. For hot loops over records, get the key's index once
+   with GetAJShapeKeyIndex(shape, key) and then use GetKVPFromShapedAJObject(record, idx) on every record with that shape.
+  -the keys of a shaped object are shared: dont free or edit them. AddToAJObject detaches the object first (gives it its own keys);
+   call DetachAJObjectShape yourself before changing keys or relinking KVPs by hand. KVP pointers stay valid either way.
+  -shapes belong to the table, so delete (or detach) the objects before DeleteAJShapeTable. Objects with more than
+   AJ_MAX_SHAPE_KEYS keys, or non string keys, are left alone.
+  -a table is not thread safe; like contexts, use one per thread.*/
+
+#define AJ_MAX_SHAPE_KEYS 64 //objects with more keys than this are dictionaries more than records
+#define AJ_FNV_OFFSET_BASIS 2166136261u
+
+//FNV-1a over length bytes, continuing from hash (start with AJ_FNV_OFFSET_BASIS)
+unsigned int __internal__HashBytes(const char * bytes, int length, unsigned int hash){
+  for(int i = 0; i < length; i++){
+    hash ^= (unsigned char)bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+//makes an empty shape table. its shapes are allocated with the current context's allocator, so dont create it inside an AJDocument parse.
+struct AJShapeTable * CreateAJShapeTable(){
+  struct AJContext * ctx = AJGetContext();
+  struct AJShapeTable * table = (struct AJShapeTable *)ctx->Allocator.Alloc(sizeof(struct AJShapeTable), ctx->Allocator.UserPointer);
+  table->Allocator = ctx->Allocator;
+  table->BucketCount = 64;
+  table->ShapeCount = 0;
+  table->Buckets = (struct AJShape **)table->Allocator.Alloc(sizeof(struct AJShape *) * table->BucketCount, table->Allocator.UserPointer);
+  memset(table->Buckets, 0, sizeof(struct AJShape *) * table->BucketCount);
+  memset(table->Predictions, 0, sizeof(table->Predictions));
+  return table;
+}
+
+//frees the table and all its shapes. objects still using them are left with dangling keys.
+void DeleteAJShapeTable(struct AJShapeTable * table){
+  for(int i = 0; i < table->BucketCount; i++){
+    struct AJShape * shape = table->Buckets[i];
+    while(shape != NULL){
+      struct AJShape * next = shape->NextInBucket;
+      table->Allocator.Free(shape, table->Allocator.UserPointer);
+      shape = next;
+    }
+  }
+  table->Allocator.Free(table->Buckets, table->Allocator.UserPointer);
+  table->Allocator.Free(table, table->Allocator.UserPointer);
+}
+
+//index of key in shape's key list, or -1
+int GetAJShapeKeyIndex(struct AJShape * shape, char * key){
+  int length = strlen(key);
+  int mask = shape->HashIndexSize - 1;
+  int slot = __internal__HashBytes(key, length, AJ_FNV_OFFSET_BASIS) & mask;
+  while(shape->HashIndex[slot] != 0){
+    struct AJString * candidate = &shape->Keys[shape->HashIndex[slot] - 1];
+    if(candidate->length == length && memcmp(candidate->string, key, length) == 0){
+      return shape->HashIndex[slot] - 1;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+//the idxth KVP of a shaped object, straight out of its KVP block. falls back to walking the list for unshaped objects.
+struct AJKeyValuePair * GetKVPFromShapedAJObject(struct AJObject * ajo, int idx){
+  if(idx < 0 || idx >= ajo->AJKVPCount){return NULL;}
+  if(ajo->Shape != NULL){
+    return &ajo->KVPBlock[idx];
+  }
+  return GetKVPFromObjectIndex(ajo->FirstAJKVP, 0, idx);
+}
+
+//hash of the whole key sequence of a (string keyed) KVP list
+unsigned int __internal__HashKeySequence(struct AJKeyValuePair * first, int count){
+  unsigned int hash = AJ_FNV_OFFSET_BASIS;
+  struct AJKeyValuePair * current = first;
+  for(int i = 0; i < count; i++){
+    struct AJString * key = (struct AJString *)current->key;
+    hash = __internal__HashBytes(key->string, key->length + 1, hash); //+1 takes the null terminator in as a separator
+    current = current->NextAJKVP;
+  }
+  return hash;
+}
+
+//builds a shape for the keys of the count KVPs starting at first. The shape, its key strings, its hash index and the chars of long
+//keys are all one allocation from the table's allocator.
+struct AJShape * __internal__CreateAJShape(struct AJShapeTable * table, struct AJKeyValuePair * first, int count, unsigned int sequenceHash){
+  int hashIndexSize = 4;
+  while(hashIndexSize < count * 2){hashIndexSize *= 2;}
+  size_t size = sizeof(struct AJShape) + sizeof(struct AJString) * count + sizeof(int) * (hashIndexSize + count);
+  struct AJKeyValuePair * current = first;
+  for(int i = 0; i < count; i++){
+    int length = ((struct AJString *)current->key)->length;
+    if(length >= AJ_STRING_INLINE_CAPACITY){size += length + 1;}
+    current = current->NextAJKVP;
+  }
+
+  struct AJShape * shape = (struct AJShape *)table->Allocator.Alloc(size, table->Allocator.UserPointer);
+  shape->KeyCount = count;
+  shape->Keys = (struct AJString *)(shape + 1);
+  shape->HashIndex = (int *)(shape->Keys + count);
+  shape->HashIndexSize = hashIndexSize;
+  shape->SequenceHash = sequenceHash;
+  shape->CanonicalOrder = shape->HashIndex + hashIndexSize;
+  shape->HasCanonicalOrder = 0;
+  memset(shape->HashIndex, 0, sizeof(int) * hashIndexSize);
+  char * longChars = (char *)(shape->CanonicalOrder + count);
+
+  current = first;
+  for(int i = 0; i < count; i++){
+    struct AJString * from = (struct AJString *)current->key;
+    struct AJString * to = &shape->Keys[i];
+    to->length = from->length;
+    if(from->length < AJ_STRING_INLINE_CAPACITY){
+      to->string = to->InlineChars;
+    }else{
+      to->string = longChars;
+      longChars += from->length + 1;
+    }
+    memcpy(to->string, from->string, from->length + 1);
+    to->Raw = from->Raw;
+    to->RefCount = 0; //never deleted on its own, the shape owns it
+
+    int slot = __internal__HashBytes(to->string, to->length, AJ_FNV_OFFSET_BASIS) & (hashIndexSize - 1);
+    while(shape->HashIndex[slot] != 0){slot = (slot + 1) & (hashIndexSize - 1);}
+    shape->HashIndex[slot] = i + 1;
+    current = current->NextAJKVP;
+  }
+  return shape;
+}
+
+//finds (or makes) the shape for the keys of the count KVPs starting at first
+struct AJShape * __internal__GetAJShape(struct AJShapeTable * table, struct AJKeyValuePair * first, int count){
+  unsigned int sequenceHash = __internal__HashKeySequence(first, count);
+  struct AJShape * shape = table->Buckets[sequenceHash & (table->BucketCount - 1)];
+  for(; shape != NULL; shape = shape->NextInBucket){
+    if(shape->SequenceHash != sequenceHash || shape->KeyCount != count){continue;}
+    struct AJKeyValuePair * current = first;
+    int i = 0;
+    for(; i < count; i++){
+      struct AJString * key = (struct AJString *)current->key;
+      if(key->length != shape->Keys[i].length || key->Raw != shape->Keys[i].Raw || memcmp(key->string, shape->Keys[i].string, key->length) != 0){break;}
+      current = current->NextAJKVP;
+    }
+    if(i == count){return shape;}
+  }
+
+  if(table->ShapeCount >= table->BucketCount){ //keep chains short: double the buckets and rehash
+    int newCount = table->BucketCount * 2;
+    struct AJShape ** newBuckets = (struct AJShape **)table->Allocator.Alloc(sizeof(struct AJShape *) * newCount, table->Allocator.UserPointer);
+    memset(newBuckets, 0, sizeof(struct AJShape *) * newCount);
+    for(int b = 0; b < table->BucketCount; b++){
+      struct AJShape * moving = table->Buckets[b];
+      while(moving != NULL){
+        struct AJShape * next = moving->NextInBucket;
+        moving->NextInBucket = newBuckets[moving->SequenceHash & (newCount - 1)];
+        newBuckets[moving->SequenceHash & (newCount - 1)] = moving;
+        moving = next;
+      }
+    }
+    table->Allocator.Free(table->Buckets, table->Allocator.UserPointer);
+    table->Buckets = newBuckets;
+    table->BucketCount = newCount;
+  }
+
+  shape = __internal__CreateAJShape(table, first, count, sequenceHash);
+  shape->NextInBucket = table->Buckets[sequenceHash & (table->BucketCount - 1)];
+  table->Buckets[sequenceHash & (table->BucketCount - 1)] = shape;
+  table->ShapeCount++;
+  return shape;
+}
+
+//the text parser's side of shaping: compares the still unparsed key whose opening quote is at JSONString[i] with key keyIndex of
+//*predicted (for the first key, *predicted is first set to the last shape the table saw starting with that key). returns the shape's
+//key, with the closing quote's index in *closingQuote, or NULL when it is some other key.
+struct AJString * __internal__MatchShapeKey(struct AJShapeTable * table, struct AJShape ** predicted, int keyIndex, char * JSONString, int i, int * closingQuote){
+  char quote = JSONString[i];
+  int end = i + 1;
+  int hasEscapes = 0;
+  while(JSONString[end] != quote){
+    if(JSONString[end] == '\0'){return NULL;}
+    if(JSONString[end] == escape){
+      hasEscapes = 1;
+      if(JSONString[end + 1] == '\0'){return NULL;}
+      end++;
+    }
+    end++;
+  }
+  if(hasEscapes){return NULL;} //leave those to ParseNewAJString, which decodes them or marks them Raw
+  int length = end - i - 1;
+  if(keyIndex == 0){
+    *predicted = table->Predictions[__internal__HashBytes(&JSONString[i + 1], length, AJ_FNV_OFFSET_BASIS) & (AJ_SHAPE_PREDICTIONS - 1)];
+  }
+  struct AJShape * shape = *predicted;
+  if(shape == NULL || keyIndex >= shape->KeyCount){return NULL;}
+  struct AJString * key = &shape->Keys[keyIndex];
+  if(key->length != length || memcmp(key->string, &JSONString[i + 1], length) != 0){return NULL;}
+  *closingQuote = end;
+  return key;
+}
+
+//moves a freshly built object onto its shape: KVPs get copied into one block with the shared keys, and the old keys and KVPs are freed
+//(an old block, left by a parse that guessed the wrong shape, goes as a whole)
+void __internal__ShapeAJObject(struct AJShapeTable * table, struct AJObject * ajo){
+  int count = ajo->AJKVPCount;
+  if(ajo->Shape != NULL || count == 0 || count > AJ_MAX_SHAPE_KEYS){return;}
+  struct AJKeyValuePair * current = ajo->FirstAJKVP;
+  for(int i = 0; i < count; i++){
+    if(current->KeyType != TYPE_STRING){return;}
+    current = current->NextAJKVP;
+  }
+
+  struct AJShape * shape = __internal__GetAJShape(table, ajo->FirstAJKVP, count);
+  table->Predictions[__internal__HashBytes(shape->Keys[0].string, shape->Keys[0].length, AJ_FNV_OFFSET_BASIS) & (AJ_SHAPE_PREDICTIONS - 1)] = shape;
+  struct AJKeyValuePair * block = (struct AJKeyValuePair *)__internal__Malloc(sizeof(struct AJKeyValuePair) * count);
+  current = ajo->FirstAJKVP;
+  for(int i = 0; i < count; i++){
+    struct AJKeyValuePair * kvp = &block[i];
+    *kvp = *current;
+    if(current->value == (void*)&current->InlineValue){
+      kvp->value = (void*)&kvp->InlineValue;
+    }
+    kvp->key = (void*)&shape->Keys[i];
+    kvp->PrevAJKVP = i == 0 ? NULL : &block[i - 1];
+    kvp->NextAJKVP = i == count - 1 ? NULL : &block[i + 1];
+
+    struct AJKeyValuePair * next = current->NextAJKVP;
+    AJDelete(current->key, TYPE_STRING);
+    if(!__internal__IsInKVPBlock(ajo, current)){
+      __internal__Free(current);
+    }
+    current = next;
+  }
+  __internal__Free(ajo->KVPBlock);
+  ajo->FirstAJKVP = block;
+  ajo->LastAJKVP = &block[count - 1];
+  ajo->KVPBlock = block;
+  ajo->KVPBlockCount = count;
+  ajo->Shape = shape;
+}
+
+//turns a shaped object back into a normal one by giving it its own copy of every key. The KVPs stay where they are.
+void DetachAJObjectShape(struct AJObject * ajo){
+  if(ajo->Shape == NULL){return;}
+  for(struct AJKeyValuePair * kvp = ajo->FirstAJKVP; kvp != NULL; kvp = kvp->NextAJKVP){
+    struct AJString * sharedKey = (struct AJString *)kvp->key;
+    struct AJString * ownKey = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+    __internal__SetAJStringChars(ownKey, sharedKey->string, sharedKey->length);
+    ownKey->Raw = sharedKey->Raw;
+    ownKey->RefCount = 0;
+    kvp->key = (void*)ownKey;
+  }
+  ajo->Shape = NULL;
+}
+
+/* Interning (hash consing)
+Reference data tends to repeat the same strings ("USD", "active") and the same small sub-objects over and over. Put an
+AJInternTable in AJContext->Intern and the parsers (text and msgpack) hand out one shared node for every repeat:
+  -strings are looked up by their chars before anything is allocated.
+  -arrays and objects of at most AJ_MAX_INTERN_CHILDREN children are looked up once they are finished, if all their children are
+   scalars or shared nodes themselves (so big or one-off subtrees are left alone). A repeat is freed and the first copy used instead.
+Shared nodes count their references in RefCount (the table holds one too). AJDelete / DeleteAJArray / DeleteAJObject on a shared
+node just drop a reference, so deleting trees works as normal; a node is freed once its last reference goes, which for anything
+still in the table is DeleteAJInternTable.
+  -shared nodes are read only: a change would show up everywhere the node is used. The Add* / Remove* functions and
+   PackAJArray leave a shared container as it is and return 0; what you passed them is then still yours to delete.
+   AJClone gives you an unshared copy to edit.
+  -the table keeps the allocator that was active when it was made (like AJShapeTable), and only shares nodes parsed while that
+   same allocator is active, so every node it holds goes back to the right Free. DeleteAJInternTable can then run under any context.
+   ParseAJDocument ignores the setting, since arena memory cant outlive a reset.
+  -a table is not thread safe; use one per thread.*/
+
+#define AJ_MAX_INTERN_CHILDREN 32
+
+struct __internal__InternEntry{
+  unsigned int Hash;
+  int Type;
+  void * Node; //NULL: empty slot
+};
+
+struct AJInternTable{
+  struct __internal__InternEntry * Entries;
+  int Capacity; //power of 2
+  int Count;
+  struct AJAllocator Allocator; //the table and every node it shares come from this one
+};
+
+//1 if a and b allocate from the same place
+static inline int __internal__SameAllocator(struct AJAllocator * a, struct AJAllocator * b){
+  return a->Alloc == b->Alloc && a->Realloc == b->Realloc && a->Free == b->Free && a->UserPointer == b->UserPointer;
+}
+
+struct AJInternTable * CreateAJInternTable(){
+  struct AJContext * ctx = AJGetContext();
+  struct AJInternTable * table = (struct AJInternTable *)ctx->Allocator.Alloc(sizeof(struct AJInternTable), ctx->Allocator.UserPointer);
+  table->Allocator = ctx->Allocator;
+  table->Capacity = 256;
+  table->Count = 0;
+  table->Entries = (struct __internal__InternEntry *)table->Allocator.Alloc(sizeof(struct __internal__InternEntry) * table->Capacity, table->Allocator.UserPointer);
+  memset(table->Entries, 0, sizeof(struct __internal__InternEntry) * table->Capacity);
+  return table;
+}
+
+//drops the table's reference on every node in it (freeing the ones nothing else uses), then frees the table
+void DeleteAJInternTable(struct AJInternTable * table){
+  struct AJContext ctx; //the nodes go back to the table's allocator, whatever the caller's context is
+  AJInitContext(&ctx);
+  ctx.Allocator = table->Allocator;
+  struct AJContext * previous = AJSetContext(&ctx);
+  for(int i = 0; i < table->Capacity; i++){
+    if(table->Entries[i].Node != NULL){
+      AJDelete(table->Entries[i].Node, table->Entries[i].Type);
+    }
+  }
+  AJSetContext(previous);
+  table->Allocator.Free(table->Entries, table->Allocator.UserPointer);
+  table->Allocator.Free(table, table->Allocator.UserPointer);
+}
+
+void __internal__InternInsert(struct AJInternTable * table, unsigned int hash, int type, void * node){
+  if((table->Count + 1) * 10 > table->Capacity * 7){ //keep it under 70% full
+    struct __internal__InternEntry * old = table->Entries;
+    int oldCapacity = table->Capacity;
+    table->Capacity *= 2;
+    table->Entries = (struct __internal__InternEntry *)table->Allocator.Alloc(sizeof(struct __internal__InternEntry) * table->Capacity, table->Allocator.UserPointer);
+    memset(table->Entries, 0, sizeof(struct __internal__InternEntry) * table->Capacity);
+    table->Count = 0;
+    for(int i = 0; i < oldCapacity; i++){
+      if(old[i].Node != NULL){
+        __internal__InternInsert(table, old[i].Hash, old[i].Type, old[i].Node);
+      }
+    }
+    table->Allocator.Free(old, table->Allocator.UserPointer);
+  }
+  int slot = hash & (table->Capacity - 1);
+  while(table->Entries[slot].Node != NULL){slot = (slot + 1) & (table->Capacity - 1);}
+  table->Entries[slot].Hash = hash;
+  table->Entries[slot].Type = type;
+  table->Entries[slot].Node = node;
+  table->Count++;
+}
+
+//the shared AJString holding these length bytes, made (and put in the table) if this is the first time they are seen.
+//under another allocator than the table's, a plain unshared string
+struct AJString * __internal__InternAJStringBytes(struct AJInternTable * table, char * bytes, int length){
+  if(!__internal__SameAllocator(&AJGetContext()->Allocator, &table->Allocator)){
+    return __internal__CreateAJStringFromBytes(bytes, length);
+  }
+  unsigned int hash = __internal__HashBytes(bytes, length, AJ_FNV_OFFSET_BASIS);
+  int slot = hash & (table->Capacity - 1);
+  while(table->Entries[slot].Node != NULL){
+    struct __internal__InternEntry * entry = &table->Entries[slot];
+    if(entry->Hash == hash && entry->Type == TYPE_STRING){
+      struct AJString * candidate = (struct AJString *)entry->Node;
+      if(candidate->length == length && memcmp(candidate->string, bytes, length) == 0){
+        candidate->RefCount++;
+        return candidate;
+      }
+    }
+    slot = (slot + 1) & (table->Capacity - 1);
+  }
+  struct AJString * pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+  __internal__SetAJStringChars(pelumi, bytes, length);
+  pelumi->RefCount = 2; //the table and whoever asked
+  __internal__InternInsert(table, hash, TYPE_STRING, (void*)pelumi);
+  return pelumi;
+}
+
+//children can be compared by value (scalars) or by address (strings, arrays, objects that are already shared)
+int __internal__InternIsCanonical(void * value, int type){
+  switch(type){
+    case TYPE_STRING: return ((struct AJString *)value)->RefCount > 0;
+    case TYPE_ARRAY: return ((struct AJArray *)value)->RefCount > 0;
+    case TYPE_OBJECT: return ((struct AJObject *)value)->RefCount > 0;
+  }
+  return 1;
+}
+
+unsigned int __internal__InternHashChild(void * value, int type, unsigned int hash){
+  hash = __internal__HashBytes((char*)&type, sizeof(int), hash);
+  switch(type){
+    case TYPE_NUMBER:{
+      struct AJNumber * ayomide = (struct AJNumber *)value;
+      char * lexeme = __internal__CurrentLexeme(ayomide);
+      if(lexeme != NULL){
+        return __internal__HashBytes(lexeme, strlen(lexeme), hash);
+      }
+      double num = ayomide->number == 0 ? 0 : ayomide->number; //-0 == 0, so they have to hash the same
+      return __internal__HashBytes((char*)&num, sizeof(double), hash);
+    }
+    case TYPE_BOOLEAN: return __internal__HashBytes(&((struct AJBoolean *)value)->TruthValue, 1, hash);
+    case TYPE_NULL: return hash;
+  }
+  return __internal__HashBytes((char*)&value, sizeof(void *), hash); //shared node: its address is its identity
+}
+
+int __internal__InternChildEquals(void * a, int typeA, void * b, int typeB){
+  if(typeA != typeB){return 0;}
+  switch(typeA){
+    case TYPE_NUMBER:{
+      struct AJNumber * x = (struct AJNumber *)a;
+      struct AJNumber * y = (struct AJNumber *)b;
+      char * lexemeX = __internal__CurrentLexeme(x);
+      char * lexemeY = __internal__CurrentLexeme(y);
+      if(lexemeX != NULL || lexemeY != NULL){ //"1.0" and "1" have to stay different so they print back the same
+        return lexemeX != NULL && lexemeY != NULL && strcmp(lexemeX, lexemeY) == 0;
+      }
+      return x->number == y->number;
+    }
+    case TYPE_BOOLEAN: return ((struct AJBoolean *)a)->TruthValue == ((struct AJBoolean *)b)->TruthValue;
+    case TYPE_NULL: return 1;
+  }
+  return a == b;
+}
+
+//hash of a finished array or object, or 0 with *ok = 0 when it cant be shared (too big, or a child that isnt shared)
+unsigned int __internal__InternHashContainer(void * node, int type, int * ok){
+  unsigned int hash = __internal__HashBytes((char*)&type, sizeof(int), AJ_FNV_OFFSET_BASIS);
+  *ok = 0;
+  if(type == TYPE_ARRAY){
+    struct AJArray * aja = (struct AJArray *)node;
+    if(aja->length > AJ_MAX_INTERN_CHILDREN){return 0;}
+    if(aja->PackedNumbers != NULL){
+      for(int i = 0; i < aja->length; i++){
+        double num = aja->PackedNumbers[i] == 0 ? 0 : aja->PackedNumbers[i]; //-0 == 0, like in __internal__InternHashChild
+        hash = __internal__HashBytes((char*)&num, sizeof(double), hash);
+      }
+    }else{
+      for(struct AJArrayElement * current = aja->FirstElement; current != NULL; current = current->NextAJElement){
+        if(!__internal__InternIsCanonical(current->ArrayElement, current->ArrayElementType)){return 0;}
+        hash = __internal__InternHashChild(current->ArrayElement, current->ArrayElementType, hash);
+      }
+    }
+    hash = __internal__HashBytes((char*)&aja->length, sizeof(int), hash);
+  }else{
+    struct AJObject * ajo = (struct AJObject *)node;
+    if(ajo->AJKVPCount > AJ_MAX_INTERN_CHILDREN){return 0;}
+    for(struct AJKeyValuePair * current = ajo->FirstAJKVP; current != NULL; current = current->NextAJKVP){
+      //shaped keys belong to their shape: the same address means the same key there too
+      if(ajo->Shape == NULL && !__internal__InternIsCanonical(current->key, current->KeyType)){return 0;}
+      if(!__internal__InternIsCanonical(current->value, current->ValueType)){return 0;}
+      hash = __internal__InternHashChild(current->key, current->KeyType, hash);
+      hash = __internal__InternHashChild(current->value, current->ValueType, hash);
+    }
+    hash = __internal__HashBytes((char*)&ajo->AJKVPCount, sizeof(int), hash);
+  }
+  *ok = 1;
+  return hash;
+}
+
+int __internal__InternContainerEquals(void * a, void * b, int type){
+  if(type == TYPE_ARRAY){
+    struct AJArray * x = (struct AJArray *)a;
+    struct AJArray * y = (struct AJArray *)b;
+    if(x->length != y->length || (x->PackedNumbers == NULL) != (y->PackedNumbers == NULL)){return 0;}
+    if(x->PackedNumbers != NULL){
+      for(int i = 0; i < x->length; i++){
+        if(x->PackedNumbers[i] != y->PackedNumbers[i]){return 0;}
+      }
+      return 1;
+    }
+    struct AJArrayElement * ex = x->FirstElement;
+    struct AJArrayElement * ey = y->FirstElement;
+    for(; ex != NULL; ex = ex->NextAJElement, ey = ey->NextAJElement){
+      if(!__internal__InternChildEquals(ex->ArrayElement, ex->ArrayElementType, ey->ArrayElement, ey->ArrayElementType)){return 0;}
+    }
+    return 1;
+  }
+  struct AJObject * x = (struct AJObject *)a;
+  struct AJObject * y = (struct AJObject *)b;
+  if(x->AJKVPCount != y->AJKVPCount){return 0;}
+  struct AJKeyValuePair * kx = x->FirstAJKVP;
+  struct AJKeyValuePair * ky = y->FirstAJKVP;
+  for(; kx != NULL; kx = kx->NextAJKVP, ky = ky->NextAJKVP){
+    if(!__internal__InternChildEquals(kx->key, kx->KeyType, ky->key, ky->KeyType)){return 0;}
+    if(!__internal__InternChildEquals(kx->value, kx->ValueType, ky->value, ky->ValueType)){return 0;}
+  }
+  return 1;
+}
+
+//swaps a just parsed array / object for the shared copy if there is one (freeing node), or shares node from now on.
+//returns whichever node the parent should point at.
+void * __internal__InternAJContainer(struct AJInternTable * table, void * node, int type){
+  if(!__internal__SameAllocator(&AJGetContext()->Allocator, &table->Allocator)){return node;}
+  int ok;
+  unsigned int hash = __internal__InternHashContainer(node, type, &ok);
+  if(!ok){return node;}
+  int slot = hash & (table->Capacity - 1);
+  while(table->Entries[slot].Node != NULL){
+    struct __internal__InternEntry * entry = &table->Entries[slot];
+    if(entry->Hash == hash && entry->Type == type && __internal__InternContainerEquals(entry->Node, node, type)){
+      AJDelete(node, type);
+      if(type == TYPE_ARRAY){
+        ((struct AJArray *)entry->Node)->RefCount++;
+      }else{
+        ((struct AJObject *)entry->Node)->RefCount++;
+      }
+      return entry->Node;
+    }
+    slot = (slot + 1) & (table->Capacity - 1);
+  }
+  if(type == TYPE_ARRAY){
+    ((struct AJArray *)node)->RefCount = 2; //the table and the parent
+  }else{
+    ((struct AJObject *)node)->RefCount = 2;
+  }
+  __internal__InternInsert(table, hash, type, node);
+  return node;
+}
+
+/* Builders
+For putting big objects / arrays together in code. AddToAJObject / AddToAJArray allocate every KVP or element on its own; a builder
+keeps them in one growing block (reserve the size up front if you know it) and links everything once, in FinishAJ*Builder.
+Numbers, booleans and nulls added through the typed Add functions are stored inline with AJContext->InlineScalars on, so they
+cost no allocation at all; otherwise FinishAJ*Builder gives each one its own node.
+The finished object / array is a normal one (its block is KVPBlock / ElementBlock) and can be edited and deleted like any other.
+The builder itself is freed by FinishAJ*Builder.
+Every Add function returns 1, or 0 when it was given a NULL key / value and added nothing (a value passed in is then still yours).
+The AddMany / AddNumbers functions check everything first, so they add all of it or none of it and later indexes never shift.*/
+
+struct AJObjectBuilder{
+  struct AJKeyValuePair * Block; //value == NULL marks a scalar kept in InlineValue until Finish places it (the block can still move)
+  int Count;
+  int Capacity;
+};
+
+struct AJArrayBuilder{
+  struct AJArrayElement * Block; //ArrayElement == NULL marks an inline scalar, like in AJObjectBuilder
+  int Count;
+  int Capacity;
+};
+
+//makes room for at least capacity KVPs in total
+void AJObjectBuilderReserve(struct AJObjectBuilder * builder, int capacity){
+  if(capacity <= builder->Capacity){return;}
+  builder->Block = (struct AJKeyValuePair *)__internal__Realloc(builder->Block, sizeof(struct AJKeyValuePair) * capacity);
+  builder->Capacity = capacity;
+}
+
+struct AJObjectBuilder * CreateAJObjectBuilder(int capacity){
+  struct AJObjectBuilder * builder = (struct AJObjectBuilder *)__internal__Malloc(sizeof(struct AJObjectBuilder));
+  builder->Block = NULL;
+  builder->Count = 0;
+  builder->Capacity = 0;
+  AJObjectBuilderReserve(builder, capacity < 4 ? 4 : capacity);
+  return builder;
+}
+
+//next free KVP in the block, with its key set (copied from key)
+struct AJKeyValuePair * __internal__ObjectBuilderNext(struct AJObjectBuilder * builder, char * key){
+  if(builder->Count == builder->Capacity){
+    AJObjectBuilderReserve(builder, builder->Capacity * 2);
+  }
+  struct AJKeyValuePair * kvp = &builder->Block[builder->Count++];
+  kvp->key = (void*)CreateAJString(key);
+  kvp->KeyType = TYPE_STRING;
+  return kvp;
+}
+
+//adds key : value. value becomes part of the object (it is deleted with it).
+int AJObjectBuilderAdd(struct AJObjectBuilder * builder, char * key, void * value, int valueType){
+  if(key == NULL || value == NULL){return 0;}
+  struct AJKeyValuePair * kvp = __internal__ObjectBuilderNext(builder, key);
+  kvp->value = value;
+  kvp->ValueType = valueType;
+  return 1;
+}
+
+//adds count KVPs in one go: keys[i] : values[i] (of type valueTypes[i]). 0, and nothing added, if any key or value is NULL
+int AJObjectBuilderAddMany(struct AJObjectBuilder * builder, char ** keys, void ** values, int * valueTypes, int count){
+  for(int i = 0; i < count; i++){
+    if(keys[i] == NULL || values[i] == NULL){return 0;}
+  }
+  AJObjectBuilderReserve(builder, builder->Count + count);
+  for(int i = 0; i < count; i++){
+    AJObjectBuilderAdd(builder, keys[i], values[i], valueTypes[i]);
+  }
+  return 1;
+}
+
+int AJObjectBuilderAddNumber(struct AJObjectBuilder * builder, char * key, double num){
+  if(key == NULL){return 0;}
+  struct AJKeyValuePair * kvp = __internal__ObjectBuilderNext(builder, key);
+  kvp->InlineValue.Number.number = num;
+  kvp->InlineValue.Number.Lexeme = NULL;
+  kvp->value = NULL;
+  kvp->ValueType = TYPE_NUMBER;
+  return 1;
+}
+
+int AJObjectBuilderAddBoolean(struct AJObjectBuilder * builder, char * key, char truthValue){
+  if(key == NULL){return 0;}
+  struct AJKeyValuePair * kvp = __internal__ObjectBuilderNext(builder, key);
+  kvp->InlineValue.Boolean.TruthValue = truthValue;
+  kvp->value = NULL;
+  kvp->ValueType = TYPE_BOOLEAN;
+  return 1;
+}
+
+int AJObjectBuilderAddNull(struct AJObjectBuilder * builder, char * key){
+  if(key == NULL){return 0;}
+  struct AJKeyValuePair * kvp = __internal__ObjectBuilderNext(builder, key);
+  kvp->value = NULL;
+  kvp->ValueType = TYPE_NULL;
+  return 1;
+}
+
+//links everything up and hands back the object. frees the builder.
+struct AJObject * FinishAJObjectBuilder(struct AJObjectBuilder * builder){
+  struct AJObject * adedoyin = CreateAJObject();
+  int count = builder->Count;
+  struct AJKeyValuePair * block = builder->Block;
+  if(count == 0){
+    __internal__Free(block);
+    block = NULL;
+  }else if(count < builder->Capacity){
+    block = (struct AJKeyValuePair *)__internal__Realloc(block, sizeof(struct AJKeyValuePair) * count);
+  }
+  for(int i = 0; i < count; i++){
+    if(block[i].value == NULL){
+      block[i].value = __internal__PlaceScalar(&block[i].InlineValue, block[i].ValueType);
+    }
+    block[i].PrevAJKVP = i == 0 ? NULL : &block[i - 1];
+    block[i].NextAJKVP = i == count - 1 ? NULL : &block[i + 1];
+  }
+  adedoyin->FirstAJKVP = block;
+  adedoyin->LastAJKVP = count == 0 ? NULL : &block[count - 1];
+  adedoyin->AJKVPCount = count;
+  adedoyin->KVPBlock = block;
+  adedoyin->KVPBlockCount = count;
+  __internal__Free(builder);
+  return adedoyin;
+}
+
+//makes room for at least capacity elements in total
+void AJArrayBuilderReserve(struct AJArrayBuilder * builder, int capacity){
+  if(capacity <= builder->Capacity){return;}
+  builder->Block = (struct AJArrayElement *)__internal__Realloc(builder->Block, sizeof(struct AJArrayElement) * capacity);
+  builder->Capacity = capacity;
+}
+
+struct AJArrayBuilder * CreateAJArrayBuilder(int capacity){
+  struct AJArrayBuilder * builder = (struct AJArrayBuilder *)__internal__Malloc(sizeof(struct AJArrayBuilder));
+  builder->Block = NULL;
+  builder->Count = 0;
+  builder->Capacity = 0;
+  AJArrayBuilderReserve(builder, capacity < 4 ? 4 : capacity);
+  return builder;
+}
+
+struct AJArrayElement * __internal__ArrayBuilderNext(struct AJArrayBuilder * builder){
+  if(builder->Count == builder->Capacity){
+    AJArrayBuilderReserve(builder, builder->Capacity * 2);
+  }
+  return &builder->Block[builder->Count++];
+}
+
+//appends element. it becomes part of the array (it is deleted with it).
+int AJArrayBuilderAdd(struct AJArrayBuilder * builder, void * element, int elementType){
+  if(element == NULL){return 0;}
+  struct AJArrayElement * el = __internal__ArrayBuilderNext(builder);
+  el->ArrayElement = element;
+  el->ArrayElementType = elementType;
+  return 1;
+}
+
+int AJArrayBuilderAddNumber(struct AJArrayBuilder * builder, double num){
+  struct AJArrayElement * el = __internal__ArrayBuilderNext(builder);
+  el->InlineElement.Number.number = num;
+  el->InlineElement.Number.Lexeme = NULL;
+  el->ArrayElement = NULL;
+  el->ArrayElementType = TYPE_NUMBER;
+  return 1;
+}
+
+//appends count numbers in one go
+int AJArrayBuilderAddNumbers(struct AJArrayBuilder * builder, double * nums, int count){
+  if(nums == NULL && count > 0){return 0;}
+  AJArrayBuilderReserve(builder, builder->Count + count);
+  for(int i = 0; i < count; i++){
+    AJArrayBuilderAddNumber(builder, nums[i]);
+  }
+  return 1;
+}
+
+int AJArrayBuilderAddBoolean(struct AJArrayBuilder * builder, char truthValue){
+  struct AJArrayElement * el = __internal__ArrayBuilderNext(builder);
+  el->InlineElement.Boolean.TruthValue = truthValue;
+  el->ArrayElement = NULL;
+  el->ArrayElementType = TYPE_BOOLEAN;
+  return 1;
+}
+
+int AJArrayBuilderAddNull(struct AJArrayBuilder * builder){
+  struct AJArrayElement * el = __internal__ArrayBuilderNext(builder);
+  el->ArrayElement = NULL;
+  el->ArrayElementType = TYPE_NULL;
+  return 1;
+}
+
+//links everything up and hands back the array. frees the builder.
+struct AJArray * FinishAJArrayBuilder(struct AJArrayBuilder * builder){
+  struct AJArray * opeyemi = CreateAJArray();
+  int count = builder->Count;
+  struct AJArrayElement * block = builder->Block;
+  if(count == 0){
+    __internal__Free(block);
+    block = NULL;
+  }else if(count < builder->Capacity){
+    block = (struct AJArrayElement *)__internal__Realloc(block, sizeof(struct AJArrayElement) * count);
+  }
+  for(int i = 0; i < count; i++){
+    if(block[i].ArrayElement == NULL){
+      block[i].ArrayElement = __internal__PlaceScalar(&block[i].InlineElement, block[i].ArrayElementType);
+    }
+    block[i].PrevAJElement = i == 0 ? NULL : &block[i - 1];
+    block[i].NextAJElement = i == count - 1 ? NULL : &block[i + 1];
+  }
+  opeyemi->FirstElement = block;
+  opeyemi->LastElement = count == 0 ? NULL : &block[count - 1];
+  opeyemi->length = count;
+  opeyemi->ElementBlock = block;
+  opeyemi->ElementBlockCount = count;
+  __internal__Free(builder);
+  return opeyemi;
+}
+
+/* AJWriter: streaming JSON output without building a tree.
+Call AJWriterBeginObject / AJWriterKey / AJWriterDouble / AJWriterEndArray ... in document order and the writer takes care of
+commas, colons and brackets (a small stack remembers where it is) and escapes strings. Output looks the same as what
+WriteAJObjectAsStringToBuffer produces. Text goes into the writer's own buffer (AJWriterGetText), or, with a sink, gets
+handed to the sink every time the buffer fills up and on AJWriterFlush.
+Every call returns 1, or 0 if it doesnt fit where the writer is (a value where a key should be, an end that doesnt match its begin,
+nesting deeper than AJ_WRITER_MAX_DEPTH, a second value at the top level) or has no JSON text (NaN and infinities, also inside
+a tree given to AJWriterValue). After a 0 the writer is in error (Error = 1) and ignores everything until AJWriterReset.*/
+
+#define AJ_WRITER_MAX_DEPTH 256
+#define AJ_WRITER_IN_OBJECT 1 //stack bits
+#define AJ_WRITER_HAS_MEMBERS 2
+
+struct AJWriter{
+  char * Buffer;
+  int BufferLength;
+  int Position;
+  void (*Sink)(char * bytes, int length, void * UserPointer); //NULL: keep everything in Buffer
+  void * SinkUserPointer;
+  char Stack[AJ_WRITER_MAX_DEPTH]; //AJ_WRITER_* bits for every open container
+  int Depth;
+  char ExpectingValue; //a key was just written
+  char HasRoot; //the top level value was started: a document has only one
+  char Error;
+};
+
+struct AJWriter * CreateAJWriter(int initialBufferLength){
+  struct AJWriter * writer = (struct AJWriter *)__internal__Malloc(sizeof(struct AJWriter));
+  writer->BufferLength = initialBufferLength < 64 ? 64 : initialBufferLength;
+  writer->Buffer = (char *)__internal__Malloc(writer->BufferLength);
+  writer->Buffer[0] = '\0';
+  writer->Position = 0;
+  writer->Sink = NULL;
+  writer->SinkUserPointer = NULL;
+  writer->Depth = 0;
+  writer->ExpectingValue = 0;
+  writer->HasRoot = 0;
+  writer->Error = 0;
+  return writer;
+}
+
+//a writer that passes its text to sink in pieces of up to bufferLength bytes, instead of keeping all of it
+struct AJWriter * CreateAJWriterWithSink(void (*sink)(char * bytes, int length, void * UserPointer), void * UserPointer, int bufferLength){
+  struct AJWriter * writer = CreateAJWriter(bufferLength);
+  writer->Sink = sink;
+  writer->SinkUserPointer = UserPointer;
+  return writer;
+}
+
+void DeleteAJWriter(struct AJWriter * writer){
+  __internal__Free(writer->Buffer);
+  __internal__Free(writer);
+}
+
+//hands whatever is buffered to the sink (does nothing without one)
+void AJWriterFlush(struct AJWriter * writer){
+  if(writer->Sink != NULL && writer->Position > 0){
+    writer->Sink(writer->Buffer, writer->Position, writer->SinkUserPointer);
+    writer->Position = 0;
+    writer->Buffer[0] = '\0';
+  }
+}
+
+//empties the writer (and clears an error) so it can write another document
+void AJWriterReset(struct AJWriter * writer){
+  writer->Position = 0;
+  writer->Buffer[0] = '\0';
+  writer->Depth = 0;
+  writer->ExpectingValue = 0;
+  writer->HasRoot = 0;
+  writer->Error = 0;
+}
+
+//the text written so far (null terminated) and its length. Only the part since the last flush when there is a sink.
+char * AJWriterGetText(struct AJWriter * writer, int * length){
+  if(length != NULL){*length = writer->Position;}
+  return writer->Buffer;
+}
+
+//makes sure needed more bytes (+ the null terminator) fit. returns where to write them.
+char * __internal__WriterReserve(struct AJWriter * writer, int needed){
+  if(writer->BufferLength - writer->Position <= needed){
+    AJWriterFlush(writer);
+    if(writer->BufferLength - writer->Position <= needed){
+      int newLength = writer->BufferLength * 2;
+      while(newLength - writer->Position <= needed){newLength *= 2;}
+      writer->Buffer = (char *)__internal__Realloc(writer->Buffer, newLength);
+      writer->BufferLength = newLength;
+    }
+  }
+  return &writer->Buffer[writer->Position];
+}
+
+void __internal__WriterAppend(struct AJWriter * writer, const char * bytes, int length){
+  char * at = __internal__WriterReserve(writer, length);
+  memcpy(at, bytes, length);
+  writer->Position += length;
+  writer->Buffer[writer->Position] = '\0';
+}
+
+//writes chars as a quoted, escaped JSON string (non ASCII as \uXXXX too with asciiOnly).
+//room for the whole escaped string is made once, clean runs are memcpy'd.
+void __internal__WriterEscapedString(struct AJWriter * writer, const char * chars, int length, int asciiOnly){
+  int cleanLength = __internal__NextCharToEscape(chars, 0, length, asciiOnly);
+  int escapedLength = cleanLength;
+  if(cleanLength != length){
+    escapedLength += __internal__EscapedLength(&chars[cleanLength], length - cleanLength, asciiOnly);
+  }
+  char * at = __internal__WriterReserve(writer, escapedLength + 2);
+  at[0] = '"';
+  memcpy(&at[1], chars, cleanLength);
+  if(cleanLength != length){
+    __internal__WriteEscapedChars(&chars[cleanLength], length - cleanLength, &at[1 + cleanLength], asciiOnly);
+  }
+  at[escapedLength + 1] = '"';
+  writer->Position += escapedLength + 2;
+  writer->Buffer[writer->Position] = '\0';
+}
+
+//everything that goes before a value: checks it is allowed here and writes the ", " between array elements
+int __internal__WriterBeforeValue(struct AJWriter * writer){
+  if(writer->Error){return 0;}
+  if(writer->Depth > 0){
+    char * top = &writer->Stack[writer->Depth - 1];
+    if(*top & AJ_WRITER_IN_OBJECT){
+      if(!writer->ExpectingValue){writer->Error = 1; return 0;} //objects need a key first
+      writer->ExpectingValue = 0;
+    }else{
+      if(*top & AJ_WRITER_HAS_MEMBERS){
+        __internal__WriterAppend(writer, ", ", 2);
+      }
+      *top |= AJ_WRITER_HAS_MEMBERS;
+    }
+  }else{
+    if(writer->HasRoot){writer->Error = 1; return 0;}
+    writer->HasRoot = 1;
+  }
+  return 1;
+}
+
+int __internal__WriterBegin(struct AJWriter * writer, char isObject){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  if(writer->Depth == AJ_WRITER_MAX_DEPTH){writer->Error = 1; return 0;}
+  writer->Stack[writer->Depth++] = isObject ? AJ_WRITER_IN_OBJECT : 0;
+  __internal__WriterAppend(writer, isObject ? "{ " : "[ ", 2);
+  return 1;
+}
+
+int __internal__WriterEnd(struct AJWriter * writer, char isObject){
+  if(writer->Error){return 0;}
+  if(writer->Depth == 0 || ((writer->Stack[writer->Depth - 1] & AJ_WRITER_IN_OBJECT) != 0) != isObject || writer->ExpectingValue){
+    writer->Error = 1;
+    return 0;
+  }
+  writer->Depth--;
+  __internal__WriterAppend(writer, isObject ? " }" : " ]", 2);
+  return 1;
+}
+
+int AJWriterBeginObject(struct AJWriter * writer){return __internal__WriterBegin(writer, 1);}
+int AJWriterEndObject(struct AJWriter * writer){return __internal__WriterEnd(writer, 1);}
+int AJWriterBeginArray(struct AJWriter * writer){return __internal__WriterBegin(writer, 0);}
+int AJWriterEndArray(struct AJWriter * writer){return __internal__WriterEnd(writer, 0);}
+
+//key of the next member of the current object (length chars, doesnt need to be null terminated)
+int AJWriterKeyWithLength(struct AJWriter * writer, char * key, int length){
+  if(writer->Error){return 0;}
+  if(writer->Depth == 0 || !(writer->Stack[writer->Depth - 1] & AJ_WRITER_IN_OBJECT) || writer->ExpectingValue){
+    writer->Error = 1;
+    return 0;
+  }
+  char * top = &writer->Stack[writer->Depth - 1];
+  if(*top & AJ_WRITER_HAS_MEMBERS){
+    __internal__WriterAppend(writer, ", ", 2);
+  }
+  *top |= AJ_WRITER_HAS_MEMBERS;
+  __internal__WriterEscapedString(writer, key, length, AJGetContext()->EscapeNonAscii);
+  __internal__WriterAppend(writer, " : ", 3);
+  writer->ExpectingValue = 1;
+  return 1;
+}
+
+int AJWriterKey(struct AJWriter * writer, char * key){
+  return AJWriterKeyWithLength(writer, key, strlen(key));
+}
+
+int AJWriterStringWithLength(struct AJWriter * writer, char * string, int length){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  __internal__WriterEscapedString(writer, string, length, AJGetContext()->EscapeNonAscii);
+  return 1;
+}
+
+int AJWriterString(struct AJWriter * writer, char * string){
+  return AJWriterStringWithLength(writer, string, strlen(string));
+}
+
+//whole numbers are written straight from their digits, no printf
+int AJWriterInt64(struct AJWriter * writer, long long num){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  char digits[21];
+  int at = 21;
+  unsigned long long magnitude = num < 0 ? 0ULL - (unsigned long long)num : (unsigned long long)num;
+  do{
+    digits[--at] = '0' + (magnitude % 10);
+    magnitude /= 10;
+  }while(magnitude != 0);
+  if(num < 0){digits[--at] = '-';}
+  __internal__WriterAppend(writer, &digits[at], 21 - at);
+  return 1;
+}
+
+//doubles use the context's number format, the same as the tree writers. NaN and infinities fail, JSON has no text for them
+int AJWriterDouble(struct AJWriter * writer, double num){
+  if(num != num || num - num != 0){writer->Error = 1; return 0;}
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  char numStrBuf[AJ_NUMBER_TEXT_SIZE];
+  int length = snprintf(numStrBuf, sizeof(numStrBuf), AJGetContext()->NumberFormatString, num);
+  if(length < 0){length = 0;}
+  if(length > (int)sizeof(numStrBuf) - 1){length = sizeof(numStrBuf) - 1;} //snprintf returns what it would have written, not what it did
+  __internal__WriterAppend(writer, numStrBuf, length);
+  return 1;
+}
+
+//writes number text exactly as given (e.g. a lexeme you kept), no checks
+int AJWriterRawNumber(struct AJWriter * writer, char * text, int length){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  __internal__WriterAppend(writer, text, length);
+  return 1;
+}
+
+int AJWriterBoolean(struct AJWriter * writer, char truthValue){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  __internal__WriterAppend(writer, truthValue ? "true" : "false", truthValue ? 4 : 5);
+  return 1;
+}
+
+int AJWriterNull(struct AJWriter * writer){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  __internal__WriterAppend(writer, "null", 4);
+  return 1;
+}
+
+//1 if there is a NaN or an infinity anywhere in node
+int __internal__HasNonFiniteNumber(void * node, int type){
+  switch(type){
+    case TYPE_NUMBER:{
+      double num = ((struct AJNumber *)node)->number;
+      return num != num || num - num != 0;
+    }
+    case TYPE_ARRAY:{
+      struct AJArray * aja = (struct AJArray *)node;
+      if(aja->PackedNumbers != NULL){
+        for(int i = 0; i < aja->length; i++){
+          if(aja->PackedNumbers[i] != aja->PackedNumbers[i] || aja->PackedNumbers[i] - aja->PackedNumbers[i] != 0){return 1;}
+        }
+        return 0;
+      }
+      for(struct AJArrayElement * current = aja->FirstElement; current != NULL; current = current->NextAJElement){
+        if(__internal__HasNonFiniteNumber(current->ArrayElement, current->ArrayElementType)){return 1;}
+      }
+      return 0;
+    }
+    case TYPE_OBJECT:{
+      for(struct AJKeyValuePair * current = ((struct AJObject *)node)->FirstAJKVP; current != NULL; current = current->NextAJKVP){
+        if(__internal__HasNonFiniteNumber(current->key, current->KeyType) || __internal__HasNonFiniteNumber(current->value, current->ValueType)){return 1;}
+      }
+      return 0;
+    }
+  }
+  return 0;
+}
+
+//writes an existing AJ tree (or scalar) as the next value, for when part of the output already is one
+int AJWriterValue(struct AJWriter * writer, void * obj, int type){
+  if(writer->Error){return 0;}
+  if(__internal__HasNonFiniteNumber(obj, type)){writer->Error = 1; return 0;}
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  if(writer->BufferLength - writer->Position < writer->BufferLength / 2){
+    AJWriterFlush(writer); //the tree writers grow the buffer themselves; give them room first
+  }
+  switch(type){
+    case TYPE_OBJECT:{
+      writer->Position += WriteAJObjectAsStringToBuffer((struct AJObject*)obj, &writer->Buffer, &writer->BufferLength, writer->Position) - 1;
+      break;
+    }
+    case TYPE_ARRAY:{
+      writer->Position += WriteAJArrayAsStringToBuffer((struct AJArray*)obj, &writer->Buffer, &writer->BufferLength, writer->Position) - 1;
+      break;
+    }
+    default:{
+      writer->Position += WritePrimitiveTypeAsStringToBuffer(obj, type, &writer->Buffer, &writer->BufferLength, writer->Position) - 1;
+    }
+  }
+  if(writer->BufferLength - writer->Position <= 1){ //keep the usual room for the null terminator
+    __internal__WriterReserve(writer, 1);
+  }
+  return 1;
+}
+
+/* Deferred deletes (AJReclaimer)
+Deleting a big tree frees every node one by one, which is slow enough to show up in latency when it happens on a request thread.
+AJDeleteLater just puts the root on the reclaimer's queue and returns. The trees are then freed either
+  -by a background thread (CreateAJReclaimer(1), needs pthreads: link with -pthread), or
+  -whenever you call AJReclaimNow (CreateAJReclaimer(0)), e.g after the response has gone out.
+Each tree is freed with the allocator of the context that was active when it was queued, so that allocator has to be fine with
+being called from the reclaimer thread. Dont queue trees that share nodes (AJInternTable) with trees still in use: reference counts
+are not atomic. AJDocument arenas are already cheap to drop; they dont need this.*/
+
+struct __internal__DeferredDelete{
+  void * Node;
+  int Type;
+  struct AJAllocator Allocator; //the one the tree was made with
+  struct __internal__DeferredDelete * Next;
+};
+
+struct AJReclaimer{
+  struct __internal__DeferredDelete * Head;
+  struct __internal__DeferredDelete * Tail;
+  int Stop;
+  int HasThread;
+#ifdef AJ_HAVE_PTHREADS
+  pthread_t Thread;
+  pthread_mutex_t Lock;
+  pthread_cond_t Wake;
+#endif
+};
+
+//frees every tree in the list (a queue that was taken off the reclaimer). returns how many.
+int __internal__RunDeferredDeletes(struct __internal__DeferredDelete * current){
+  int count = 0;
+  struct AJContext ctx;
+  AJInitContext(&ctx);
+  struct AJContext * previous = AJSetContext(&ctx);
+  while(current != NULL){
+    struct __internal__DeferredDelete * next = current->Next;
+    ctx.Allocator = current->Allocator;
+    AJDelete(current->Node, current->Type);
+    ctx.Allocator.Free(current, ctx.Allocator.UserPointer);
+    count++;
+    current = next;
+  }
+  AJSetContext(previous);
+  return count;
+}
+
+#ifdef AJ_HAVE_PTHREADS
+void * __internal__ReclaimerThread(void * arg){
+  struct AJReclaimer * reclaimer = (struct AJReclaimer *)arg;
+  pthread_mutex_lock(&reclaimer->Lock);
+  while(1){
+    while(reclaimer->Head == NULL && !reclaimer->Stop){
+      pthread_cond_wait(&reclaimer->Wake, &reclaimer->Lock);
+    }
+    if(reclaimer->Head == NULL){break;} //stopping and nothing left
+    struct __internal__DeferredDelete * batch = reclaimer->Head;
+    reclaimer->Head = NULL;
+    reclaimer->Tail = NULL;
+    pthread_mutex_unlock(&reclaimer->Lock);
+    __internal__RunDeferredDeletes(batch);
+    pthread_mutex_lock(&reclaimer->Lock);
+  }
+  pthread_mutex_unlock(&reclaimer->Lock);
+  return NULL;
+}
+#endif
+
+//useThread = 1 starts a background thread that frees queued trees as they come in (falls back to 0 without pthreads).
+//useThread = 0: trees wait in the queue until AJReclaimNow.
+struct AJReclaimer * CreateAJReclaimer(int useThread){
+  struct AJReclaimer * reclaimer = (struct AJReclaimer *)__internal__Malloc(sizeof(struct AJReclaimer));
+  reclaimer->Head = NULL;
+  reclaimer->Tail = NULL;
+  reclaimer->Stop = 0;
+  reclaimer->HasThread = 0;
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_init(&reclaimer->Lock, NULL);
+  pthread_cond_init(&reclaimer->Wake, NULL);
+  if(useThread && pthread_create(&reclaimer->Thread, NULL, __internal__ReclaimerThread, reclaimer) == 0){
+    reclaimer->HasThread = 1;
+  }
+#endif
+  return reclaimer;
+}
+
+//queues aj (any AJ type) to be deleted later. O(1): one small allocation and, with a thread, a lock.
+void AJDeleteLater(struct AJReclaimer * reclaimer, void * aj, int elementType){
+  if(aj == NULL){return;}
+  struct AJContext * ctx = AJGetContext();
+  __internal__ForgetCachedSubtree(aj, elementType); //the reclaimer frees it without the text cache seeing
+  struct __internal__DeferredDelete * entry = (struct __internal__DeferredDelete *)__internal__Malloc(sizeof(struct __internal__DeferredDelete));
+  entry->Node = aj;
+  entry->Type = elementType;
+  entry->Allocator = ctx->Allocator;
+  entry->Next = NULL;
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_lock(&reclaimer->Lock);
+#endif
+  if(reclaimer->Tail != NULL){
+    reclaimer->Tail->Next = entry;
+  }else{
+    reclaimer->Head = entry;
+  }
+  reclaimer->Tail = entry;
+#ifdef AJ_HAVE_PTHREADS
+  pthread_cond_signal(&reclaimer->Wake);
+  pthread_mutex_unlock(&reclaimer->Lock);
+#endif
+}
+
+//frees everything queued so far on the calling thread. returns how many trees that was.
+int AJReclaimNow(struct AJReclaimer * reclaimer){
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_lock(&reclaimer->Lock);
+#endif
+  struct __internal__DeferredDelete * batch = reclaimer->Head;
+  reclaimer->Head = NULL;
+  reclaimer->Tail = NULL;
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_unlock(&reclaimer->Lock);
+#endif
+  return __internal__RunDeferredDeletes(batch);
+}
+
+//frees whatever is still queued, stops the thread (if any) and frees the reclaimer
+void DeleteAJReclaimer(struct AJReclaimer * reclaimer){
+#ifdef AJ_HAVE_PTHREADS
+  if(reclaimer->HasThread){
+    pthread_mutex_lock(&reclaimer->Lock);
+    reclaimer->Stop = 1;
+    pthread_cond_signal(&reclaimer->Wake);
+    pthread_mutex_unlock(&reclaimer->Lock);
+    pthread_join(reclaimer->Thread, NULL); //the thread empties the queue before it exits
+  }
+#endif
+  AJReclaimNow(reclaimer);
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_destroy(&reclaimer->Lock);
+  pthread_cond_destroy(&reclaimer->Wake);
+#endif
+  __internal__Free(reclaimer);
+}
+
+/* Parallel text writing
+WriteAJArrayAsStringToBufferParallel / WriteAJObjectAsStringToBufferParallel write the same text as the normal writers, but split
+a big container's members into threadCount ranges and write each range on its own thread into its own buffer. The pieces are then
+copied into the output buffer one after another (one resize, one memcpy each). Containers with fewer than
+AJ_PARALLEL_MIN_MEMBERS members are written normally, except that their array / object members get the parallel treatment,
+so {"rows" : [ ...millions... ]} still spreads out. Threads are started per call (pthreads; without them this is the normal writer).
+Worker threads write with a copy of the calling thread's context, so its allocator has to be thread safe.*/
+
+#define AJ_PARALLEL_MIN_MEMBERS 1024
+
+//writes any AJ type with the matching text writer. same return value as they have (chars written + 1)
+int __internal__WriteAJValueAsString(void * obj, int type, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  switch(type){
+    case TYPE_ARRAY: return WriteAJArrayAsStringToBuffer((struct AJArray*)obj, originalBufferPointer, buflength, positionToStartWriting);
+    case TYPE_OBJECT: return WriteAJObjectAsStringToBuffer((struct AJObject*)obj, originalBufferPointer, buflength, positionToStartWriting);
+  }
+  return WritePrimitiveTypeAsStringToBuffer(obj, type, originalBufferPointer, buflength, positionToStartWriting);
+}
+
+void __internal__WriteLiteral(const char * text, int length, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, length + 1);
+  memcpy(&(*originalBufferPointer)[positionToStartWriting], text, length + 1);
+}
+
+#ifdef AJ_HAVE_PTHREADS
+//one thread's share of a container
+struct __internal__WriteRange{
+  struct AJArray * Array; //NULL when writing KVPs
+  struct AJArrayElement * FirstElement;
+  struct AJKeyValuePair * FirstKVP;
+  int StartIndex; //of FirstElement / FirstKVP, used for packed arrays
+  int Count;
+  struct AJContext Context;
+  char * Buffer;
+  int BufferLength;
+  int Length; //chars written, no null terminator
+};
+
+//writes a range's members separated by ", " (no brackets) into range->Buffer
+void * __internal__WriteRangeWorker(void * arg){
+  struct __internal__WriteRange * range = (struct __internal__WriteRange *)arg;
+  struct AJContext * previous = AJSetContext(&range->Context);
+  range->BufferLength = 65536;
+  range->Buffer = (char *)__internal__Malloc(range->BufferLength);
+  range->Buffer[0] = '\0';
+  int pos = 0;
+  struct AJArrayElement * el = range->FirstElement;
+  struct AJKeyValuePair * ajkvp = range->FirstKVP;
+  for(int i = 0; i < range->Count; i++){
+    if(i != 0){
+      __internal__WriteLiteral(", ", 2, &range->Buffer, &range->BufferLength, pos);
+      pos += 2;
+    }
+    if(range->Array != NULL){
+      if(range->Array->PackedNumbers != NULL){
+        struct AJNumber packed;
+        packed.number = range->Array->PackedNumbers[range->StartIndex + i];
+        packed.Lexeme = NULL;
+        pos += WritePrimitiveTypeAsStringToBuffer(&packed, TYPE_NUMBER, &range->Buffer, &range->BufferLength, pos) - 1;
+      }else{
+        pos += __internal__WriteAJValueAsString(el->ArrayElement, el->ArrayElementType, &range->Buffer, &range->BufferLength, pos) - 1;
+        el = el->NextAJElement;
+      }
+    }else{
+      pos += __internal__WriteAJValueAsString(ajkvp->key, ajkvp->KeyType, &range->Buffer, &range->BufferLength, pos) - 1;
+      __internal__WriteLiteral(" : ", 3, &range->Buffer, &range->BufferLength, pos);
+      pos += 3;
+      pos += __internal__WriteAJValueAsString(ajkvp->value, ajkvp->ValueType, &range->Buffer, &range->BufferLength, pos) - 1;
+      ajkvp = ajkvp->NextAJKVP;
+    }
+  }
+  range->Length = pos;
+  AJSetContext(previous);
+  return NULL;
+}
+
+//splits the count members over threadCount threads and copies their text in after "[ " / "{ "
+int __internal__WriteMembersParallel(struct AJArray * aja, struct AJObject * ajo, int count, char ** originalBufferPointer, int * buflength, int positionToStartWriting, int threadCount){
+  int start = positionToStartWriting;
+  struct __internal__WriteRange * ranges = (struct __internal__WriteRange *)__internal__Malloc(sizeof(struct __internal__WriteRange) * threadCount);
+  int perRange = (count + threadCount - 1) / threadCount;
+  struct AJArrayElement * el = aja != NULL ? aja->FirstElement : NULL;
+  struct AJKeyValuePair * ajkvp = ajo != NULL ? ajo->FirstAJKVP : NULL;
+  int used = 0;
+  int rangeCount = 0;
+  for(int t = 0; t < threadCount && used < count; t++){ //one walk of the list to find where each range starts
+    struct __internal__WriteRange * range = &ranges[t];
+    range->Array = aja;
+    range->FirstElement = el;
+    range->FirstKVP = ajkvp;
+    range->StartIndex = used;
+    range->Count = count - used < perRange ? count - used : perRange;
+    range->Context = *AJGetContext();
+    range->Context.TextCache = NULL; //the text cache is not thread safe
+    used += range->Count;
+    for(int i = 0; i < range->Count; i++){
+      if(el != NULL){el = el->NextAJElement;}
+      if(ajkvp != NULL){ajkvp = ajkvp->NextAJKVP;}
+    }
+    rangeCount++;
+  }
+  threadCount = rangeCount; //the last ranges can come out empty when count is small
+
+  pthread_t * threads = (pthread_t *)__internal__Malloc(sizeof(pthread_t) * threadCount);
+  char * started = (char *)__internal__Malloc(threadCount);
+  for(int t = 1; t < threadCount; t++){
+    started[t] = pthread_create(&threads[t], NULL, __internal__WriteRangeWorker, &ranges[t]) == 0;
+  }
+  __internal__WriteRangeWorker(&ranges[0]); //this thread does the first range
+  for(int t = 1; t < threadCount; t++){
+    if(started[t]){
+      pthread_join(threads[t], NULL);
+    }else{
+      __internal__WriteRangeWorker(&ranges[t]); //couldnt get a thread, do it here
+    }
+  }
+
+  //gather: size the output once, then one memcpy per range
+  int total = 0;
+  for(int t = 0; t < threadCount; t++){total += ranges[t].Length + 2;}
+  __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, total + 1);
+  for(int t = 0; t < threadCount; t++){
+    if(t != 0){
+      memcpy(&(*originalBufferPointer)[positionToStartWriting], ", ", 2);
+      positionToStartWriting += 2;
+    }
+    memcpy(&(*originalBufferPointer)[positionToStartWriting], ranges[t].Buffer, ranges[t].Length);
+    positionToStartWriting += ranges[t].Length;
+    __internal__Free(ranges[t].Buffer);
+  }
+  (*originalBufferPointer)[positionToStartWriting] = '\0';
+  __internal__Free(started);
+  __internal__Free(threads);
+  __internal__Free(ranges);
+  return positionToStartWriting - start;
+}
+
+//like __internal__WriteAJValueAsString, with big containers (or the containers inside small ones) written in parallel
+int __internal__WriteParallel(void * obj, int type, char ** originalBufferPointer, int * buflength, int positionToStartWriting, int threadCount){
+  if(type != TYPE_ARRAY && type != TYPE_OBJECT){
+    return WritePrimitiveTypeAsStringToBuffer(obj, type, originalBufferPointer, buflength, positionToStartWriting);
+  }
+  int start = positionToStartWriting;
+  struct AJArray * aja = type == TYPE_ARRAY ? (struct AJArray*)obj : NULL;
+  struct AJObject * ajo = type == TYPE_OBJECT ? (struct AJObject*)obj : NULL;
+  int count = aja != NULL ? aja->length : ajo->AJKVPCount;
+
+  __internal__WriteLiteral(aja != NULL ? "[ " : "{ ", 2, originalBufferPointer, buflength, positionToStartWriting);
+  positionToStartWriting += 2;
+  if(count >= AJ_PARALLEL_MIN_MEMBERS){
+    positionToStartWriting += __internal__WriteMembersParallel(aja, ajo, count, originalBufferPointer, buflength, positionToStartWriting, threadCount);
+  }else{
+    struct AJArrayElement * el = aja != NULL ? aja->FirstElement : NULL;
+    struct AJKeyValuePair * ajkvp = ajo != NULL ? ajo->FirstAJKVP : NULL;
+    for(int i = 0; i < count; i++){
+      if(i != 0){
+        __internal__WriteLiteral(", ", 2, originalBufferPointer, buflength, positionToStartWriting);
+        positionToStartWriting += 2;
+      }
+      if(aja != NULL && aja->PackedNumbers != NULL){
+        struct AJNumber packed;
+        packed.number = aja->PackedNumbers[i];
+        packed.Lexeme = NULL;
+        positionToStartWriting += WritePrimitiveTypeAsStringToBuffer(&packed, TYPE_NUMBER, originalBufferPointer, buflength, positionToStartWriting) - 1;
+      }else if(aja != NULL){
+        positionToStartWriting += __internal__WriteParallel(el->ArrayElement, el->ArrayElementType, originalBufferPointer, buflength, positionToStartWriting, threadCount) - 1;
+        el = el->NextAJElement;
+      }else{
+        positionToStartWriting += __internal__WriteAJValueAsString(ajkvp->key, ajkvp->KeyType, originalBufferPointer, buflength, positionToStartWriting) - 1;
+        __internal__WriteLiteral(" : ", 3, originalBufferPointer, buflength, positionToStartWriting);
+        positionToStartWriting += 3;
+        positionToStartWriting += __internal__WriteParallel(ajkvp->value, ajkvp->ValueType, originalBufferPointer, buflength, positionToStartWriting, threadCount) - 1;
+        ajkvp = ajkvp->NextAJKVP;
+      }
+    }
+  }
+  __internal__WriteLiteral(aja != NULL ? " ]" : " }", 2, originalBufferPointer, buflength, positionToStartWriting);
+  positionToStartWriting += 2;
+  return positionToStartWriting - start + 1; // +1 for null terminator
+}
+
+#endif
+
+//same output and return value as WriteAJArrayAsStringToBuffer, written by up to threadCount threads
+int WriteAJArrayAsStringToBufferParallel(struct AJArray * aja, char ** originalBufferPointer, int * buflength, int positionToStartWriting, int threadCount){
+#ifdef AJ_HAVE_PTHREADS
+  if(threadCount > 1){
+    return __internal__WriteParallel((void*)aja, TYPE_ARRAY, originalBufferPointer, buflength, positionToStartWriting, threadCount);
+  }
+#endif
+  return WriteAJArrayAsStringToBuffer(aja, originalBufferPointer, buflength, positionToStartWriting);
+}
+
+//same output and return value as WriteAJObjectAsStringToBuffer, written by up to threadCount threads
+int WriteAJObjectAsStringToBufferParallel(struct AJObject * ajo, char ** originalBufferPointer, int * buflength, int positionToStartWriting, int threadCount){
+#ifdef AJ_HAVE_PTHREADS
+  if(threadCount > 1){
+    return __internal__WriteParallel((void*)ajo, TYPE_OBJECT, originalBufferPointer, buflength, positionToStartWriting, threadCount);
+  }
+#endif
+  return WriteAJObjectAsStringToBuffer(ajo, originalBufferPointer, buflength, positionToStartWriting);
+}
+
+/* Text caching
+Long lived documents that change a few values at a time dont need all their text formatted again on every write.
+With an AJTextCache as AJContext->TextCache, the text writers remember each container's text (if it is at least
+AJ_TEXT_CACHE_MIN_LENGTH chars) and the container it was written inside. Changing the tree through AddToAJObject,
+AddToAJArray, AddNumberToAJArray, RemoveFromAJArray or AJNumberSetDouble marks the changed node and every container
+above it dirty, so the next write formats only those and memcpys the text of everything else.
+Changed something by hand (a bool's TruthValue, a string's chars...)? call AJMarkDirty() on it.
+Cached text is in the format that was active when it was written: make a new cache after changing the number format or EscapeStrings.
+Nodes shared through an AJInternTable have more than one parent, so dont change those while caching, and make a new cache
+after DeleteAJDocument (its arena is freed without visiting the nodes).*/
+
+#define AJ_TEXT_CACHE_MIN_LENGTH 64
+
+struct __internal__CachedText{
+  void * Node;
+  void * Parent; //the container it was last written inside, NULL for the one the write started at
+  char * Text; //its text from the last write. NULL if it was short or has changed since
+  int TextLength;
+  char Dirty; //changed since the last write. all containers above a dirty node are dirty too
+  struct __internal__CachedText * NextInBucket;
+};
+
+struct AJTextCache{
+  struct __internal__CachedText ** Buckets;
+  int BucketCount;
+  int Count;
+  struct AJAllocator Allocator;
+};
+
+//makes an empty text cache. set it as AJContext->TextCache to use it
+struct AJTextCache * CreateAJTextCache(){
+  struct AJContext * ctx = AJGetContext();
+  struct AJTextCache * cache = (struct AJTextCache *)ctx->Allocator.Alloc(sizeof(struct AJTextCache), ctx->Allocator.UserPointer);
+  cache->Allocator = ctx->Allocator;
+  cache->BucketCount = 256;
+  cache->Count = 0;
+  cache->Buckets = (struct __internal__CachedText **)cache->Allocator.Alloc(sizeof(struct __internal__CachedText *) * cache->BucketCount, cache->Allocator.UserPointer);
+  memset(cache->Buckets, 0, sizeof(struct __internal__CachedText *) * cache->BucketCount);
+  return cache;
+}
+
+void DeleteAJTextCache(struct AJTextCache * cache){
+  for(int i = 0; i < cache->BucketCount; i++){
+    struct __internal__CachedText * entry = cache->Buckets[i];
+    while(entry != NULL){
+      struct __internal__CachedText * next = entry->NextInBucket;
+      cache->Allocator.Free(entry->Text, cache->Allocator.UserPointer);
+      cache->Allocator.Free(entry, cache->Allocator.UserPointer);
+      entry = next;
+    }
+  }
+  cache->Allocator.Free(cache->Buckets, cache->Allocator.UserPointer);
+  cache->Allocator.Free(cache, cache->Allocator.UserPointer);
+}
+
+static inline int __internal__CacheBucket(struct AJTextCache * cache, void * node){
+  return (int)((((size_t)node >> 4) * 2654435761u) & (unsigned int)(cache->BucketCount - 1));
+}
+
+struct __internal__CachedText * __internal__FindCachedText(struct AJTextCache * cache, void * node){
+  struct __internal__CachedText * entry = cache->Buckets[__internal__CacheBucket(cache, node)];
+  while(entry != NULL && entry->Node != node){
+    entry = entry->NextInBucket;
+  }
+  return entry;
+}
+
+//the entry for node, made (clean, no text, no parent) if there wasnt one
+struct __internal__CachedText * __internal__GetCachedText(struct AJTextCache * cache, void * node){
+  struct __internal__CachedText * entry = __internal__FindCachedText(cache, node);
+  if(entry != NULL){return entry;}
+  if(cache->Count >= cache->BucketCount){ //keep chains short: double the buckets and spread the entries out again
+    struct __internal__CachedText ** oldBuckets = cache->Buckets;
+    int oldCount = cache->BucketCount;
+    cache->BucketCount *= 2;
+    cache->Buckets = (struct __internal__CachedText **)cache->Allocator.Alloc(sizeof(struct __internal__CachedText *) * cache->BucketCount, cache->Allocator.UserPointer);
+    memset(cache->Buckets, 0, sizeof(struct __internal__CachedText *) * cache->BucketCount);
+    for(int i = 0; i < oldCount; i++){
+      struct __internal__CachedText * moving = oldBuckets[i];
+      while(moving != NULL){
+        struct __internal__CachedText * next = moving->NextInBucket;
+        int bucket = __internal__CacheBucket(cache, moving->Node);
+        moving->NextInBucket = cache->Buckets[bucket];
+        cache->Buckets[bucket] = moving;
+        moving = next;
+      }
+    }
+    cache->Allocator.Free(oldBuckets, cache->Allocator.UserPointer);
+  }
+  entry = (struct __internal__CachedText *)cache->Allocator.Alloc(sizeof(struct __internal__CachedText), cache->Allocator.UserPointer);
+  entry->Node = node;
+  entry->Parent = NULL;
+  entry->Text = NULL;
+  entry->TextLength = 0;
+  entry->Dirty = 0;
+  int bucket = __internal__CacheBucket(cache, node);
+  entry->NextInBucket = cache->Buckets[bucket];
+  cache->Buckets[bucket] = entry;
+  cache->Count++;
+  return entry;
+}
+
+//tell the cache node has changed (AddToAJObject etc do this themselves). its text and the text of every container above it is dropped
+void AJMarkDirty(void * node){
+  struct AJTextCache * cache = AJGetContext()->TextCache;
+  if(cache == NULL){return;}
+  struct __internal__CachedText * entry = __internal__FindCachedText(cache, node);
+  while(entry != NULL && entry->Dirty == 0){ //a dirty entry's parents are already dirty
+    entry->Dirty = 1;
+    cache->Allocator.Free(entry->Text, cache->Allocator.UserPointer);
+    entry->Text = NULL;
+    entry = entry->Parent != NULL ? __internal__FindCachedText(cache, entry->Parent) : NULL;
+  }
+}
+
+//node is being freed: drop its entry, so a new node at the same address doesnt get its text
+void __internal__ForgetCachedText(void * node){
+  struct AJTextCache * cache = AJGetContext()->TextCache;
+  if(cache == NULL){return;}
+  struct __internal__CachedText ** link = &cache->Buckets[__internal__CacheBucket(cache, node)];
+  while(*link != NULL){
+    if((*link)->Node == node){
+      struct __internal__CachedText * entry = *link;
+      *link = entry->NextInBucket;
+      cache->Allocator.Free(entry->Text, cache->Allocator.UserPointer);
+      cache->Allocator.Free(entry, cache->Allocator.UserPointer);
+      cache->Count--;
+      return;
+    }
+    link = &(*link)->NextInBucket;
+  }
+}
+
+//forgets node and everything inside it, for trees that are freed where the cache cant see (AJDeleteLater)
+void __internal__ForgetCachedSubtree(void * node, int type){
+  if(AJGetContext()->TextCache == NULL){return;}
+  if(type == TYPE_ARRAY){
+    struct AJArrayElement * el = ((struct AJArray *)node)->FirstElement;
+    for(; el != NULL && ((struct AJArray *)node)->PackedNumbers == NULL; el = el->NextAJElement){
+      __internal__ForgetCachedSubtree(el->ArrayElement, el->ArrayElementType);
+    }
+  }else if(type == TYPE_OBJECT){
+    for(struct AJKeyValuePair * ajkvp = ((struct AJObject *)node)->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+      __internal__ForgetCachedSubtree(ajkvp->value, ajkvp->ValueType);
+    }
+  }
+  __internal__ForgetCachedText(node);
+}
+
+//copies node's cached text into the buffer if it is still good. returns chars written + 1 like the writers, or 0 when there is nothing usable
+int __internal__WriteCachedText(struct AJTextCache * cache, void * node, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  struct __internal__CachedText * entry = __internal__FindCachedText(cache, node);
+  if(entry == NULL || entry->Dirty || entry->Text == NULL){return 0;}
+  __internal__EnsureBufferSpace(originalBufferPointer, buflength, positionToStartWriting, entry->TextLength + 1);
+  memcpy(&(*originalBufferPointer)[positionToStartWriting], entry->Text, entry->TextLength);
+  (*originalBufferPointer)[positionToStartWriting + entry->TextLength] = '\0';
+  return entry->TextLength + 1;
+}
+
+//node was just written as text (length chars, not null terminated): it is clean, and its text is kept when long enough
+void __internal__StoreCachedText(struct AJTextCache * cache, void * node, char * text, int length){
+  struct __internal__CachedText * entry = __internal__GetCachedText(cache, node);
+  entry->Dirty = 0;
+  if(length < AJ_TEXT_CACHE_MIN_LENGTH){
+    cache->Allocator.Free(entry->Text, cache->Allocator.UserPointer);
+    entry->Text = NULL;
+    return;
+  }
+  entry->Text = (char *)cache->Allocator.Realloc(entry->Text, length, cache->Allocator.UserPointer);
+  memcpy(entry->Text, text, length);
+  entry->TextLength = length;
+}
+
+//child was just written inside parent. remember that, so changes to child can find parent
+void __internal__NoteCachedChild(struct AJTextCache * cache, void * child, void * parent){
+  struct __internal__CachedText * entry = __internal__GetCachedText(cache, child);
+  entry->Parent = parent;
+  entry->Dirty = 0;
+}
+
+/* Incremental reparsing
+An editor sends the whole text again after every keystroke, but only a few chars changed. With an AJSourceMap as
+AJContext->SourceMap, ParseNewAJObject records where every container's brackets are in the text (in document order).
+ReparseAJObject() then takes the new text and the edited range, finds the smallest container whose brackets are both
+outside the edit and parses only that container again. Its child containers that the edit didnt touch are not parsed
+either: the old nodes are moved into the new container as they are. Everything after the edit just has its offsets shifted.
+If the edit changed the structure (the reparsed container doesnt end where it should), the container above it is tried, up to
+the whole document. One map belongs to one document (the last one parsed with it); dont combine it with an AJInternTable.*/
+
+struct __internal__SourceEntry{
+  void * Node;
+  int Type;
+  int Start; //index of the opening bracket in the text
+  int End; //index of the closing bracket
+  int Parent; //index of the entry of the container it is in, -1 for the root
+};
+
+struct AJSourceMap{
+  struct __internal__SourceEntry * Entries; //the document's containers, in the order they start in the text
+  int Count;
+  int Capacity;
+  struct __internal__SourceEntry * Building; //entries of the parse that is running
+  int BuildingCount;
+  int BuildingCapacity;
+  int OpenEntry; //Building index of the container being parsed right now, -1 when none
+  //while ReparseAJObject runs:
+  char Reparsing;
+  int ReparseEntry; //Entries index of the container being parsed again
+  int EditStart;
+  int OldEditEnd;
+  int Delta; //new length - old length of the edited range
+  void ** Reused; //old child nodes moved into the new container, in order
+  int ReusedCount;
+  int ReusedCapacity;
+  struct AJAllocator Allocator;
+};
+
+struct AJSourceMap * CreateAJSourceMap(){
+  struct AJContext * ctx = AJGetContext();
+  struct AJSourceMap * map = (struct AJSourceMap *)ctx->Allocator.Alloc(sizeof(struct AJSourceMap), ctx->Allocator.UserPointer);
+  memset(map, 0, sizeof(struct AJSourceMap));
+  map->Allocator = ctx->Allocator;
+  map->OpenEntry = -1;
+  return map;
+}
+
+void DeleteAJSourceMap(struct AJSourceMap * map){
+  map->Allocator.Free(map->Entries, map->Allocator.UserPointer);
+  map->Allocator.Free(map->Building, map->Allocator.UserPointer);
+  map->Allocator.Free(map->Reused, map->Allocator.UserPointer);
+  map->Allocator.Free(map, map->Allocator.UserPointer);
+}
+
+//makes room for 'more' entries after the first *count in *entries
+void __internal__ReserveSourceEntries(struct AJSourceMap * map, struct __internal__SourceEntry ** entries, int * capacity, int count, int more){
+  if(count + more <= *capacity){return;}
+  int newCapacity = *capacity == 0 ? 64 : *capacity * 2;
+  while(newCapacity < count + more){newCapacity *= 2;}
+  *entries = (struct __internal__SourceEntry *)map->Allocator.Realloc(*entries, sizeof(struct __internal__SourceEntry) * newCapacity, map->Allocator.UserPointer);
+  *capacity = newCapacity;
+}
+
+//the parsers call this when they start a container. returns its Building index
+int __internal__BeginSourceEntry(struct AJSourceMap * map, void * node, int type, int start){
+  __internal__ReserveSourceEntries(map, &map->Building, &map->BuildingCapacity, map->BuildingCount, 1);
+  struct __internal__SourceEntry * entry = &map->Building[map->BuildingCount];
+  entry->Node = node;
+  entry->Type = type;
+  entry->Start = start;
+  entry->End = start;
+  entry->Parent = map->OpenEntry;
+  map->OpenEntry = map->BuildingCount;
+  return map->BuildingCount++;
+}
+
+//...and this when they reach its closing bracket. a finished top level parse becomes the map's document
+void __internal__EndSourceEntry(struct AJSourceMap * map, int entry, int end){
+  map->Building[entry].End = end;
+  map->OpenEntry = map->Building[entry].Parent;
+  if(map->OpenEntry == -1 && !map->Reparsing){
+    struct __internal__SourceEntry * oldEntries = map->Entries;
+    int oldCapacity = map->Capacity;
+    map->Entries = map->Building;
+    map->Count = map->BuildingCount;
+    map->Capacity = map->BuildingCapacity;
+    map->Building = oldEntries;
+    map->BuildingCapacity = oldCapacity;
+    map->BuildingCount = 0;
+  }
+}
+
+//first Entries index in [from, to) whose Start is > start
+int __internal__FirstSourceEntryAfter(struct AJSourceMap * map, int from, int to, int start){
+  while(from < to){
+    int middle = from + (to - from) / 2;
+    if(map->Entries[middle].Start <= start){
+      from = middle + 1;
+    }else{
+      to = middle;
+    }
+  }
+  return from;
+}
+
+//while reparsing: if the container starting at 'start' (new text) is a child of the reparsed container that the edit didnt touch,
+//return the old node and move *returnIdx to its closing bracket instead of parsing it again
+void * __internal__ReuseSourceNode(struct AJSourceMap * map, int start, int type, int * returnIdx){
+  if(!map->Reparsing || map->OpenEntry != 0){return NULL;} //only direct children of the container being reparsed
+  int oldStart;
+  if(start < map->EditStart){
+    oldStart = start;
+  }else if(start >= map->OldEditEnd + map->Delta){
+    oldStart = start - map->Delta;
+  }else{
+    return NULL; //it is in the edited text
+  }
+  int parentEnd = map->Entries[map->ReparseEntry].End;
+  int subtreeEnd = __internal__FirstSourceEntryAfter(map, map->ReparseEntry + 1, map->Count, parentEnd);
+  int found = __internal__FirstSourceEntryAfter(map, map->ReparseEntry + 1, subtreeEnd, oldStart) - 1;
+  if(found <= map->ReparseEntry){return NULL;}
+  struct __internal__SourceEntry * old = &map->Entries[found];
+  if(old->Start != oldStart || old->Parent != map->ReparseEntry || old->Type != type){return NULL;}
+  if(old->End >= map->EditStart && old->Start < map->OldEditEnd){return NULL;} //the edit is inside it
+  int shift = start - oldStart;
+  int size = __internal__FirstSourceEntryAfter(map, found, subtreeEnd, old->End) - found;
+  __internal__ReserveSourceEntries(map, &map->Building, &map->BuildingCapacity, map->BuildingCount, size);
+  int base = map->BuildingCount;
+  for(int i = 0; i < size; i++){ //its entries (and its children's) come along, shifted
+    struct __internal__SourceEntry * copy = &map->Building[base + i];
+    *copy = map->Entries[found + i];
+    copy->Start += shift;
+    copy->End += shift;
+    copy->Parent = i == 0 ? map->OpenEntry : copy->Parent - found + base;
+  }
+  map->BuildingCount += size;
+  if(map->ReusedCount == map->ReusedCapacity){
+    map->ReusedCapacity = map->ReusedCapacity == 0 ? 16 : map->ReusedCapacity * 2;
+    map->Reused = (void **)map->Allocator.Realloc(map->Reused, sizeof(void *) * map->ReusedCapacity, map->Allocator.UserPointer);
+  }
+  map->Reused[map->ReusedCount++] = old->Node;
+  *returnIdx = old->End + shift;
+  return old->Node;
+}
+
+//points the slots of a container that hold the reused nodes (they are in the same order) at an inline null,
+//so deleting the container leaves the reused nodes alone
+void __internal__DetachReusedNodes(struct AJSourceMap * map, void * node, int type){
+  int next = 0;
+  if(type == TYPE_ARRAY){
+    struct AJArrayElement * el = ((struct AJArray *)node)->FirstElement;
+    for(; el != NULL && next < map->ReusedCount && ((struct AJArray *)node)->PackedNumbers == NULL; el = el->NextAJElement){
+      if(el->ArrayElement == map->Reused[next]){
+        el->ArrayElement = (void *)&el->InlineElement;
+        el->ArrayElementType = TYPE_NULL;
+        next++;
+      }
+    }
+  }else{
+    for(struct AJKeyValuePair * ajkvp = ((struct AJObject *)node)->FirstAJKVP; ajkvp != NULL && next < map->ReusedCount; ajkvp = ajkvp->NextAJKVP){
+      if(ajkvp->value == map->Reused[next]){
+        ajkvp->value = (void *)&ajkvp->InlineValue;
+        ajkvp->ValueType = TYPE_NULL;
+        next++;
+      }
+    }
+  }
+}
+
+//puts newNode where oldNode is in container (as an element, value or key)
+void __internal__ReplaceChildNode(void * container, int type, void * oldNode, void * newNode){
+  if(type == TYPE_ARRAY){
+    for(struct AJArrayElement * el = ((struct AJArray *)container)->FirstElement; el != NULL; el = el->NextAJElement){
+      if(el->ArrayElement == oldNode){
+        el->ArrayElement = newNode;
+        break;
+      }
+    }
+  }else{
+    for(struct AJKeyValuePair * ajkvp = ((struct AJObject *)container)->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+      if(ajkvp->value == oldNode){
+        ajkvp->value = newNode;
+        break;
+      }
+      if(ajkvp->key == oldNode){
+        ajkvp->key = newNode;
+        break;
+      }
+    }
+  }
+  AJMarkDirty(container);
+}
+
+//the reparse of Entries[c] worked: swap its entries for the Building ones and shift everything after it
+void __internal__SpliceSourceEntries(struct AJSourceMap * map, int c){
+  int oldSize = __internal__FirstSourceEntryAfter(map, c, map->Count, map->Entries[c].End) - c;
+  int newSize = map->BuildingCount;
+  int grow = newSize - oldSize;
+  int delta = map->Delta;
+  for(int a = map->Entries[c].Parent; a != -1; a = map->Entries[a].Parent){ //containers around it got longer or shorter
+    map->Entries[a].End += delta;
+  }
+  __internal__ReserveSourceEntries(map, &map->Entries, &map->Capacity, map->Count, grow > 0 ? grow : 0);
+  memmove(&map->Entries[c + newSize], &map->Entries[c + oldSize], sizeof(struct __internal__SourceEntry) * (map->Count - c - oldSize));
+  map->Count += grow;
+  for(int i = c + newSize; i < map->Count; i++){ //everything after the edit
+    map->Entries[i].Start += delta;
+    map->Entries[i].End += delta;
+    if(map->Entries[i].Parent >= c + oldSize){
+      map->Entries[i].Parent += grow;
+    }
+  }
+  int parent = map->Entries[c].Parent;
+  for(int i = 0; i < newSize; i++){
+    map->Entries[c + i] = map->Building[i];
+    map->Entries[c + i].Parent = i == 0 ? parent : map->Building[i].Parent + c;
+  }
+  map->BuildingCount = 0;
+}
+
+/*root was parsed from the old text with the context's SourceMap. JSONString is the whole new text, in which the chars
+[editStart, oldEditEnd) of the old text were replaced by [editStart, newEditEnd). Returns the updated tree: root itself,
+unless the edit reached root's own brackets, then root is deleted and a new one returned.*/
+struct AJObject * ReparseAJObject(struct AJObject * root, char * JSONString, int editStart, int oldEditEnd, int newEditEnd){
+  struct AJSourceMap * map = AJGetContext()->SourceMap;
+  int c = -1;
+  if(map != NULL && map->Count > 0 && map->Entries[0].Node == root){
+    c = __internal__FirstSourceEntryAfter(map, 0, map->Count, editStart - 1) - 1; //last container that starts before the edit
+    while(c != -1 && oldEditEnd > map->Entries[c].End){
+      c = map->Entries[c].Parent;
+    }
+  }
+  while(c != -1){
+    struct __internal__SourceEntry old = map->Entries[c];
+    map->Reparsing = 1;
+    map->ReparseEntry = c;
+    map->EditStart = editStart;
+    map->OldEditEnd = oldEditEnd;
+    map->Delta = newEditEnd - oldEditEnd;
+    map->ReusedCount = 0;
+    map->BuildingCount = 0;
+    map->OpenEntry = -1;
+    int end;
+    void * node = old.Type == TYPE_ARRAY ? (void *)ParseNewAJArray(old.Start, JSONString, &end) : (void *)ParseNewAJObject(old.Start, JSONString, &end);
+    map->Reparsing = 0;
+    if(end == old.End + map->Delta){ //lines up with the rest of the document
+      __internal__SpliceSourceEntries(map, c);
+      __internal__DetachReusedNodes(map, old.Node, old.Type);
+      if(old.Parent != -1){
+        struct __internal__SourceEntry * parent = &map->Entries[old.Parent];
+        __internal__ReplaceChildNode(parent->Node, parent->Type, old.Node, node);
+      }
+      AJDelete(old.Node, old.Type);
+      return old.Parent == -1 ? (struct AJObject *)node : root;
+    }
+    //the edit reaches further than this container: try the one around it
+    __internal__DetachReusedNodes(map, node, old.Type);
+    AJDelete(node, old.Type);
+    map->BuildingCount = 0;
+    c = old.Parent;
+  }
+  //no map, or the root itself changed: parse it all
+  DeleteAJObject(root);
+  int start = 0;
+  while(JSONString[start] != '\0' && JSONString[start] != openObjectBracket){start++;}
+  if(JSONString[start] == '\0'){return NULL;}
+  if(map != NULL){
+    map->BuildingCount = 0;
+    map->OpenEntry = -1;
+  }
+  int end;
+  return ParseNewAJObject(start, JSONString, &end);
+}
+
+/* Cloning
+AJClone makes a deep copy of any node with the current context's allocator, so it is deleted like any other tree. An array's
+elements are made in one ElementBlock and an object's KVPs in one KVPBlock, scalars stay inline where they were inline, and shaped
+objects share their shape (and its keys) with the original instead of copying the keys.
+AJCloneToDocument is for stamping out a template many times: it adds up how much arena space the copy needs, makes sure the
+document's arena has that much in one piece, and clones into it, so the whole copy is one contiguous run of memory.
+ResetAJDocument (or the next AJCloneToDocument) throws it away again without any frees.*/
+
+//arena bytes one allocation of size takes (same sums as __internal__ArenaAlloc)
+static inline size_t __internal__ArenaBytes(size_t size){
+  return sizeof(struct __internal__ArenaBlockHeader) + ((size + AJ_ARENA_ALIGNMENT - 1) & ~(size_t)(AJ_ARENA_ALIGNMENT - 1));
+}
+
+//arena bytes AJClone(node, type) will allocate
+size_t __internal__MeasureClone(void * node, int type){
+  switch(type){
+    case TYPE_STRING:{
+      struct AJString * ajstr = (struct AJString *)node;
+      return __internal__ArenaBytes(sizeof(struct AJString)) + (ajstr->length < AJ_STRING_INLINE_CAPACITY ? 0 : __internal__ArenaBytes(ajstr->length + 1));
+    }
+    case TYPE_NUMBER:{
+      struct AJNumber * ayomide = (struct AJNumber *)node;
+      char * lexeme = __internal__CurrentLexeme(ayomide);
+      return __internal__ArenaBytes(lexeme != NULL ? AJ_LEXEME_OFFSET + strlen(lexeme) + 1 : sizeof(struct AJNumber));
+    }
+    case TYPE_BOOLEAN: return __internal__ArenaBytes(sizeof(struct AJBoolean));
+    case TYPE_NULL: return __internal__ArenaBytes(sizeof(struct AJNull));
+    case TYPE_ARRAY:{
+      struct AJArray * aja = (struct AJArray *)node;
+      size_t total = __internal__ArenaBytes(sizeof(struct AJArray));
+      if(aja->PackedNumbers != NULL){
+        return total + __internal__ArenaBytes(sizeof(double) * (aja->length > 0 ? aja->length : 1));
+      }
+      if(aja->length > 0){
+        total += __internal__ArenaBytes(sizeof(struct AJArrayElement) * aja->length);
+      }
+      for(struct AJArrayElement * el = aja->FirstElement; el != NULL; el = el->NextAJElement){
+        if(el->ArrayElement != (void *)&el->InlineElement){
+          total += __internal__MeasureClone(el->ArrayElement, el->ArrayElementType);
+        }
+      }
+      return total;
+    }
+    case TYPE_OBJECT:{
+      struct AJObject * ajo = (struct AJObject *)node;
+      size_t total = __internal__ArenaBytes(sizeof(struct AJObject));
+      if(ajo->AJKVPCount > 0){
+        total += __internal__ArenaBytes(sizeof(struct AJKeyValuePair) * ajo->AJKVPCount);
+      }
+      for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+        if(ajo->Shape == NULL){
+          total += __internal__MeasureClone(ajkvp->key, ajkvp->KeyType);
+        }
+        if(ajkvp->value != (void *)&ajkvp->InlineValue){
+          total += __internal__MeasureClone(ajkvp->value, ajkvp->ValueType);
+        }
+      }
+      return total;
+    }
+  }
+  return 0;
+}
+
+//deep copy of node (type is its TYPE_). NULL for an unknown type
+void * AJClone(void * node, int type){
+  switch(type){
+    case TYPE_STRING:{
+      struct AJString * ajstr = (struct AJString *)node;
+      struct AJString * pelumi = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+      __internal__SetAJStringChars(pelumi, ajstr->string, ajstr->length);
+      pelumi->Raw = ajstr->Raw;
+      pelumi->RefCount = 0;
+      return pelumi;
+    }
+    case TYPE_NUMBER:{ //a lexeme lives right behind its AJNumber, so it comes along in the same copy
+      struct AJNumber * original = (struct AJNumber *)node;
+      char * lexeme = __internal__CurrentLexeme(original); //a stale one is left behind
+      size_t size = lexeme != NULL ? AJ_LEXEME_OFFSET + strlen(lexeme) + 1 : sizeof(struct AJNumber);
+      struct AJNumber * ayomide = (struct AJNumber *)__internal__Malloc(size);
+      memcpy(ayomide, original, size);
+      ayomide->Lexeme = lexeme != NULL ? (char *)ayomide + AJ_LEXEME_OFFSET : NULL;
+      return ayomide;
+    }
+    case TYPE_BOOLEAN:{
+      struct AJBoolean * joju = (struct AJBoolean *)__internal__Malloc(sizeof(struct AJBoolean));
+      *joju = *(struct AJBoolean *)node;
+      return joju;
+    }
+    case TYPE_NULL:{
+      return __internal__Malloc(sizeof(struct AJNull));
+    }
+    case TYPE_ARRAY:{
+      struct AJArray * original = (struct AJArray *)node;
+      struct AJArray * opeyemi = CreateAJArray();
+      opeyemi->length = original->length;
+      if(original->PackedNumbers != NULL){
+        opeyemi->PackedCapacity = original->length > 0 ? original->length : 1;
+        opeyemi->PackedNumbers = (double *)__internal__Malloc(sizeof(double) * opeyemi->PackedCapacity);
+        memcpy(opeyemi->PackedNumbers, original->PackedNumbers, sizeof(double) * original->length);
+        return opeyemi;
+      }
+      if(original->length == 0){return opeyemi;}
+      struct AJArrayElement * block = (struct AJArrayElement *)__internal__Malloc(sizeof(struct AJArrayElement) * original->length);
+      opeyemi->ElementBlock = block;
+      opeyemi->ElementBlockCount = original->length;
+      int i = 0;
+      for(struct AJArrayElement * el = original->FirstElement; el != NULL; el = el->NextAJElement, i++){
+        block[i].PrevAJElement = i > 0 ? &block[i - 1] : NULL;
+        block[i].NextAJElement = i < original->length - 1 ? &block[i + 1] : NULL;
+        block[i].ArrayElementType = el->ArrayElementType;
+        if(el->ArrayElement == (void *)&el->InlineElement){
+          block[i].InlineElement = el->InlineElement;
+          block[i].ArrayElement = (void *)&block[i].InlineElement;
+        }else{
+          block[i].ArrayElement = AJClone(el->ArrayElement, el->ArrayElementType);
+        }
+      }
+      opeyemi->FirstElement = &block[0];
+      opeyemi->LastElement = &block[original->length - 1];
+      return opeyemi;
+    }
+    case TYPE_OBJECT:{
+      struct AJObject * original = (struct AJObject *)node;
+      struct AJObject * adedoyin = CreateAJObject();
+      adedoyin->AJKVPCount = original->AJKVPCount;
+      adedoyin->Shape = original->Shape; //the keys below are the shape's, same as in the original
+      if(original->AJKVPCount == 0){return adedoyin;}
+      struct AJKeyValuePair * block = (struct AJKeyValuePair *)__internal__Malloc(sizeof(struct AJKeyValuePair) * original->AJKVPCount);
+      adedoyin->KVPBlock = block;
+      adedoyin->KVPBlockCount = original->AJKVPCount;
+      int i = 0;
+      for(struct AJKeyValuePair * ajkvp = original->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP, i++){
+        block[i].PrevAJKVP = i > 0 ? &block[i - 1] : NULL;
+        block[i].NextAJKVP = i < original->AJKVPCount - 1 ? &block[i + 1] : NULL;
+        block[i].KeyType = ajkvp->KeyType;
+        block[i].key = original->Shape != NULL ? ajkvp->key : AJClone(ajkvp->key, ajkvp->KeyType);
+        block[i].ValueType = ajkvp->ValueType;
+        if(ajkvp->value == (void *)&ajkvp->InlineValue){
+          block[i].InlineValue = ajkvp->InlineValue;
+          block[i].value = (void *)&block[i].InlineValue;
+        }else{
+          block[i].value = AJClone(ajkvp->value, ajkvp->ValueType);
+        }
+      }
+      adedoyin->FirstAJKVP = &block[0];
+      adedoyin->LastAJKVP = &block[original->AJKVPCount - 1];
+      return adedoyin;
+    }
+  }
+  return NULL;
+}
+
+/*Detaching values: takes the value out of a KVP or array element so it can be put somewhere else (or deleted on its own).
+The returned node belongs to the caller: a scalar that was stored inline is copied to the heap first. The KVP / element is
+left holding a null (inline with InlineScalars on), so the container it is in stays valid. type gets the value's TYPE_.*/
+void * __internal__DetachValue(void ** value, int * valueType, union AJInlineScalar * inlineSlot, int * type){
+  void * taken = *value;
+  *type = *valueType;
+  AJMarkDirty(taken); //the container above now says null
+  __internal__ForgetCachedText(taken);
+  if(taken == (void *)inlineSlot){
+    taken = AJClone(taken, *type);
+  }
+  *value = __internal__PlaceScalar(inlineSlot, TYPE_NULL);
+  *valueType = TYPE_NULL;
+  return taken;
+}
+
+void * DetachAJKVPValue(struct AJKeyValuePair * kvp, int * type){
+  return __internal__DetachValue(&kvp->value, &kvp->ValueType, &kvp->InlineValue, type);
+}
+
+//el is an element of an unpacked array (see GetElementFromArrayIndex)
+void * DetachAJArrayElementValue(struct AJArrayElement * el, int * type){
+  return __internal__DetachValue(&el->ArrayElement, &el->ArrayElementType, &el->InlineElement, type);
+}
+
+//resets doc and clones node into it as doc->Root (and returns it). the clone is one contiguous piece of doc's arena
+void * AJCloneToDocument(struct AJDocument * doc, void * node, int type){
+  ResetAJDocument(doc);
+  size_t needed = __internal__MeasureClone(node, type);
+  //get a chunk with room for all of it: allocating that much moves the arena to (or makes) such a chunk, freeing it rewinds it
+  void * reserved = __internal__ArenaAlloc(needed - sizeof(struct __internal__ArenaBlockHeader), (void *)doc);
+  if(reserved == NULL){return NULL;}
+  __internal__ArenaFree(reserved, (void *)doc);
+
+  struct AJContext * previous = AJSetContext(&doc->Context);
+  doc->Root = AJClone(node, type);
+  doc->RootType = doc->Root != NULL ? type : TYPE_NULL;
+  AJSetContext(previous);
+  return doc->Root;
+}
+
+/* Structural hashing and equality
+AJHash / AJEquals work on the trees themselves, no text in between. Both look at what the JSON says, not how it is stored:
+packed or unpacked arrays, inline or separate scalars, shaped or interned objects all hash and compare the same. Numbers are
+compared by value (so 1, 1.0 and 1e0 are equal). With ignoreKeyOrder, {"a":1,"b":2} and {"b":2,"a":1} are the same:
+the object's hash is then a sum over its KVPs, and AJEquals matches keys through a hash index instead of by position.
+Hashes are the same on every run (on machines with the same byte order), so they can be stored.*/
+
+#define AJ_HASH_SEED 0x9E3779B97F4A7C15ULL
+#define AJ_HASH_SEED_2 0xC2B2AE3D27D4EB4FULL //second lane of AJHash128
+#define AJ_EQUALS_SCAN_KEYS 8 //objects with at most this many keys are matched by scanning instead of building an index
+
+static inline unsigned long long __internal__Mix64(unsigned long long x){
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+//hashes 8 bytes at a time
+unsigned long long __internal__HashBytes64(const char * bytes, int length, unsigned long long hash){
+  int i = 0;
+  for(; i + 8 <= length; i += 8){
+    unsigned long long word;
+    memcpy(&word, &bytes[i], 8);
+    hash = __internal__Mix64(hash ^ word) * 0x100000001B3ULL;
+  }
+  unsigned long long tail = 0;
+  memcpy(&tail, &bytes[i], length - i);
+  return __internal__Mix64(hash ^ tail ^ ((unsigned long long)length << 56));
+}
+
+static inline unsigned long long __internal__HashNumber64(double num, unsigned long long seed){
+  if(num == 0){num = 0;} //-0 == 0, so they have to hash the same
+  unsigned long long bits;
+  memcpy(&bits, &num, sizeof(double));
+  return __internal__Mix64(seed ^ bits ^ ((unsigned long long)TYPE_NUMBER << 60));
+}
+
+unsigned long long __internal__StructuralHash(void * node, int type, int ignoreKeyOrder, unsigned long long seed){
+  unsigned long long hash = __internal__Mix64(seed + (unsigned long long)type);
+  switch(type){
+    case TYPE_STRING: return __internal__HashBytes64(((struct AJString *)node)->string, ((struct AJString *)node)->length, hash);
+    case TYPE_NUMBER: return __internal__HashNumber64(AJNumberGetDouble((struct AJNumber *)node), seed);
+    case TYPE_BOOLEAN: return __internal__Mix64(hash ^ (unsigned long long)((struct AJBoolean *)node)->TruthValue);
+    case TYPE_NULL: return hash;
+    case TYPE_ARRAY:{
+      struct AJArray * aja = (struct AJArray *)node;
+      if(aja->PackedNumbers != NULL){
+        for(int i = 0; i < aja->length; i++){
+          hash = __internal__Mix64(hash ^ __internal__HashNumber64(aja->PackedNumbers[i], seed)) * 0x100000001B3ULL;
+        }
+      }else{
+        for(struct AJArrayElement * el = aja->FirstElement; el != NULL; el = el->NextAJElement){
+          hash = __internal__Mix64(hash ^ __internal__StructuralHash(el->ArrayElement, el->ArrayElementType, ignoreKeyOrder, seed)) * 0x100000001B3ULL;
+        }
+      }
+      return __internal__Mix64(hash ^ (unsigned long long)aja->length);
+    }
+    case TYPE_OBJECT:{
+      struct AJObject * ajo = (struct AJObject *)node;
+      unsigned long long unordered = 0;
+      for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+        unsigned long long keyHash = __internal__StructuralHash(ajkvp->key, ajkvp->KeyType, ignoreKeyOrder, seed);
+        unsigned long long valueHash = __internal__StructuralHash(ajkvp->value, ajkvp->ValueType, ignoreKeyOrder, seed);
+        unsigned long long pairHash = __internal__Mix64(keyHash ^ (valueHash * 0x9E3779B97F4A7C15ULL));
+        if(ignoreKeyOrder){
+          unordered += pairHash; //adding doesnt care about order (and unlike xor, repeated pairs dont cancel out)
+        }else{
+          hash = __internal__Mix64(hash ^ pairHash) * 0x100000001B3ULL;
+        }
+      }
+      return __internal__Mix64(hash ^ unordered ^ (unsigned long long)ajo->AJKVPCount);
+    }
+  }
+  return hash;
+}
+
+//64 bit hash of node's content. equal trees (see AJEquals, with the same ignoreKeyOrder) get equal hashes
+unsigned long long AJHash(void * node, int type, int ignoreKeyOrder){
+  return __internal__StructuralHash(node, type, ignoreKeyOrder, AJ_HASH_SEED);
+}
+
+//the same, 128 bits wide (two independent 64 bit lanes) for when collisions must be practically impossible
+void AJHash128(void * node, int type, int ignoreKeyOrder, unsigned long long out[2]){
+  out[0] = __internal__StructuralHash(node, type, ignoreKeyOrder, AJ_HASH_SEED);
+  out[1] = __internal__StructuralHash(node, type, ignoreKeyOrder, AJ_HASH_SEED_2);
+}
+
+int AJEquals(void * a, int typeA, void * b, int typeB, int ignoreKeyOrder);
+
+//element i of a packed or unpacked array, walking on from *el (for unpacked) so a full pass stays O(n)
+static inline void * __internal__NextArrayValue(struct AJArray * aja, int i, struct AJArrayElement ** el, struct AJNumber * packed, int * type){
+  if(aja->PackedNumbers != NULL){
+    packed->number = aja->PackedNumbers[i];
+    packed->Lexeme = NULL;
+    *type = TYPE_NUMBER;
+    return packed;
+  }
+  void * value = (*el)->ArrayElement;
+  *type = (*el)->ArrayElementType;
+  *el = (*el)->NextAJElement;
+  return value;
+}
+
+struct __internal__KeyIndexSlot{
+  unsigned long long Hash; //never 0 for a used slot
+  struct AJKeyValuePair * KVP; //NULL once matched
+};
+
+//1 if every KVP of x has an equal KVP in y (and the counts match), in any order
+int __internal__UnorderedObjectEquals(struct AJObject * x, struct AJObject * y){
+  int count = x->AJKVPCount;
+  if(count <= AJ_EQUALS_SCAN_KEYS){ //few keys: scanning beats hashing
+    unsigned int matched = 0;
+    for(struct AJKeyValuePair * kx = x->FirstAJKVP; kx != NULL; kx = kx->NextAJKVP){
+      int i = 0;
+      struct AJKeyValuePair * ky = y->FirstAJKVP;
+      for(; ky != NULL; ky = ky->NextAJKVP, i++){
+        if(!(matched & (1u << i)) && AJEquals(kx->key, kx->KeyType, ky->key, ky->KeyType, 1) && AJEquals(kx->value, kx->ValueType, ky->value, ky->ValueType, 1)){break;}
+      }
+      if(ky == NULL){return 0;}
+      matched |= 1u << i;
+    }
+    return 1;
+  }
+  //index y's keys by hash, then look each of x's keys up in it
+  int capacity = 16;
+  while(capacity < count * 2){capacity *= 2;}
+  struct __internal__KeyIndexSlot * index = (struct __internal__KeyIndexSlot *)__internal__Malloc(sizeof(struct __internal__KeyIndexSlot) * capacity);
+  memset(index, 0, sizeof(struct __internal__KeyIndexSlot) * capacity);
+  for(struct AJKeyValuePair * ky = y->FirstAJKVP; ky != NULL; ky = ky->NextAJKVP){
+    unsigned long long hash = AJHash(ky->key, ky->KeyType, 1) | 1;
+    int slot = (int)(hash & (capacity - 1));
+    while(index[slot].Hash != 0){slot = (slot + 1) & (capacity - 1);}
+    index[slot].Hash = hash;
+    index[slot].KVP = ky;
+  }
+  int equal = 1;
+  for(struct AJKeyValuePair * kx = x->FirstAJKVP; kx != NULL && equal; kx = kx->NextAJKVP){
+    unsigned long long hash = AJHash(kx->key, kx->KeyType, 1) | 1;
+    int slot = (int)(hash & (capacity - 1));
+    equal = 0;
+    for(; index[slot].Hash != 0; slot = (slot + 1) & (capacity - 1)){
+      struct AJKeyValuePair * ky = index[slot].KVP;
+      if(index[slot].Hash == hash && ky != NULL && AJEquals(kx->key, kx->KeyType, ky->key, ky->KeyType, 1) && AJEquals(kx->value, kx->ValueType, ky->value, ky->ValueType, 1)){
+        equal = 1;
+        index[slot].KVP = NULL; //a repeated key has to match a different KVP
+        break;
+      }
+    }
+  }
+  __internal__Free(index);
+  return equal;
+}
+
+//1 if a and b hold the same JSON. with ignoreKeyOrder, objects with the same KVPs in another order are equal too
+int AJEquals(void * a, int typeA, void * b, int typeB, int ignoreKeyOrder){
+  if(typeA != typeB){return 0;}
+  if(a == b){return 1;}
+  switch(typeA){
+    case TYPE_STRING:{
+      struct AJString * x = (struct AJString *)a;
+      struct AJString * y = (struct AJString *)b;
+      return x->length == y->length && memcmp(x->string, y->string, x->length) == 0;
+    }
+    case TYPE_NUMBER: return AJNumberGetDouble((struct AJNumber *)a) == AJNumberGetDouble((struct AJNumber *)b);
+    case TYPE_BOOLEAN: return ((struct AJBoolean *)a)->TruthValue == ((struct AJBoolean *)b)->TruthValue;
+    case TYPE_NULL: return 1;
+    case TYPE_ARRAY:{
+      struct AJArray * x = (struct AJArray *)a;
+      struct AJArray * y = (struct AJArray *)b;
+      if(x->length != y->length){return 0;}
+      if(x->PackedNumbers != NULL && y->PackedNumbers != NULL){
+        for(int i = 0; i < x->length; i++){
+          if(x->PackedNumbers[i] != y->PackedNumbers[i]){return 0;}
+        }
+        return 1;
+      }
+      struct AJArrayElement * ex = x->FirstElement;
+      struct AJArrayElement * ey = y->FirstElement;
+      struct AJNumber packedX, packedY;
+      for(int i = 0; i < x->length; i++){
+        int tx, ty;
+        void * vx = __internal__NextArrayValue(x, i, &ex, &packedX, &tx);
+        void * vy = __internal__NextArrayValue(y, i, &ey, &packedY, &ty);
+        if(!AJEquals(vx, tx, vy, ty, ignoreKeyOrder)){return 0;}
+      }
+      return 1;
+    }
+    case TYPE_OBJECT:{
+      struct AJObject * x = (struct AJObject *)a;
+      struct AJObject * y = (struct AJObject *)b;
+      if(x->AJKVPCount != y->AJKVPCount){return 0;}
+      if(ignoreKeyOrder && (x->Shape == NULL || x->Shape != y->Shape)){ //one shape means the same keys in the same order
+        return __internal__UnorderedObjectEquals(x, y);
+      }
+      struct AJKeyValuePair * kx = x->FirstAJKVP;
+      struct AJKeyValuePair * ky = y->FirstAJKVP;
+      for(; kx != NULL; kx = kx->NextAJKVP, ky = ky->NextAJKVP){
+        if((x->Shape == NULL || x->Shape != y->Shape) && !AJEquals(kx->key, kx->KeyType, ky->key, ky->KeyType, ignoreKeyOrder)){return 0;}
+        if(!AJEquals(kx->value, kx->ValueType, ky->value, ky->ValueType, ignoreKeyOrder)){return 0;}
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Diff and patch
+AJDiff(a, b) writes out what changed between two trees as a JSON Patch (RFC 6902): an AJArray of op objects like
+{ "op" : "replace", "path" : "/users/3/name", "value" : "x" }. AJApplyPatch replays one on another tree in place, so only the changed
+parts have to be sent around. AJMergeDiff / AJApplyMergePatch do the same with a JSON Merge Patch (RFC 7386), which is a sparse copy of
+the changed keys (null meaning 'remove'); simpler, but it cant set a value to null or change part of an array.
+  -objects are matched key by key (through a hash index for bigger objects), so key order never makes a change.
+  -arrays first skip the elements that are the same at both ends. What is left is compared by AJHash: elements of a that still occur in b
+   are kept and the rest removed, then the missing elements of b are added in place. Without many matches (records edited in place)
+   elements are diffed pairwise instead. Either way no element is compared against every other one.
+  -diffs only emit add, remove and replace; AJApplyPatch also takes move, copy and test.
+  -values in a patch are copies (AJClone), and AJApplyPatch copies them again, so the patch is deleted like any other AJArray.
+  -AJApplyPatch is all or nothing (RFC 6902 section 5). Every op is checked first (a known op, pointers for path and from, a value
+   where one is needed), then the ops edit the tree in place. What they replace or remove is kept aside until the last op went
+   through: if one fails (a path that leads nowhere, a test that doesnt hold, a shared node in the way) every change is undone,
+   newest first, and it returns 0 with the tree as it was. Nodes the patch doesnt touch keep their addresses and their cached text;
+   replaced and removed ones are deleted once it succeeds. move and copy put a copy of the value at path.*/
+
+struct __internal__PathBuffer{
+  char * Chars; //null terminated
+  int Length;
+  int Capacity;
+};
+
+static inline void __internal__ReservePath(struct __internal__PathBuffer * path, int extra){
+  if(path->Length + extra + 1 > path->Capacity){
+    while(path->Length + extra + 1 > path->Capacity){path->Capacity *= 2;}
+    path->Chars = (char *)__internal__Realloc(path->Chars, path->Capacity);
+  }
+}
+
+//appends "/key" to path, escaping ~ and / as a JSON pointer wants
+void __internal__PushPathKey(struct __internal__PathBuffer * path, const char * key, int length){
+  __internal__ReservePath(path, length * 2 + 1);
+  path->Chars[path->Length++] = '/';
+  for(int i = 0; i < length; i++){
+    if(key[i] == '~' || key[i] == '/'){
+      path->Chars[path->Length++] = '~';
+      path->Chars[path->Length++] = key[i] == '~' ? '0' : '1';
+    }else{
+      path->Chars[path->Length++] = key[i];
+    }
+  }
+  path->Chars[path->Length] = '\0';
+}
+
+void __internal__PushPathIndex(struct __internal__PathBuffer * path, int idx){
+  __internal__ReservePath(path, 12);
+  path->Length += sprintf(&path->Chars[path->Length], "/%d", idx);
+}
+
+static inline void __internal__PopPath(struct __internal__PathBuffer * path, int length){
+  path->Length = length;
+  path->Chars[length] = '\0';
+}
+
+static inline void __internal__AddStringKVP(struct AJObject * ajo, char * key, const char * value, int valueLength){
+  struct AJString * str = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+  __internal__SetAJStringChars(str, value, valueLength);
+  str->RefCount = 0;
+  AddToAJObjectBeforeKVP(ajo, CreateAJKeyValuePair(CreateAJString(key), TYPE_STRING, str, TYPE_STRING), NULL);
+}
+
+//appends { "op" : op, "path" : path(, "value" : copy of value) } to patch
+void __internal__AddPatchOp(struct AJArray * patch, const char * op, struct __internal__PathBuffer * path, void * value, int valueType){
+  struct AJObject * ajo = CreateAJObject();
+  __internal__AddStringKVP(ajo, "op", op, strlen(op));
+  __internal__AddStringKVP(ajo, "path", path->Chars, path->Length);
+  if(value != NULL){
+    AddToAJObjectBeforeKVP(ajo, CreateAJKeyValuePair(CreateAJString("value"), TYPE_STRING, AJClone(value, valueType), valueType), NULL);
+  }
+  AddToAJArray(patch, ajo, TYPE_OBJECT, patch->length);
+}
+
+//finds KVPs by key: a hash index over the keys for big objects, a plain walk for small ones
+struct __internal__KeyIndex{
+  struct AJObject * Object;
+  struct __internal__KeyIndexSlot * Slots; //NULL: walk Object instead
+  int Capacity; //power of 2
+};
+
+void __internal__BuildKeyIndex(struct __internal__KeyIndex * index, struct AJObject * ajo){
+  index->Object = ajo;
+  index->Slots = NULL;
+  index->Capacity = 0;
+  if(ajo->AJKVPCount <= AJ_EQUALS_SCAN_KEYS){return;}
+  index->Capacity = 16;
+  while(index->Capacity < ajo->AJKVPCount * 2){index->Capacity *= 2;}
+  index->Slots = (struct __internal__KeyIndexSlot *)__internal__Malloc(sizeof(struct __internal__KeyIndexSlot) * index->Capacity);
+  memset(index->Slots, 0, sizeof(struct __internal__KeyIndexSlot) * index->Capacity);
+  for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    unsigned long long hash = AJHash(ajkvp->key, ajkvp->KeyType, 1) | 1;
+    int slot = (int)(hash & (index->Capacity - 1));
+    while(index->Slots[slot].Hash != 0){slot = (slot + 1) & (index->Capacity - 1);}
+    index->Slots[slot].Hash = hash;
+    index->Slots[slot].KVP = ajkvp;
+  }
+}
+
+struct AJKeyValuePair * __internal__FindInKeyIndex(struct __internal__KeyIndex * index, void * key, int keyType){
+  if(index->Slots == NULL){
+    for(struct AJKeyValuePair * ajkvp = index->Object->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+      if(AJEquals(key, keyType, ajkvp->key, ajkvp->KeyType, 1)){return ajkvp;}
+    }
+    return NULL;
+  }
+  unsigned long long hash = AJHash(key, keyType, 1) | 1;
+  for(int slot = (int)(hash & (index->Capacity - 1)); index->Slots[slot].Hash != 0; slot = (slot + 1) & (index->Capacity - 1)){
+    struct AJKeyValuePair * ajkvp = index->Slots[slot].KVP;
+    if(index->Slots[slot].Hash == hash && ajkvp != NULL && AJEquals(key, keyType, ajkvp->key, ajkvp->KeyType, 1)){return ajkvp;}
+  }
+  return NULL;
+}
+
+//for when ajkvp is about to be freed
+void __internal__DropFromKeyIndex(struct __internal__KeyIndex * index, struct AJKeyValuePair * ajkvp){
+  if(index->Slots == NULL){return;}
+  unsigned long long hash = AJHash(ajkvp->key, ajkvp->KeyType, 1) | 1;
+  for(int slot = (int)(hash & (index->Capacity - 1)); index->Slots[slot].Hash != 0; slot = (slot + 1) & (index->Capacity - 1)){
+    if(index->Slots[slot].KVP == ajkvp){
+      index->Slots[slot].KVP = NULL; //keeps its Hash, so lookups still probe past it
+      return;
+    }
+  }
+}
+
+//one element of an array being diffed. packed numbers get a temporary AJNumber so they look like any other element
+struct __internal__DiffItem{
+  void * Node;
+  int Type;
+  unsigned long long Hash;
+};
+
+struct __internal__DiffItem * __internal__GetDiffItems(struct AJArray * aja, struct AJNumber ** packed){
+  struct __internal__DiffItem * items = (struct __internal__DiffItem *)__internal__Malloc(sizeof(struct __internal__DiffItem) * (aja->length > 0 ? aja->length : 1));
+  *packed = NULL;
+  if(aja->PackedNumbers != NULL){
+    *packed = (struct AJNumber *)__internal__Malloc(sizeof(struct AJNumber) * (aja->length > 0 ? aja->length : 1));
+    for(int i = 0; i < aja->length; i++){
+      (*packed)[i].number = aja->PackedNumbers[i];
+      (*packed)[i].Lexeme = NULL;
+      items[i].Node = &(*packed)[i];
+      items[i].Type = TYPE_NUMBER;
+    }
+  }else{
+    int i = 0;
+    for(struct AJArrayElement * el = aja->FirstElement; el != NULL; el = el->NextAJElement, i++){
+      items[i].Node = el->ArrayElement;
+      items[i].Type = el->ArrayElementType;
+    }
+  }
+  for(int i = 0; i < aja->length; i++){
+    items[i].Hash = AJHash(items[i].Node, items[i].Type, 1);
+  }
+  return items;
+}
+
+static inline int __internal__SameDiffItem(struct __internal__DiffItem * x, struct __internal__DiffItem * y){
+  return x->Hash == y->Hash && AJEquals(x->Node, x->Type, y->Node, y->Type, 1);
+}
+
+//counts per hash, for matching array elements without comparing each against each
+struct __internal__HashCountSlot{
+  unsigned long long Hash; //never 0 for a used slot
+  int Count;
+};
+
+//the slot counting hash. with add, it is made if it isnt there yet; without, that gives an empty slot (Count 0)
+static inline struct __internal__HashCountSlot * __internal__HashCountSlotFor(struct __internal__HashCountSlot * slots, int capacity, unsigned long long hash, int add){
+  hash |= 1;
+  int slot = (int)(hash & (capacity - 1));
+  while(slots[slot].Hash != 0 && slots[slot].Hash != hash){slot = (slot + 1) & (capacity - 1);}
+  if(add){slots[slot].Hash = hash;}
+  return &slots[slot];
+}
+
+void __internal__Diff(struct AJArray * patch, struct __internal__PathBuffer * path, void * a, int typeA, void * b, int typeB);
+
+void __internal__DiffObjects(struct AJArray * patch, struct __internal__PathBuffer * path, struct AJObject * a, struct AJObject * b){
+  for(struct AJKeyValuePair * ajkvp = a->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    if(ajkvp->KeyType != TYPE_STRING){ //a pointer cant name this key
+      if(!AJEquals(a, TYPE_OBJECT, b, TYPE_OBJECT, 1)){__internal__AddPatchOp(patch, "replace", path, b, TYPE_OBJECT);}
+      return;
+    }
+  }
+  for(struct AJKeyValuePair * ajkvp = b->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    if(ajkvp->KeyType != TYPE_STRING){
+      __internal__AddPatchOp(patch, "replace", path, b, TYPE_OBJECT);
+      return;
+    }
+  }
+  struct __internal__KeyIndex indexA, indexB;
+  __internal__BuildKeyIndex(&indexA, a);
+  __internal__BuildKeyIndex(&indexB, b);
+  int pathLength = path->Length;
+  for(struct AJKeyValuePair * ajkvp = a->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    struct AJString * key = (struct AJString *)ajkvp->key;
+    struct AJKeyValuePair * other = __internal__FindInKeyIndex(&indexB, ajkvp->key, TYPE_STRING);
+    __internal__PushPathKey(path, key->string, key->length);
+    if(other == NULL){
+      __internal__AddPatchOp(patch, "remove", path, NULL, TYPE_NULL);
+    }else{
+      __internal__Diff(patch, path, ajkvp->value, ajkvp->ValueType, other->value, other->ValueType);
+    }
+    __internal__PopPath(path, pathLength);
+  }
+  for(struct AJKeyValuePair * ajkvp = b->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    if(__internal__FindInKeyIndex(&indexA, ajkvp->key, TYPE_STRING) == NULL){
+      struct AJString * key = (struct AJString *)ajkvp->key;
+      __internal__PushPathKey(path, key->string, key->length);
+      __internal__AddPatchOp(patch, "add", path, ajkvp->value, ajkvp->ValueType);
+      __internal__PopPath(path, pathLength);
+    }
+  }
+  __internal__Free(indexA.Slots);
+  __internal__Free(indexB.Slots);
+}
+
+void __internal__DiffArrays(struct AJArray * patch, struct __internal__PathBuffer * path, struct AJArray * a, struct AJArray * b){
+  struct AJNumber * packedA, * packedB;
+  struct __internal__DiffItem * x = __internal__GetDiffItems(a, &packedA);
+  struct __internal__DiffItem * y = __internal__GetDiffItems(b, &packedB);
+  int pathLength = path->Length;
+
+  //skip what is the same at both ends
+  int start = 0;
+  while(start < a->length && start < b->length && __internal__SameDiffItem(&x[start], &y[start])){start++;}
+  int endA = a->length, endB = b->length;
+  while(endA > start && endB > start && __internal__SameDiffItem(&x[endA - 1], &y[endB - 1])){endA--; endB--;}
+  int countA = endA - start, countB = endB - start;
+
+  //how many of b's elements a already has somewhere
+  int capacity = 16;
+  while(capacity < countB * 2){capacity *= 2;}
+  struct __internal__HashCountSlot * counts = (struct __internal__HashCountSlot *)__internal__Malloc(sizeof(struct __internal__HashCountSlot) * capacity);
+  memset(counts, 0, sizeof(struct __internal__HashCountSlot) * capacity);
+  for(int j = start; j < endB; j++){
+    __internal__HashCountSlotFor(counts, capacity, y[j].Hash, 1)->Count++;
+  }
+  char * keep = (char *)__internal__Malloc(countA > 0 ? countA : 1);
+  int matches = 0;
+  for(int i = start; i < endA; i++){
+    struct __internal__HashCountSlot * slot = __internal__HashCountSlotFor(counts, capacity, x[i].Hash, 0);
+    keep[i - start] = slot->Count > 0;
+    if(slot->Count > 0){slot->Count--; matches++;}
+  }
+
+  int shorter = countA < countB ? countA : countB;
+  if(matches * 2 < shorter){ //mostly edited in place: diff element by element, then trim or extend the tail
+    for(int i = 0; i < shorter; i++){
+      __internal__PushPathIndex(path, start + i);
+      __internal__Diff(patch, path, x[start + i].Node, x[start + i].Type, y[start + i].Node, y[start + i].Type);
+      __internal__PopPath(path, pathLength);
+    }
+    for(int i = shorter; i < countA; i++){
+      __internal__PushPathIndex(path, start + shorter);
+      __internal__AddPatchOp(patch, "remove", path, NULL, TYPE_NULL);
+      __internal__PopPath(path, pathLength);
+    }
+    for(int j = shorter; j < countB; j++){
+      __internal__PushPathIndex(path, start + j);
+      __internal__AddPatchOp(patch, "add", path, y[start + j].Node, y[start + j].Type);
+      __internal__PopPath(path, pathLength);
+    }
+  }else{
+    //remove what b doesnt have (from the back, so the indexes in front stay put)
+    int kept = 0;
+    for(int i = endA - 1; i >= start; i--){
+      if(keep[i - start]){
+        x[start + countA - 1 - kept] = x[i]; //packs the kept elements at the end of x's middle, in order
+        kept++;
+        continue;
+      }
+      __internal__PushPathIndex(path, i);
+      __internal__AddPatchOp(patch, "remove", path, NULL, TYPE_NULL);
+      __internal__PopPath(path, pathLength);
+    }
+    //walk b, adding whatever the kept elements dont line up with
+    struct __internal__DiffItem * remaining = &x[start + countA - kept];
+    int k = 0;
+    for(int j = start; j < endB; j++){
+      if(k < kept && __internal__SameDiffItem(&remaining[k], &y[j])){
+        k++;
+        continue;
+      }
+      __internal__PushPathIndex(path, j);
+      __internal__AddPatchOp(patch, "add", path, y[j].Node, y[j].Type);
+      __internal__PopPath(path, pathLength);
+    }
+    for(; k < kept; k++){ //kept but out of order: they were added again above, so these copies go
+      __internal__PushPathIndex(path, endB);
+      __internal__AddPatchOp(patch, "remove", path, NULL, TYPE_NULL);
+      __internal__PopPath(path, pathLength);
+    }
+  }
+  __internal__Free(keep);
+  __internal__Free(counts);
+  __internal__Free(x);
+  __internal__Free(y);
+  __internal__Free(packedA);
+  __internal__Free(packedB);
+}
+
+void __internal__Diff(struct AJArray * patch, struct __internal__PathBuffer * path, void * a, int typeA, void * b, int typeB){
+  if(typeA != typeB){
+    __internal__AddPatchOp(patch, "replace", path, b, typeB);
+    return;
+  }
+  switch(typeA){
+    case TYPE_OBJECT: __internal__DiffObjects(patch, path, (struct AJObject *)a, (struct AJObject *)b); return;
+    case TYPE_ARRAY: __internal__DiffArrays(patch, path, (struct AJArray *)a, (struct AJArray *)b); return;
+  }
+  if(!AJEquals(a, typeA, b, typeB, 1)){
+    __internal__AddPatchOp(patch, "replace", path, b, typeB);
+  }
+}
+
+//JSON Patch (RFC 6902) that turns a into b. An empty array when they are equal. Delete it with DeleteAJArray.
+struct AJArray * AJDiff(void * a, int typeA, void * b, int typeB){
+  struct AJArray * patch = CreateAJArray();
+  struct __internal__PathBuffer path;
+  path.Capacity = 64;
+  path.Length = 0;
+  path.Chars = (char *)__internal__Malloc(path.Capacity);
+  path.Chars[0] = '\0';
+  __internal__Diff(patch, &path, a, typeA, b, typeB);
+  __internal__Free(path.Chars);
+  return patch;
+}
+
+//reads the array index in a pointer token. "-" is the end (only allowed when allowEnd). -1 if it isnt one
+int __internal__PointerIndex(char * token, int length, int arrayLength, int allowEnd){
+  if(length == 1 && token[0] == '-'){return allowEnd ? arrayLength : -1;}
+  if(length == 0 || length > 9 || (token[0] == '0' && length > 1)){return -1;}
+  int idx = 0;
+  for(int i = 0; i < length; i++){
+    if(token[i] < '0' || token[i] > '9'){return -1;}
+    idx = idx * 10 + (token[i] - '0');
+  }
+  return idx < arrayLength + (allowEnd ? 1 : 0) ? idx : -1;
+}
+
+//unescapes the pointer token path[0..length) into a new null terminated buffer (free it with __internal__Free)
+char * __internal__PointerToken(const char * path, int length, int * tokenLength){
+  char * token = (char *)__internal__Malloc(length + 1);
+  int n = 0;
+  for(int i = 0; i < length; i++){
+    if(path[i] == '~' && i + 1 < length && (path[i + 1] == '0' || path[i + 1] == '1')){
+      token[n++] = path[i + 1] == '0' ? '~' : '/';
+      i++;
+    }else{
+      token[n++] = path[i];
+    }
+  }
+  token[n] = '\0';
+  *tokenLength = n;
+  return token;
+}
+
+//the child of container named by token (its type through childType), or NULL. for objects *kvp is the KVP holding it
+void * __internal__PointerChild(void * container, int type, char * token, int tokenLength, int * childType, struct AJKeyValuePair ** kvp, struct AJNumber * packedNumber){
+  if(type == TYPE_OBJECT){
+    *kvp = SearchObjectForKey(token, (struct AJObject *)container);
+    if(*kvp == NULL){return NULL;}
+    *childType = (*kvp)->ValueType;
+    return (*kvp)->value;
+  }
+  if(type == TYPE_ARRAY){
+    struct AJArray * aja = (struct AJArray *)container;
+    int idx = __internal__PointerIndex(token, tokenLength, aja->length, 0);
+    if(idx < 0){return NULL;}
+    *childType = TYPE_NUMBER;
+    if(aja->PackedNumbers != NULL){
+      packedNumber->number = aja->PackedNumbers[idx];
+      packedNumber->Lexeme = NULL;
+      return packedNumber;
+    }
+    struct AJArrayElement * el = GetElementFromArrayIndex(aja->FirstElement, 0, idx);
+    *childType = el->ArrayElementType;
+    return el->ArrayElement;
+  }
+  return NULL;
+}
+
+//follows path[0..length) down from node. NULL if it leads nowhere
+void * __internal__WalkPointer(void * node, int type, const char * path, int length, int * nodeType, struct AJNumber * packedNumber){
+  *nodeType = type;
+  int i = 0;
+  while(node != NULL && i < length){
+    if(path[i] != '/'){return NULL;}
+    int end = i + 1;
+    while(end < length && path[end] != '/'){end++;}
+    int tokenLength;
+    char * token = __internal__PointerToken(&path[i + 1], end - i - 1, &tokenLength);
+    struct AJKeyValuePair * kvp;
+    node = __internal__PointerChild(node, *nodeType, token, tokenLength, nodeType, &kvp, packedNumber);
+    __internal__Free(token);
+    i = end;
+  }
+  return node;
+}
+
+//gives ajkvp (a KVP of ajo) a new value, deleting the old one
+void __internal__SetKVPValue(struct AJObject * ajo, struct AJKeyValuePair * ajkvp, void * value, int valueType){
+  if(ajkvp->value != (void*)&ajkvp->InlineValue){
+    AJDelete(ajkvp->value, ajkvp->ValueType);
+  }else{
+    __internal__ForgetCachedText(ajkvp->value);
+  }
+  ajkvp->value = value;
+  ajkvp->ValueType = valueType;
+  AJMarkDirty(ajo);
+}
+
+//what AJApplyPatch has to do to take back one change (and, if every op goes through, what it deletes then)
+#define AJ_PATCH_UNDO_ROOT 0 //Value: the old root
+#define AJ_PATCH_UNDO_ADDED_KVP 1 //KVP: the one added
+#define AJ_PATCH_UNDO_SET_KVP 2 //KVP got a new value, Value: the old one
+#define AJ_PATCH_UNDO_REMOVED_KVP 3 //KVP was unlinked, Value: the KVP it was in front of (NULL: it was the last)
+#define AJ_PATCH_UNDO_ADDED_ELEMENT 4 //Index
+#define AJ_PATCH_UNDO_SET_ELEMENT 5 //Element got a new value, Value: the old one
+#define AJ_PATCH_UNDO_SET_NUMBER 6 //the packed number at Index was Number
+#define AJ_PATCH_UNDO_REMOVED_ELEMENT 7 //Element was unlinked from Index
+#define AJ_PATCH_UNDO_REMOVED_NUMBER 8 //the packed number Number was removed from Index
+
+struct __internal__PatchUndo{
+  int Kind;
+  void * Container;
+  struct AJKeyValuePair * KVP;
+  struct AJArrayElement * Element;
+  void * Value;
+  int ValueType;
+  int Index;
+  double Number;
+};
+
+struct __internal__PatchLog{
+  struct __internal__PatchUndo * Entries;
+  int Count;
+  int Capacity;
+};
+
+static inline struct __internal__PatchUndo * __internal__LogPatchChange(struct __internal__PatchLog * log, int kind, void * container){
+  if(log->Count == log->Capacity){
+    log->Capacity = log->Capacity == 0 ? 8 : log->Capacity * 2;
+    log->Entries = (struct __internal__PatchUndo *)__internal__Realloc(log->Entries, sizeof(struct __internal__PatchUndo) * log->Capacity);
+  }
+  struct __internal__PatchUndo * entry = &log->Entries[log->Count++];
+  entry->Kind = kind;
+  entry->Container = container;
+  return entry;
+}
+
+//deletes a value that was taken out of a KVP / element (inline ones are part of it, so they only drop their cached text)
+static inline void __internal__DeleteTakenValue(void * value, int type, union AJInlineScalar * inlineSlot){
+  if(value != (void*)inlineSlot){
+    AJDelete(value, type);
+  }else{
+    __internal__ForgetCachedText(value);
+  }
+}
+
+//the add and replace ops on one container. value is owned by the container afterwards if this returns 1; what it replaced is kept in log
+int __internal__PatchPut(void * container, int type, char * token, int tokenLength, void * value, int valueType, int replace, struct __internal__PatchLog * log){
+  if(type == TYPE_OBJECT){
+    struct AJObject * ajo = (struct AJObject *)container;
+    struct AJKeyValuePair * ajkvp = SearchObjectForKey(token, ajo);
+    if(ajkvp != NULL){
+      struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_SET_KVP, ajo);
+      entry->KVP = ajkvp;
+      entry->Value = ajkvp->value;
+      entry->ValueType = ajkvp->ValueType;
+      ajkvp->value = value;
+      ajkvp->ValueType = valueType;
+      AJMarkDirty(ajo);
+      return 1;
+    }
+    if(replace){return 0;}
+    struct AJString * key = (struct AJString *)__internal__Malloc(sizeof(struct AJString));
+    __internal__SetAJStringChars(key, token, tokenLength);
+    key->RefCount = 0;
+    ajkvp = CreateAJKeyValuePair(key, TYPE_STRING, value, valueType);
+    AddToAJObjectBeforeKVP(ajo, ajkvp, NULL);
+    __internal__LogPatchChange(log, AJ_PATCH_UNDO_ADDED_KVP, ajo)->KVP = ajkvp;
+    return 1;
+  }
+  if(type != TYPE_ARRAY){return 0;}
+  struct AJArray * aja = (struct AJArray *)container;
+  int idx = __internal__PointerIndex(token, tokenLength, aja->length, !replace);
+  if(idx < 0){return 0;}
+  if(aja->PackedNumbers != NULL && valueType == TYPE_NUMBER){ //stays packed
+    double num = AJNumberGetDouble((struct AJNumber *)value);
+    AJDelete(value, TYPE_NUMBER);
+    if(replace){
+      struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_SET_NUMBER, aja);
+      entry->Index = idx;
+      entry->Number = aja->PackedNumbers[idx];
+      aja->PackedNumbers[idx] = num;
+      AJMarkDirty(aja);
+    }else{
+      AddNumberToAJArray(aja, num, idx);
+      __internal__LogPatchChange(log, AJ_PATCH_UNDO_ADDED_ELEMENT, aja)->Index = idx;
+    }
+    return 1;
+  }
+  if(replace && aja->PackedNumbers == NULL){ //the element stays where it is, only its value changes
+    struct AJArrayElement * el = GetElementFromArrayIndex(aja->FirstElement, 0, idx);
+    struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_SET_ELEMENT, aja);
+    entry->Element = el;
+    entry->Value = el->ArrayElement;
+    entry->ValueType = el->ArrayElementType;
+    el->ArrayElement = value;
+    el->ArrayElementType = valueType;
+    AJMarkDirty(aja);
+    return 1;
+  }
+  if(replace){ //a packed number replaced by something else
+    struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_REMOVED_NUMBER, aja);
+    entry->Index = idx;
+    entry->Number = aja->PackedNumbers[idx];
+    RemoveFromAJArray(aja, idx);
+  }
+  AddToAJArray(aja, value, valueType, idx);
+  __internal__LogPatchChange(log, AJ_PATCH_UNDO_ADDED_ELEMENT, aja)->Index = idx;
+  return 1;
+}
+
+//the remove op on one container. what it removed is kept in log
+int __internal__PatchRemove(void * container, int type, char * token, int tokenLength, struct __internal__PatchLog * log){
+  if(type == TYPE_OBJECT){
+    struct AJObject * ajo = (struct AJObject *)container;
+    struct AJKeyValuePair * ajkvp = SearchObjectForKey(token, ajo);
+    if(ajkvp == NULL){return 0;}
+    struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_REMOVED_KVP, ajo);
+    entry->KVP = ajkvp;
+    entry->Value = ajkvp->NextAJKVP;
+    __internal__UnlinkAJKVP(ajo, ajkvp);
+    return 1;
+  }
+  if(type != TYPE_ARRAY){return 0;}
+  struct AJArray * aja = (struct AJArray *)container;
+  int idx = __internal__PointerIndex(token, tokenLength, aja->length, 0);
+  if(idx < 0){return 0;}
+  if(aja->PackedNumbers != NULL){
+    struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_REMOVED_NUMBER, aja);
+    entry->Index = idx;
+    entry->Number = aja->PackedNumbers[idx];
+    RemoveFromAJArray(aja, idx);
+    return 1;
+  }
+  struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_REMOVED_ELEMENT, aja);
+  entry->Element = GetElementFromArrayIndex(aja->FirstElement, 0, idx);
+  entry->Index = idx;
+  __internal__UnlinkAJArrayElement(aja, entry->Element);
+  return 1;
+}
+
+static inline int __internal__IsSharedNode(void * node, int type){
+  return (type == TYPE_OBJECT && ((struct AJObject *)node)->RefCount > 0) || (type == TYPE_ARRAY && ((struct AJArray *)node)->RefCount > 0);
+}
+
+//add / replace / remove of the value at path. value (a copy the patch doesnt own) is used up when this returns 1
+int __internal__PatchAt(void ** root, int * rootType, struct AJString * path, void * value, int valueType, const char * op, struct __internal__PatchLog * log){
+  if(path->length == 0){ //the whole document
+    if(op[0] == 'r' && op[2] == 'm'){return 0;}
+    struct __internal__PatchUndo * entry = __internal__LogPatchChange(log, AJ_PATCH_UNDO_ROOT, NULL);
+    entry->Value = *root;
+    entry->ValueType = *rootType;
+    *root = value;
+    *rootType = valueType;
+    return 1;
+  }
+  int lastSlash = path->length - 1;
+  while(lastSlash > 0 && path->string[lastSlash] != '/'){lastSlash--;}
+  if(path->string[lastSlash] != '/'){return 0;}
+  int parentType;
+  struct AJNumber packedNumber;
+  void * parent = __internal__WalkPointer(*root, *rootType, path->string, lastSlash, &parentType, &packedNumber);
+  if(parent == NULL || (parentType != TYPE_OBJECT && parentType != TYPE_ARRAY) || __internal__IsSharedNode(parent, parentType)){return 0;}
+  int tokenLength;
+  char * token = __internal__PointerToken(&path->string[lastSlash + 1], path->length - lastSlash - 1, &tokenLength);
+  int done;
+  if(op[0] == 'a'){
+    done = __internal__PatchPut(parent, parentType, token, tokenLength, value, valueType, 0, log);
+  }else if(op[2] == 'p'){ //replace
+    done = __internal__PatchPut(parent, parentType, token, tokenLength, value, valueType, 1, log);
+  }else{
+    done = __internal__PatchRemove(parent, parentType, token, tokenLength, log);
+  }
+  __internal__Free(token);
+  return done;
+}
+
+//puts back everything in log, newest first, so each change is undone on the tree it was made on
+void __internal__UndoPatch(void ** root, int * rootType, struct __internal__PatchLog * log){
+  for(int i = log->Count - 1; i >= 0; i--){
+    struct __internal__PatchUndo * entry = &log->Entries[i];
+    switch(entry->Kind){
+      case AJ_PATCH_UNDO_ROOT:{
+        AJDelete(*root, *rootType);
+        *root = entry->Value;
+        *rootType = entry->ValueType;
+        break;
+      }
+      case AJ_PATCH_UNDO_ADDED_KVP: RemoveKVPFromAJObject((struct AJObject *)entry->Container, entry->KVP); break;
+      case AJ_PATCH_UNDO_SET_KVP:{
+        AJDelete(entry->KVP->value, entry->KVP->ValueType); //always a copy the patch made
+        entry->KVP->value = entry->Value;
+        entry->KVP->ValueType = entry->ValueType;
+        AJMarkDirty(entry->Container);
+        break;
+      }
+      case AJ_PATCH_UNDO_REMOVED_KVP: AddToAJObjectBeforeKVP((struct AJObject *)entry->Container, entry->KVP, (struct AJKeyValuePair *)entry->Value); break;
+      case AJ_PATCH_UNDO_ADDED_ELEMENT: RemoveFromAJArray((struct AJArray *)entry->Container, entry->Index); break;
+      case AJ_PATCH_UNDO_SET_ELEMENT:{
+        AJDelete(entry->Element->ArrayElement, entry->Element->ArrayElementType);
+        entry->Element->ArrayElement = entry->Value;
+        entry->Element->ArrayElementType = entry->ValueType;
+        AJMarkDirty(entry->Container);
+        break;
+      }
+      case AJ_PATCH_UNDO_SET_NUMBER:{
+        struct AJArray * aja = (struct AJArray *)entry->Container;
+        if(aja->PackedNumbers != NULL){
+          aja->PackedNumbers[entry->Index] = entry->Number;
+          AJMarkDirty(aja);
+        }else{ //a later op unpacked it
+          AJNumberSetDouble((struct AJNumber *)GetElementFromArrayIndex(aja->FirstElement, 0, entry->Index)->ArrayElement, entry->Number);
+        }
+        break;
+      }
+      case AJ_PATCH_UNDO_REMOVED_ELEMENT: __internal__LinkAJArrayElement((struct AJArray *)entry->Container, entry->Element, entry->Index); break;
+      case AJ_PATCH_UNDO_REMOVED_NUMBER: AddNumberToAJArray((struct AJArray *)entry->Container, entry->Number, entry->Index); break;
+    }
+  }
+}
+
+//every op went through: deletes what the ops replaced or removed. oldest first, so a container is still there for the entries inside it
+void __internal__CommitPatch(struct __internal__PatchLog * log){
+  for(int i = 0; i < log->Count; i++){
+    struct __internal__PatchUndo * entry = &log->Entries[i];
+    switch(entry->Kind){
+      case AJ_PATCH_UNDO_ROOT: AJDelete(entry->Value, entry->ValueType); break;
+      case AJ_PATCH_UNDO_SET_KVP: __internal__DeleteTakenValue(entry->Value, entry->ValueType, &entry->KVP->InlineValue); break;
+      case AJ_PATCH_UNDO_REMOVED_KVP: __internal__DeleteUnlinkedAJKVP((struct AJObject *)entry->Container, entry->KVP); break;
+      case AJ_PATCH_UNDO_SET_ELEMENT: __internal__DeleteTakenValue(entry->Value, entry->ValueType, &entry->Element->InlineElement); break;
+      case AJ_PATCH_UNDO_REMOVED_ELEMENT: __internal__DeleteUnlinkedAJArrayElement((struct AJArray *)entry->Container, entry->Element); break;
+    }
+  }
+}
+
+//looks key up in a patch op, expecting type. NULL if it isnt there
+static inline void * __internal__PatchOpMember(struct AJObject * op, char * key, int * type){
+  struct AJKeyValuePair * ajkvp = SearchObjectForKey(key, op);
+  if(ajkvp == NULL){return NULL;}
+  *type = ajkvp->ValueType;
+  return ajkvp->value;
+}
+
+//1 if every op of patch is well formed: a known op, a pointer for path (and from), and a value where it needs one
+int __internal__CheckPatchOps(struct AJArray * patch){
+  for(struct AJArrayElement * el = patch->FirstElement; el != NULL; el = el->NextAJElement){
+    if(el->ArrayElementType != TYPE_OBJECT){return 0;}
+    struct AJObject * op = (struct AJObject *)el->ArrayElement;
+    int opType, pathType, valueType, fromType;
+    struct AJString * name = (struct AJString *)__internal__PatchOpMember(op, "op", &opType);
+    struct AJString * path = (struct AJString *)__internal__PatchOpMember(op, "path", &pathType);
+    void * value = __internal__PatchOpMember(op, "value", &valueType);
+    struct AJString * from = (struct AJString *)__internal__PatchOpMember(op, "from", &fromType);
+    if(name == NULL || opType != TYPE_STRING || path == NULL || pathType != TYPE_STRING){return 0;}
+    if(path->length > 0 && path->string[0] != '/'){return 0;}
+    if(compareStringToAJString("add", name) || compareStringToAJString("replace", name) || compareStringToAJString("test", name)){
+      if(value == NULL){return 0;}
+    }else if(compareStringToAJString("move", name) || compareStringToAJString("copy", name)){
+      if(from == NULL || fromType != TYPE_STRING || (from->length > 0 && from->string[0] != '/')){return 0;}
+    }else if(!compareStringToAJString("remove", name)){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+//applies every op of (a checked) patch to the tree at root in place, noting each change in log. stops at the first one that fails
+int __internal__ApplyPatchOps(void ** root, int * rootType, struct AJArray * patch, struct __internal__PatchLog * log){
+  struct AJNumber packedNumber;
+  for(struct AJArrayElement * el = patch->FirstElement; el != NULL; el = el->NextAJElement){
+    struct AJObject * op = (struct AJObject *)el->ArrayElement;
+    int opType, pathType, valueType, fromType;
+    struct AJString * name = (struct AJString *)__internal__PatchOpMember(op, "op", &opType);
+    struct AJString * path = (struct AJString *)__internal__PatchOpMember(op, "path", &pathType);
+    void * value = __internal__PatchOpMember(op, "value", &valueType);
+    struct AJString * from = (struct AJString *)__internal__PatchOpMember(op, "from", &fromType);
+
+    int done = 0;
+    if(compareStringToAJString("add", name) || compareStringToAJString("replace", name)){
+      void * copy = AJClone(value, valueType);
+      done = __internal__PatchAt(root, rootType, path, copy, valueType, name->string, log);
+      if(!done){AJDelete(copy, valueType);}
+    }else if(compareStringToAJString("remove", name)){
+      done = __internal__PatchAt(root, rootType, path, NULL, TYPE_NULL, "remove", log);
+    }else if(compareStringToAJString("test", name)){
+      int type;
+      void * current = __internal__WalkPointer(*root, *rootType, path->string, path->length, &type, &packedNumber);
+      done = current != NULL && AJEquals(current, type, value, valueType, 1);
+    }else{ //move, copy
+      int type;
+      void * source = __internal__WalkPointer(*root, *rootType, from->string, from->length, &type, &packedNumber);
+      int isMove = name->string[0] == 'm';
+      //a value cant move into itself
+      if(source != NULL && isMove && path->length > from->length && memcmp(path->string, from->string, from->length) == 0 && path->string[from->length] == '/'){source = NULL;}
+      if(source != NULL){
+        void * copy = AJClone(source, type);
+        done = !isMove || __internal__PatchAt(root, rootType, from, NULL, TYPE_NULL, "remove", log);
+        done = done && __internal__PatchAt(root, rootType, path, copy, type, "add", log);
+        if(!done){AJDelete(copy, type);}
+      }
+    }
+    if(!done){return 0;}
+  }
+  return 1;
+}
+
+//applies a JSON Patch (RFC 6902) to *root in place. returns 1 if every op applied (*root and *rootType change only when an op
+//replaces the whole document), returns 0 and leaves the tree as it was if one didnt (see above).
+int AJApplyPatch(void ** root, int * rootType, struct AJArray * patch){
+  if(patch->PackedNumbers != NULL){return patch->length == 0;} //numbers arent ops
+  if(patch->length == 0){return 1;}
+  if(!__internal__CheckPatchOps(patch)){return 0;}
+  struct __internal__PatchLog log;
+  log.Entries = NULL;
+  log.Count = 0;
+  log.Capacity = 0;
+  int done = __internal__ApplyPatchOps(root, rootType, patch, &log);
+  if(done){
+    __internal__CommitPatch(&log);
+  }else{
+    __internal__UndoPatch(root, rootType, &log);
+  }
+  __internal__Free(log.Entries);
+  return done;
+}
+
+void __internal__MergeDiff(struct AJObject * patch, struct AJObject * a, struct AJObject * b){
+  struct __internal__KeyIndex indexA, indexB;
+  __internal__BuildKeyIndex(&indexA, a);
+  __internal__BuildKeyIndex(&indexB, b);
+  for(struct AJKeyValuePair * ajkvp = a->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    if(__internal__FindInKeyIndex(&indexB, ajkvp->key, ajkvp->KeyType) == NULL){
+      AddToAJObjectBeforeKVP(patch, CreateAJKeyValuePair(AJClone(ajkvp->key, ajkvp->KeyType), ajkvp->KeyType, CreateAJNull(), TYPE_NULL), NULL);
+    }
+  }
+  for(struct AJKeyValuePair * ajkvp = b->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    struct AJKeyValuePair * other = __internal__FindInKeyIndex(&indexA, ajkvp->key, ajkvp->KeyType);
+    void * change = NULL;
+    if(other != NULL && other->ValueType == TYPE_OBJECT && ajkvp->ValueType == TYPE_OBJECT){
+      struct AJObject * nested = CreateAJObject();
+      __internal__MergeDiff(nested, (struct AJObject *)other->value, (struct AJObject *)ajkvp->value);
+      if(nested->AJKVPCount == 0){
+        DeleteAJObject(nested);
+      }else{
+        change = nested;
+      }
+    }else if(other == NULL || !AJEquals(other->value, other->ValueType, ajkvp->value, ajkvp->ValueType, 1)){
+      change = AJClone(ajkvp->value, ajkvp->ValueType);
+    }
+    if(change != NULL){
+      AddToAJObjectBeforeKVP(patch, CreateAJKeyValuePair(AJClone(ajkvp->key, ajkvp->KeyType), ajkvp->KeyType, change, ajkvp->ValueType), NULL);
+    }
+  }
+  __internal__Free(indexA.Slots);
+  __internal__Free(indexB.Slots);
+}
+
+//JSON Merge Patch (RFC 7386) that turns object a into object b. An empty object when they are equal. Delete it with DeleteAJObject.
+struct AJObject * AJMergeDiff(struct AJObject * a, struct AJObject * b){
+  struct AJObject * patch = CreateAJObject();
+  __internal__MergeDiff(patch, a, b);
+  return patch;
+}
+
+//applies a JSON Merge Patch (RFC 7386) to target in place. 0 if it ran into a shared node (the keys before it stay applied)
+int AJApplyMergePatch(struct AJObject * target, struct AJObject * patch){
+  if(target->RefCount > 0){return 0;}
+  struct __internal__KeyIndex index;
+  __internal__BuildKeyIndex(&index, target); //KVPs added below are never looked up again, patch keys being unique
+  int done = 1;
+  for(struct AJKeyValuePair * ajkvp = patch->FirstAJKVP; ajkvp != NULL && done; ajkvp = ajkvp->NextAJKVP){
+    struct AJKeyValuePair * current = __internal__FindInKeyIndex(&index, ajkvp->key, ajkvp->KeyType);
+    if(ajkvp->ValueType == TYPE_NULL){
+      if(current != NULL){
+        __internal__DropFromKeyIndex(&index, current);
+        RemoveKVPFromAJObject(target, current);
+      }
+      continue;
+    }
+    if(ajkvp->ValueType == TYPE_OBJECT){
+      if(current == NULL || current->ValueType != TYPE_OBJECT){ //merge into a fresh object
+        struct AJObject * fresh = CreateAJObject();
+        if(current == NULL){
+          AddToAJObjectBeforeKVP(target, CreateAJKeyValuePair(AJClone(ajkvp->key, ajkvp->KeyType), ajkvp->KeyType, fresh, TYPE_OBJECT), NULL);
+        }else{
+          __internal__SetKVPValue(target, current, fresh, TYPE_OBJECT);
+        }
+        done = AJApplyMergePatch(fresh, (struct AJObject *)ajkvp->value);
+      }else{
+        done = AJApplyMergePatch((struct AJObject *)current->value, (struct AJObject *)ajkvp->value);
+      }
+      continue;
+    }
+    void * copy = AJClone(ajkvp->value, ajkvp->ValueType);
+    if(current == NULL){
+      AddToAJObjectBeforeKVP(target, CreateAJKeyValuePair(AJClone(ajkvp->key, ajkvp->KeyType), ajkvp->KeyType, copy, ajkvp->ValueType), NULL);
+    }else{
+      __internal__SetKVPValue(target, current, copy, ajkvp->ValueType);
+    }
+  }
+  __internal__Free(index.Slots);
+  return done;
+}
+
+/* Canonical JSON (RFC 8785, JCS)
+For signing and content addressing: the same JSON always comes out as the same bytes. AJWriterCanonicalValue streams a tree through an
+AJWriter (so a writer with a sink hands it on as it goes, no copy of the whole text), WriteAJValueAsCanonicalStringToBuffer writes it
+into a buffer like the other text writers.
+  -no whitespace, object members sorted by their keys' UTF-16 code units. Shaped objects sort their shape's keys once and keep the
+   order in the shape, so arrays of records pay for the sort once.
+  -numbers as ECMAScript prints them: the fewest digits that read back as the same double, exponent only below 1e-6 or from 1e21.
+  -strings escape only ", \ and control chars (as \n etc or \u00xx), everything else is written as UTF-8. Strings still holding their
+   source escapes (AJContext->EscapeStrings off, the default) are decoded first.
+  -NaN, infinities and non string keys have no canonical form: the write fails (returns 0).*/
+
+//the code point starting at s[i] (or the byte itself if it isnt valid UTF-8)
+static inline unsigned int __internal__DecodeUTF8At(const unsigned char * s, int i, int length){
+  unsigned char c = s[i];
+  int extra = c >= 0xC2 && c <= 0xDF ? 1 : c >= 0xE0 && c <= 0xEF ? 2 : c >= 0xF0 && c <= 0xF4 ? 3 : 0;
+  if(extra == 0 || i + extra >= length){return c;}
+  unsigned int codepoint = extra == 1 ? c & 0x1F : extra == 2 ? c & 0x0F : c & 0x07;
+  for(int k = 1; k <= extra; k++){
+    if((s[i + k] & 0xC0) != 0x80){return c;}
+    codepoint = (codepoint << 6) | (s[i + k] & 0x3F);
+  }
+  return codepoint;
+}
+
+//compares two UTF-8 strings the way their UTF-16 forms compare (code points past U+FFFF sort as surrogates, before U+E000)
+int __internal__CompareUTF16Order(const char * a, int lengthA, const char * b, int lengthB){
+  int shorter = lengthA < lengthB ? lengthA : lengthB;
+  int i = 0;
+  while(i < shorter && a[i] == b[i]){i++;}
+  if(i == shorter){return lengthA - lengthB;}
+  while(i > 0 && ((unsigned char)a[i] & 0xC0) == 0x80){i--;} //back to the start of the char they differ in
+  unsigned int x = __internal__DecodeUTF8At((const unsigned char *)a, i, lengthA);
+  unsigned int y = __internal__DecodeUTF8At((const unsigned char *)b, i, lengthB);
+  unsigned int unitX = x >= 0x10000 ? 0xD800 + ((x - 0x10000) >> 10) : x;
+  unsigned int unitY = y >= 0x10000 ? 0xD800 + ((y - 0x10000) >> 10) : y;
+  if(unitX != unitY){return unitX < unitY ? -1 : 1;}
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+//writes num the way ECMAScript's Number toString does into out (32 chars is enough). returns the length, -1 for NaN and infinities
+int __internal__FormatCanonicalNumber(double num, char * out){
+  if(num != num || num - num != 0){return -1;}
+  if(num == 0){ //-0 too
+    out[0] = '0';
+    out[1] = '\0';
+    return 1;
+  }
+  if(num > -9007199254740992.0 && num < 9007199254740992.0 && num == (double)(long long)num){ //whole numbers: just the digits
+    return sprintf(out, "%lld", (long long)num);
+  }
+  //shortest digits that read back as num. 15 digits are always enough for a shorter form to show (as trailing zeros),
+  //except for subnormals, which have fewer digits of precision
+  char scientific[40];
+  int subnormal = num > -2.2250738585072014e-308 && num < 2.2250738585072014e-308;
+  for(int precision = subnormal ? 1 : 15; precision <= 17; precision++){
+    sprintf(scientific, "%.*e", precision - 1, num);
+    if(strtod(scientific, NULL) == num){break;}
+  }
+  char digits[20];
+  int digitCount = 0;
+  char * at = scientific;
+  int written = 0;
+  if(*at == '-'){
+    out[written++] = '-';
+    at++;
+  }
+  for(; *at != 'e'; at++){
+    if(*at != '.'){digits[digitCount++] = *at;}
+  }
+  while(digitCount > 1 && digits[digitCount - 1] == '0'){digitCount--;}
+  int n = atoi(at + 1) + 1; //num is 0.digits times 10^n
+
+  if(digitCount <= n && n <= 21){ //digits, then zeros
+    memcpy(&out[written], digits, digitCount);
+    written += digitCount;
+    for(int i = digitCount; i < n; i++){out[written++] = '0';}
+  }else if(0 < n && n <= 21){ //point inside the digits
+    memcpy(&out[written], digits, n);
+    written += n;
+    out[written++] = '.';
+    memcpy(&out[written], &digits[n], digitCount - n);
+    written += digitCount - n;
+  }else if(-6 < n && n <= 0){ //0.000digits
+    out[written++] = '0';
+    out[written++] = '.';
+    for(int i = n; i < 0; i++){out[written++] = '0';}
+    memcpy(&out[written], digits, digitCount);
+    written += digitCount;
+  }else{ //d.ddde+x
+    out[written++] = digits[0];
+    if(digitCount > 1){
+      out[written++] = '.';
+      memcpy(&out[written], &digits[1], digitCount - 1);
+      written += digitCount - 1;
+    }
+    written += sprintf(&out[written], "e%c%d", n - 1 < 0 ? '-' : '+', n - 1 < 0 ? 1 - n : n - 1);
+  }
+  out[written] = '\0';
+  return written;
+}
+
+//the real chars of a string: its own, or when they still hold source escapes, a decoded copy in *decoded (free that afterwards)
+static inline const char * __internal__CanonicalChars(struct AJString * str, int storedEscaped, int * length, char ** decoded){
+  *decoded = NULL;
+  *length = str->length;
+  if(!storedEscaped || !str->Raw){return str->string;}
+  *decoded = (char *)__internal__Malloc(str->length + 1);
+  *length = __internal__UnescapeChars(str->string, str->length, *decoded);
+  return *decoded;
+}
+
+struct __internal__CanonicalMember{
+  const char * Key;
+  int KeyLength;
+  char * Decoded;
+  struct AJKeyValuePair * KVP;
+};
+
+int __internal__CompareCanonicalMembers(const void * x, const void * y){
+  const struct __internal__CanonicalMember * a = (const struct __internal__CanonicalMember *)x;
+  const struct __internal__CanonicalMember * b = (const struct __internal__CanonicalMember *)y;
+  return __internal__CompareUTF16Order(a->Key, a->KeyLength, b->Key, b->KeyLength);
+}
+
+//puts ajo's KVPs into members sorted by key, decoding the keys as needed
+void __internal__SortCanonicalKeys(struct __internal__CanonicalMember * members, struct AJObject * ajo, int storedEscaped){
+  int count = 0;
+  for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP, count++){
+    members[count].Key = __internal__CanonicalChars((struct AJString *)ajkvp->key, storedEscaped, &members[count].KeyLength, &members[count].Decoded);
+    members[count].KVP = ajkvp;
+  }
+  qsort(members, count, sizeof(struct __internal__CanonicalMember), __internal__CompareCanonicalMembers);
+}
+
+int __internal__WriteCanonical(struct AJWriter * writer, void * node, int type, int storedEscaped){
+  switch(type){
+    case TYPE_STRING:{
+      char * decoded;
+      int length;
+      const char * chars = __internal__CanonicalChars((struct AJString *)node, storedEscaped, &length, &decoded);
+      __internal__WriterEscapedString(writer, chars, length, 0);
+      __internal__Free(decoded);
+      return 1;
+    }
+    case TYPE_NUMBER:{
+      char digits[32];
+      int length = __internal__FormatCanonicalNumber(AJNumberGetDouble((struct AJNumber *)node), digits);
+      if(length < 0){return 0;}
+      __internal__WriterAppend(writer, digits, length);
+      return 1;
+    }
+    case TYPE_BOOLEAN:{
+      int truthValue = ((struct AJBoolean *)node)->TruthValue;
+      __internal__WriterAppend(writer, truthValue ? "true" : "false", truthValue ? 4 : 5);
+      return 1;
+    }
+    case TYPE_NULL:{
+      __internal__WriterAppend(writer, "null", 4);
+      return 1;
+    }
+    case TYPE_ARRAY:{
+      struct AJArray * aja = (struct AJArray *)node;
+      __internal__WriterAppend(writer, "[", 1);
+      if(aja->PackedNumbers != NULL){
+        for(int i = 0; i < aja->length; i++){
+          char digits[33];
+          int length = __internal__FormatCanonicalNumber(aja->PackedNumbers[i], &digits[1]);
+          if(length < 0){return 0;}
+          digits[0] = ',';
+          __internal__WriterAppend(writer, i == 0 ? &digits[1] : digits, i == 0 ? length : length + 1);
+        }
+      }else{
+        for(struct AJArrayElement * el = aja->FirstElement; el != NULL; el = el->NextAJElement){
+          if(el != aja->FirstElement){__internal__WriterAppend(writer, ",", 1);}
+          if(!__internal__WriteCanonical(writer, el->ArrayElement, el->ArrayElementType, storedEscaped)){return 0;}
+        }
+      }
+      __internal__WriterAppend(writer, "]", 1);
+      return 1;
+    }
+    case TYPE_OBJECT:{
+      struct AJObject * ajo = (struct AJObject *)node;
+      int count = ajo->AJKVPCount;
+      for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+        if(ajkvp->KeyType != TYPE_STRING){return 0;}
+      }
+      struct AJShape * shape = ajo->Shape;
+      struct __internal__CanonicalMember * members = NULL;
+      if(shape == NULL || !shape->HasCanonicalOrder){
+        members = (struct __internal__CanonicalMember *)__internal__Malloc(sizeof(struct __internal__CanonicalMember) * (count > 0 ? count : 1));
+        __internal__SortCanonicalKeys(members, ajo, storedEscaped);
+        if(shape != NULL){ //the same order works for every object of this shape (their KVPs are KVPBlock[0..count-1])
+          for(int i = 0; i < count; i++){shape->CanonicalOrder[i] = (int)(members[i].KVP - ajo->KVPBlock);}
+          shape->HasCanonicalOrder = 1;
+        }
+      }
+
+      int written = 1;
+      __internal__WriterAppend(writer, "{", 1);
+      for(int i = 0; i < count && written; i++){
+        if(i > 0){__internal__WriterAppend(writer, ",", 1);}
+        struct AJKeyValuePair * ajkvp;
+        if(members != NULL){
+          ajkvp = members[i].KVP;
+          __internal__WriterEscapedString(writer, members[i].Key, members[i].KeyLength, 0);
+        }else{
+          ajkvp = &ajo->KVPBlock[shape->CanonicalOrder[i]];
+          __internal__WriteCanonical(writer, ajkvp->key, TYPE_STRING, storedEscaped);
+        }
+        __internal__WriterAppend(writer, ":", 1);
+        written = __internal__WriteCanonical(writer, ajkvp->value, ajkvp->ValueType, storedEscaped);
+      }
+      if(written){__internal__WriterAppend(writer, "}", 1);}
+      if(members != NULL){
+        for(int i = 0; i < count; i++){__internal__Free(members[i].Decoded);}
+        __internal__Free(members);
+      }
+      return written;
+    }
+  }
+  return 0;
+}
+
+//writes obj in canonical form (see above) as the writer's next value. 0 if it has no canonical form, which puts the writer in error
+int AJWriterCanonicalValue(struct AJWriter * writer, void * obj, int type){
+  if(!__internal__WriterBeforeValue(writer)){return 0;}
+  if(!__internal__WriteCanonical(writer, obj, type, !AJGetContext()->EscapeStrings)){
+    writer->Error = 1;
+    return 0;
+  }
+  return 1;
+}
+
+//writes obj in canonical form into the buffer, growing it as needed. returns chars written + 1 like the other text writers,
+//0 if obj has no canonical form (whatever was written is then garbage)
+int WriteAJValueAsCanonicalStringToBuffer(void * obj, int type, char ** originalBufferPointer, int * buflength, int positionToStartWriting){
+  struct AJWriter writer; //borrows the buffer for the length of the write
+  writer.Buffer = *originalBufferPointer;
+  writer.BufferLength = *buflength;
+  writer.Position = positionToStartWriting;
+  writer.Sink = NULL;
+  writer.SinkUserPointer = NULL;
+  writer.Depth = 0;
+  writer.ExpectingValue = 0;
+  writer.HasRoot = 0;
+  writer.Error = 0;
+  __internal__WriterReserve(&writer, 0);
+  int written = __internal__WriteCanonical(&writer, obj, type, !AJGetContext()->EscapeStrings);
+  writer.Buffer[writer.Position] = '\0';
+  *originalBufferPointer = writer.Buffer;
+  *buflength = writer.BufferLength;
+  return written ? writer.Position - positionToStartWriting + 1 : 0;
+}
+
+/* Struct bindings
+For typed code that would otherwise parse into an AJObject, copy every field out with SearchObjectForKey and delete the tree:
+describe the struct once and ParseJSONIntoStruct fills it straight from the text, without making any AJ nodes. AJWriterStruct goes the
+other way, through an AJWriter.
+
+  struct Point{ double x, y; };
+  struct Shape{ long long id; char name[32]; struct Point points[16]; int pointCount; char closed; };
+
+  static struct AJFieldBinding PointFields[] = { AJ_BIND_FIELD(struct Point, x, AJ_FIELD_NUMBER), AJ_BIND_FIELD(struct Point, y, AJ_FIELD_NUMBER) };
+  static struct AJStructBinding PointBinding = AJ_STRUCT_BINDING(PointFields);
+  static struct AJFieldBinding ShapeFields[] = {
+    AJ_BIND_FIELD(struct Shape, id, AJ_FIELD_INT),
+    AJ_BIND_FIELD(struct Shape, name, AJ_FIELD_STRING),
+    AJ_BIND_ARRAY(struct Shape, points, AJ_FIELD_OBJECT, pointCount, &PointBinding),
+    AJ_BIND_FIELD_NAMED(struct Shape, closed, "isClosed", AJ_FIELD_BOOL),
+  };
+  static struct AJStructBinding ShapeBinding = AJ_STRUCT_BINDING(ShapeFields);
+
+  -AJ_FIELD_INT fits any signed integer member (char up to long long, by its size; out of range values fail), AJ_FIELD_NUMBER a float
+   or double, AJ_FIELD_BOOL any integer member (1 / 0). AJ_FIELD_STRING is a char array: the string is decoded (escapes turned into the
+   real chars) and null terminated, and one that doesnt fit fails the parse instead of being cut short.
+  -AJ_BIND_ARRAY fills a fixed size C array and stores how many elements it got in an int member. More elements than fit fail.
+  -fields missing from the text, and nulls, leave the member as it was (so zero the struct first). Unknown keys are skipped.
+  -keys are found through a perfect hash over the field names: a seed that gives every name its own slot is searched for once, by
+   AJPrepareStructBinding (or the first parse). After that each key costs one hash, one load and one compare. Prepare shared bindings
+   before using them from several threads.
+  -AJPrepareStructBinding also checks the binding: AJ_FIELD_NUMBER members have to be 4 or 8 bytes (float or double) and every
+   AJ_FIELD_OBJECT (or array of them) needs its Nested binding. A binding that fails that fails every parse and write.
+  -numbers have to follow the JSON grammar (no '+', no leading zeros, no hex, no 'inf'), and AJ_FIELD_INT values past long long fail.*/
+
+#define AJ_FIELD_INT 1
+#define AJ_FIELD_NUMBER 2
+#define AJ_FIELD_BOOL 3
+#define AJ_FIELD_STRING 4
+#define AJ_FIELD_OBJECT 5
+#define AJ_FIELD_ARRAY 6
+#define AJ_MAX_BOUND_FIELDS 64 //bindings with more fields look keys up by walking the fields
+
+struct AJStructBinding;
+
+struct AJFieldBinding{
+  const char * Name; //the JSON key
+  int NameLength;
+  int Type; //AJ_FIELD_*
+  size_t Offset;
+  size_t Size; //of the member, or of one element for AJ_FIELD_ARRAY
+  struct AJStructBinding * Nested; //AJ_FIELD_OBJECT (or an array of them)
+  int ElementType; //AJ_FIELD_ARRAY: AJ_FIELD_* of the elements
+  int Capacity; //AJ_FIELD_ARRAY: elements that fit
+  size_t CountOffset; //AJ_FIELD_ARRAY: where the int element count goes
+};
+
+struct AJStructBinding{
+  struct AJFieldBinding * Fields;
+  int FieldCount;
+  int Ready; //0: not prepared yet, 1: Slots is a perfect hash, -1: no perfect hash, fields are walked, -2: broken (see AJPrepareStructBinding)
+  unsigned int Seed;
+  int SlotMask;
+  unsigned char Slots[8 * AJ_MAX_BOUND_FIELDS]; //field index + 1, 0 means empty
+};
+
+#define AJ_BIND_FIELD_NAMED(structType, member, jsonName, fieldType) \
+  {jsonName, sizeof(jsonName) - 1, fieldType, offsetof(structType, member), sizeof(((structType *)0)->member), NULL, 0, 0, 0}
+#define AJ_BIND_FIELD(structType, member, fieldType) AJ_BIND_FIELD_NAMED(structType, member, #member, fieldType)
+#define AJ_BIND_OBJECT(structType, member, binding) \
+  {#member, sizeof(#member) - 1, AJ_FIELD_OBJECT, offsetof(structType, member), sizeof(((structType *)0)->member), binding, 0, 0, 0}
+#define AJ_BIND_ARRAY(structType, member, elementType, countMember, binding) \
+  {#member, sizeof(#member) - 1, AJ_FIELD_ARRAY, offsetof(structType, member), sizeof(((structType *)0)->member[0]), binding, elementType, \
+   (int)(sizeof(((structType *)0)->member) / sizeof(((structType *)0)->member[0])), offsetof(structType, countMember)}
+#define AJ_STRUCT_BINDING(fields) {fields, (int)(sizeof(fields) / sizeof(fields[0])), 0, 0, 0, {0}}
+
+static inline unsigned int __internal__FieldHash(const char * name, int length, unsigned int seed){
+  return __internal__HashBytes(name, length, AJ_FNV_OFFSET_BASIS ^ (seed * 0x9E3779B1u));
+}
+
+//checks the fields and finds a seed that puts every field name in its own slot (for nested bindings too).
+//returns 0 if the binding cant work: a number member that isnt a float or double, or an object field without a Nested binding
+int AJPrepareStructBinding(struct AJStructBinding * binding){
+  if(binding->Ready != 0){return binding->Ready != -2;}
+  binding->Ready = -2; //until the checks below pass
+  for(int i = 0; i < binding->FieldCount; i++){
+    struct AJFieldBinding * field = &binding->Fields[i];
+    int type = field->Type == AJ_FIELD_ARRAY ? field->ElementType : field->Type;
+    if(type == AJ_FIELD_NUMBER && field->Size != sizeof(float) && field->Size != sizeof(double)){return 0;}
+    if(type == AJ_FIELD_OBJECT && field->Nested == NULL){return 0;}
+    if(field->Nested != NULL && !AJPrepareStructBinding(field->Nested)){return 0;}
+  }
+  binding->Ready = -1;
+  if(binding->FieldCount > AJ_MAX_BOUND_FIELDS){return 1;}
+  for(int slotCount = 8; slotCount <= 8 * AJ_MAX_BOUND_FIELDS; slotCount *= 2){
+    if(slotCount < binding->FieldCount * 2){continue;}
+    for(unsigned int seed = 1; seed <= 512; seed++){
+      memset(binding->Slots, 0, sizeof(binding->Slots));
+      int i = 0;
+      for(; i < binding->FieldCount; i++){
+        int slot = __internal__FieldHash(binding->Fields[i].Name, binding->Fields[i].NameLength, seed) & (slotCount - 1);
+        if(binding->Slots[slot] != 0){break;}
+        binding->Slots[slot] = (unsigned char)(i + 1);
+      }
+      if(i == binding->FieldCount){
+        binding->Seed = seed;
+        binding->SlotMask = slotCount - 1;
+        binding->Ready = 1;
+        return 1;
+      }
+    }
+  }
+  return 1;
+}
+
+struct AJFieldBinding * __internal__FindBoundField(struct AJStructBinding * binding, const char * key, int length){
+  if(binding->Ready == 1){
+    int f = binding->Slots[__internal__FieldHash(key, length, binding->Seed) & binding->SlotMask];
+    if(f == 0){return NULL;}
+    struct AJFieldBinding * field = &binding->Fields[f - 1];
+    return field->NameLength == length && memcmp(field->Name, key, length) == 0 ? field : NULL;
+  }
+  for(int i = 0; i < binding->FieldCount; i++){
+    if(binding->Fields[i].NameLength == length && memcmp(binding->Fields[i].Name, key, length) == 0){return &binding->Fields[i];}
+  }
+  return NULL;
+}
+
+static inline int __internal__SkipSpace(const char * s, int i){
+  while(s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r'){i++;}
+  return i;
+}
+
+//length of the JSON number at s[i] (-?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?), 0 if there isnt a valid one there
+int __internal__JSONNumberLength(const char * s, int i){
+  int start = i;
+  if(s[i] == '-'){i++;}
+  if(s[i] == '0'){
+    i++;
+  }else if(s[i] >= '1' && s[i] <= '9'){
+    while(s[i] >= '0' && s[i] <= '9'){i++;}
+  }else{
+    return 0;
+  }
+  if(s[i] == '.'){
+    i++;
+    if(s[i] < '0' || s[i] > '9'){return 0;}
+    while(s[i] >= '0' && s[i] <= '9'){i++;}
+  }
+  if(s[i] == 'e' || s[i] == 'E'){
+    i++;
+    if(s[i] == '+' || s[i] == '-'){i++;}
+    if(s[i] < '0' || s[i] > '9'){return 0;}
+    while(s[i] >= '0' && s[i] <= '9'){i++;}
+  }
+  return i - start;
+}
+
+//index of the closing quote of the string opening at s[i], -1 if there isnt one
+int __internal__FindClosingQuote(const char * s, int i){
+  for(i++; s[i] != '\0' && s[i] != '"'; i++){
+    if(s[i] == '\\' && s[i + 1] != '\0'){i++;}
+  }
+  return s[i] == '"' ? i : -1;
+}
+
+//index right after the value starting at s[i], -1 if it is broken
+int __internal__SkipJSONValue(const char * s, int i){
+  if(s[i] == '"'){
+    int end = __internal__FindClosingQuote(s, i);
+    return end < 0 ? -1 : end + 1;
+  }
+  if(s[i] == '{' || s[i] == '['){
+    int depth = 0;
+    do{
+      if(s[i] == '\0'){return -1;}
+      if(s[i] == '"'){
+        i = __internal__FindClosingQuote(s, i);
+        if(i < 0){return -1;}
+      }else if(s[i] == '{' || s[i] == '['){
+        depth++;
+      }else if(s[i] == '}' || s[i] == ']'){
+        depth--;
+      }
+      i++;
+    }while(depth > 0);
+    return i;
+  }
+  int start = i;
+  while(s[i] != '\0' && s[i] != ',' && s[i] != '}' && s[i] != ']' && s[i] != ' ' && s[i] != '\t' && s[i] != '\n' && s[i] != '\r'){i++;}
+  return i == start ? -1 : i;
+}
+
+//stores v in an integer member of size bytes. 0 if it doesnt fit
+static inline int __internal__StoreBoundInt(char * dest, size_t size, long long v){
+  switch(size){
+    case 1:{ if(v < -128 || v > 127){return 0;} signed char x = (signed char)v; memcpy(dest, &x, 1); return 1; }
+    case 2:{ if(v < -32768 || v > 32767){return 0;} short x = (short)v; memcpy(dest, &x, 2); return 1; }
+    case 4:{ if(v < -2147483647LL - 1 || v > 2147483647LL){return 0;} int x = (int)v; memcpy(dest, &x, 4); return 1; }
+    case 8:{ memcpy(dest, &v, 8); return 1; }
+  }
+  return 0;
+}
+
+static inline long long __internal__LoadBoundInt(const char * src, size_t size){
+  switch(size){
+    case 1:{ signed char x; memcpy(&x, src, 1); return x; }
+    case 2:{ short x; memcpy(&x, src, 2); return x; }
+    case 4:{ int x; memcpy(&x, src, 4); return x; }
+    case 8:{ long long x; memcpy(&x, src, 8); return x; }
+  }
+  return 0;
+}
+
+int __internal__ParseStructFields(struct AJStructBinding * binding, char * out, const char * s, int * idx);
+
+//parses the value at s[*idx] into dest as a (type, size) member. moves *idx past it; 0 if it doesnt fit the member
+int __internal__ParseBoundValue(struct AJFieldBinding * field, int type, size_t size, char * dest, const char * s, int * idx){
+  int i = *idx;
+  if(strncmp(&s[i], "null", 4) == 0){ //same as leaving it out
+    *idx = i + 4;
+    return 1;
+  }
+  switch(type){
+    case AJ_FIELD_INT:{
+      int length = __internal__JSONNumberLength(s, i);
+      if(length == 0){return 0;}
+      char * end;
+      errno = 0;
+      long long v = strtoll(&s[i], &end, 10);
+      if(errno == ERANGE || end != &s[i + length]){return 0;} //too big for long long, or it has a fraction / exponent
+      *idx = i + length;
+      return __internal__StoreBoundInt(dest, size, v);
+    }
+    case AJ_FIELD_NUMBER:{
+      int length = __internal__JSONNumberLength(s, i);
+      if(length == 0 || (size != sizeof(float) && size != sizeof(double))){return 0;}
+      double v = strtod(&s[i], NULL);
+      *idx = i + length;
+      if(size == sizeof(float)){
+        float x = (float)v;
+        memcpy(dest, &x, sizeof(float));
+      }else{
+        memcpy(dest, &v, sizeof(double));
+      }
+      return 1;
+    }
+    case AJ_FIELD_BOOL:{
+      int truthValue = strncmp(&s[i], "true", 4) == 0;
+      if(!truthValue && strncmp(&s[i], "false", 5) != 0){return 0;}
+      *idx = i + (truthValue ? 4 : 5);
+      return __internal__StoreBoundInt(dest, size, truthValue);
+    }
+    case AJ_FIELD_STRING:{
+      if(s[i] != '"'){return 0;}
+      int end = __internal__FindClosingQuote(s, i);
+      if(end < 0){return 0;}
+      int rawLength = end - i - 1;
+      *idx = end + 1;
+      if((size_t)rawLength < size){ //decoding never makes it longer
+        dest[__internal__UnescapeChars(&s[i + 1], rawLength, dest)] = '\0';
+        return 1;
+      }
+      char * decoded = (char *)__internal__Malloc(rawLength);
+      int length = __internal__UnescapeChars(&s[i + 1], rawLength, decoded);
+      int fits = (size_t)length < size;
+      if(fits){
+        memcpy(dest, decoded, length);
+        dest[length] = '\0';
+      }
+      __internal__Free(decoded);
+      return fits;
+    }
+    case AJ_FIELD_OBJECT:{
+      if(s[i] != '{'){return 0;}
+      return __internal__ParseStructFields(field->Nested, dest, s, idx);
+    }
+    case AJ_FIELD_ARRAY:{
+      if(s[i] != '[' || field->ElementType == AJ_FIELD_ARRAY){return 0;}
+      int count = 0;
+      i = __internal__SkipSpace(s, i + 1);
+      while(s[i] != ']'){
+        if(count == field->Capacity){return 0;}
+        if(!__internal__ParseBoundValue(field, field->ElementType, size, dest + size * count, s, &i)){return 0;}
+        count++;
+        i = __internal__SkipSpace(s, i);
+        if(s[i] == ','){
+          i = __internal__SkipSpace(s, i + 1);
+          if(s[i] == ']'){return 0;} //no trailing commas
+        }else if(s[i] != ']'){
+          return 0;
+        }
+      }
+      *idx = i + 1;
+      memcpy(dest - field->Offset + field->CountOffset, &count, sizeof(int));
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//fills out from the object opening at s[*idx]. moves *idx past it
+int __internal__ParseStructFields(struct AJStructBinding * binding, char * out, const char * s, int * idx){
+  int i = __internal__SkipSpace(s, *idx + 1);
+  while(s[i] != '}'){
+    if(s[i] != '"'){return 0;}
+    int keyEnd = __internal__FindClosingQuote(s, i);
+    if(keyEnd < 0){return 0;}
+    const char * key = &s[i + 1];
+    int keyLength = keyEnd - i - 1;
+    char decodedKey[64];
+    if(memchr(key, '\\', keyLength) != NULL && keyLength <= (int)sizeof(decodedKey)){ //field names are plain chars
+      keyLength = __internal__UnescapeChars(key, keyLength, decodedKey);
+      key = decodedKey;
+    }
+    struct AJFieldBinding * field = __internal__FindBoundField(binding, key, keyLength);
+    i = __internal__SkipSpace(s, keyEnd + 1);
+    if(s[i] != ':'){return 0;}
+    i = __internal__SkipSpace(s, i + 1);
+    if(field == NULL){
+      i = __internal__SkipJSONValue(s, i);
+      if(i < 0){return 0;}
+    }else if(!__internal__ParseBoundValue(field, field->Type, field->Size, out + field->Offset, s, &i)){
+      return 0;
+    }
+    i = __internal__SkipSpace(s, i);
+    if(s[i] == ','){
+      i = __internal__SkipSpace(s, i + 1);
+      if(s[i] == '}'){return 0;} //no trailing commas
+    }else if(s[i] != '}'){
+      return 0;
+    }
+  }
+  *idx = i + 1;
+  return 1;
+}
+
+//fills the struct at out (described by binding) from the JSON object opening at JSONString[indexOfOpeningBracket], without making
+//an AJObject. returnIdx gets the index right after it. returns 1, or 0 if the text is broken or doesnt fit the struct; out may
+//be partly filled then.
+int ParseJSONIntoStruct(struct AJStructBinding * binding, void * out, int indexOfOpeningBracket, char * JSONString, int * returnIdx){
+  if(!AJPrepareStructBinding(binding)){return 0;}
+  int i = __internal__SkipSpace(JSONString, indexOfOpeningBracket);
+  if(JSONString[i] != '{'){return 0;}
+  int done = __internal__ParseStructFields(binding, (char *)out, JSONString, &i);
+  if(done && returnIdx != NULL){*returnIdx = i;}
+  return done;
+}
+
+int AJWriterStruct(struct AJWriter * writer, struct AJStructBinding * binding, void * in);
+
+int __internal__WriteBoundValue(struct AJWriter * writer, struct AJFieldBinding * field, int type, size_t size, char * src){
+  switch(type){
+    case AJ_FIELD_INT: return AJWriterInt64(writer, __internal__LoadBoundInt(src, size));
+    case AJ_FIELD_NUMBER:{
+      if(size == sizeof(float)){
+        float x;
+        memcpy(&x, src, sizeof(float));
+        return AJWriterDouble(writer, x);
+      }
+      if(size != sizeof(double)){return 0;}
+      double x;
+      memcpy(&x, src, sizeof(double));
+      return AJWriterDouble(writer, x);
+    }
+    case AJ_FIELD_BOOL: return AJWriterBoolean(writer, __internal__LoadBoundInt(src, size) != 0);
+    case AJ_FIELD_STRING:{
+      char * terminator = (char *)memchr(src, '\0', size);
+      return AJWriterStringWithLength(writer, src, terminator != NULL ? (int)(terminator - src) : (int)size);
+    }
+    case AJ_FIELD_OBJECT: return AJWriterStruct(writer, field->Nested, src);
+    case AJ_FIELD_ARRAY:{
+      int count;
+      memcpy(&count, src - field->Offset + field->CountOffset, sizeof(int));
+      if(count > field->Capacity){count = field->Capacity;}
+      AJWriterBeginArray(writer);
+      for(int i = 0; i < count; i++){
+        __internal__WriteBoundValue(writer, field, field->ElementType, size, src + size * i);
+      }
+      return AJWriterEndArray(writer);
+    }
+  }
+  return 0;
+}
+
+//writes the struct at in (described by binding) as the writer's next value: an object with every bound field. 0 if the writer is in error
+//(a broken binding, see AJPrepareStructBinding, puts it in error)
+int AJWriterStruct(struct AJWriter * writer, struct AJStructBinding * binding, void * in){
+  if(!AJPrepareStructBinding(binding)){
+    writer->Error = 1;
+    return 0;
+  }
+  AJWriterBeginObject(writer);
+  for(int i = 0; i < binding->FieldCount; i++){
+    struct AJFieldBinding * field = &binding->Fields[i];
+    AJWriterKeyWithLength(writer, (char *)field->Name, field->NameLength);
+    __internal__WriteBoundValue(writer, field, field->Type, field->Size, (char *)in + field->Offset);
+  }
+  return AJWriterEndObject(writer);
+}
+
+/* Schemas
+CompileAJSchema turns a JSON Schema (a parsed AJObject) into one flat program: an array of nodes, a hash index per node for finding
+the subschema of each key, and required keys as bits. AJValidate runs it over a tree. AJValidateText runs it straight over the text,
+checking the syntax on the way (strictly: no leading zeros, control chars or unknown escapes in strings), and gives up at the first
+thing that fails - so ParseNewAJObjectValidated only makes nodes for documents that are valid.
+  -keywords: type (with "integer"), enum, const, minimum, maximum, exclusiveMinimum / exclusiveMaximum (numbers, or draft 4 booleans),
+   multipleOf, minLength, maxLength, pattern, items (one schema for every element), minItems, maxItems, properties, required,
+   additionalProperties, minProperties, maxProperties, allOf, anyOf, oneOf, not, $ref to a "#/json/pointer" in the same schema
+   (recursive schemas are fine), and true / false as schemas. Keywords it doesnt know (title, description, $schema, ...) are skipped,
+   but the ones that would change the result and arent supported (patternProperties, uniqueItems, dependencies, dependentRequired,
+   if / then / else, contains, propertyNames, prefixItems...) make CompileAJSchema return NULL instead of being ignored.
+  -keys are matched the way they are stored, so schema and documents should be parsed with the same AJContext->EscapeStrings.
+   minLength / maxLength count code points and patterns see the decoded string either way.
+  -patterns are POSIX extended regexes plus \d \w \s (and \D \W \S outside brackets). Patterns ERE cant do (lookarounds, lazy
+   quantifiers, backreferences) make CompileAJSchema return NULL, as does any pattern when regex.h isnt there (see AJ_HAVE_REGEX).
+   So does anything else it cant compile: a $ref that isnt local, items as an array, a keyword with the wrong type.
+  -AJValidateText doesnt build a tree, but it isnt allocation free: it parses the value (only that value) when it has to compare an
+   array or object to an enum or const, decodes keys with escapes (EscapeStrings on), and copies strings of 256 bytes or more that
+   have escapes or a pattern to check.
+  -multipleOf is exact for whole divisors. For others the quotient has to be within 1e-9 (relative) of a whole number, as 0.3 / 0.1
+   isnt quite 3.
+  -a compiled schema is only read while validating, so threads can share one. Delete it with the context it was made under. */
+
+#define AJ_SCHEMA_INTEGER (1 << 6) //"integer" type bit, next to the 1 << TYPE_* ones
+#define AJ_SCHEMA_ALL_TYPES ((1 << 7) - 1)
+#define AJ_SCHEMA_ANYTHING -1 //subschema index of true and of keywords that arent there
+#define AJ_SCHEMA_NOTHING -2 //subschema index of false
+#define AJ_SCHEMA_INVALID -3 //couldnt compile it
+#define AJ_SCHEMA_UNLISTED -4 //property entry of a required key missing from properties: its value goes to additionalProperties
+
+#define AJ_SCHEMA_MINIMUM 1 //SchemaNode->Bounds bits
+#define AJ_SCHEMA_MAXIMUM 2
+#define AJ_SCHEMA_EXCLUSIVE_MINIMUM 4
+#define AJ_SCHEMA_EXCLUSIVE_MAXIMUM 8
+#define AJ_SCHEMA_MULTIPLE_OF 16
+
+struct __internal__SchemaNode{
+  int Types; //1 << TYPE_* bits and AJ_SCHEMA_INTEGER
+  int Bounds;
+  double Minimum, Maximum, ExclusiveMinimum, ExclusiveMaximum, MultipleOf;
+  int MinLength, MaxLength, MinItems, MaxItems, MinProperties, MaxProperties; //-1: none
+  int Pattern; //into AJSchema->Patterns, -1: none
+  int FirstEnum, EnumCount; //into AJSchema->Values. EnumCount -1: no enum
+  int Const; //into AJSchema->Values, -1: none
+  int Items, AdditionalProperties, Ref; //subschemas
+  int Not; //subschema, only if HasNot
+  char HasNot;
+  char LooksInside; //has keywords about elements or members, so a tree walk has to visit them
+  int FirstProperty, PropertyCount, RequiredCount; //into AJSchema->Properties. required ones have RequiredBit 0..RequiredCount-1
+  int FirstSlot, SlotMask; //hash index over the properties, into AJSchema->Slots
+  int FirstSub, AllOfCount, AnyOfCount, OneOfCount; //into AJSchema->Subs: the allOf ones, then anyOf, then oneOf
+};
+
+struct __internal__SchemaProperty{
+  int NameOffset, NameLength; //into AJSchema->Names
+  int Node; //subschema or AJ_SCHEMA_UNLISTED
+  int RequiredBit; //-1: not required
+};
+
+struct __internal__SchemaValue{ //an enum or const value (a copy)
+  void * Node;
+  int Type;
+};
+
+struct AJSchema{
+  struct __internal__SchemaNode * Nodes;
+  int NodeCount, NodeCapacity;
+  struct __internal__SchemaProperty * Properties;
+  int PropertyCount, PropertyCapacity;
+  int * Slots; //property index (within its node) + 1, 0 is empty
+  int SlotCount, SlotCapacity;
+  int * Subs;
+  int SubCount, SubCapacity;
+  struct __internal__SchemaValue * Values;
+  int ValueCount, ValueCapacity;
+  void ** Patterns; //regex_t *s
+  int PatternCount, PatternCapacity;
+  char * Names;
+  int NamesLength, NamesCapacity;
+  int Root;
+};
+
+struct __internal__CompiledSchema{
+  struct AJObject * Object;
+  int Node;
+};
+
+struct __internal__SchemaCompiler{
+  struct AJSchema * Schema;
+  struct AJObject * Document; //the whole schema, for $ref
+  struct __internal__CompiledSchema * Compiled; //schema objects that already have a node, so shared subschemas and $ref loops compile once
+  int CompiledCount, CompiledCapacity;
+};
+
+//room for extra more elements of size bytes in array (count used, *capacity allocated)
+static inline void * __internal__GrowArray(void * array, int count, int * capacity, int extra, size_t size){
+  if(count + extra <= *capacity){return array;}
+  int newCapacity = *capacity < 8 ? 8 : *capacity;
+  while(newCapacity < count + extra){newCapacity *= 2;}
+  *capacity = newCapacity;
+  return __internal__Realloc(array, size * newCapacity);
+}
+
+int __internal__NewSchemaNode(struct AJSchema * schema){
+  schema->Nodes = (struct __internal__SchemaNode *)__internal__GrowArray(schema->Nodes, schema->NodeCount, &schema->NodeCapacity, 1, sizeof(struct __internal__SchemaNode));
+  struct __internal__SchemaNode * pelumi = &schema->Nodes[schema->NodeCount];
+  memset(pelumi, 0, sizeof(struct __internal__SchemaNode));
+  pelumi->Types = AJ_SCHEMA_ALL_TYPES;
+  pelumi->MinLength = pelumi->MaxLength = pelumi->MinItems = pelumi->MaxItems = pelumi->MinProperties = pelumi->MaxProperties = -1;
+  pelumi->Pattern = pelumi->EnumCount = pelumi->Const = -1;
+  pelumi->Items = pelumi->AdditionalProperties = pelumi->Ref = AJ_SCHEMA_ANYTHING;
+  return schema->NodeCount++;
+}
+
+int __internal__AddSchemaValue(struct AJSchema * schema, void * value, int type){
+  schema->Values = (struct __internal__SchemaValue *)__internal__GrowArray(schema->Values, schema->ValueCount, &schema->ValueCapacity, 1, sizeof(struct __internal__SchemaValue));
+  schema->Values[schema->ValueCount].Node = AJClone(value, type);
+  schema->Values[schema->ValueCount].Type = type;
+  return schema->ValueCount++;
+}
+
+//the value of keyword in a schema object if it is there with the wanted type (-1: any type, given back in *type)
+static inline void * __internal__SchemaKeyword(struct AJObject * ajo, const char * keyword, int wantedType, int * type){
+  struct AJKeyValuePair * ajkvp = SearchObjectForKey((char *)keyword, ajo);
+  if(ajkvp == NULL || (wantedType >= 0 && ajkvp->ValueType != wantedType)){return NULL;}
+  if(type != NULL){*type = ajkvp->ValueType;}
+  return ajkvp->value;
+}
+
+//-1 when the keyword isnt there, -2 when it isnt a whole number >= 0
+int __internal__SchemaCount(struct AJObject * ajo, const char * keyword){
+  int type;
+  void * value = __internal__SchemaKeyword(ajo, keyword, -1, &type);
+  if(value == NULL){return -1;}
+  if(type != TYPE_NUMBER){return -2;}
+  double count = AJNumberGetDouble((struct AJNumber *)value);
+  return count >= 0 && count <= 2147483647.0 && count == (double)(int)count ? (int)count : -2;
+}
+
+static inline int __internal__SchemaTypeBit(struct AJString * name){
+  if(compareStringToAJString("object", name)){return 1 << TYPE_OBJECT;}
+  if(compareStringToAJString("array", name)){return 1 << TYPE_ARRAY;}
+  if(compareStringToAJString("string", name)){return 1 << TYPE_STRING;}
+  if(compareStringToAJString("number", name)){return (1 << TYPE_NUMBER) | AJ_SCHEMA_INTEGER;}
+  if(compareStringToAJString("integer", name)){return AJ_SCHEMA_INTEGER;}
+  if(compareStringToAJString("boolean", name)){return 1 << TYPE_BOOLEAN;}
+  if(compareStringToAJString("null", name)){return 1 << TYPE_NULL;}
+  return 0;
+}
+
+#ifdef AJ_HAVE_REGEX
+//rewrites an ECMAScript regex as a POSIX extended one. NULL if it uses something ERE doesnt have
+char * __internal__PatternToERE(const char * p, int length){
+  char * ere = (char *)__internal__Malloc(length * 7 + 1); //\W -> [^A-Za-z0-9_] is the most a char can grow
+  int n = 0;
+  int inBrackets = 0;
+  int supported = 1;
+  for(int i = 0; i < length; i++){
+    char ch = p[i];
+    if(ch != '\\'){
+      if(!inBrackets && i + 1 < length && p[i + 1] == '?' && (ch == '(' || ch == '*' || ch == '+' || ch == '?' || ch == '}')){
+        supported = 0; //(?: (?= (?<name> and lazy quantifiers
+        break;
+      }
+      if(ch == '[' && !inBrackets){
+        inBrackets = 1;
+        ere[n++] = ch;
+        if(i + 1 < length && p[i + 1] == '^'){ere[n++] = p[++i];}
+        if(i + 1 < length && p[i + 1] == ']'){ //[] and [^] mean something else in ERE
+          supported = 0;
+          break;
+        }
+        continue;
+      }
+      if(ch == ']'){inBrackets = 0;}
+      ere[n++] = ch;
+      continue;
+    }
+    if(++i == length){
+      supported = 0;
+      break;
+    }
+    char escaped = p[i];
+    const char * replacement = NULL;
+    switch(escaped){
+      case 'd': replacement = inBrackets ? "0-9" : "[0-9]"; break;
+      case 'w': replacement = inBrackets ? "A-Za-z0-9_" : "[A-Za-z0-9_]"; break;
+      case 's': replacement = inBrackets ? "[:space:]" : "[[:space:]]"; break;
+      case 'D': replacement = inBrackets ? NULL : "[^0-9]"; break;
+      case 'W': replacement = inBrackets ? NULL : "[^A-Za-z0-9_]"; break;
+      case 'S': replacement = inBrackets ? NULL : "[^[:space:]]"; break;
+      case 'n': replacement = "\n"; break;
+      case 'r': replacement = "\r"; break;
+      case 't': replacement = "\t"; break;
+    }
+    if(replacement != NULL){
+      int replacementLength = strlen(replacement);
+      memcpy(&ere[n], replacement, replacementLength);
+      n += replacementLength;
+    }else if((escaped >= 'a' && escaped <= 'z') || (escaped >= 'A' && escaped <= 'Z') || (escaped >= '0' && escaped <= '9')){
+      supported = 0; //\b, \1, \uXXXX, and \D \W \S inside brackets
+      break;
+    }else if(inBrackets){ //a backslash is a plain char inside ERE brackets
+      if(escaped == ']' || escaped == '\\' || escaped == '-' || escaped == '^'){
+        supported = 0;
+        break;
+      }
+      ere[n++] = escaped;
+    }else{
+      if(strchr(".[]()*+?{}|^$\\", escaped) != NULL){ere[n++] = '\\';}
+      ere[n++] = escaped;
+    }
+  }
+  if(!supported || inBrackets){
+    __internal__Free(ere);
+    return NULL;
+  }
+  ere[n] = '\0';
+  return ere;
+}
+#endif
+
+//compiles the "pattern" string. -1 if it cant
+int __internal__CompileSchemaPattern(struct AJSchema * schema, struct AJString * pattern){
+#ifdef AJ_HAVE_REGEX
+  char * decoded = (char *)__internal__Malloc(pattern->length + 1);
+  int length = pattern->length;
+  if(!pattern->Raw){
+    memcpy(decoded, pattern->string, length);
+  }else{
+    length = __internal__UnescapeChars(pattern->string, pattern->length, decoded);
+  }
+  char * ere = __internal__PatternToERE(decoded, length);
+  __internal__Free(decoded);
+  if(ere == NULL){return -1;}
+  regex_t * compiled = (regex_t *)__internal__Malloc(sizeof(regex_t));
+  int failed = regcomp(compiled, ere, REG_EXTENDED | REG_NOSUB);
+  __internal__Free(ere);
+  if(failed){
+    __internal__Free(compiled);
+    return -1;
+  }
+  schema->Patterns = (void **)__internal__GrowArray(schema->Patterns, schema->PatternCount, &schema->PatternCapacity, 1, sizeof(void *));
+  schema->Patterns[schema->PatternCount] = compiled;
+  return schema->PatternCount++;
+#else
+  return -1;
+#endif
+}
+
+int __internal__CompileSchema(struct __internal__SchemaCompiler * compiler, void * node, int type);
+
+//compiles the schemas in aja into out. 0 on error
+int __internal__CompileSchemaList(struct __internal__SchemaCompiler * compiler, struct AJArray * aja, int * out){
+  if(aja->PackedNumbers != NULL){return 0;}
+  for(struct AJArrayElement * el = aja->FirstElement; el != NULL; el = el->NextAJElement){
+    *out = __internal__CompileSchema(compiler, el->ArrayElement, el->ArrayElementType);
+    if(*out++ == AJ_SCHEMA_INVALID){return 0;}
+  }
+  return 1;
+}
+
+//properties and required, into pelumi (a node being compiled). 0 on error
+int __internal__CompileSchemaProperties(struct __internal__SchemaCompiler * compiler, struct __internal__SchemaNode * pelumi, struct AJObject * properties, struct AJArray * required){
+  struct AJSchema * schema = compiler->Schema;
+  int most = (properties != NULL ? properties->AJKVPCount : 0) + (required != NULL ? required->length : 0);
+  if(most == 0){return 1;}
+  //collected here first: compiling the subschemas adds other nodes' properties to schema->Properties
+  struct __internal__SchemaProperty * list = (struct __internal__SchemaProperty *)__internal__Malloc(sizeof(struct __internal__SchemaProperty) * most);
+  int listed = 0;
+  int ok = 1;
+  for(struct AJKeyValuePair * ajkvp = properties != NULL ? properties->FirstAJKVP : NULL; ajkvp != NULL && ok; ajkvp = ajkvp->NextAJKVP){
+    struct AJString * name = (struct AJString *)ajkvp->key;
+    int node = __internal__CompileSchema(compiler, ajkvp->value, ajkvp->ValueType);
+    ok = node != AJ_SCHEMA_INVALID;
+    schema->Names = (char *)__internal__GrowArray(schema->Names, schema->NamesLength, &schema->NamesCapacity, name->length, 1);
+    memcpy(&schema->Names[schema->NamesLength], name->string, name->length);
+    list[listed].NameOffset = schema->NamesLength;
+    list[listed].NameLength = name->length;
+    list[listed].Node = node;
+    list[listed++].RequiredBit = -1;
+    schema->NamesLength += name->length;
+  }
+  if(required != NULL && required->PackedNumbers != NULL){ok = 0;}
+  for(struct AJArrayElement * el = required != NULL ? required->FirstElement : NULL; el != NULL && ok; el = el->NextAJElement){
+    if(el->ArrayElementType != TYPE_STRING){
+      ok = 0;
+      break;
+    }
+    struct AJString * name = (struct AJString *)el->ArrayElement;
+    int found = 0;
+    while(found < listed && (list[found].NameLength != name->length || memcmp(&schema->Names[list[found].NameOffset], name->string, name->length) != 0)){found++;}
+    if(found == listed){
+      schema->Names = (char *)__internal__GrowArray(schema->Names, schema->NamesLength, &schema->NamesCapacity, name->length, 1);
+      memcpy(&schema->Names[schema->NamesLength], name->string, name->length);
+      list[listed].NameOffset = schema->NamesLength;
+      list[listed].NameLength = name->length;
+      list[listed].Node = AJ_SCHEMA_UNLISTED;
+      list[listed++].RequiredBit = -1;
+      schema->NamesLength += name->length;
+    }
+    if(list[found].RequiredBit < 0){ //listed twice is still one key
+      list[found].RequiredBit = pelumi->RequiredCount++;
+    }
+  }
+  if(ok){
+    schema->Properties = (struct __internal__SchemaProperty *)__internal__GrowArray(schema->Properties, schema->PropertyCount, &schema->PropertyCapacity, listed, sizeof(struct __internal__SchemaProperty));
+    memcpy(&schema->Properties[schema->PropertyCount], list, sizeof(struct __internal__SchemaProperty) * listed);
+    pelumi->FirstProperty = schema->PropertyCount;
+    pelumi->PropertyCount = listed;
+    schema->PropertyCount += listed;
+
+    int slotCount = 2;
+    while(slotCount < listed * 2){slotCount *= 2;}
+    schema->Slots = (int *)__internal__GrowArray(schema->Slots, schema->SlotCount, &schema->SlotCapacity, slotCount, sizeof(int));
+    int * slots = &schema->Slots[schema->SlotCount];
+    memset(slots, 0, sizeof(int) * slotCount);
+    for(int i = 0; i < listed; i++){
+      int slot = __internal__HashBytes(&schema->Names[list[i].NameOffset], list[i].NameLength, AJ_FNV_OFFSET_BASIS) & (slotCount - 1);
+      while(slots[slot] != 0){slot = (slot + 1) & (slotCount - 1);}
+      slots[slot] = i + 1;
+    }
+    pelumi->FirstSlot = schema->SlotCount;
+    pelumi->SlotMask = slotCount - 1;
+    schema->SlotCount += slotCount;
+  }
+  __internal__Free(list);
+  return ok;
+}
+
+//compiles one schema (an object or a boolean) and everything under it. gives back its node index, AJ_SCHEMA_ANYTHING / NOTHING
+//for true / false, or AJ_SCHEMA_INVALID
+int __internal__CompileSchema(struct __internal__SchemaCompiler * compiler, void * node, int type){
+  if(type == TYPE_BOOLEAN){return ((struct AJBoolean *)node)->TruthValue ? AJ_SCHEMA_ANYTHING : AJ_SCHEMA_NOTHING;}
+  if(type != TYPE_OBJECT){return AJ_SCHEMA_INVALID;}
+  struct AJObject * ajo = (struct AJObject *)node;
+  for(int i = 0; i < compiler->CompiledCount; i++){
+    if(compiler->Compiled[i].Object == ajo){return compiler->Compiled[i].Node;}
+  }
+  struct AJSchema * schema = compiler->Schema;
+  int index = __internal__NewSchemaNode(schema);
+  compiler->Compiled = (struct __internal__CompiledSchema *)__internal__GrowArray(compiler->Compiled, compiler->CompiledCount, &compiler->CompiledCapacity, 1, sizeof(struct __internal__CompiledSchema));
+  compiler->Compiled[compiler->CompiledCount].Object = ajo;
+  compiler->Compiled[compiler->CompiledCount++].Node = index;
+  struct __internal__SchemaNode pelumi = schema->Nodes[index]; //filled in here and stored at the end: compiling subschemas moves Nodes
+  int valueType;
+  void * value;
+
+  const char * unsupported[] = {"patternProperties", "uniqueItems", "dependencies", "dependentRequired", "dependentSchemas", "if", "then", "else",
+    "contains", "minContains", "maxContains", "propertyNames", "prefixItems", "additionalItems", "unevaluatedItems", "unevaluatedProperties"};
+  for(int i = 0; i < (int)(sizeof(unsupported) / sizeof(unsupported[0])); i++){
+    if(__internal__SchemaKeyword(ajo, unsupported[i], -1, NULL) != NULL){return AJ_SCHEMA_INVALID;} //ignoring it would let invalid documents through
+  }
+
+  if((value = __internal__SchemaKeyword(ajo, "type", -1, &valueType)) != NULL){
+    pelumi.Types = 0;
+    if(valueType == TYPE_STRING){
+      pelumi.Types = __internal__SchemaTypeBit((struct AJString *)value);
+    }else if(valueType == TYPE_ARRAY && ((struct AJArray *)value)->PackedNumbers == NULL){
+      for(struct AJArrayElement * el = ((struct AJArray *)value)->FirstElement; el != NULL; el = el->NextAJElement){
+        int bit = el->ArrayElementType == TYPE_STRING ? __internal__SchemaTypeBit((struct AJString *)el->ArrayElement) : 0;
+        if(bit == 0){return AJ_SCHEMA_INVALID;}
+        pelumi.Types |= bit;
+      }
+    }
+    if(pelumi.Types == 0 && valueType != TYPE_ARRAY){return AJ_SCHEMA_INVALID;}
+  }
+
+  if((value = __internal__SchemaKeyword(ajo, "enum", -1, &valueType)) != NULL){
+    if(valueType != TYPE_ARRAY){return AJ_SCHEMA_INVALID;}
+    struct AJArray * aja = (struct AJArray *)value;
+    struct AJArrayElement * el = aja->FirstElement;
+    struct AJNumber packed;
+    pelumi.FirstEnum = schema->ValueCount;
+    pelumi.EnumCount = aja->length;
+    for(int i = 0; i < aja->length; i++){
+      int elementType;
+      void * element = __internal__NextArrayValue(aja, i, &el, &packed, &elementType);
+      __internal__AddSchemaValue(schema, element, elementType);
+    }
+  }
+  if((value = __internal__SchemaKeyword(ajo, "const", -1, &valueType)) != NULL){
+    pelumi.Const = __internal__AddSchemaValue(schema, value, valueType);
+  }
+
+  if((value = __internal__SchemaKeyword(ajo, "minimum", TYPE_NUMBER, NULL)) != NULL){
+    pelumi.Bounds |= AJ_SCHEMA_MINIMUM;
+    pelumi.Minimum = AJNumberGetDouble((struct AJNumber *)value);
+  }
+  if((value = __internal__SchemaKeyword(ajo, "maximum", TYPE_NUMBER, NULL)) != NULL){
+    pelumi.Bounds |= AJ_SCHEMA_MAXIMUM;
+    pelumi.Maximum = AJNumberGetDouble((struct AJNumber *)value);
+  }
+  if((value = __internal__SchemaKeyword(ajo, "exclusiveMinimum", -1, &valueType)) != NULL){
+    if(valueType == TYPE_NUMBER){
+      pelumi.Bounds |= AJ_SCHEMA_EXCLUSIVE_MINIMUM;
+      pelumi.ExclusiveMinimum = AJNumberGetDouble((struct AJNumber *)value);
+    }else if(valueType != TYPE_BOOLEAN){
+      return AJ_SCHEMA_INVALID;
+    }else if(((struct AJBoolean *)value)->TruthValue && (pelumi.Bounds & AJ_SCHEMA_MINIMUM)){ //draft 4: makes minimum exclusive
+      pelumi.Bounds = (pelumi.Bounds & ~AJ_SCHEMA_MINIMUM) | AJ_SCHEMA_EXCLUSIVE_MINIMUM;
+      pelumi.ExclusiveMinimum = pelumi.Minimum;
+    }
+  }
+  if((value = __internal__SchemaKeyword(ajo, "exclusiveMaximum", -1, &valueType)) != NULL){
+    if(valueType == TYPE_NUMBER){
+      pelumi.Bounds |= AJ_SCHEMA_EXCLUSIVE_MAXIMUM;
+      pelumi.ExclusiveMaximum = AJNumberGetDouble((struct AJNumber *)value);
+    }else if(valueType != TYPE_BOOLEAN){
+      return AJ_SCHEMA_INVALID;
+    }else if(((struct AJBoolean *)value)->TruthValue && (pelumi.Bounds & AJ_SCHEMA_MAXIMUM)){
+      pelumi.Bounds = (pelumi.Bounds & ~AJ_SCHEMA_MAXIMUM) | AJ_SCHEMA_EXCLUSIVE_MAXIMUM;
+      pelumi.ExclusiveMaximum = pelumi.Maximum;
+    }
+  }
+  if((value = __internal__SchemaKeyword(ajo, "multipleOf", TYPE_NUMBER, NULL)) != NULL){
+    pelumi.Bounds |= AJ_SCHEMA_MULTIPLE_OF;
+    pelumi.MultipleOf = AJNumberGetDouble((struct AJNumber *)value);
+    if(!(pelumi.MultipleOf > 0)){return AJ_SCHEMA_INVALID;}
+  }
+
+  const char * countNames[6] = {"minLength", "maxLength", "minItems", "maxItems", "minProperties", "maxProperties"};
+  int * counts[6] = {&pelumi.MinLength, &pelumi.MaxLength, &pelumi.MinItems, &pelumi.MaxItems, &pelumi.MinProperties, &pelumi.MaxProperties};
+  for(int i = 0; i < 6; i++){
+    *counts[i] = __internal__SchemaCount(ajo, countNames[i]);
+    if(*counts[i] == -2){return AJ_SCHEMA_INVALID;}
+  }
+
+  if((value = __internal__SchemaKeyword(ajo, "pattern", TYPE_STRING, NULL)) != NULL){
+    pelumi.Pattern = __internal__CompileSchemaPattern(schema, (struct AJString *)value);
+    if(pelumi.Pattern < 0){return AJ_SCHEMA_INVALID;}
+  }
+
+  if((value = __internal__SchemaKeyword(ajo, "items", -1, &valueType)) != NULL){
+    pelumi.Items = __internal__CompileSchema(compiler, value, valueType);
+    if(pelumi.Items == AJ_SCHEMA_INVALID){return AJ_SCHEMA_INVALID;}
+  }
+  if((value = __internal__SchemaKeyword(ajo, "additionalProperties", -1, &valueType)) != NULL){
+    pelumi.AdditionalProperties = __internal__CompileSchema(compiler, value, valueType);
+    if(pelumi.AdditionalProperties == AJ_SCHEMA_INVALID){return AJ_SCHEMA_INVALID;}
+  }
+  struct AJObject * properties = (struct AJObject *)__internal__SchemaKeyword(ajo, "properties", TYPE_OBJECT, NULL);
+  struct AJArray * required = (struct AJArray *)__internal__SchemaKeyword(ajo, "required", TYPE_ARRAY, NULL);
+  if(!__internal__CompileSchemaProperties(compiler, &pelumi, properties, required)){return AJ_SCHEMA_INVALID;}
+
+  const char * listNames[3] = {"allOf", "anyOf", "oneOf"};
+  int * listCounts[3] = {&pelumi.AllOfCount, &pelumi.AnyOfCount, &pelumi.OneOfCount};
+  struct AJArray * lists[3];
+  int subCount = 0;
+  for(int i = 0; i < 3; i++){
+    lists[i] = (struct AJArray *)__internal__SchemaKeyword(ajo, listNames[i], -1, &valueType);
+    if(lists[i] != NULL && (valueType != TYPE_ARRAY || lists[i]->length == 0)){return AJ_SCHEMA_INVALID;}
+    *listCounts[i] = lists[i] != NULL ? lists[i]->length : 0;
+    subCount += *listCounts[i];
+  }
+  if(subCount > 0){
+    int * subs = (int *)__internal__Malloc(sizeof(int) * subCount);
+    int ok = 1;
+    int * out = subs;
+    for(int i = 0; i < 3 && ok; i++){
+      if(lists[i] == NULL){continue;}
+      ok = __internal__CompileSchemaList(compiler, lists[i], out);
+      out += lists[i]->length;
+    }
+    if(ok){
+      schema->Subs = (int *)__internal__GrowArray(schema->Subs, schema->SubCount, &schema->SubCapacity, subCount, sizeof(int));
+      memcpy(&schema->Subs[schema->SubCount], subs, sizeof(int) * subCount);
+      pelumi.FirstSub = schema->SubCount;
+      schema->SubCount += subCount;
+    }
+    __internal__Free(subs);
+    if(!ok){return AJ_SCHEMA_INVALID;}
+  }
+
+  if((value = __internal__SchemaKeyword(ajo, "not", -1, &valueType)) != NULL){
+    pelumi.HasNot = 1;
+    pelumi.Not = __internal__CompileSchema(compiler, value, valueType);
+    if(pelumi.Not == AJ_SCHEMA_INVALID){return AJ_SCHEMA_INVALID;}
+  }
+  if((value = __internal__SchemaKeyword(ajo, "$ref", TYPE_STRING, NULL)) != NULL){
+    struct AJString * ref = (struct AJString *)value;
+    if(ref->length == 0 || ref->string[0] != '#'){return AJ_SCHEMA_INVALID;}
+    struct AJNumber packed;
+    void * target = __internal__WalkPointer(compiler->Document, TYPE_OBJECT, ref->string + 1, ref->length - 1, &valueType, &packed);
+    pelumi.Ref = target != NULL ? __internal__CompileSchema(compiler, target, valueType) : AJ_SCHEMA_INVALID;
+    if(pelumi.Ref == AJ_SCHEMA_INVALID){return AJ_SCHEMA_INVALID;}
+  }
+
+  pelumi.LooksInside = pelumi.PropertyCount > 0 || pelumi.Items != AJ_SCHEMA_ANYTHING || pelumi.AdditionalProperties != AJ_SCHEMA_ANYTHING;
+  schema->Nodes[index] = pelumi;
+  return index;
+}
+
+void DeleteAJSchema(struct AJSchema * schema){
+  for(int i = 0; i < schema->ValueCount; i++){
+    AJDelete(schema->Values[i].Node, schema->Values[i].Type);
+  }
+#ifdef AJ_HAVE_REGEX
+  for(int i = 0; i < schema->PatternCount; i++){
+    regfree((regex_t *)schema->Patterns[i]);
+    __internal__Free(schema->Patterns[i]);
+  }
+#endif
+  __internal__Free(schema->Nodes);
+  __internal__Free(schema->Properties);
+  __internal__Free(schema->Slots);
+  __internal__Free(schema->Subs);
+  __internal__Free(schema->Values);
+  __internal__Free(schema->Patterns);
+  __internal__Free(schema->Names);
+  __internal__Free(schema);
+}
+
+//compiles schemaObject (the root of a parsed JSON Schema; it can be deleted afterwards). NULL if it uses something that cant be compiled
+struct AJSchema * CompileAJSchema(struct AJObject * schemaObject){
+  struct AJSchema * schema = (struct AJSchema *)__internal__Malloc(sizeof(struct AJSchema));
+  memset(schema, 0, sizeof(struct AJSchema));
+  struct __internal__SchemaCompiler compiler;
+  compiler.Schema = schema;
+  compiler.Document = schemaObject;
+  compiler.Compiled = NULL;
+  compiler.CompiledCount = compiler.CompiledCapacity = 0;
+  schema->Root = __internal__CompileSchema(&compiler, schemaObject, TYPE_OBJECT);
+  __internal__Free(compiler.Compiled);
+  if(schema->Root == AJ_SCHEMA_INVALID){
+    DeleteAJSchema(schema);
+    return NULL;
+  }
+  return schema;
+}
+
+//a scalar being validated, from a tree or from text
+struct __internal__SchemaScalar{
+  int Type;
+  double Number;
+  char Truth;
+  const char * Chars; //strings, as they are stored
+  int Length;
+  char Raw; //1: Chars still have their escapes (text, or a tree parsed with EscapeStrings off)
+};
+
+static inline int __internal__IsWholeNumber(double x){
+  if(x != x){return 0;}
+  if(x > 9e18 || x < -9e18){return x - x == 0;} //doubles this big have no fraction left (x - x is NaN for infinities)
+  return x == (double)(long long)x;
+}
+
+static inline int __internal__IsMultipleOf(double x, double m){
+  if(__internal__IsWholeNumber(m) && m <= 9e18 && x <= 9e18 && x >= -9e18){ //whole divisor: exact
+    return __internal__IsWholeNumber(x) && (long long)x % (long long)m == 0;
+  }
+  double q = x / m;
+  if(q - q != 0){return 0;}
+  if(q > 4e15 || q < -4e15){return 1;}
+  double whole = (double)(long long)(q < 0 ? q - 0.5 : q + 0.5);
+  double off = q - whole;
+  double tolerance = 1e-9 * (whole < 0 ? -whole : whole); //0.3 / 0.1 isnt quite 3, but 1e-10 / 0.1 isnt 0 either
+  return off <= tolerance && off >= -tolerance;
+}
+
+static inline int __internal__SchemaTypeAllows(struct __internal__SchemaNode * n, int type, double number){
+  if(n->Types & (1 << type)){return 1;}
+  return type == TYPE_NUMBER && (n->Types & AJ_SCHEMA_INTEGER) && __internal__IsWholeNumber(number);
+}
+
+static inline int __internal__SchemaCountAllows(int count, int min, int max){
+  return count >= min && (max < 0 || count <= max);
+}
+
+static inline int __internal__SchemaScalarEquals(struct __internal__SchemaScalar * v, const char * chars, int length, struct __internal__SchemaValue * e){
+  if(e->Type != v->Type){return 0;}
+  switch(v->Type){
+    case TYPE_NUMBER: return AJNumberGetDouble((struct AJNumber *)e->Node) == v->Number;
+    case TYPE_BOOLEAN: return ((struct AJBoolean *)e->Node)->TruthValue == v->Truth;
+    case TYPE_STRING: return ((struct AJString *)e->Node)->length == length && memcmp(((struct AJString *)e->Node)->string, chars, length) == 0;
+  }
+  return 1;
+}
+
+//const and enum for a scalar. strings are compared as chars / length
+int __internal__SchemaScalarInEnum(struct AJSchema * schema, struct __internal__SchemaNode * n, struct __internal__SchemaScalar * v, const char * chars, int length){
+  if(n->Const >= 0 && !__internal__SchemaScalarEquals(v, chars, length, &schema->Values[n->Const])){return 0;}
+  if(n->EnumCount < 0){return 1;}
+  for(int i = 0; i < n->EnumCount; i++){
+    if(__internal__SchemaScalarEquals(v, chars, length, &schema->Values[n->FirstEnum + i])){return 1;}
+  }
+  return 0;
+}
+
+//const and enum for an array or object
+int __internal__SchemaTreeInEnum(struct AJSchema * schema, struct __internal__SchemaNode * n, void * node, int type){
+  if(n->Const >= 0 && !AJEquals(node, type, schema->Values[n->Const].Node, schema->Values[n->Const].Type, 1)){return 0;}
+  if(n->EnumCount < 0){return 1;}
+  for(int i = 0; i < n->EnumCount; i++){
+    if(AJEquals(node, type, schema->Values[n->FirstEnum + i].Node, schema->Values[n->FirstEnum + i].Type, 1)){return 1;}
+  }
+  return 0;
+}
+
+int __internal__SchemaCheckString(struct AJSchema * schema, struct __internal__SchemaNode * n, struct __internal__SchemaScalar * v){
+  if(n->MinLength < 0 && n->MaxLength < 0 && n->Pattern < 0 && n->EnumCount < 0 && n->Const < 0){return 1;}
+  int escapeStrings = AJGetContext()->EscapeStrings;
+  int needsDecoding = v->Raw && memchr(v->Chars, '\\', v->Length) != NULL;
+  const char * chars = v->Chars; //decoded
+  int length = v->Length;
+  char stackChars[256];
+  char * buffer = NULL;
+  if(needsDecoding || n->Pattern >= 0){ //regexec wants a null terminator, and text isnt terminated after the string
+    buffer = v->Length < (int)sizeof(stackChars) ? stackChars : (char *)__internal__Malloc(v->Length + 1);
+    if(needsDecoding){
+      length = __internal__UnescapeChars(v->Chars, v->Length, buffer);
+    }else{
+      memcpy(buffer, v->Chars, length);
+    }
+    buffer[length] = '\0';
+    chars = buffer;
+  }
+  int ok = 1;
+  if(n->MinLength >= 0 || n->MaxLength >= 0){
+    int codePoints = 0;
+    for(int i = 0; i < length; i++){
+      codePoints += ((unsigned char)chars[i] & 0xC0) != 0x80;
+    }
+    ok = __internal__SchemaCountAllows(codePoints, n->MinLength, n->MaxLength);
+  }
+#ifdef AJ_HAVE_REGEX
+  if(ok && n->Pattern >= 0){
+    ok = regexec((regex_t *)schema->Patterns[n->Pattern], chars, 0, NULL, 0) == 0;
+  }
+#endif
+  if(ok){ //enum strings are stored the way the schema was parsed: decoded only with EscapeStrings on
+    ok = escapeStrings ? __internal__SchemaScalarInEnum(schema, n, v, chars, length) : __internal__SchemaScalarInEnum(schema, n, v, v->Chars, v->Length);
+  }
+  if(buffer != stackChars){__internal__Free(buffer);}
+  return ok;
+}
+
+int __internal__SchemaCheckScalar(struct AJSchema * schema, struct __internal__SchemaNode * n, struct __internal__SchemaScalar * v){
+  if(!__internal__SchemaTypeAllows(n, v->Type, v->Number)){return 0;}
+  if(v->Type == TYPE_STRING){return __internal__SchemaCheckString(schema, n, v);}
+  if(v->Type == TYPE_NUMBER && n->Bounds != 0){
+    double x = v->Number;
+    if((n->Bounds & AJ_SCHEMA_MINIMUM) && !(x >= n->Minimum)){return 0;}
+    if((n->Bounds & AJ_SCHEMA_MAXIMUM) && !(x <= n->Maximum)){return 0;}
+    if((n->Bounds & AJ_SCHEMA_EXCLUSIVE_MINIMUM) && !(x > n->ExclusiveMinimum)){return 0;}
+    if((n->Bounds & AJ_SCHEMA_EXCLUSIVE_MAXIMUM) && !(x < n->ExclusiveMaximum)){return 0;}
+    if((n->Bounds & AJ_SCHEMA_MULTIPLE_OF) && !__internal__IsMultipleOf(x, n->MultipleOf)){return 0;}
+  }
+  return __internal__SchemaScalarInEnum(schema, n, v, v->Chars, v->Length);
+}
+
+//the subschema for the member called key, noting it in seen if it is required
+int __internal__SchemaMemberNode(struct AJSchema * schema, struct __internal__SchemaNode * n, const char * key, int length, int raw, unsigned long long * seen){
+  if(n->PropertyCount == 0){return n->AdditionalProperties;}
+  char * decoded = NULL;
+  if(raw && AJGetContext()->EscapeStrings && memchr(key, '\\', length) != NULL){ //the schema's keys were decoded when it was parsed
+    decoded = (char *)__internal__Malloc(length);
+    length = __internal__UnescapeChars(key, length, decoded);
+    key = decoded;
+  }
+  int * slots = &schema->Slots[n->FirstSlot];
+  int slot = __internal__HashBytes(key, length, AJ_FNV_OFFSET_BASIS) & n->SlotMask;
+  int node = n->AdditionalProperties;
+  while(slots[slot] != 0){
+    struct __internal__SchemaProperty * property = &schema->Properties[n->FirstProperty + slots[slot] - 1];
+    if(property->NameLength == length && memcmp(&schema->Names[property->NameOffset], key, length) == 0){
+      if(property->RequiredBit >= 0){seen[property->RequiredBit >> 6] |= 1ULL << (property->RequiredBit & 63);}
+      if(property->Node != AJ_SCHEMA_UNLISTED){node = property->Node;}
+      break;
+    }
+    slot = (slot + 1) & n->SlotMask;
+  }
+  __internal__Free(decoded);
+  return node;
+}
+
+static inline int __internal__SchemaSawRequired(struct __internal__SchemaNode * n, unsigned long long * seen){
+  for(int i = 0; i < n->RequiredCount; i++){
+    if(!((seen[i >> 6] >> (i & 63)) & 1)){return 0;}
+  }
+  return 1;
+}
+
+int __internal__ValidateSchemaTree(struct AJSchema * schema, int index, void * node, int type);
+int __internal__ValidateSchemaText(struct AJSchema * schema, int index, char * JSONString, int i, int * end);
+
+//allOf, anyOf, oneOf, not and $ref: the same value against other subschemas. text: JSONString isnt NULL and the value starts at idx
+int __internal__SchemaCheckApplicators(struct AJSchema * schema, struct __internal__SchemaNode * n, void * node, int type, char * JSONString, int idx){
+  int * subs = &schema->Subs[n->FirstSub];
+  int end;
+  #define AJ_SCHEMA_SUBVALID(sub) (JSONString == NULL ? __internal__ValidateSchemaTree(schema, sub, node, type) : __internal__ValidateSchemaText(schema, sub, JSONString, idx, &end))
+  for(int i = 0; i < n->AllOfCount; i++){
+    if(!AJ_SCHEMA_SUBVALID(subs[i])){return 0;}
+  }
+  subs += n->AllOfCount;
+  int matched = n->AnyOfCount == 0;
+  for(int i = 0; i < n->AnyOfCount && !matched; i++){
+    matched = AJ_SCHEMA_SUBVALID(subs[i]);
+  }
+  if(!matched){return 0;}
+  subs += n->AnyOfCount;
+  matched = 0;
+  for(int i = 0; i < n->OneOfCount && matched < 2; i++){
+    matched += AJ_SCHEMA_SUBVALID(subs[i]);
+  }
+  if(n->OneOfCount > 0 && matched != 1){return 0;}
+  if(n->HasNot && AJ_SCHEMA_SUBVALID(n->Not)){return 0;}
+  if(n->Ref != AJ_SCHEMA_ANYTHING && !AJ_SCHEMA_SUBVALID(n->Ref)){return 0;}
+  #undef AJ_SCHEMA_SUBVALID
+  return 1;
+}
+
+int __internal__ValidateSchemaTree(struct AJSchema * schema, int index, void * node, int type){
+  if(index == AJ_SCHEMA_ANYTHING){return 1;}
+  if(index == AJ_SCHEMA_NOTHING){return 0;}
+  struct __internal__SchemaNode * n = &schema->Nodes[index];
+  switch(type){
+    case TYPE_OBJECT:{
+      struct AJObject * ajo = (struct AJObject *)node;
+      if(!(n->Types & (1 << TYPE_OBJECT)) || !__internal__SchemaCountAllows(ajo->AJKVPCount, n->MinProperties, n->MaxProperties)){return 0;}
+      if(n->LooksInside){
+        unsigned long long seen[n->RequiredCount / 64 + 1];
+        memset(seen, 0, sizeof(seen));
+        for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+          struct AJString * key = (struct AJString *)ajkvp->key;
+          int child = __internal__SchemaMemberNode(schema, n, key->string, key->length, 0, seen);
+          if(!__internal__ValidateSchemaTree(schema, child, ajkvp->value, ajkvp->ValueType)){return 0;}
+        }
+        if(!__internal__SchemaSawRequired(n, seen)){return 0;}
+      }
+      if(!__internal__SchemaTreeInEnum(schema, n, node, type)){return 0;}
+      break;
+    }
+    case TYPE_ARRAY:{
+      struct AJArray * aja = (struct AJArray *)node;
+      if(!(n->Types & (1 << TYPE_ARRAY)) || !__internal__SchemaCountAllows(aja->length, n->MinItems, n->MaxItems)){return 0;}
+      if(n->Items != AJ_SCHEMA_ANYTHING){
+        struct AJArrayElement * el = aja->FirstElement;
+        struct AJNumber packed;
+        for(int i = 0; i < aja->length; i++){
+          int elementType;
+          void * element = __internal__NextArrayValue(aja, i, &el, &packed, &elementType);
+          if(!__internal__ValidateSchemaTree(schema, n->Items, element, elementType)){return 0;}
+        }
+      }
+      if(!__internal__SchemaTreeInEnum(schema, n, node, type)){return 0;}
+      break;
+    }
+    default:{
+      struct __internal__SchemaScalar v;
+      v.Type = type;
+      v.Number = type == TYPE_NUMBER ? AJNumberGetDouble((struct AJNumber *)node) : 0;
+      v.Truth = type == TYPE_BOOLEAN ? ((struct AJBoolean *)node)->TruthValue : 0;
+      v.Chars = type == TYPE_STRING ? ((struct AJString *)node)->string : NULL;
+      v.Length = type == TYPE_STRING ? ((struct AJString *)node)->length : 0;
+      v.Raw = type == TYPE_STRING && ((struct AJString *)node)->Raw;
+      if(!__internal__SchemaCheckScalar(schema, n, &v)){return 0;}
+    }
+  }
+  return __internal__SchemaCheckApplicators(schema, n, node, type, NULL, 0);
+}
+
+//const and enum for an array or object in text: parses just that value to compare it
+int __internal__SchemaTextInEnum(struct AJSchema * schema, struct __internal__SchemaNode * n, char * JSONString, int idx, int type){
+  if(n->EnumCount < 0 && n->Const < 0){return 1;}
+  struct AJContext quiet = *AJGetContext(); //no shapes, interning or source map entries for a throwaway tree
+  quiet.Shapes = NULL;
+  quiet.Intern = NULL;
+  quiet.SourceMap = NULL;
+  quiet.TextCache = NULL;
+  struct AJContext * previous = AJSetContext(&quiet);
+  int ignored;
+  void * value = type == TYPE_OBJECT ? (void *)ParseNewAJObject(idx, JSONString, &ignored) : (void *)ParseNewAJArray(idx, JSONString, &ignored);
+  int ok = __internal__SchemaTreeInEnum(schema, n, value, type);
+  AJDelete(value, type);
+  AJSetContext(previous);
+  return ok;
+}
+
+//closing quote of the string starting at s[i], -1 if it isnt strict JSON: a raw control char, or an escape JSON doesnt have
+int __internal__StrictClosingQuote(const char * s, int i){
+  for(i++; s[i] != '"'; i++){
+    if((unsigned char)s[i] < 0x20){return -1;} //the terminator included
+    if(s[i] != '\\'){continue;}
+    char c = s[++i];
+    if(c == 'u'){
+      for(int k = 1; k <= 4; k++){
+        if(__internal__HexValue(s[i + k]) < 0){return -1;}
+      }
+      i += 4;
+    }else if(c == '\0' || strchr("\"\\/bfnrt", c) == NULL){
+      return -1;
+    }
+  }
+  return i;
+}
+
+//validates the value at JSONString[i] (after any white space), syntax included. *end: the index right after it
+int __internal__ValidateSchemaText(struct AJSchema * schema, int index, char * JSONString, int i, int * end){
+  if(index == AJ_SCHEMA_NOTHING){return 0;}
+  struct __internal__SchemaNode * n = index >= 0 ? &schema->Nodes[index] : NULL; //NULL: anything, only the syntax is checked
+  char * s = JSONString;
+  i = __internal__SkipSpace(s, i);
+  int start = i;
+  int type;
+  struct __internal__SchemaScalar v;
+  v.Number = 0;
+  v.Truth = 0;
+  v.Chars = NULL;
+  v.Length = 0;
+  v.Raw = 1;
+  switch(s[i]){
+    case '{':{
+      type = TYPE_OBJECT;
+      if(n != NULL && !(n->Types & (1 << TYPE_OBJECT))){return 0;}
+      unsigned long long seen[n != NULL ? n->RequiredCount / 64 + 1 : 1];
+      memset(seen, 0, sizeof(seen));
+      int count = 0;
+      i = __internal__SkipSpace(s, i + 1);
+      while(s[i] != '}'){
+        if(s[i] != '"'){return 0;}
+        int closingQuote = __internal__StrictClosingQuote(s, i);
+        if(closingQuote < 0){return 0;}
+        int child = n != NULL ? __internal__SchemaMemberNode(schema, n, &s[i + 1], closingQuote - i - 1, 1, seen) : AJ_SCHEMA_ANYTHING;
+        i = __internal__SkipSpace(s, closingQuote + 1);
+        if(s[i] != ':' || !__internal__ValidateSchemaText(schema, child, s, i + 1, &i)){return 0;}
+        count++;
+        i = __internal__SkipSpace(s, i);
+        if(s[i] == ','){
+          i = __internal__SkipSpace(s, i + 1);
+          if(s[i] == '}'){return 0;}
+        }else if(s[i] != '}'){
+          return 0;
+        }
+      }
+      *end = i + 1;
+      if(n == NULL){return 1;}
+      if(!__internal__SchemaCountAllows(count, n->MinProperties, n->MaxProperties) || !__internal__SchemaSawRequired(n, seen)){return 0;}
+      if(!__internal__SchemaTextInEnum(schema, n, s, start, type)){return 0;}
+      break;
+    }
+    case '[':{
+      type = TYPE_ARRAY;
+      if(n != NULL && !(n->Types & (1 << TYPE_ARRAY))){return 0;}
+      int child = n != NULL ? n->Items : AJ_SCHEMA_ANYTHING;
+      int count = 0;
+      i = __internal__SkipSpace(s, i + 1);
+      while(s[i] != ']'){
+        if(!__internal__ValidateSchemaText(schema, child, s, i, &i)){return 0;}
+        count++;
+        i = __internal__SkipSpace(s, i);
+        if(s[i] == ','){
+          i = __internal__SkipSpace(s, i + 1);
+          if(s[i] == ']'){return 0;}
+        }else if(s[i] != ']'){
+          return 0;
+        }
+      }
+      *end = i + 1;
+      if(n == NULL){return 1;}
+      if(!__internal__SchemaCountAllows(count, n->MinItems, n->MaxItems)){return 0;}
+      if(!__internal__SchemaTextInEnum(schema, n, s, start, type)){return 0;}
+      break;
+    }
+    case '"':{
+      int closingQuote = __internal__StrictClosingQuote(s, i);
+      if(closingQuote < 0){return 0;}
+      type = TYPE_STRING;
+      v.Chars = &s[i + 1];
+      v.Length = closingQuote - i - 1;
+      *end = closingQuote + 1;
+      break;
+    }
+    case 't':
+    case 'f':{
+      type = TYPE_BOOLEAN;
+      v.Truth = s[i] == 't';
+      if(strncmp(&s[i], v.Truth ? "true" : "false", v.Truth ? 4 : 5) != 0){return 0;}
+      *end = i + (v.Truth ? 4 : 5);
+      break;
+    }
+    case 'n':{
+      type = TYPE_NULL;
+      if(strncmp(&s[i], "null", 4) != 0){return 0;}
+      *end = i + 4;
+      break;
+    }
+    default:{
+      type = TYPE_NUMBER;
+      int length = __internal__JSONNumberLength(s, i);
+      if(length == 0){return 0;}
+      if(n != NULL){v.Number = strtod(&s[i], NULL);}
+      *end = i + length;
+    }
+  }
+  if(n == NULL){return 1;}
+  if(type != TYPE_OBJECT && type != TYPE_ARRAY){
+    v.Type = type;
+    if(!__internal__SchemaCheckScalar(schema, n, &v)){return 0;}
+  }
+  return __internal__SchemaCheckApplicators(schema, n, NULL, 0, s, start);
+}
+
+//1 if node (of type) is valid under schema
+int AJValidate(struct AJSchema * schema, void * node, int type){
+  return __internal__ValidateSchemaTree(schema, schema->Root, node, type);
+}
+
+//validates the JSON value starting at JSONString[indexOfFirstChar] without parsing it, stopping at the first thing that fails.
+//malformed text is invalid. returnIdx (can be NULL) gets the index of the value's last char, like ParseNewAJObject
+int AJValidateText(struct AJSchema * schema, int indexOfFirstChar, char * JSONString, int * returnIdx){
+  int end;
+  if(!__internal__ValidateSchemaText(schema, schema->Root, JSONString, indexOfFirstChar, &end)){return 0;}
+  if(returnIdx != NULL){*returnIdx = end - 1;}
+  return 1;
+}
+
+//ParseNewAJObject for documents that are valid under schema: NULL (and nothing allocated) otherwise
+struct AJObject * ParseNewAJObjectValidated(struct AJSchema * schema, int indexOfOpeningBracket, char * JSONString, int * returnIdx){
+  int i = __internal__SkipSpace(JSONString, indexOfOpeningBracket);
+  if(JSONString[i] != '{' || !AJValidateText(schema, i, JSONString, NULL)){return NULL;}
+  return ParseNewAJObject(i, JSONString, returnIdx);
+}
+
+/* JSONPath
+CompileAJPath turns a JSONPath query (RFC 9535) into a list of segments and selectors once. AJEvaluatePaths then runs any number of
+compiled queries over a tree in one depth first walk: each node carries the (query, segment) pairs still alive at it, a child is
+only visited when some query can still match at or under it, and matches go to onMatch as they are found. Hundreds of rules over
+one document cost one walk instead of hundreds.
+  -$ for the root, .name and ['name'], .* and [*], [0] and [-1], [start:end:step], unions like ['a', 0, 2:4], .. for descendants,
+   and filters like [?@.total > 100 && @.paid] (the older [?(...)] form works too).
+  -filters: @ (the member being tested) and $ queries made of names and indexes, 'strings' and "strings", numbers, true, false, null,
+   == != < <= > >=, && || ! and brackets. A query on its own tests that it leads somewhere. Functions (length(), match()...) arent supported.
+  -matches come in document order for each query (so $[1,0] gives element 0 first), duplicates included like the RFC says.
+  -names are matched against decoded keys, so it doesnt matter whether the tree was parsed with AJContext->EscapeStrings.
+  -for elements of packed arrays onMatch gets an AJNumber that only lives until it returns.*/
+
+#define AJ_PATH_NAME 0 //selector kinds
+#define AJ_PATH_WILDCARD 1
+#define AJ_PATH_INDEX 2
+#define AJ_PATH_SLICE 3
+#define AJ_PATH_FILTER 4
+
+#define AJ_PATH_OR 0 //filter expression kinds
+#define AJ_PATH_AND 1
+#define AJ_PATH_NOT 2
+#define AJ_PATH_COMPARE 3
+#define AJ_PATH_EXISTS 4
+#define AJ_PATH_QUERY 5
+#define AJ_PATH_LITERAL 6
+
+#define AJ_PATH_EQUAL 0 //comparisons
+#define AJ_PATH_NOT_EQUAL 1
+#define AJ_PATH_LESS 2
+#define AJ_PATH_LESS_EQUAL 3
+#define AJ_PATH_GREATER 4
+#define AJ_PATH_GREATER_EQUAL 5
+
+struct __internal__PathSelector{
+  int Kind;
+  int NameOffset, NameLength; //decoded, in AJPath->Names
+  unsigned int NameHash;
+  int Start, End, Step; //INDEX uses Start. SLICE: HasStart / HasEnd say if they were given
+  char HasStart, HasEnd;
+  int Filter; //expression index
+};
+
+struct __internal__PathSegment{
+  int FirstSelector, SelectorCount;
+  char Descendant; //..: the selectors apply to the node's children and to the children of everything under it
+};
+
+struct __internal__PathExpression{
+  int Kind;
+  int Op; //COMPARE
+  int Left, Right; //subexpressions. NOT and EXISTS only use Left. COMPARE's are QUERY or LITERAL ones
+  char FromRoot; //QUERY: starts at $ instead of @
+  int FirstStep, StepCount; //QUERY: NAME / INDEX selectors in AJPath->Steps
+  int LiteralType; //LITERAL
+  double Number;
+  int StringOffset, StringLength;
+  char Truth;
+};
+
+struct AJPath{
+  struct __internal__PathSegment * Segments;
+  int SegmentCount, SegmentCapacity;
+  struct __internal__PathSelector * Selectors;
+  int SelectorCount, SelectorCapacity;
+  struct __internal__PathSelector * Steps;
+  int StepCount, StepCapacity;
+  struct __internal__PathExpression * Expressions;
+  int ExpressionCount, ExpressionCapacity;
+  char * Names; //names and string literals, each null terminated
+  int NamesLength, NamesCapacity;
+};
+
+struct __internal__PathParser{
+  struct AJPath * Path;
+  const char * s;
+  int i;
+};
+
+void DeleteAJPath(struct AJPath * path){
+  __internal__Free(path->Segments);
+  __internal__Free(path->Selectors);
+  __internal__Free(path->Steps);
+  __internal__Free(path->Expressions);
+  __internal__Free(path->Names);
+  __internal__Free(path);
+}
+
+//copies (decoding escapes if decode) a name into path->Names and points selector at it
+void __internal__SetPathName(struct AJPath * path, struct __internal__PathSelector * selector, const char * chars, int length, int decode){
+  path->Names = (char *)__internal__GrowArray(path->Names, path->NamesLength, &path->NamesCapacity, length + 1, 1);
+  char * name = &path->Names[path->NamesLength];
+  if(decode){
+    length = __internal__UnescapeChars(chars, length, name);
+  }else{
+    memcpy(name, chars, length);
+  }
+  name[length] = '\0';
+  selector->Kind = AJ_PATH_NAME;
+  selector->NameOffset = path->NamesLength;
+  selector->NameLength = length;
+  selector->NameHash = __internal__HashBytes(name, length, AJ_FNV_OFFSET_BASIS);
+  path->NamesLength += length + 1;
+}
+
+static inline int __internal__IsPathNameChar(unsigned char ch){
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch >= 0x80;
+}
+
+static inline int __internal__IsDigit(char ch){
+  return ch >= '0' && ch <= '9';
+}
+
+//a 'quoted' or "quoted" name at p->i. 0 if there isnt one
+int __internal__ParsePathString(struct __internal__PathParser * p, struct __internal__PathSelector * selector){
+  char quote = p->s[p->i];
+  if(quote != '\'' && quote != '"'){return 0;}
+  int end = p->i + 1;
+  while(p->s[end] != '\0' && p->s[end] != quote){
+    end += p->s[end] == '\\' && p->s[end + 1] != '\0' ? 2 : 1;
+  }
+  if(p->s[end] != quote){return 0;}
+  __internal__SetPathName(p->Path, selector, &p->s[p->i + 1], end - p->i - 1, 1);
+  p->i = end + 1;
+  return 1;
+}
+
+int __internal__ParsePathInt(struct __internal__PathParser * p, int * out){
+  int negative = p->s[p->i] == '-';
+  int j = p->i + negative;
+  if(!__internal__IsDigit(p->s[j])){return 0;}
+  long long value = 0;
+  while(__internal__IsDigit(p->s[j])){
+    value = value * 10 + (p->s[j++] - '0');
+    if(value > 2147483647LL){return 0;}
+  }
+  *out = negative ? (int)-value : (int)value;
+  p->i = j;
+  return 1;
+}
+
+int __internal__NewPathExpression(struct AJPath * path, int kind){
+  path->Expressions = (struct __internal__PathExpression *)__internal__GrowArray(path->Expressions, path->ExpressionCount, &path->ExpressionCapacity, 1, sizeof(struct __internal__PathExpression));
+  struct __internal__PathExpression * pelumi = &path->Expressions[path->ExpressionCount];
+  memset(pelumi, 0, sizeof(struct __internal__PathExpression));
+  pelumi->Kind = kind;
+  pelumi->Left = pelumi->Right = -1;
+  return path->ExpressionCount++;
+}
+
+//@... or $... inside a filter: names and indexes only. -1 on a syntax error
+int __internal__ParsePathQuery(struct __internal__PathParser * p){
+  struct AJPath * path = p->Path;
+  const char * s = p->s;
+  int e = __internal__NewPathExpression(path, AJ_PATH_QUERY);
+  int firstStep = path->StepCount;
+  int fromRoot = s[p->i++] == '$';
+  while(1){
+    struct __internal__PathSelector step;
+    memset(&step, 0, sizeof(step));
+    if(s[p->i] == '.' && __internal__IsPathNameChar(s[p->i + 1]) && !__internal__IsDigit(s[p->i + 1])){
+      int start = ++p->i;
+      while(__internal__IsPathNameChar(s[p->i])){p->i++;}
+      __internal__SetPathName(path, &step, &s[start], p->i - start, 0);
+    }else if(s[p->i] == '['){
+      p->i = __internal__SkipSpace(s, p->i + 1);
+      if(!__internal__ParsePathString(p, &step)){
+        step.Kind = AJ_PATH_INDEX;
+        if(!__internal__ParsePathInt(p, &step.Start)){return -1;}
+      }
+      p->i = __internal__SkipSpace(s, p->i);
+      if(s[p->i++] != ']'){return -1;}
+    }else{
+      break;
+    }
+    path->Steps = (struct __internal__PathSelector *)__internal__GrowArray(path->Steps, path->StepCount, &path->StepCapacity, 1, sizeof(struct __internal__PathSelector));
+    path->Steps[path->StepCount++] = step;
+  }
+  path->Expressions[e].FromRoot = fromRoot;
+  path->Expressions[e].FirstStep = firstStep;
+  path->Expressions[e].StepCount = path->StepCount - firstStep;
+  return e;
+}
+
+//a query or a literal
+int __internal__ParsePathOperand(struct __internal__PathParser * p){
+  struct AJPath * path = p->Path;
+  const char * s = p->s;
+  p->i = __internal__SkipSpace(s, p->i);
+  char ch = s[p->i];
+  if(ch == '@' || ch == '$'){return __internal__ParsePathQuery(p);}
+  int e = __internal__NewPathExpression(path, AJ_PATH_LITERAL);
+  struct __internal__PathExpression * pelumi = &path->Expressions[e];
+  if(ch == '\'' || ch == '"'){
+    struct __internal__PathSelector name;
+    if(!__internal__ParsePathString(p, &name)){return -1;}
+    pelumi = &path->Expressions[e];
+    pelumi->LiteralType = TYPE_STRING;
+    pelumi->StringOffset = name.NameOffset;
+    pelumi->StringLength = name.NameLength;
+    return e;
+  }
+  if(strncmp(&s[p->i], "true", 4) == 0 || strncmp(&s[p->i], "false", 5) == 0){
+    pelumi->LiteralType = TYPE_BOOLEAN;
+    pelumi->Truth = ch == 't';
+    p->i += ch == 't' ? 4 : 5;
+  }else if(strncmp(&s[p->i], "null", 4) == 0){
+    pelumi->LiteralType = TYPE_NULL;
+    p->i += 4;
+  }else{
+    int j = p->i + (ch == '-');
+    if(!__internal__IsDigit(s[j])){return -1;}
+    while(__internal__IsDigit(s[j])){j++;}
+    if(s[j] == '.'){
+      if(!__internal__IsDigit(s[++j])){return -1;}
+      while(__internal__IsDigit(s[j])){j++;}
+    }
+    if(s[j] == 'e' || s[j] == 'E'){
+      j += 1 + (s[j + 1] == '+' || s[j + 1] == '-');
+      if(!__internal__IsDigit(s[j])){return -1;}
+      while(__internal__IsDigit(s[j])){j++;}
+    }
+    pelumi->LiteralType = TYPE_NUMBER;
+    pelumi->Number = strtod(&s[p->i], NULL);
+    p->i = j;
+  }
+  if(__internal__IsPathNameChar(s[p->i])){return -1;} //truex, nullable
+  return e;
+}
+
+int __internal__ParsePathOr(struct __internal__PathParser * p);
+
+//(...), a comparison, or a query tested for existence
+int __internal__ParsePathComparison(struct __internal__PathParser * p){
+  const char * s = p->s;
+  p->i = __internal__SkipSpace(s, p->i);
+  if(s[p->i] == '('){
+    p->i++;
+    int inner = __internal__ParsePathOr(p);
+    p->i = __internal__SkipSpace(s, p->i);
+    if(inner < 0 || s[p->i] != ')'){return -1;}
+    p->i++;
+    return inner;
+  }
+  int left = __internal__ParsePathOperand(p);
+  if(left < 0){return -1;}
+  p->i = __internal__SkipSpace(s, p->i);
+  int op = -1;
+  if(s[p->i] == '=' && s[p->i + 1] == '='){op = AJ_PATH_EQUAL;}
+  else if(s[p->i] == '!' && s[p->i + 1] == '='){op = AJ_PATH_NOT_EQUAL;}
+  else if(s[p->i] == '<'){op = s[p->i + 1] == '=' ? AJ_PATH_LESS_EQUAL : AJ_PATH_LESS;}
+  else if(s[p->i] == '>'){op = s[p->i + 1] == '=' ? AJ_PATH_GREATER_EQUAL : AJ_PATH_GREATER;}
+  if(op < 0){
+    if(p->Path->Expressions[left].Kind != AJ_PATH_QUERY){return -1;} //a literal on its own
+    int e = __internal__NewPathExpression(p->Path, AJ_PATH_EXISTS);
+    p->Path->Expressions[e].Left = left;
+    return e;
+  }
+  p->i += op == AJ_PATH_LESS || op == AJ_PATH_GREATER ? 1 : 2;
+  int right = __internal__ParsePathOperand(p);
+  if(right < 0){return -1;}
+  int e = __internal__NewPathExpression(p->Path, AJ_PATH_COMPARE);
+  p->Path->Expressions[e].Op = op;
+  p->Path->Expressions[e].Left = left;
+  p->Path->Expressions[e].Right = right;
+  return e;
+}
+
+int __internal__ParsePathNot(struct __internal__PathParser * p){
+  p->i = __internal__SkipSpace(p->s, p->i);
+  if(p->s[p->i] != '!' || p->s[p->i + 1] == '='){return __internal__ParsePathComparison(p);}
+  p->i++;
+  int inner = __internal__ParsePathNot(p);
+  if(inner < 0){return -1;}
+  int e = __internal__NewPathExpression(p->Path, AJ_PATH_NOT);
+  p->Path->Expressions[e].Left = inner;
+  return e;
+}
+
+int __internal__ParsePathAnd(struct __internal__PathParser * p){
+  int left = __internal__ParsePathNot(p);
+  while(left >= 0){
+    p->i = __internal__SkipSpace(p->s, p->i);
+    if(p->s[p->i] != '&' || p->s[p->i + 1] != '&'){break;}
+    p->i += 2;
+    int right = __internal__ParsePathNot(p);
+    if(right < 0){return -1;}
+    int e = __internal__NewPathExpression(p->Path, AJ_PATH_AND);
+    p->Path->Expressions[e].Left = left;
+    p->Path->Expressions[e].Right = right;
+    left = e;
+  }
+  return left;
+}
+
+//a whole filter expression. -1 on a syntax error
+int __internal__ParsePathOr(struct __internal__PathParser * p){
+  int left = __internal__ParsePathAnd(p);
+  while(left >= 0){
+    p->i = __internal__SkipSpace(p->s, p->i);
+    if(p->s[p->i] != '|' || p->s[p->i + 1] != '|'){break;}
+    p->i += 2;
+    int right = __internal__ParsePathAnd(p);
+    if(right < 0){return -1;}
+    int e = __internal__NewPathExpression(p->Path, AJ_PATH_OR);
+    p->Path->Expressions[e].Left = left;
+    p->Path->Expressions[e].Right = right;
+    left = e;
+  }
+  return left;
+}
+
+//one selector inside [ ]
+int __internal__ParsePathSelector(struct __internal__PathParser * p, struct __internal__PathSelector * selector){
+  const char * s = p->s;
+  memset(selector, 0, sizeof(struct __internal__PathSelector));
+  selector->Step = 1;
+  if(s[p->i] == '\'' || s[p->i] == '"'){return __internal__ParsePathString(p, selector);}
+  if(s[p->i] == '*'){
+    selector->Kind = AJ_PATH_WILDCARD;
+    p->i++;
+    return 1;
+  }
+  if(s[p->i] == '?'){
+    p->i++;
+    selector->Kind = AJ_PATH_FILTER;
+    selector->Filter = __internal__ParsePathOr(p);
+    return selector->Filter >= 0;
+  }
+  selector->HasStart = __internal__ParsePathInt(p, &selector->Start);
+  p->i = __internal__SkipSpace(s, p->i);
+  if(s[p->i] != ':'){
+    selector->Kind = AJ_PATH_INDEX;
+    return selector->HasStart;
+  }
+  selector->Kind = AJ_PATH_SLICE;
+  p->i = __internal__SkipSpace(s, p->i + 1);
+  selector->HasEnd = __internal__ParsePathInt(p, &selector->End);
+  p->i = __internal__SkipSpace(s, p->i);
+  if(s[p->i] == ':'){
+    p->i = __internal__SkipSpace(s, p->i + 1);
+    if((s[p->i] == '-' || __internal__IsDigit(s[p->i])) && !__internal__ParsePathInt(p, &selector->Step)){return 0;}
+  }
+  return 1;
+}
+
+//.name, .*, [...], or any of those after ..
+int __internal__ParsePathSegment(struct __internal__PathParser * p){
+  struct AJPath * path = p->Path;
+  const char * s = p->s;
+  struct __internal__PathSegment segment;
+  segment.Descendant = 0;
+  segment.FirstSelector = path->SelectorCount;
+  segment.SelectorCount = 0;
+  int dotted = 0;
+  if(s[p->i] == '.' && s[p->i + 1] == '.'){
+    segment.Descendant = 1;
+    p->i += 2;
+    dotted = s[p->i] != '[';
+  }else if(s[p->i] == '.'){
+    p->i++;
+    dotted = 1;
+  }else if(s[p->i] != '['){
+    return 0;
+  }
+  if(dotted){
+    struct __internal__PathSelector selector;
+    memset(&selector, 0, sizeof(selector));
+    if(s[p->i] == '*'){
+      selector.Kind = AJ_PATH_WILDCARD;
+      p->i++;
+    }else{
+      int start = p->i;
+      while(__internal__IsPathNameChar(s[p->i])){p->i++;}
+      if(p->i == start || __internal__IsDigit(s[start])){return 0;}
+      __internal__SetPathName(path, &selector, &s[start], p->i - start, 0);
+    }
+    path->Selectors = (struct __internal__PathSelector *)__internal__GrowArray(path->Selectors, path->SelectorCount, &path->SelectorCapacity, 1, sizeof(struct __internal__PathSelector));
+    path->Selectors[path->SelectorCount++] = selector;
+    segment.SelectorCount = 1;
+  }else{
+    p->i++;
+    while(1){ //filters only add expressions and steps, so a segment's selectors stay next to each other
+      p->i = __internal__SkipSpace(s, p->i);
+      struct __internal__PathSelector selector;
+      if(!__internal__ParsePathSelector(p, &selector)){return 0;}
+      path->Selectors = (struct __internal__PathSelector *)__internal__GrowArray(path->Selectors, path->SelectorCount, &path->SelectorCapacity, 1, sizeof(struct __internal__PathSelector));
+      path->Selectors[path->SelectorCount++] = selector;
+      segment.SelectorCount++;
+      p->i = __internal__SkipSpace(s, p->i);
+      if(s[p->i] == ']'){break;}
+      if(s[p->i++] != ','){return 0;}
+    }
+    p->i++;
+  }
+  path->Segments = (struct __internal__PathSegment *)__internal__GrowArray(path->Segments, path->SegmentCount, &path->SegmentCapacity, 1, sizeof(struct __internal__PathSegment));
+  path->Segments[path->SegmentCount++] = segment;
+  return 1;
+}
+
+//compiles a JSONPath query like "$.orders[?(@.total > 100)].id". NULL on a syntax error
+struct AJPath * CompileAJPath(char * query){
+  struct AJPath * path = (struct AJPath *)__internal__Malloc(sizeof(struct AJPath));
+  memset(path, 0, sizeof(struct AJPath));
+  struct __internal__PathParser p;
+  p.Path = path;
+  p.s = query;
+  p.i = __internal__SkipSpace(query, 0);
+  int ok = query[p.i++] == '$';
+  while(ok){
+    p.i = __internal__SkipSpace(query, p.i);
+    if(query[p.i] == '\0'){break;}
+    ok = __internal__ParsePathSegment(&p);
+  }
+  if(!ok){
+    DeleteAJPath(path);
+    return NULL;
+  }
+  return path;
+}
+
+//the chars of str decoded like path names are. *decoded is non-NULL when a copy had to be made, free it afterwards
+static inline const char * __internal__PathStringChars(struct AJString * str, int escapeStrings, int * length, char ** decoded){
+  *decoded = NULL;
+  *length = str->length;
+  if(escapeStrings || !str->Raw){return str->string;}
+  *decoded = (char *)__internal__Malloc(str->length + 1);
+  *length = __internal__UnescapeChars(str->string, str->length, *decoded);
+  return *decoded;
+}
+
+void * __internal__PathMember(struct AJObject * ajo, const char * name, int length, int escapeStrings, int * type){
+  for(struct AJKeyValuePair * ajkvp = ajo->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+    int keyLength;
+    char * decoded;
+    const char * key = __internal__PathStringChars((struct AJString *)ajkvp->key, escapeStrings, &keyLength, &decoded);
+    int found = keyLength == length && memcmp(key, name, length) == 0;
+    __internal__Free(decoded);
+    if(found){
+      *type = ajkvp->ValueType;
+      return ajkvp->value;
+    }
+  }
+  return NULL;
+}
+
+void * __internal__PathElement(struct AJArray * aja, int index, int * type, struct AJNumber * packed){
+  if(index < 0){index += aja->length;}
+  if(index < 0 || index >= aja->length){return NULL;}
+  if(aja->PackedNumbers != NULL){
+    packed->number = aja->PackedNumbers[index];
+    packed->Lexeme = NULL;
+    *type = TYPE_NUMBER;
+    return packed;
+  }
+  struct AJArrayElement * el = aja->FirstElement;
+  while(index-- > 0){el = el->NextAJElement;}
+  *type = el->ArrayElementType;
+  return el->ArrayElement;
+}
+
+static inline int __internal__InPathSlice(struct __internal__PathSelector * selector, int index, int length){
+  int step = selector->Step;
+  if(step == 0){return 0;}
+  long long start = selector->Start < 0 ? (long long)length + selector->Start : selector->Start;
+  long long end = selector->End < 0 ? (long long)length + selector->End : selector->End;
+  if(step > 0){
+    long long lower = !selector->HasStart ? 0 : start < 0 ? 0 : start > length ? length : start;
+    long long upper = !selector->HasEnd ? length : end < 0 ? 0 : end > length ? length : end;
+    return index >= lower && index < upper && (index - lower) % step == 0;
+  }
+  long long upper = !selector->HasStart ? length - 1 : start < -1 ? -1 : start > length - 1 ? length - 1 : start;
+  long long lower = !selector->HasEnd ? -1 : end < -1 ? -1 : end > length - 1 ? length - 1 : end;
+  return index <= upper && index > lower && (upper - index) % -(long long)step == 0;
+}
+
+struct __internal__PathState{
+  int Query;
+  int Segment; //the next segment to apply. SegmentCount: the query matched here
+};
+
+struct __internal__PathWalk{
+  struct AJPath ** Paths;
+  void * Root;
+  int RootType;
+  int EscapeStrings;
+  struct __internal__PathState * States; //a stack: each node's states sit above its parent's
+  int StateCount, StateCapacity;
+  void (*OnMatch)(int pathIndex, void * node, int type, void * UserPointer);
+  void * UserPointer;
+  int Matches;
+};
+
+//a filter query's value or a literal, ready to compare. Type -1: the query led nowhere
+struct __internal__PathOperand{
+  int Type;
+  void * Node;
+  double Number;
+  const char * Chars;
+  int Length;
+  char Truth;
+  char * Decoded;
+};
+
+void * __internal__FollowPathQuery(struct __internal__PathWalk * walk, struct AJPath * path, struct __internal__PathExpression * query, void * current, int currentType, int * type, struct AJNumber * packed){
+  void * node = query->FromRoot ? walk->Root : current;
+  *type = query->FromRoot ? walk->RootType : currentType;
+  for(int i = 0; i < query->StepCount && node != NULL; i++){
+    struct __internal__PathSelector * step = &path->Steps[query->FirstStep + i];
+    if(step->Kind == AJ_PATH_NAME && *type == TYPE_OBJECT){
+      node = __internal__PathMember((struct AJObject *)node, &path->Names[step->NameOffset], step->NameLength, walk->EscapeStrings, type);
+    }else if(step->Kind == AJ_PATH_INDEX && *type == TYPE_ARRAY){
+      node = __internal__PathElement((struct AJArray *)node, step->Start, type, packed);
+    }else{
+      node = NULL;
+    }
+  }
+  return node;
+}
+
+void __internal__ResolvePathOperand(struct __internal__PathWalk * walk, struct AJPath * path, int e, void * current, int currentType, struct __internal__PathOperand * out){
+  struct __internal__PathExpression * expression = &path->Expressions[e];
+  out->Decoded = NULL;
+  if(expression->Kind == AJ_PATH_LITERAL){
+    out->Type = expression->LiteralType;
+    out->Number = expression->Number;
+    out->Truth = expression->Truth;
+    out->Chars = path->Names != NULL ? &path->Names[expression->StringOffset] : NULL;
+    out->Length = expression->StringLength;
+    return;
+  }
+  struct AJNumber packed;
+  int type;
+  out->Node = __internal__FollowPathQuery(walk, path, expression, current, currentType, &type, &packed);
+  out->Type = out->Node != NULL ? type : -1;
+  switch(out->Type){
+    case TYPE_NUMBER: out->Number = AJNumberGetDouble((struct AJNumber *)out->Node); break;
+    case TYPE_BOOLEAN: out->Truth = ((struct AJBoolean *)out->Node)->TruthValue; break;
+    case TYPE_STRING: out->Chars = __internal__PathStringChars((struct AJString *)out->Node, walk->EscapeStrings, &out->Length, &out->Decoded); break;
+  }
+}
+
+int __internal__PathOperandsEqual(struct __internal__PathOperand * a, struct __internal__PathOperand * b){
+  if(a->Type != b->Type){return 0;}
+  switch(a->Type){
+    case -1: return 1; //nothing == nothing
+    case TYPE_NUMBER: return a->Number == b->Number;
+    case TYPE_STRING: return a->Length == b->Length && memcmp(a->Chars, b->Chars, a->Length) == 0;
+    case TYPE_BOOLEAN: return a->Truth == b->Truth;
+    case TYPE_NULL: return 1;
+  }
+  return AJEquals(a->Node, a->Type, b->Node, b->Type, 1);
+}
+
+//only numbers and strings (by code point, which is UTF-8 byte order) have an order
+int __internal__PathOperandLess(struct __internal__PathOperand * a, struct __internal__PathOperand * b){
+  if(a->Type != b->Type){return 0;}
+  if(a->Type == TYPE_NUMBER){return a->Number < b->Number;}
+  if(a->Type != TYPE_STRING){return 0;}
+  int shorter = a->Length < b->Length ? a->Length : b->Length;
+  int compared = memcmp(a->Chars, b->Chars, shorter);
+  return compared < 0 || (compared == 0 && a->Length < b->Length);
+}
+
+//evaluates filter expression e with @ being current
+int __internal__PathFilter(struct __internal__PathWalk * walk, struct AJPath * path, int e, void * current, int currentType){
+  struct __internal__PathExpression * expression = &path->Expressions[e];
+  switch(expression->Kind){
+    case AJ_PATH_OR: return __internal__PathFilter(walk, path, expression->Left, current, currentType) || __internal__PathFilter(walk, path, expression->Right, current, currentType);
+    case AJ_PATH_AND: return __internal__PathFilter(walk, path, expression->Left, current, currentType) && __internal__PathFilter(walk, path, expression->Right, current, currentType);
+    case AJ_PATH_NOT: return !__internal__PathFilter(walk, path, expression->Left, current, currentType);
+    case AJ_PATH_EXISTS:{
+      struct AJNumber packed;
+      int type;
+      return __internal__FollowPathQuery(walk, path, &path->Expressions[expression->Left], current, currentType, &type, &packed) != NULL;
+    }
+    case AJ_PATH_COMPARE:{
+      struct __internal__PathOperand a, b;
+      __internal__ResolvePathOperand(walk, path, expression->Left, current, currentType, &a);
+      __internal__ResolvePathOperand(walk, path, expression->Right, current, currentType, &b);
+      int result = 0;
+      switch(expression->Op){
+        case AJ_PATH_EQUAL: result = __internal__PathOperandsEqual(&a, &b); break;
+        case AJ_PATH_NOT_EQUAL: result = !__internal__PathOperandsEqual(&a, &b); break;
+        case AJ_PATH_LESS: result = __internal__PathOperandLess(&a, &b); break;
+        case AJ_PATH_LESS_EQUAL: result = __internal__PathOperandLess(&a, &b) || __internal__PathOperandsEqual(&a, &b); break;
+        case AJ_PATH_GREATER: result = __internal__PathOperandLess(&b, &a); break;
+        case AJ_PATH_GREATER_EQUAL: result = __internal__PathOperandLess(&b, &a) || __internal__PathOperandsEqual(&a, &b); break;
+      }
+      __internal__Free(a.Decoded);
+      __internal__Free(b.Decoded);
+      return result;
+    }
+  }
+  return 0;
+}
+
+//does selector pick this child? key is NULL for array elements (index of length)
+int __internal__PathSelects(struct __internal__PathWalk * walk, struct AJPath * path, struct __internal__PathSelector * selector, const char * key, int keyLength, unsigned int keyHash, int index, int length, void * child, int childType){
+  switch(selector->Kind){
+    case AJ_PATH_NAME: return key != NULL && selector->NameHash == keyHash && selector->NameLength == keyLength && memcmp(&path->Names[selector->NameOffset], key, keyLength) == 0;
+    case AJ_PATH_WILDCARD: return 1;
+    case AJ_PATH_INDEX: return key == NULL && (selector->Start < 0 ? selector->Start + length : selector->Start) == index;
+    case AJ_PATH_SLICE: return key == NULL && __internal__InPathSlice(selector, index, length);
+    case AJ_PATH_FILTER: return __internal__PathFilter(walk, path, selector->Filter, child, childType);
+  }
+  return 0;
+}
+
+void __internal__WalkPaths(struct __internal__PathWalk * walk, void * node, int type, int firstState, int stateCount);
+
+//works out which of the parent's states carry on into child, and visits it if any do
+void __internal__WalkPathChild(struct __internal__PathWalk * walk, int firstState, int stateCount, const char * key, int keyLength, unsigned int keyHash, int index, int length, void * child, int childType){
+  int childFirst = walk->StateCount;
+  int container = childType == TYPE_OBJECT || childType == TYPE_ARRAY;
+  for(int k = 0; k < stateCount; k++){
+    struct __internal__PathState state = walk->States[firstState + k]; //a copy: pushing can move States
+    struct AJPath * path = walk->Paths[state.Query];
+    if(state.Segment == path->SegmentCount){continue;}
+    struct __internal__PathSegment * segment = &path->Segments[state.Segment];
+    for(int s = 0; s < segment->SelectorCount; s++){
+      if(!__internal__PathSelects(walk, path, &path->Selectors[segment->FirstSelector + s], key, keyLength, keyHash, index, length, child, childType)){continue;}
+      walk->States = (struct __internal__PathState *)__internal__GrowArray(walk->States, walk->StateCount, &walk->StateCapacity, 1, sizeof(struct __internal__PathState));
+      walk->States[walk->StateCount].Query = state.Query;
+      walk->States[walk->StateCount++].Segment = state.Segment + 1;
+    }
+    if(segment->Descendant && container){ //.. keeps looking further down
+      walk->States = (struct __internal__PathState *)__internal__GrowArray(walk->States, walk->StateCount, &walk->StateCapacity, 1, sizeof(struct __internal__PathState));
+      walk->States[walk->StateCount++] = state;
+    }
+  }
+  if(walk->StateCount > childFirst){
+    __internal__WalkPaths(walk, child, childType, childFirst, walk->StateCount - childFirst);
+  }
+  walk->StateCount = childFirst;
+}
+
+void __internal__WalkPaths(struct __internal__PathWalk * walk, void * node, int type, int firstState, int stateCount){
+  for(int k = 0; k < stateCount; k++){
+    struct __internal__PathState state = walk->States[firstState + k];
+    if(state.Segment == walk->Paths[state.Query]->SegmentCount){
+      walk->Matches++;
+      walk->OnMatch(state.Query, node, type, walk->UserPointer);
+    }
+  }
+  if(type == TYPE_OBJECT){
+    for(struct AJKeyValuePair * ajkvp = ((struct AJObject *)node)->FirstAJKVP; ajkvp != NULL; ajkvp = ajkvp->NextAJKVP){
+      int keyLength;
+      char * decoded;
+      const char * key = __internal__PathStringChars((struct AJString *)ajkvp->key, walk->EscapeStrings, &keyLength, &decoded);
+      __internal__WalkPathChild(walk, firstState, stateCount, key, keyLength, __internal__HashBytes(key, keyLength, AJ_FNV_OFFSET_BASIS), 0, 0, ajkvp->value, ajkvp->ValueType);
+      __internal__Free(decoded);
+    }
+  }else if(type == TYPE_ARRAY){
+    struct AJArray * aja = (struct AJArray *)node;
+    struct AJArrayElement * el = aja->FirstElement;
+    struct AJNumber packed;
+    for(int i = 0; i < aja->length; i++){
+      int elementType;
+      void * element = __internal__NextArrayValue(aja, i, &el, &packed, &elementType);
+      __internal__WalkPathChild(walk, firstState, stateCount, NULL, 0, 0, i, aja->length, element, elementType);
+    }
+  }
+}
+
+//runs pathCount compiled queries over root in one walk. onMatch gets each match with the index of the query (in paths) it
+//matched. returns the number of matches
+int AJEvaluatePaths(struct AJPath ** paths, int pathCount, void * root, int rootType, void (*onMatch)(int pathIndex, void * node, int type, void * UserPointer), void * UserPointer){
+  struct __internal__PathWalk walk;
+  walk.Paths = paths;
+  walk.Root = root;
+  walk.RootType = rootType;
+  walk.EscapeStrings = AJGetContext()->EscapeStrings;
+  walk.OnMatch = onMatch;
+  walk.UserPointer = UserPointer;
+  walk.Matches = 0;
+  walk.StateCapacity = 0;
+  walk.States = (struct __internal__PathState *)__internal__GrowArray(NULL, 0, &walk.StateCapacity, pathCount, sizeof(struct __internal__PathState));
+  for(int i = 0; i < pathCount; i++){
+    walk.States[i].Query = i;
+    walk.States[i].Segment = 0;
+  }
+  walk.StateCount = pathCount;
+  __internal__WalkPaths(&walk, root, rootType, 0, pathCount);
+  __internal__Free(walk.States);
+  return walk.Matches;
+}
+
+void __internal__CollectPathMatch(int pathIndex, void * node, int type, void * UserPointer){
+  (void)pathIndex; //AJQuery runs one query
+  struct AJArray * matches = (struct AJArray *)UserPointer;
+  AddToAJArray(matches, AJClone(node, type), type, matches->length);
+}
+
+//the matches of one JSONPath query, copied into a new array. NULL if the query doesnt compile
+struct AJArray * AJQuery(char * query, void * root, int rootType){
+  struct AJPath * path = CompileAJPath(query);
+  if(path == NULL){return NULL;}
+  struct AJArray * matches = CreateAJArray();
+  AJEvaluatePaths(&path, 1, root, rootType, __internal__CollectPathMatch, matches);
+  DeleteAJPath(path);
+  return matches;
+}
+
+typedef struct AJString AJString;
+typedef struct AJNumber AJNumber;
+typedef struct AJArray AJArray;
+typedef struct AJObject AJObject;
+typedef struct AJBoolean AJBoolean;
+typedef struct AJNull AJNull;
+typedef struct AJArrayElement AJArrayElement;
+typedef struct AJKeyValuePair AJKeyValuePair;
+
+// #define TESTING_AROLAN_JSON
+#ifdef TESTING_AROLAN_JSON
+//the text of a tree or scalar in a new heap buffer, for comparing outputs in the tests below. free it with AJFree
+char * TestAJText(void * node, int type){
+  int length = 16;
+  char * text = (char *)AJAlloc(length);
+  text[0] = '\0';
+  if(type == TYPE_OBJECT){
+    WriteAJObjectAsStringToBuffer((struct AJObject *)node, &text, &length, 0);
+  }else if(type == TYPE_ARRAY){
+    WriteAJArrayAsStringToBuffer((struct AJArray *)node, &text, &length, 0);
+  }else{
+    WritePrimitiveTypeAsStringToBuffer(node, type, &text, &length, 0);
+  }
+  return text;
+}
+
+//an allocator that counts the blocks still live in UserPointer (a long). the lock is for the reclaimer thread freeing while the test allocates
+#ifdef AJ_HAVE_PTHREADS
+pthread_mutex_t TestAllocLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+void TestCountAlloc(void * UserPointer, long change){
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_lock(&TestAllocLock);
+#endif
+  *(long *)UserPointer += change;
+#ifdef AJ_HAVE_PTHREADS
+  pthread_mutex_unlock(&TestAllocLock);
+#endif
+}
+void * TestCountingAlloc(size_t size, void * UserPointer){TestCountAlloc(UserPointer, 1); return malloc(size);}
+void * TestCountingRealloc(void * ptr, size_t newSize, void * UserPointer){
+  if(ptr == NULL){TestCountAlloc(UserPointer, 1);}
+  return realloc(ptr, newSize);
+}
+void TestCountingFree(void * ptr, void * UserPointer){
+  if(ptr != NULL){TestCountAlloc(UserPointer, -1);}
+  free(ptr);
+}
+
+//bound structs for the binding tests: small capacities so overflows are easy to write
+struct TestPoint{ double x, y; };
+struct TestShape{ long long id; char name[8]; struct TestPoint points[2]; int pointCount; char closed; signed char level; float weight; };
+static struct AJFieldBinding TestPointFields[] = { AJ_BIND_FIELD(struct TestPoint, x, AJ_FIELD_NUMBER), AJ_BIND_FIELD(struct TestPoint, y, AJ_FIELD_NUMBER) };
+static struct AJStructBinding TestPointBinding = AJ_STRUCT_BINDING(TestPointFields);
+static struct AJFieldBinding TestShapeFields[] = {
+  AJ_BIND_FIELD(struct TestShape, id, AJ_FIELD_INT),
+  AJ_BIND_FIELD(struct TestShape, name, AJ_FIELD_STRING),
+  AJ_BIND_ARRAY(struct TestShape, points, AJ_FIELD_OBJECT, pointCount, &TestPointBinding),
+  AJ_BIND_FIELD_NAMED(struct TestShape, closed, "isClosed", AJ_FIELD_BOOL),
+  AJ_BIND_FIELD(struct TestShape, level, AJ_FIELD_INT),
+  AJ_BIND_FIELD(struct TestShape, weight, AJ_FIELD_NUMBER),
+};
+static struct AJStructBinding TestShapeBinding = AJ_STRUCT_BINDING(TestShapeFields);
+struct TestBroken{ short x; };
+static struct AJFieldBinding TestBrokenFields[] = { AJ_BIND_FIELD(struct TestBroken, x, AJ_FIELD_NUMBER) }; //a short cant take a number
+static struct AJStructBinding TestBrokenBinding = AJ_STRUCT_BINDING(TestBrokenFields);
+
+//onMatch for the path tests: copies each match into the array for its query
+void TestCollectPathMatches(int pathIndex, void * node, int type, void * UserPointer){
+  AJArray ** matches = (AJArray **)UserPointer;
+  AddToAJArray(matches[pathIndex], AJClone(node, type), type, matches[pathIndex]->length);
+}
+
+//small test suite
+int main(){
+  char * JSONFile = LoadJSONFromFile("test.json");
+  AJNumber * nu = CreateAJNumber(11.17f);
+  AJString * st = CreateAJString("Eni To Ba Da Omi Siwaju ");
+  AJBoolean * bo = CreateAJBoolean("TRUE");
+  AJNull * nul = CreateAJNull();
+
+  int hold = 0;
+  AJArray * aja = ParseNewAJArray(0, "[{'a':1},{'b':2},{'c':3},{'d':4},{'e':5}]", &hold);
+
+  hold = 0;
+  AJObject * ajo = ParseNewAJObject(0, "{ 'key1' :  1, 'key2' : null, 'arraykey' : [{'false':true}], 'objectkey': {'subkey1' : false, 'subkey2' : 20} }", &hold);
+  // AJObject * ajo = ParseNewAJObject(0, "{'a':'b'}", &hold);
+  // AJObject * ajo = ParseNewAJObject(0, JSONFile, &hold);
+
+  // PrettyPrintAJObject(ajo, 0);
+
+  int len = 1;
+  char * buf = (char*)malloc(sizeof(char) * len);
+  // memset(buf, '\0', len);
+
+  int bytes_written = 0;
+  int pos = 0;
+  pos += WriteAJObjectAsStringToBuffer(ajo, &buf, &len, pos) - 1;
+  // pos += WriteAJArrayAsStringToBuffer(aja, buf, &len, pos) - 1;
+
+  int len2 = 100;
+  char * buf2 = (char*)malloc(sizeof(char) * len);
+  int f = 16843009;
+  AppendToBuffer_WithKnownLengthOfInput((char*)&f, 4, &buf2, &len2, 0);
+
+
+  printf("%s\n", buf2);
+
+  //schemas: every document goes through the text validator and through a parsed tree, and both have to agree with expected
+  struct {const char * schema; const char * document; int expected;} schemaTests[] = {
+    {"{\"type\":\"object\"}", "{}", 1},
+    {"{\"type\":\"array\"}", "{}", 0},
+    {"{\"type\":[\"string\",\"null\"]}", "null", 1},
+    {"{\"type\":\"integer\"}", "3.0", 1},
+    {"{\"type\":\"integer\"}", "3.5", 0},
+    {"{\"required\":[\"a\",\"b\"]}", "{\"a\":1,\"b\":2}", 1},
+    {"{\"required\":[\"a\",\"b\"]}", "{\"a\":1}", 0},
+    {"{\"properties\":{\"a\":{\"type\":\"number\"}},\"additionalProperties\":false}", "{\"a\":1}", 1},
+    {"{\"properties\":{\"a\":{\"type\":\"number\"}},\"additionalProperties\":false}", "{\"a\":1,\"b\":2}", 0},
+    {"{\"properties\":{\"a\":{\"type\":\"number\"}}}", "{\"a\":\"1\"}", 0},
+    {"{\"minimum\":1,\"exclusiveMaximum\":10}", "1", 1},
+    {"{\"minimum\":1,\"exclusiveMaximum\":10}", "10", 0},
+    {"{\"minimum\":1,\"exclusiveMaximum\":10}", "0.5", 0},
+    {"{\"maxLength\":3}", "\"\\u00e9t\u00e9\"", 1},
+    {"{\"minItems\":1,\"maxItems\":2,\"items\":{\"type\":\"string\"}}", "[\"a\",\"b\"]", 1},
+    {"{\"minItems\":1,\"maxItems\":2,\"items\":{\"type\":\"string\"}}", "[]", 0},
+    {"{\"minItems\":1,\"maxItems\":2,\"items\":{\"type\":\"string\"}}", "[\"a\",1]", 0},
+    {"{\"multipleOf\":0.1}", "0.3", 1},
+    {"{\"multipleOf\":0.1}", "0.35", 0},
+    {"{\"multipleOf\":1}", "0.0000000001", 0},
+    {"{\"multipleOf\":3}", "-9", 1},
+#ifdef AJ_HAVE_REGEX
+    {"{\"pattern\":\"^\\\\d{3}-[a-z]+$\"}", "\"123-abc\"", 1},
+    {"{\"pattern\":\"^\\\\d{3}-[a-z]+$\"}", "\"12-abc\"", 0},
+#endif
+    {"{\"enum\":[1,\"two\",[3]]}", "[3]", 1},
+    {"{\"enum\":[1,\"two\",[3]]}", "\"three\"", 0},
+    {"{\"anyOf\":[{\"type\":\"string\"},{\"minimum\":5}],\"not\":{\"const\":7}}", "6", 1},
+    {"{\"anyOf\":[{\"type\":\"string\"},{\"minimum\":5}],\"not\":{\"const\":7}}", "7", 0},
+    {"{\"oneOf\":[{\"type\":\"integer\"},{\"minimum\":0}]}", "1", 0},
+    {"{\"$defs\":{\"node\":{\"type\":\"object\",\"properties\":{\"next\":{\"$ref\":\"#/$defs/node\"}}}},\"$ref\":\"#/$defs/node\"}", "{\"next\":{\"next\":{}}}", 1},
+    {"{\"$defs\":{\"node\":{\"type\":\"object\",\"properties\":{\"next\":{\"$ref\":\"#/$defs/node\"}}}},\"$ref\":\"#/$defs/node\"}", "{\"next\":{\"next\":1}}", 0},
+  };
+  int schemaFailures = 0;
+  for(int i = 0; i < (int)(sizeof(schemaTests) / sizeof(schemaTests[0])); i++){
+    int end;
+    AJObject * schemaObject = ParseNewAJObject(0, (char *)schemaTests[i].schema, &end);
+    struct AJSchema * schema = CompileAJSchema(schemaObject);
+    DeleteAJObject(schemaObject);
+    if(schema == NULL){
+      printf("schema %d didnt compile\n", i);
+      schemaFailures++;
+      continue;
+    }
+    char * document = (char *)schemaTests[i].document;
+    char wrapped[256]; //the tree path parses the document as the value of "v"
+    snprintf(wrapped, sizeof(wrapped), "{\"v\":%s}", document);
+    AJObject * tree = ParseNewAJObject(0, wrapped, &end);
+    AJKeyValuePair * v = SearchObjectForKey("v", tree);
+    int textResult = AJValidateText(schema, 0, document, NULL);
+    int treeResult = AJValidate(schema, v->value, v->ValueType);
+    if(textResult != schemaTests[i].expected || treeResult != schemaTests[i].expected){
+      printf("schema %d on %s: text %d, tree %d, expected %d\n", i, document, textResult, treeResult, schemaTests[i].expected);
+      schemaFailures++;
+    }
+    DeleteAJObject(tree);
+    DeleteAJSchema(schema);
+  }
+  //keywords that would change the result but arent supported, and strict text syntax
+  const char * unsupportedSchemas[] = {"{\"uniqueItems\":true}", "{\"patternProperties\":{}}", "{\"if\":{},\"then\":{}}", "{\"contains\":{}}", "{\"propertyNames\":{}}", "{\"dependentRequired\":{}}", "{\"items\":[{}]}"};
+  for(int i = 0; i < (int)(sizeof(unsupportedSchemas) / sizeof(unsupportedSchemas[0])); i++){
+    int end;
+    AJObject * schemaObject = ParseNewAJObject(0, (char *)unsupportedSchemas[i], &end);
+    struct AJSchema * schema = CompileAJSchema(schemaObject);
+    if(schema != NULL){
+      printf("%s compiled\n", unsupportedSchemas[i]);
+      schemaFailures++;
+      DeleteAJSchema(schema);
+    }
+    DeleteAJObject(schemaObject);
+  }
+  const char * malformed[] = {"[01]", "[\"a\tb\"]", "[\"\\q\"]", "[\"\\u12g4\"]", "[1.]", "[-]", "{\"a\":1,}"};
+  AJObject * anythingObject = ParseNewAJObject(0, "{}", &hold);
+  struct AJSchema * anything = CompileAJSchema(anythingObject);
+  for(int i = 0; i < (int)(sizeof(malformed) / sizeof(malformed[0])); i++){
+    if(AJValidateText(anything, 0, (char *)malformed[i], NULL)){
+      printf("%s passed the text validator\n", malformed[i]);
+      schemaFailures++;
+    }
+  }
+  DeleteAJSchema(anything);
+  DeleteAJObject(anythingObject);
+  printf("schema tests: %d failed\n", schemaFailures);
+  int failures = schemaFailures;
+
+  //AJWriter: every char of calls is one call ({ } [ ] begin/end, k key "k", 1 Int64, d 0.5, s "a\"b", t true, z null,
+  //N NaN, v the tree [1,{"x":null}]). expected NULL means some call has to fail and leave the writer in error
+  struct {const char * calls; const char * expected;} writerTests[] = {
+    {"[11t]", "[ 1, 1, true ]"},
+    {"{k1k[z]}", "{ \"k\" : 1, \"k\" : [ null ] }"},
+    {"[{}[]s]", "[ {  }, [  ], \"a\\\"b\" ]"},
+    {"[[[1]][1]]", "[ [ [ 1 ] ], [ 1 ] ]"},
+    {"{kv}", "{ \"k\" : [ 1.000, { \"x\" : null } ] }"},
+    {"[d]", "[ 0.500 ]"},
+    {"s", "\"a\\\"b\""},
+    {"{1}", NULL},
+    {"[k]", NULL},
+    {"[}", NULL},
+    {"{k}", NULL},
+    {"]", NULL},
+    {"11", NULL},
+    {"[1]t", NULL},
+    {"[N]", NULL},
+  };
+  int writerFailures = 0;
+  AJArray * writerTree = ParseNewAJArray(0, "[1,{\"x\":null}]", &hold);
+  for(int i = 0; i < (int)(sizeof(writerTests) / sizeof(writerTests[0])); i++){
+    struct AJWriter * writer = CreateAJWriter(0);
+    int ok = 1;
+    for(const char * call = writerTests[i].calls; *call != '\0' && ok; call++){
+      switch(*call){
+        case '{': ok = AJWriterBeginObject(writer); break;
+        case '}': ok = AJWriterEndObject(writer); break;
+        case '[': ok = AJWriterBeginArray(writer); break;
+        case ']': ok = AJWriterEndArray(writer); break;
+        case 'k': ok = AJWriterKey(writer, "k"); break;
+        case '1': ok = AJWriterInt64(writer, 1); break;
+        case 'd': ok = AJWriterDouble(writer, 0.5); break;
+        case 's': ok = AJWriterString(writer, "a\"b"); break;
+        case 't': ok = AJWriterBoolean(writer, 1); break;
+        case 'z': ok = AJWriterNull(writer); break;
+        case 'N': ok = AJWriterDouble(writer, 0.0 / 0.0); break;
+        case 'v': ok = AJWriterValue(writer, writerTree, TYPE_ARRAY); break;
+      }
+    }
+    char * text = AJWriterGetText(writer, NULL);
+    if(writerTests[i].expected == NULL ? ok || !writer->Error : !ok || writer->Depth != 0 || strcmp(text, writerTests[i].expected) != 0){
+      printf("writer %d (%s): ok %d, wrote %s\n", i, writerTests[i].calls, ok, text);
+      writerFailures++;
+    }
+    DeleteAJWriter(writer);
+  }
+  DeleteAJArray(writerTree);
+  printf("writer tests: %d failed\n", writerFailures);
+  failures += writerFailures;
+
+  //AJReclaimer: queued trees are all freed, by AJReclaimNow or by the thread, with the allocator they were made with
+  struct {const char * document; int useThread; char pack; char inlineScalars;} reclaimerTests[] = {
+    {"{\"a\":[1,2,{\"b\":\"c\"}],\"d\":{\"e\":null}}", 0, 0, 0},
+    {"{\"a\":[1,2,{\"b\":\"c\"}],\"d\":{\"e\":null}}", 1, 0, 0},
+    {"{\"a\":[1.5,2,3],\"b\":[[true,false]]}", 0, 1, 1},
+    {"{\"a\":[1.5,2,3],\"b\":[[true,false]]}", 1, 1, 1},
+    {"{}", 0, 0, 0},
+  };
+  int reclaimerFailures = 0;
+  for(int i = 0; i < (int)(sizeof(reclaimerTests) / sizeof(reclaimerTests[0])); i++){
+    long live = 0;
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.Allocator.Alloc = TestCountingAlloc;
+    ctx.Allocator.Realloc = TestCountingRealloc;
+    ctx.Allocator.Free = TestCountingFree;
+    ctx.Allocator.UserPointer = &live;
+    ctx.PackNumericArrays = reclaimerTests[i].pack;
+    ctx.InlineScalars = reclaimerTests[i].inlineScalars;
+    struct AJContext * previous = AJSetContext(&ctx);
+    struct AJReclaimer * reclaimer = CreateAJReclaimer(reclaimerTests[i].useThread);
+    long empty = live;
+    for(int j = 0; j < 3; j++){
+      int end = 0;
+      AJDeleteLater(reclaimer, ParseNewAJObject(0, (char *)reclaimerTests[i].document, &end), TYPE_OBJECT);
+    }
+    AJDeleteLater(reclaimer, NULL, TYPE_OBJECT);
+    if(!reclaimerTests[i].useThread){
+      int reclaimed = AJReclaimNow(reclaimer);
+      if(reclaimed != 3 || live != empty){
+        printf("reclaimer %d: reclaimed %d trees, %ld blocks left\n", i, reclaimed, live - empty);
+        reclaimerFailures++;
+      }
+    }
+    DeleteAJReclaimer(reclaimer);
+    AJSetContext(previous);
+    if(live != 0){
+      printf("reclaimer %d: %ld blocks left after DeleteAJReclaimer\n", i, live);
+      reclaimerFailures++;
+    }
+  }
+  printf("reclaimer tests: %d failed\n", reclaimerFailures);
+  failures += reclaimerFailures;
+
+  //parallel writers: the same text (and return value) as the sequential ones, above and below AJ_PARALLEL_MIN_MEMBERS.
+  //kind 0: array of numbers, 1: array of objects, 2: {"rows" : array of objects, "n" : 1}
+  struct {int count; int kind; int threadCount; char pack; char inlineScalars;} parallelTests[] = {
+    {5000, 0, 4, 0, 0},
+    {5000, 0, 4, 1, 0},
+    {3000, 1, 3, 0, 1},
+    {2500, 2, 4, 0, 0},
+    {5000, 1, 1, 0, 0},
+    {10, 1, 4, 0, 0},
+    {0, 0, 4, 0, 0},
+  };
+  int parallelFailures = 0;
+  for(int i = 0; i < (int)(sizeof(parallelTests) / sizeof(parallelTests[0])); i++){
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.PackNumericArrays = parallelTests[i].pack;
+    ctx.InlineScalars = parallelTests[i].inlineScalars;
+    struct AJContext * previous = AJSetContext(&ctx);
+    struct AJWriter * documentWriter = CreateAJWriter(0);
+    if(parallelTests[i].kind == 2){
+      AJWriterBeginObject(documentWriter);
+      AJWriterKey(documentWriter, "rows");
+    }
+    AJWriterBeginArray(documentWriter);
+    for(int j = 0; j < parallelTests[i].count; j++){
+      if(parallelTests[i].kind == 0){
+        AJWriterDouble(documentWriter, j + 0.25);
+        continue;
+      }
+      AJWriterBeginObject(documentWriter);
+      AJWriterKey(documentWriter, "i");
+      AJWriterInt64(documentWriter, j);
+      AJWriterKey(documentWriter, "s");
+      AJWriterString(documentWriter, "a\tb");
+      AJWriterKey(documentWriter, "t");
+      AJWriterBeginArray(documentWriter);
+      AJWriterBoolean(documentWriter, 1);
+      AJWriterNull(documentWriter);
+      AJWriterEndArray(documentWriter);
+      AJWriterEndObject(documentWriter);
+    }
+    AJWriterEndArray(documentWriter);
+    if(parallelTests[i].kind == 2){
+      AJWriterKey(documentWriter, "n");
+      AJWriterInt64(documentWriter, 1);
+      AJWriterEndObject(documentWriter);
+    }
+    char * document = AJWriterGetText(documentWriter, NULL);
+    int end = 0;
+    int rootType = parallelTests[i].kind == 2 ? TYPE_OBJECT : TYPE_ARRAY;
+    void * root = rootType == TYPE_OBJECT ? (void *)ParseNewAJObject(0, document, &end) : (void *)ParseNewAJArray(0, document, &end);
+    char * sequential = TestAJText(root, rootType);
+    int parallelLength = 8;
+    char * parallel = (char *)AJAlloc(parallelLength);
+    memcpy(parallel, "abc", 4); //written after a prefix, like sequential writes into one buffer
+    int written = rootType == TYPE_OBJECT ? WriteAJObjectAsStringToBufferParallel((AJObject *)root, &parallel, &parallelLength, 3, parallelTests[i].threadCount)
+      : WriteAJArrayAsStringToBufferParallel((AJArray *)root, &parallel, &parallelLength, 3, parallelTests[i].threadCount);
+    if(strncmp(parallel, "abc", 3) != 0 || strcmp(&parallel[3], sequential) != 0 || written != (int)strlen(sequential) + 1){
+      printf("parallel %d: returned %d, text differs: %d\n", i, written, strcmp(&parallel[3], sequential) != 0);
+      parallelFailures++;
+    }
+    AJFree(parallel);
+    AJFree(sequential);
+    AJDelete(root, rootType);
+    DeleteAJWriter(documentWriter);
+    AJSetContext(previous);
+  }
+  printf("parallel tests: %d failed\n", parallelFailures);
+  failures += parallelFailures;
+
+  //AJTextCache: after every edit, the cached write has to give the same text as a write without the cache. edits:
+  //n users[0].score += 1, a push to the last user's tags, x add a number to meta.list, r remove users[0], o add a KVP to meta,
+  //d remove meta's first KVP, b flip meta.ok by hand (AJMarkDirty), p a patch, u a patch that fails and is rolled back
+  struct {const char * edits; char pack; char inlineScalars;} cacheTests[] = {
+    {"n", 0, 0},
+    {"nn", 0, 0},
+    {"a", 0, 0},
+    {"x", 0, 0},
+    {"x", 1, 0},
+    {"ar", 0, 0},
+    {"od", 0, 0},
+    {"b", 0, 0},
+    {"b", 0, 1},
+    {"pu", 0, 0},
+    {"nabxpodr", 0, 1},
+    {"nuxnux", 1, 1},
+  };
+  int cacheFailures = 0;
+  for(int i = 0; i < (int)(sizeof(cacheTests) / sizeof(cacheTests[0])); i++){
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.PackNumericArrays = cacheTests[i].pack;
+    ctx.InlineScalars = cacheTests[i].inlineScalars;
+    struct AJContext * previous = AJSetContext(&ctx);
+    struct AJTextCache * cache = CreateAJTextCache();
+    ctx.TextCache = cache;
+    int end = 0;
+    AJObject * root = ParseNewAJObject(0, "{\"users\":[{\"name\":\"ada lovelace\",\"tags\":[\"analyst\",\"engine\",\"notes\"],\"score\":1.5},"
+      "{\"name\":\"bob\",\"tags\":[\"p\",\"q\"],\"score\":2}],\"meta\":{\"count\":2,\"ok\":true,\"list\":[1,2,3],\"note\":\"long enough to be kept by the text cache\"}}", &end);
+    AJFree(TestAJText(root, TYPE_OBJECT)); //fills the cache
+    for(const char * edit = cacheTests[i].edits; *edit != '\0'; edit++){
+      AJArray * users = (AJArray *)SearchObjectForKey("users", root)->value;
+      AJObject * meta = (AJObject *)SearchObjectForKey("meta", root)->value;
+      switch(*edit){
+        case 'n':{
+          AJNumber * score = (AJNumber *)SearchObjectForKey("score", (AJObject *)users->FirstElement->ArrayElement)->value;
+          AJNumberSetDouble(score, score->number + 1);
+          break;
+        }
+        case 'a':{
+          AJArray * tags = (AJArray *)SearchObjectForKey("tags", (AJObject *)users->LastElement->ArrayElement)->value;
+          AddToAJArray(tags, CreateAJString("r"), TYPE_STRING, tags->length);
+          break;
+        }
+        case 'x': AddNumberToAJArray((AJArray *)SearchObjectForKey("list", meta)->value, 4, 0); break;
+        case 'r': RemoveFromAJArray(users, 0); break;
+        case 'o': AddToAJObject(meta, CreateAJKeyValuePair(CreateAJString("k"), TYPE_STRING, CreateAJNumber(7), TYPE_NUMBER), meta->AJKVPCount); break;
+        case 'd': RemoveFromAJObject(meta, 0); break;
+        case 'b':{
+          AJBoolean * ok = (AJBoolean *)SearchObjectForKey("ok", meta)->value;
+          ok->TruthValue = !ok->TruthValue;
+          AJMarkDirty(ok);
+          break;
+        }
+        case 'p':
+        case 'u':{
+          AJArray * patch = ParseNewAJArray(0, *edit == 'p' ? "[{\"op\":\"replace\",\"path\":\"/meta/note\",\"value\":\"patched\"}]"
+            : "[{\"op\":\"remove\",\"path\":\"/meta/list/0\"},{\"op\":\"add\",\"path\":\"/users/0/x\",\"value\":1},{\"op\":\"test\",\"path\":\"/nothing\",\"value\":1}]", &end);
+          void * patchRoot = root;
+          int patchRootType = TYPE_OBJECT;
+          AJApplyPatch(&patchRoot, &patchRootType, patch);
+          DeleteAJArray(patch);
+          break;
+        }
+      }
+      char * cached = TestAJText(root, TYPE_OBJECT);
+      ctx.TextCache = NULL;
+      char * uncached = TestAJText(root, TYPE_OBJECT);
+      ctx.TextCache = cache;
+      if(strcmp(cached, uncached) != 0){
+        printf("cache %d after %c: %s\ninstead of %s\n", i, *edit, cached, uncached);
+        cacheFailures++;
+      }
+      AJFree(cached);
+      AJFree(uncached);
+    }
+    DeleteAJObject(root);
+    DeleteAJTextCache(cache);
+    AJSetContext(previous);
+  }
+  printf("cache tests: %d failed\n", cacheFailures);
+  failures += cacheFailures;
+
+  //ReparseAJObject: edits applied one after another to the same document (each replaces find with replacement),
+  //every reparse has to give the same text as parsing the whole new document. keepsRoot: only a container inside was parsed again
+  struct {const char * find; const char * replacement; int keepsRoot;} reparseTests[] = {
+    {"2,{", "25,{", 1},
+    {"\"x\"", "\"xyz\"", 1},
+    {"true", "false", 1},
+    {"\"d\"", "\"n\":0,\"d\"", 1},
+    {"25,", "25],\"z\":[", 0}, //moves a bracket: the array around it doesnt line up anymore
+    {",\"e\":\"str\"", "", 0},
+    {"}}", "},\"f\":1}", 0}, //reaches the root's bracket
+    {"1,25", " 1,25", 1},
+    {"null", "{\"deep\":[[[]]]}", 1},
+    {"[]", "[7]", 1},
+  };
+  int reparseFailures = 0;
+  char reparseTextA[256] = "{\"a\":[1,2,{\"b\":\"x\"}],\"c\":{\"d\":[true,null]},\"e\":\"str\"}";
+  char reparseTextB[256];
+  char * reparseTexts[2] = {reparseTextA, reparseTextB}; //the old and new text swap every edit
+  struct AJContext reparseContext;
+  AJInitContext(&reparseContext);
+  struct AJSourceMap * sourceMap = CreateAJSourceMap();
+  reparseContext.SourceMap = sourceMap;
+  struct AJContext * beforeReparse = AJSetContext(&reparseContext);
+  AJObject * reparsed = ParseNewAJObject(0, reparseTexts[0], &hold);
+  for(int i = 0; i < (int)(sizeof(reparseTests) / sizeof(reparseTests[0])); i++){
+    char * oldText = reparseTexts[i % 2];
+    char * newText = reparseTexts[(i + 1) % 2];
+    char * found = strstr(oldText, reparseTests[i].find);
+    if(found == NULL){
+      printf("reparse %d: %s isnt in %s\n", i, reparseTests[i].find, oldText);
+      reparseFailures++;
+      break;
+    }
+    int editStart = found - oldText;
+    int oldEditEnd = editStart + strlen(reparseTests[i].find);
+    snprintf(newText, 256, "%.*s%s%s", editStart, oldText, reparseTests[i].replacement, &oldText[oldEditEnd]);
+    AJObject * before = reparsed;
+    reparsed = ReparseAJObject(reparsed, newText, editStart, oldEditEnd, editStart + strlen(reparseTests[i].replacement));
+    reparseContext.SourceMap = NULL; //the full parse must not replace the document in the map
+    AJObject * full = ParseNewAJObject(0, newText, &hold);
+    reparseContext.SourceMap = sourceMap;
+    char * reparsedText = TestAJText(reparsed, TYPE_OBJECT);
+    char * fullText = TestAJText(full, TYPE_OBJECT);
+    if(strcmp(reparsedText, fullText) != 0 || (reparsed == before) != reparseTests[i].keepsRoot){
+      printf("reparse %d of %s: %s\ninstead of %s (root kept: %d)\n", i, newText, reparsedText, fullText, reparsed == before);
+      reparseFailures++;
+    }
+    AJFree(reparsedText);
+    AJFree(fullText);
+    DeleteAJObject(full);
+  }
+  DeleteAJObject(reparsed);
+  DeleteAJSourceMap(sourceMap);
+  AJSetContext(beforeReparse);
+  printf("reparse tests: %d failed\n", reparseFailures);
+  failures += reparseFailures;
+
+  //AJClone / AJCloneToDocument: the copy writes the same text as the original under every storage option, editing the copy
+  //leaves the original alone, and the document copy takes exactly the arena space it was measured at
+  struct {char pack; char inlineScalars; char shapes; char lexemes; char escapeStrings;} cloneTests[] = {
+    {0, 0, 0, 0, 0},
+    {1, 0, 0, 0, 0},
+    {0, 1, 0, 0, 0},
+    {0, 0, 1, 0, 0},
+    {0, 0, 0, 1, 0},
+    {0, 0, 0, 0, 1},
+    {1, 1, 1, 1, 1},
+  };
+  int cloneFailures = 0;
+  for(int i = 0; i < (int)(sizeof(cloneTests) / sizeof(cloneTests[0])); i++){
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.PackNumericArrays = cloneTests[i].pack;
+    ctx.InlineScalars = cloneTests[i].inlineScalars;
+    ctx.Shapes = cloneTests[i].shapes ? CreateAJShapeTable() : NULL;
+    ctx.KeepNumberLexemes = cloneTests[i].lexemes;
+    ctx.EscapeStrings = cloneTests[i].escapeStrings;
+    struct AJContext * previous = AJSetContext(&ctx);
+    int end = 0;
+    AJObject * original = ParseNewAJObject(0, "{\"n\":[1,2.5,-0.10,1e2],\"s\":\"a\\nb \\u00e9 a long string that is not inline\",\"t\":true,\"z\":null,"
+      "\"recs\":[{\"a\":1,\"b\":\"x\"},{\"a\":2,\"b\":\"y\"},{\"a\":3,\"b\":\"z\"}],\"e\":{},\"ea\":[]}", &end);
+    char * originalText = TestAJText(original, TYPE_OBJECT);
+    AJObject * clone = (AJObject *)AJClone(original, TYPE_OBJECT);
+    char * cloneText = TestAJText(clone, TYPE_OBJECT);
+    RemoveFromAJObject(clone, 0);
+    AJArray * cloneRecs = (AJArray *)SearchObjectForKey("recs", clone)->value;
+    RemoveFromAJObject((AJObject *)cloneRecs->FirstElement->ArrayElement, 0);
+    char * originalAfter = TestAJText(original, TYPE_OBJECT);
+    struct AJDocument * doc = CreateAJDocument(0);
+    AJCloneToDocument(doc, original, TYPE_OBJECT);
+    char * docText = TestAJText(doc->Root, doc->RootType);
+    size_t measured = __internal__MeasureClone(original, TYPE_OBJECT);
+    if(strcmp(cloneText, originalText) != 0 || strcmp(originalAfter, originalText) != 0 || strcmp(docText, originalText) != 0
+      || doc->CurrentChunk->Used != measured){
+      printf("clone %d: %s\ndocument %s (%d of %d bytes)\nfrom %s\n", i, cloneText, docText, (int)doc->CurrentChunk->Used, (int)measured, originalText);
+      cloneFailures++;
+    }
+    AJFree(originalText);
+    AJFree(cloneText);
+    AJFree(originalAfter);
+    AJFree(docText);
+    DeleteAJDocument(doc);
+    DeleteAJObject(clone);
+    DeleteAJObject(original);
+    if(ctx.Shapes != NULL){DeleteAJShapeTable(ctx.Shapes);}
+    AJSetContext(previous);
+  }
+  printf("clone tests: %d failed\n", cloneFailures);
+  failures += cloneFailures;
+
+  //AJEquals / AJHash: a is parsed plainly, b once packed, inline and shaped and once with lexemes, so only what the JSON says
+  //can matter. equal values have to hash the same
+  struct {const char * a; const char * b; int ignoreKeyOrder; int expected;} equalsTests[] = {
+    {"1", "1.0", 0, 1},
+    {"1e0", "1", 0, 1},
+    {"-0", "0", 0, 1},
+    {"1", "\"1\"", 0, 0},
+    {"\"\\u0041\"", "\"A\"", 0, 1},
+    {"\"x\"", "\"y\"", 0, 0},
+    {"null", "false", 0, 0},
+    {"[]", "{}", 0, 0},
+    {"[1,2,3]", "[1,2,3]", 0, 1},
+    {"[1,2,3]", "[1,3,2]", 1, 0},
+    {"[1,2]", "[1,2,3]", 0, 0},
+    {"[-0,0.5]", "[0,0.50]", 0, 1},
+    {"{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 0, 0},
+    {"{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1, 1},
+    {"{\"a\":1}", "{\"a\":1,\"b\":2}", 1, 0},
+    {"{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9,\"j\":10}", "{\"j\":10,\"i\":9,\"h\":8,\"g\":7,\"f\":6,\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":1}", 1, 1},
+    {"{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9,\"j\":10}", "{\"j\":10,\"i\":9,\"h\":8,\"g\":7,\"f\":6,\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":0}", 1, 0},
+    {"{\"x\":[{\"p\":1,\"q\":[true,null]}]}", "{\"x\":[{\"q\":[true,null],\"p\":1}]}", 1, 1},
+    {"{\"x\":[{\"p\":1,\"q\":[true,null]}]}", "{\"x\":[{\"q\":[true,null],\"p\":1}]}", 0, 0},
+  };
+  int equalsFailures = 0;
+  struct AJContext plainContext, storedContexts[2];
+  AJInitContext(&plainContext);
+  plainContext.EscapeStrings = 1;
+  for(int s = 0; s < 2; s++){
+    AJInitContext(&storedContexts[s]);
+    storedContexts[s].EscapeStrings = 1;
+    storedContexts[s].PackNumericArrays = s == 0;
+    storedContexts[s].InlineScalars = s == 0;
+    storedContexts[s].Shapes = s == 0 ? CreateAJShapeTable() : NULL;
+    storedContexts[s].KeepNumberLexemes = s == 1;
+  }
+  for(int i = 0; i < (int)(sizeof(equalsTests) / sizeof(equalsTests[0])) * 2; i++){
+    int row = i / 2;
+    struct AJContext * storedContext = &storedContexts[i % 2];
+    char wrapped[256];
+    int end;
+    snprintf(wrapped, sizeof(wrapped), "{\"v\":%s}", equalsTests[row].a);
+    struct AJContext * previous = AJSetContext(&plainContext);
+    AJObject * treeA = ParseNewAJObject(0, wrapped, &end);
+    AJSetContext(storedContext);
+    snprintf(wrapped, sizeof(wrapped), "{\"v\":%s}", equalsTests[row].b);
+    AJObject * treeB = ParseNewAJObject(0, wrapped, &end);
+    AJSetContext(previous);
+    AJKeyValuePair * a = SearchObjectForKey("v", treeA);
+    AJKeyValuePair * b = SearchObjectForKey("v", treeB);
+    int ignore = equalsTests[row].ignoreKeyOrder;
+    int equal = AJEquals(a->value, a->ValueType, b->value, b->ValueType, ignore);
+    int reversed = AJEquals(b->value, b->ValueType, a->value, a->ValueType, ignore);
+    unsigned long long hashesA[2], hashesB[2];
+    AJHash128(a->value, a->ValueType, ignore, hashesA);
+    AJHash128(b->value, b->ValueType, ignore, hashesB);
+    int sameHash = AJHash(a->value, a->ValueType, ignore) == AJHash(b->value, b->ValueType, ignore) && hashesA[0] == hashesB[0] && hashesA[1] == hashesB[1];
+    if(equal != equalsTests[row].expected || reversed != equal || (equal && !sameHash)){
+      printf("equals %d/%d (%s, %s): %d, reversed %d, same hash %d\n", row, i % 2, equalsTests[row].a, equalsTests[row].b, equal, reversed, sameHash);
+      equalsFailures++;
+    }
+    DeleteAJObject(treeA);
+    AJSetContext(storedContext);
+    DeleteAJObject(treeB);
+    AJSetContext(previous);
+  }
+  DeleteAJShapeTable(storedContexts[0].Shapes);
+  printf("equals tests: %d failed\n", equalsFailures);
+  failures += equalsFailures;
+
+  //AJDiff -> AJApplyPatch (and AJMergeDiff -> AJApplyMergePatch where a merge patch can say it) has to turn a into b,
+  //plain and with packed arrays and inline scalars. identical documents give an empty patch
+  struct {const char * a; const char * b; int mergeable;} diffTests[] = {
+    {"{\"a\":1,\"b\":[1,2]}", "{\"a\":1,\"b\":[1,2]}", 1},
+    {"{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3,\"c\":[1]}", 1},
+    {"{\"a\":1,\"b\":{\"c\":true}}", "{\"b\":{\"c\":false,\"d\":null}}", 0},
+    {"{\"k~/\":1,\"x\":\"y\"}", "{\"k~/\":2}", 1},
+    {"{\"deep\":{\"er\":{\"est\":[1,{\"x\":1}]}}}", "{\"deep\":{\"er\":{\"est\":[1,{\"x\":2,\"y\":3}]}}}", 1},
+    {"[1,2,3,4,5]", "[1,3,4,6,5]", 0},
+    {"[1,2,3]", "[]", 0},
+    {"[]", "[{\"a\":1},[2],null]", 0},
+    {"[\"x\",\"y\",\"z\",\"w\"]", "[\"w\",\"z\",\"y\",\"x\"]", 0},
+    {"[{\"id\":1,\"n\":\"a\"},{\"id\":2,\"n\":\"b\"},{\"id\":3,\"n\":\"c\"}]", "[{\"id\":1,\"n\":\"A\"},{\"id\":2,\"n\":\"b\"},{\"id\":3,\"n\":\"C\"}]", 0},
+    {"[[1,2],[3,4]]", "[[1,2,5],[4]]", 0},
+    {"1", "\"one\"", 0},
+    {"{\"a\":[1,2]}", "[1,2]", 0},
+  };
+  int diffFailures = 0;
+  for(int i = 0; i < (int)(sizeof(diffTests) / sizeof(diffTests[0])) * 2; i++){
+    int row = i / 2;
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.PackNumericArrays = i % 2;
+    ctx.InlineScalars = i % 2;
+    struct AJContext * previous = AJSetContext(&ctx);
+    char wrapped[256];
+    int end, typeA, typeB;
+    snprintf(wrapped, sizeof(wrapped), "{\"v\":%s}", diffTests[row].a);
+    AJObject * treeA = ParseNewAJObject(0, wrapped, &end);
+    snprintf(wrapped, sizeof(wrapped), "{\"v\":%s}", diffTests[row].b);
+    AJObject * treeB = ParseNewAJObject(0, wrapped, &end);
+    void * a = DetachAJKVPValue(SearchObjectForKey("v", treeA), &typeA);
+    void * b = DetachAJKVPValue(SearchObjectForKey("v", treeB), &typeB);
+    int same = AJEquals(a, typeA, b, typeB, 1);
+    void * merged = diffTests[row].mergeable ? AJClone(a, typeA) : NULL;
+    AJArray * patch = AJDiff(a, typeA, b, typeB);
+    int applied = AJApplyPatch(&a, &typeA, patch);
+    if(!applied || !AJEquals(a, typeA, b, typeB, 1) || (same && patch->length != 0)){
+      char * patchText = TestAJText(patch, TYPE_ARRAY);
+      printf("diff %d/%d (%s to %s): applied %d, patch %s\n", row, i % 2, diffTests[row].a, diffTests[row].b, applied, patchText);
+      AJFree(patchText);
+      diffFailures++;
+    }
+    if(merged != NULL){
+      AJObject * mergePatch = AJMergeDiff((AJObject *)merged, (AJObject *)b);
+      if(!AJApplyMergePatch((AJObject *)merged, mergePatch) || !AJEquals(merged, TYPE_OBJECT, b, typeB, 1) || (same && mergePatch->AJKVPCount != 0)){
+        printf("merge diff %d/%d (%s to %s) didnt round trip\n", row, i % 2, diffTests[row].a, diffTests[row].b);
+        diffFailures++;
+      }
+      DeleteAJObject(mergePatch);
+      DeleteAJObject((AJObject *)merged);
+    }
+    DeleteAJArray(patch);
+    AJDelete(a, typeA);
+    AJDelete(b, typeB);
+    DeleteAJObject(treeA);
+    DeleteAJObject(treeB);
+    AJSetContext(previous);
+  }
+  printf("diff tests: %d failed\n", diffFailures);
+  failures += diffFailures;
+
+  //canonical JSON (RFC 8785): number formatting, escapes and UTF-16 key order, from the RFC's examples. every document is written
+  //with EscapeStrings off and with it on (and shapes), into a buffer and through an AJWriter
+  struct {const char * document; const char * expected;} canonicalTests[] = {
+    {"[1e30,4.50,2e-3,1e-27,0.000001,1e-7]", "[1e+30,4.5,0.002,1e-27,0.000001,1e-7]"},
+    {"[333333333.33333329,1E21,1e20,-0,0.1,5e-324]", "[333333333.3333333,1e+21,100000000000000000000,0,0.1,5e-324]"},
+    {"[1.7976931348623157e308,9007199254740992,-1.5e-9,123456789012345680000]", "[1.7976931348623157e+308,9007199254740992,-1.5e-9,123456789012345680000]"},
+    {"[\"\\b\\f\\u001f\\u0001\\n\\t\\\"\\\\\\/\"]", "[\"\\b\\f\\u001f\\u0001\\n\\t\\\"\\\\/\"]"},
+    {"[\"\\u20ac\\u00e9\", \"\xc3\xa9\", \"\\ud83d\\ude00\"]", "[\"\xe2\x82\xac\xc3\xa9\",\"\xc3\xa9\",\"\xf0\x9f\x98\x80\"]"},
+    {"{\"\\u20ac\":1,\"\\r\":2,\"\\ufb33\":3,\"1\":4,\"\\ud83d\\ude00\":5,\"\\u0080\":6,\"\\u00f6\":7,\"</script>\":8}",
+      "{\"\\r\":2,\"1\":4,\"</script>\":8,\"\xc2\x80\":6,\"\xc3\xb6\":7,\"\xe2\x82\xac\":1,\"\xf0\x9f\x98\x80\":5,\"\xef\xac\xb3\":3}"},
+    {"{\"b\":[{\"z\":null,\"a\":true}],\"a\":{\"c\":\"x\",\"b\":false}}", "{\"a\":{\"b\":false,\"c\":\"x\"},\"b\":[{\"a\":true,\"z\":null}]}"},
+    {"{\"ab\":1,\"a\":2,\"b\":3,\"\":4}", "{\"\":4,\"a\":2,\"ab\":1,\"b\":3}"},
+  };
+  int canonicalFailures = 0;
+  for(int i = 0; i < (int)(sizeof(canonicalTests) / sizeof(canonicalTests[0])) * 2; i++){
+    int row = i / 2;
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.EscapeStrings = i % 2;
+    ctx.Shapes = i % 2 ? CreateAJShapeTable() : NULL;
+    struct AJContext * previous = AJSetContext(&ctx);
+    char wrapped[512];
+    int end;
+    snprintf(wrapped, sizeof(wrapped), "{\"v\":%s}", canonicalTests[row].document);
+    AJObject * tree = ParseNewAJObject(0, wrapped, &end);
+    AJKeyValuePair * v = SearchObjectForKey("v", tree);
+    int length = 16;
+    char * text = (char *)AJAlloc(length);
+    int written = WriteAJValueAsCanonicalStringToBuffer(v->value, v->ValueType, &text, &length, 0);
+    struct AJWriter * writer = CreateAJWriter(0);
+    int streamed = AJWriterCanonicalValue(writer, v->value, v->ValueType);
+    if(!written || !streamed || strcmp(text, canonicalTests[row].expected) != 0 || strcmp(AJWriterGetText(writer, NULL), canonicalTests[row].expected) != 0){
+      printf("canonical %d/%d: %s\nand %s\ninstead of %s\n", row, i % 2, text, AJWriterGetText(writer, NULL), canonicalTests[row].expected);
+      canonicalFailures++;
+    }
+    DeleteAJWriter(writer);
+    AJFree(text);
+    DeleteAJObject(tree);
+    if(ctx.Shapes != NULL){DeleteAJShapeTable(ctx.Shapes);}
+    AJSetContext(previous);
+  }
+  printf("canonical tests: %d failed\n", canonicalFailures);
+  failures += canonicalFailures;
+
+  //struct bindings: documents that fit TestShape are written back through AJWriterStruct (expected), the rest have to fail
+  struct {const char * document; const char * expected;} bindingTests[] = {
+    {"{\"id\":7,\"name\":\"ab\",\"points\":[{\"x\":1,\"y\":2}],\"isClosed\":true,\"level\":-3,\"weight\":0.5}",
+      "{ \"id\" : 7, \"name\" : \"ab\", \"points\" : [ { \"x\" : 1.000, \"y\" : 2.000 } ], \"isClosed\" : true, \"level\" : -3, \"weight\" : 0.500 }"},
+    {"{ \"name\" : \"a\\u00e9\\n\", \"other\" : {\"x\":[1,{\"y\":\"}\"}]}, \"id\" : null, \"points\" : [] }",
+      "{ \"id\" : 0, \"name\" : \"a\xc3\xa9\\n\", \"points\" : [  ], \"isClosed\" : false, \"level\" : 0, \"weight\" : 0.000 }"},
+    {"{\"id\":-9223372036854775808,\"level\":127}",
+      "{ \"id\" : -9223372036854775808, \"name\" : \"\", \"points\" : [  ], \"isClosed\" : false, \"level\" : 127, \"weight\" : 0.000 }"},
+    {"{\"level\":128}", NULL},
+    {"{\"id\":9223372036854775808}", NULL},
+    {"{\"id\":1.5}", NULL},
+    {"{\"id\":1e2}", NULL},
+    {"{\"id\":+1}", NULL},
+    {"{\"id\":01}", NULL},
+    {"{\"id\":0x1}", NULL},
+    {"{\"id\":\"1\"}", NULL},
+    {"{\"isClosed\":1}", NULL},
+    {"{\"name\":\"12345678\"}", NULL},
+    {"{\"name\":7}", NULL},
+    {"{\"points\":[{\"x\":1},{\"x\":2},{\"x\":3}]}", NULL},
+    {"{\"points\":{\"x\":1}}", NULL},
+    {"{\"points\":[{\"x\":\"1\"}]}", NULL},
+    {"{\"id\":1,}", NULL},
+    {"{\"points\":[{\"x\":1},]}", NULL},
+    {"{\"id\" 1}", NULL},
+    {"{\"id\":1", NULL},
+    {"{\"other\":[1,2}", NULL},
+    {"[]", NULL},
+  };
+  int bindingFailures = 0;
+  for(int i = 0; i < (int)(sizeof(bindingTests) / sizeof(bindingTests[0])); i++){
+    struct TestShape shape;
+    memset(&shape, 0, sizeof(shape));
+    int end = 0;
+    int parsed = ParseJSONIntoStruct(&TestShapeBinding, &shape, 0, (char *)bindingTests[i].document, &end);
+    struct AJWriter * writer = CreateAJWriter(0);
+    int written = parsed && AJWriterStruct(writer, &TestShapeBinding, &shape);
+    if(bindingTests[i].expected == NULL ? parsed : !written || strcmp(AJWriterGetText(writer, NULL), bindingTests[i].expected) != 0){
+      printf("binding %d (%s): parsed %d, wrote %s\n", i, bindingTests[i].document, parsed, AJWriterGetText(writer, NULL));
+      bindingFailures++;
+    }
+    DeleteAJWriter(writer);
+  }
+  struct TestBroken broken;
+  struct AJWriter * brokenWriter = CreateAJWriter(0);
+  if(ParseJSONIntoStruct(&TestBrokenBinding, &broken, 0, "{\"x\":1}", &hold) || AJWriterStruct(brokenWriter, &TestBrokenBinding, &broken) || !brokenWriter->Error){
+    printf("a broken binding was used\n");
+    bindingFailures++;
+  }
+  DeleteAJWriter(brokenWriter);
+  printf("binding tests: %d failed\n", bindingFailures);
+  failures += bindingFailures;
+
+  //JSONPath: what AJQuery gives for each query on one document (expected NULL: the query must not compile), plain and with packed
+  //arrays. then all the queries together through AJEvaluatePaths have to give the same matches as one at a time
+  struct {const char * query; const char * expected;} pathTests[] = {
+    {"$.store.book[0].title", "[\"Sayings\"]"},
+    {"$['store']['bicycle'].color", "[\"red\"]"},
+    {"$.store.book[-1].author", "[\"Herman Melville\"]"},
+    {"$.store.book[*].price", "[8.95,12.99,8.99]"},
+    {"$..price", "[8.95,12.99,8.99,399]"},
+    {"$.store.bicycle.*", "[\"red\",399]"},
+    {"$.nums[1:4]", "[2,3,4]"},
+    {"$.nums[::-2]", "[1,3,5]"},
+    {"$.nums[1,0,1]", "[1,2,2]"},
+    {"$.nums[?@ > 2]", "[3,4,5]"},
+    {"$.store.book[?@.isbn].title", "[\"Moby Dick\"]"},
+    {"$.store.book[?@.price < 10 && @.category == 'fiction'].title", "[\"Moby Dick\"]"},
+    {"$.store.book[?!(@.price < 10)].title", "[\"Sword\"]"},
+    {"$.store.book[?(@.price > $.nums[4] || @.author == \"x\")].price", "[8.95,12.99,8.99]"},
+    {"$.store.book[?@.price > $.store.bicycle.price]", "[]"},
+    {"$..[?@.category == 'reference'].price", "[8.95]"},
+    {"$['k~/']['a b']", "[true]"},
+    {"$.missing", "[]"},
+    {"$.nums[9]", "[]"},
+    {"$[", NULL},
+    {"store.book", NULL},
+    {"$.store.book[?length(@) > 1]", NULL},
+  };
+  int pathCount = (int)(sizeof(pathTests) / sizeof(pathTests[0]));
+  int pathFailures = 0;
+  for(int packed = 0; packed < 2; packed++){
+    struct AJContext ctx;
+    AJInitContext(&ctx);
+    ctx.PackNumericArrays = packed;
+    struct AJContext * previous = AJSetContext(&ctx);
+    int end = 0;
+    AJObject * store = ParseNewAJObject(0, "{\"store\":{\"book\":[{\"category\":\"reference\",\"author\":\"Nigel Rees\",\"title\":\"Sayings\",\"price\":8.95},"
+      "{\"category\":\"fiction\",\"author\":\"Evelyn Waugh\",\"title\":\"Sword\",\"price\":12.99},"
+      "{\"category\":\"fiction\",\"author\":\"Herman Melville\",\"title\":\"Moby Dick\",\"isbn\":\"0-553\",\"price\":8.99}],"
+      "\"bicycle\":{\"color\":\"red\",\"price\":399}},\"nums\":[1,2,3,4,5],\"k~/\":{\"a b\":true}}", &end);
+    struct AJPath * paths[sizeof(pathTests) / sizeof(pathTests[0])];
+    AJArray * batchMatches[sizeof(pathTests) / sizeof(pathTests[0])];
+    AJArray * singleMatches[sizeof(pathTests) / sizeof(pathTests[0])];
+    int compiled = 0;
+    for(int i = 0; i < pathCount; i++){
+      AJArray * matches = AJQuery((char *)pathTests[i].query, store, TYPE_OBJECT);
+      AJArray * expected = pathTests[i].expected != NULL ? ParseNewAJArray(0, (char *)pathTests[i].expected, &end) : NULL;
+      if(expected == NULL ? matches != NULL : matches == NULL || !AJEquals(matches, TYPE_ARRAY, expected, TYPE_ARRAY, 0)){
+        char * text = matches != NULL ? TestAJText(matches, TYPE_ARRAY) : NULL;
+        printf("path %d/%d %s: %s\n", i, packed, pathTests[i].query, text != NULL ? text : "didnt compile");
+        AJFree(text);
+        pathFailures++;
+      }
+      if(expected != NULL){DeleteAJArray(expected);}
+      if(matches != NULL){
+        paths[compiled] = CompileAJPath((char *)pathTests[i].query);
+        batchMatches[compiled] = CreateAJArray();
+        singleMatches[compiled++] = matches;
+      }
+    }
+    AJEvaluatePaths(paths, compiled, store, TYPE_OBJECT, TestCollectPathMatches, batchMatches);
+    for(int i = 0; i < compiled; i++){
+      if(!AJEquals(batchMatches[i], TYPE_ARRAY, singleMatches[i], TYPE_ARRAY, 0)){
+        printf("path %d/%d gave other matches in the batch\n", i, packed);
+        pathFailures++;
+      }
+      DeleteAJPath(paths[i]);
+      DeleteAJArray(batchMatches[i]);
+      DeleteAJArray(singleMatches[i]);
+    }
+    DeleteAJObject(store);
+    AJSetContext(previous);
+  }
+  printf("path tests: %d failed\n", pathFailures);
+  failures += pathFailures;
 
+  return failures != 0;
 }
 #endif